@@ -4,11 +4,13 @@ linux:QT += serialport
 CONFIG += c++11
 LFLAGS +=
 android:INCLUDEPATH += $$(HOME)/Android/android-build/include
+android:LIBS += -llog
 LIBS += -limbe_vocoder
 !win32:LIBS += -ldl
 win32:QT += serialport
 win32:INCLUDEPATH += /mnt/data/src/mxe/usr/include
 win32:LIBS += -L/mnt/data/src/mxe/usr/lib64
+win32:LIBS += -lwinmm
 win32:QMAKE_LFLAGS += -static
 QMAKE_LFLAGS_WINDOWS += --enable-stdcall-fixup
 RC_ICONS = images/droidstar.ico
@@ -34,7 +36,10 @@ SOURCES += \
         YSFConvolution.cpp \
         YSFFICH.cpp \
         androidserialport.cpp \
+        audiodsp.cpp \
         audioengine.cpp \
+        audiooutputdevice.cpp \
+        audioresampler.cpp \
         cbptc19696.cpp \
         cgolay2087.cpp \
         chamming.cpp \
@@ -50,16 +55,29 @@ SOURCES += \
         crs129.cpp \
         dcscodec.cpp \
         dmrcodec.cpp \
+        dmridindex.cpp \
         droidstar.cpp \
+        framecapture.cpp \
+        headlessaudio.cpp \
+        hostloader.cpp \
+        hostprober.cpp \
         httpmanager.cpp \
         iaxcodec.cpp \
+        jitterbuffer.cpp \
+        logger.cpp \
         m17codec.cpp \
+        mediascheduler.cpp \
         main.cpp \
         nxdncodec.cpp \
         p25codec.cpp \
         refcodec.cpp \
         serialambe.cpp \
         serialmodem.cpp \
+        streamstats.cpp \
+        viterbi.cpp \
+        vocoderloader.cpp \
+        vocoderpool.cpp \
+        vocoderstage.cpp \
         xrfcodec.cpp \
         ysfcodec.cpp
 macx:OBJECTIVE_SOURCES += micpermission.mm
@@ -110,7 +128,11 @@ HEADERS += \
 	YSFConvolution.h \
 	YSFFICH.h \
 	androidserialport.h \
+	audiodsp.h \
 	audioengine.h \
+	audiooutputdevice.h \
+	audioresampler.h \
+	audioringbuffer.h \
 	cbptc19696.h \
 	cgolay2087.h \
 	chamming.h \
@@ -121,22 +143,36 @@ HEADERS += \
 	codec2/kiss_fft.h \
 	codec2/lpc.h \
 	codec2/nlp.h \
+	codec2/profile.h \
 	codec2/qbase.h \
 	codec2/quantise.h \
 	crs129.h \
 	dcscodec.h \
 	dmrcodec.h \
+	dmridindex.h \
 	droidstar.h \
+	framecapture.h \
+	headlessaudio.h \
+	hostloader.h \
+	hostprober.h \
 	httpmanager.h \
+	jitterbuffer.h \
+	logger.h \
 	iaxcodec.h \
 	iaxdefines.h \
 	m17codec.h \
+	mediascheduler.h \
 	nxdncodec.h \
 	p25codec.h \
 	refcodec.h \
 	serialambe.h \
 	serialmodem.h \
+	streamstats.h \
+	viterbi.h \
 	vocoder_plugin.h \
+	vocoderloader.h \
+	vocoderpool.h \
+	vocoderstage.h \
 	xrfcodec.h \
 	ysfcodec.h
 macx:HEADERS += micpermission.h
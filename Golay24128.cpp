@@ -1130,6 +1130,69 @@ bool CGolay24128::decode24128(unsigned char* in, unsigned int& out)
 	return decode24128(code, out);
 }
 
+// Chase decoder for one (24,12) codeword given 24 soft values, MSB first,
+// positive for 1.  The hard decision is decoded with the 5 least reliable
+// bits flipped in every combination and the candidate codeword closest to
+// the received soft values wins.  Returns the 12 data bits and sets
+// corrected to the number of hard decisions that were changed.
+unsigned int CGolay24128::decode24128Soft(const signed char* llr, unsigned int& corrected)
+{
+	assert(llr != NULL);
+
+	const unsigned int CHASE_BITS = 5U;
+
+	unsigned int hard = 0U;
+	unsigned int rel[24U];
+	for (unsigned int i = 0U; i < 24U; i++) {
+		hard = (hard << 1) | (llr[i] > 0 ? 1U : 0U);
+		rel[23U - i] = (llr[i] < 0) ? -int(llr[i]) : llr[i];
+	}
+
+	// Bit positions of the least reliable values
+	unsigned int weak[CHASE_BITS];
+	unsigned int used = 0U;
+	for (unsigned int n = 0U; n < CHASE_BITS; n++) {
+		unsigned int best = 24U;
+		for (unsigned int i = 0U; i < 24U; i++) {
+			if (!(used & (1U << i)) && ((best == 24U) || (rel[i] < rel[best])))
+				best = i;
+		}
+		used |= 1U << best;
+		weak[n] = best;
+	}
+
+	unsigned int bestData = 0U;
+	unsigned int bestCost = 0xFFFFFFFFU;
+	unsigned int bestCode = hard;
+	for (unsigned int p = 0U; p < (1U << CHASE_BITS); p++) {
+		unsigned int test = hard;
+		for (unsigned int n = 0U; n < CHASE_BITS; n++) {
+			if (p & (1U << n))
+				test ^= 1U << weak[n];
+		}
+
+		unsigned int data = decode24128(test);
+		unsigned int code = encode24128(data);
+		unsigned int diff = code ^ hard;
+
+		unsigned int cost = 0U;
+		for (unsigned int i = 0U; diff != 0U; i++, diff >>= 1) {
+			if (diff & 1U)
+				cost += rel[i];
+		}
+
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestData = data;
+			bestCode = code;
+		}
+	}
+
+	corrected = countBits(bestCode ^ hard);
+
+	return bestData;
+}
+
 unsigned int CGolay24128::countBits(unsigned int v)
 {
 	unsigned int count = 0U;
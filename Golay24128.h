@@ -29,6 +29,7 @@ public:
 	static unsigned int decode24128(unsigned char* bytes);
 	static bool decode24128(unsigned int in, unsigned int& out);
 	static bool decode24128(unsigned char* in, unsigned int& out);
+	static unsigned int decode24128Soft(const signed char* llr, unsigned int& corrected);
 	static unsigned int countBits(unsigned int v);
 };
 
@@ -21,6 +21,8 @@ import QtQuick.Controls 2.3
 Item {
 	id: hostsTab
 	property alias hostsTextEdit: hostsTxtEdit
+	property alias probeButton: probeBtn
+	property alias probeList: probeListView
 	Rectangle{
 		id: hostsList
 		x: 20
@@ -31,8 +33,8 @@ Item {
 		Flickable{
 			anchors.fill: parent
 			contentWidth: parent.width
-			contentHeight: hostsTxtEdit.y +
-						   hostsTxtEdit.height
+			contentHeight: probeListView.y +
+						   probeListView.height
 			flickableDirection: Flickable.VerticalFlick
 			clip: true
 			Text {
@@ -61,6 +63,37 @@ Item {
 					droidstar.update_custom_hosts(hostsTxtEdit.text);
 				}
 			}
+			Button {
+				id: probeBtn
+				x: 0
+				y: hostsTxtEdit.y + hostsTxtEdit.height + 10
+				width: hostsList.width
+				text: qsTr("Probe hosts")
+				onClicked: {
+					probeBtn.enabled = false;
+					droidstar.probe_hosts();
+				}
+			}
+			ListView {
+				id: probeListView
+				x: 0
+				y: probeBtn.y + probeBtn.height + 5
+				width: hostsList.width
+				height: 500
+				clip: true
+				model: []
+				delegate: Text {
+					width: probeListView.width
+					height: 30
+					verticalAlignment: Text.AlignVCenter
+					color: (modelData.rtt < 0) ? "darkgrey" : "white"
+					text: modelData.name + "\t" + ((modelData.rtt < 0) ? qsTr("no reply") : (modelData.rtt + " ms, " + modelData.loss + "% loss"))
+					MouseArea {
+						anchors.fill: parent
+						onClicked: droidstar.select_host(modelData.name)
+					}
+				}
+			}
 		}
 	}
 }
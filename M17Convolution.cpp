@@ -17,6 +17,7 @@
  */
 
 #include "M17Convolution.h"
+#include "viterbi.h"
 
 #include <cstdio>
 #include <cassert>
@@ -47,7 +48,12 @@ const unsigned char BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U
 const uint8_t BRANCH_TABLE1[] = {0U, 0U, 0U, 0U, 2U, 2U, 2U, 2U};
 const uint8_t BRANCH_TABLE2[] = {0U, 2U, 2U, 0U, 0U, 2U, 2U, 0U};
 
-const unsigned int NUM_OF_STATES_D2 = 8U;
+// Soft symbols are 0 (certain 0) to 14 (certain 1), 7 is an erasure
+const uint8_t SOFT_BRANCH_TABLE1[] = {0U, 0U, 0U, 0U, 14U, 14U, 14U, 14U};
+const uint8_t SOFT_BRANCH_TABLE2[] = {0U, 14U, 14U, 0U, 0U, 14U, 14U, 0U};
+const uint8_t SOFT_ERASURE = 7U;
+const uint16_t M_SOFT = 28U;
+
 const unsigned int NUM_OF_STATES = 16U;
 const uint32_t     M = 4U;
 const unsigned int K = 5U;
@@ -143,14 +149,7 @@ unsigned int CM17Convolution::decodeLinkSetup(const unsigned char* in, unsigned
 	}
 
 	start();
-
-	n = 0U;
-	for (unsigned int i = 0U; i < 244U; i++) {
-		uint8_t s0 = temp[n++];
-		uint8_t s1 = temp[n++];
-
-		decode(s0, s1);
-	}
+	decode(temp, 244U);
 
 	return chainback(out, 240U) - PUNCTURE_LIST_LINK_SETUP_COUNT;
 }
@@ -176,57 +175,101 @@ unsigned int CM17Convolution::decodeData(const unsigned char* in, unsigned char*
 	}
 
 	start();
+	decode(temp, 148U);
 
-	n = 0U;
-	for (unsigned int i = 0U; i < 148U; i++) {
-		uint8_t s0 = temp[n++];
-		uint8_t s1 = temp[n++];
+	return chainback(out, 144U) - PUNCTURE_LIST_DATA_COUNT;
+}
 
-		decode(s0, s1);
-	}
+// Soft input versions of decodeLinkSetup() and decodeData().  llr[] holds one
+// value per received (punctured) bit, positive for 1 and negative for 0, with
+// the magnitude as the confidence.  Hard decisions can be passed as +/-127.
+// Returns the number of received bits the decoder corrected.
+unsigned int CM17Convolution::decodeLinkSetupSoft(const int8_t* llr, unsigned char* out)
+{
+	assert(llr != NULL);
+	assert(out != NULL);
 
-	return chainback(out, 144U) - PUNCTURE_LIST_DATA_COUNT;
+	return decodeSoft(llr, PUNCTURE_LIST_LINK_SETUP, 368U, 244U, out, 240U);
 }
 
-void CM17Convolution::start()
+unsigned int CM17Convolution::decodeDataSoft(const int8_t* llr, unsigned char* out)
 {
-	::memset(m_metrics1, 0x00U, NUM_OF_STATES * sizeof(uint16_t));
-	::memset(m_metrics2, 0x00U, NUM_OF_STATES * sizeof(uint16_t));
+	assert(llr != NULL);
+	assert(out != NULL);
 
-	m_oldMetrics = m_metrics1;
-	m_newMetrics = m_metrics2;
-	m_dp = m_decisions;
+	return decodeSoft(llr, PUNCTURE_LIST_DATA, 272U, 148U, out, 144U);
 }
 
-void CM17Convolution::decode(uint8_t s0, uint8_t s1)
+unsigned int CM17Convolution::decodeSoft(const int8_t* llr, const unsigned int* puncture, unsigned int nIn, unsigned int nSymbols, unsigned char* out, unsigned int nBits)
 {
-  *m_dp = 0U;
+	uint8_t temp[500U];
+	bool erased[500U];
+	::memset(temp, SOFT_ERASURE, 500U);
+	::memset(erased, 0x00U, sizeof(erased));
 
-  for (uint8_t i = 0U; i < NUM_OF_STATES_D2; i++) {
-    uint8_t j = i * 2U;
+	// Depuncture, punctured bits become erasures
+	unsigned int n = 0U;
+	unsigned int index = 0U;
+	for (unsigned int i = 0U; i < nIn; i++) {
+		if (n == puncture[index]) {
+			erased[n++] = true;
+			index++;
+		}
 
-    uint16_t metric = std::abs(BRANCH_TABLE1[i] - s0) + std::abs(BRANCH_TABLE2[i] - s1);
+		int v = (int(llr[i]) * 7 + (llr[i] >= 0 ? 63 : -63)) / 127;
+		if (v > 7)
+			v = 7;
+		else if (v < -7)
+			v = -7;
+		temp[n++] = uint8_t(SOFT_ERASURE + v);
+	}
 
-    uint16_t m0 = m_oldMetrics[i] + metric;
-    uint16_t m1 = m_oldMetrics[i + NUM_OF_STATES_D2] + (M - metric);
-    uint8_t decision0 = (m0 >= m1) ? 1U : 0U;
-    m_newMetrics[j + 0U] = decision0 != 0U ? m1 : m0;
+	start();
+	viterbi_acs16(m_oldMetrics, m_dp, temp, nSymbols, SOFT_BRANCH_TABLE1, SOFT_BRANCH_TABLE2, M_SOFT);
+	m_dp += nSymbols;
+
+	::memset(out, 0x00U, (nBits + 7U) / 8U);
+	chainback(out, nBits);
+
+	// Re-encode the decoded bits (plus the zero tail) and count how many of
+	// the received hard decisions differ
+	unsigned char data[31U];
+	unsigned char coded[62U];
+	::memset(data, 0x00U, sizeof(data));
+	::memcpy(data, out, (nBits + 7U) / 8U);
+	encode(data, coded, nSymbols);
+
+	unsigned int corrected = 0U;
+	for (unsigned int i = 0U; i < nSymbols * 2U; i++) {
+		if (erased[i])
+			continue;
+		bool rx = temp[i] > SOFT_ERASURE;
+		bool tx = READ_BIT1(coded, i) != 0U;
+		if (rx != tx)
+			corrected++;
+	}
 
-    m0 = m_oldMetrics[i] + (M - metric);
-    m1 = m_oldMetrics[i + NUM_OF_STATES_D2] + metric;
-    uint8_t decision1 = (m0 >= m1) ? 1U : 0U;
-    m_newMetrics[j + 1U] = decision1 != 0U ? m1 : m0;
+	return corrected;
+}
 
-    *m_dp |= (uint64_t(decision1) << (j + 1U)) | (uint64_t(decision0) << (j + 0U));
-  }
+void CM17Convolution::start()
+{
+	::memset(m_metrics1, 0x00U, NUM_OF_STATES * sizeof(uint16_t));
+	::memset(m_metrics2, 0x00U, NUM_OF_STATES * sizeof(uint16_t));
 
-  ++m_dp;
+	m_oldMetrics = m_metrics1;
+	m_newMetrics = m_metrics2;
+	m_dp = m_decisions;
+}
 
-  assert((m_dp - m_decisions) <= 300);
+// Decodes n depunctured symbol pairs from sym[0..2n-1] in one pass
+void CM17Convolution::decode(const uint8_t* sym, unsigned int n)
+{
+	assert(sym != NULL);
+	assert((m_dp - m_decisions) + n <= 300);
 
-  uint16_t* tmp = m_oldMetrics;
-  m_oldMetrics = m_newMetrics;
-  m_newMetrics = tmp;
+	viterbi_acs16(m_oldMetrics, m_dp, sym, n, BRANCH_TABLE1, BRANCH_TABLE2, M);
+	m_dp += n;
 }
 
 unsigned int CM17Convolution::chainback(unsigned char* out, unsigned int nBits)
@@ -29,6 +29,9 @@ public:
 	unsigned int decodeLinkSetup(const unsigned char* in, unsigned char* out);
 	unsigned int decodeData(const unsigned char* in, unsigned char* out);
 
+	unsigned int decodeLinkSetupSoft(const int8_t* llr, unsigned char* out);
+	unsigned int decodeDataSoft(const int8_t* llr, unsigned char* out);
+
 	void encodeLinkSetup(const unsigned char* in, unsigned char* out) const;
 	void encodeData(const unsigned char* in, unsigned char* out) const;
 
@@ -41,9 +44,10 @@ private:
 	uint64_t* m_dp;
 
 	void start();
-	void decode(uint8_t s0, uint8_t s1);
+	void decode(const uint8_t* sym, unsigned int n);
 
 	unsigned int chainback(unsigned char* out, unsigned int nBits);
+	unsigned int decodeSoft(const int8_t* llr, const unsigned int* puncture, unsigned int nIn, unsigned int nSymbols, unsigned char* out, unsigned int nBits);
 
 	void encode(const unsigned char* in, unsigned char* out, unsigned int nBits) const;
 };
@@ -33,6 +33,7 @@ Item {
 	property alias label5: _label5
 	property alias label6: _label6
 	property alias status: _status
+	property alias stats: _stats
 	property alias levelMeter: _levelMeter
 	property alias uitimer: _uitimer
 	property alias comboMode: _comboMode
@@ -180,6 +181,17 @@ Item {
 		color: "white"
 		font.pixelSize: parent.height / 35;
 	}
+	Text {
+		id: _stats
+		x: 10
+		y: (parent.height / 15 + 3) * 10 + parent.height / 30;
+		width: parent.width - 20
+		height: parent.height / 30;
+		text: qsTr("")
+		color: "white"
+		elide: Text.ElideRight
+		font.pixelSize: parent.height / 45;
+	}
 	Rectangle {
 		x: 10
 		y: (parent.height / 15 + 3) * 11;
@@ -422,6 +434,7 @@ Item {
 			droidstar.set_iaxhost(settingsTab.iaxhostEdit.text);
 			droidstar.set_iaxport(settingsTab.iaxportEdit.text);
 			droidstar.set_txtimeout(settingsTab.txtimerEdit.text);
+			droidstar.set_jitter_target(settingsTab.jitterEdit.text);
 			//droidstar.set_toggletx(toggleTX.checked);
 			droidstar.set_xrf2ref(settingsTab.xrf2ref.checked);
 			droidstar.set_ipv6(settingsTab.ipv6.checked);
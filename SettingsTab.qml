@@ -46,6 +46,7 @@ Item {
 	property alias rptr1Edit: rptr1edit
 	property alias rptr2Edit: rptr2edit
 	property alias txtimerEdit: txtimeredit
+	property alias jitterEdit: jitteredit
 	property alias toggleTX: toggletx
 	property alias xrf2ref: xrf2Ref
 	property alias ipv6: ipV6
@@ -614,10 +615,28 @@ Item {
 			height: 25
 			selectByMouse: true
 		}
+		Text {
+			id: jitterLabel
+			x: 10
+			y: 850
+			width: 80
+			height: 25
+			text: qsTr("Jitter (ms)")
+			color: "white"
+			verticalAlignment: Text.AlignVCenter
+		}
+		TextField {
+			id: jitteredit
+			x: 100
+			y: 850
+			width: 125
+			height: 25
+			selectByMouse: true
+		}
 		CheckBox {
 			id: toggletx
 			x: 10
-			y: 850
+			y: 880
 			//width: 100
 			height: 25
 			spacing: 1
@@ -629,7 +648,7 @@ Item {
 		CheckBox {
 			id: xrf2Ref
 			x: 10
-			y: 880
+			y: 910
 			//width: 100
 			height: 25
 			spacing: 1
@@ -638,7 +657,7 @@ Item {
 		CheckBox {
 			id: ipV6
 			x: 10
-			y: 910
+			y: 940
 			//width: 100
 			height: 25
 			spacing: 1
@@ -647,7 +666,7 @@ Item {
 		Text {
 			id: vocoderLabel
 			x: 10
-			y: 940
+			y: 970
 			width: 80
 			height: 25
 			text: qsTr("Vocoder")
@@ -657,14 +676,14 @@ Item {
 		ComboBox {
 			id: _comboVocoder
 			x: 100
-			y: 940
+			y: 970
 			width: parent.width - 110
 			height: 30
 		}
 		Text {
 			id: modemLabel
 			x: 10
-			y: 970
+			y: 1000
 			width: 80
 			height: 25
 			text: qsTr("Modem")
@@ -674,14 +693,14 @@ Item {
 		ComboBox {
 			id: _comboModem
 			x: 100
-			y: 970
+			y: 1000
 			width: parent.width - 110
 			height: 30
 		}
 		Text {
 			id: playbackLabel
 			x: 10
-			y: 1000
+			y: 1030
 			width: 80
 			height: 25
 			text: qsTr("Playback")
@@ -691,14 +710,14 @@ Item {
 		ComboBox {
 			id: _comboPlayback
 			x: 100
-			y: 1000
+			y: 1030
 			width: parent.width - 110
 			height: 30
 		}
 		Text {
 			id: captureLabel
 			x: 10
-			y: 1030
+			y: 1060
 			width: 80
 			height: 25
 			text: qsTr("Capture")
@@ -708,14 +727,14 @@ Item {
 		ComboBox {
 			id: _comboCapture
 			x: 100
-			y: 1030
+			y: 1060
 			width: parent.width - 110
 			height: 30
 		}
 		Text {
 			id: _modemRXFreqLabel
 			x: 10
-			y: 1070
+			y: 1100
 			width: 80
 			height: 25
 			text: qsTr("RX Freq")
@@ -725,7 +744,7 @@ Item {
 		TextField {
 			id: _modemRXFreqEdit
 			x: 100
-			y: 1070
+			y: 1100
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -734,7 +753,7 @@ Item {
 		Text {
 			id: _modemTXFreqLabel
 			x: 10
-			y: 1100
+			y: 1130
 			width: 80
 			height: 25
 			text: qsTr("TX Freq")
@@ -744,7 +763,7 @@ Item {
 		TextField {
 			id: _modemTXFreqEdit
 			x: 100
-			y: 1100
+			y: 1130
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -753,7 +772,7 @@ Item {
 		Text {
 			id: _modemRXOffsetLabel
 			x: 10
-			y: 1130
+			y: 1160
 			width: 80
 			height: 25
 			text: qsTr("RX Offset")
@@ -763,7 +782,7 @@ Item {
 		TextField {
 			id: _modemRXOffsetEdit
 			x: 100
-			y: 1130
+			y: 1160
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -772,7 +791,7 @@ Item {
 		Text {
 			id: _modemTXOffsetLabel
 			x: 10
-			y: 1160
+			y: 1190
 			width: 80
 			height: 25
 			text: qsTr("TX Offset")
@@ -782,7 +801,7 @@ Item {
 		TextField {
 			id: _modemTXOffsetEdit
 			x: 100
-			y: 1160
+			y: 1190
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -791,7 +810,7 @@ Item {
 		Text {
 			id: _modemRXLevelLabel
 			x: 10
-			y: 1190
+			y: 1220
 			width: 80
 			height: 25
 			text: qsTr("RX Level")
@@ -801,7 +820,7 @@ Item {
 		TextField {
 			id: _modemRXLevelEdit
 			x: 100
-			y: 1190
+			y: 1220
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -810,7 +829,7 @@ Item {
 		Text {
 			id: _modemTXLevelLabel
 			x: 10
-			y: 1220
+			y: 1250
 			width: 80
 			height: 25
 			text: qsTr("TX Level")
@@ -820,7 +839,7 @@ Item {
 		TextField {
 			id: _modemTXLevelEdit
 			x: 100
-			y: 1220
+			y: 1250
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -829,7 +848,7 @@ Item {
 		Text {
 			id: _modemRXDCOffsetLabel
 			x: 10
-			y: 1250
+			y: 1280
 			width: 80
 			height: 25
 			text: qsTr("RX DC Offset")
@@ -839,7 +858,7 @@ Item {
 		TextField {
 			id: _modemRXDCOffsetEdit
 			x: 100
-			y: 1250
+			y: 1280
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -848,7 +867,7 @@ Item {
 		Text {
 			id: _modemTXDCOffsetLabel
 			x: 10
-			y: 1280
+			y: 1310
 			width: 80
 			height: 25
 			text: qsTr("TX DC Offset")
@@ -858,7 +877,7 @@ Item {
 		TextField {
 			id: _modemTXDCOffsetEdit
 			x: 100
-			y: 1280
+			y: 1310
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -867,7 +886,7 @@ Item {
 		Text {
 			id: _modemRFLevelLabel
 			x: 10
-			y: 1310
+			y: 1340
 			width: 80
 			height: 25
 			text: qsTr("RF Level")
@@ -877,7 +896,7 @@ Item {
 		TextField {
 			id: _modemRFLevelEdit
 			x: 100
-			y: 1310
+			y: 1340
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -886,7 +905,7 @@ Item {
 		Text {
 			id: _modemTXDelayLabel
 			x: 10
-			y: 1340
+			y: 1370
 			width: 80
 			height: 25
 			text: qsTr("TX Delay")
@@ -896,7 +915,7 @@ Item {
 		TextField {
 			id: _modemTXDelayEdit
 			x: 100
-			y: 1340
+			y: 1370
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -905,7 +924,7 @@ Item {
 		Text {
 			id: _modemCWIdTXLevelLabel
 			x: 10
-			y: 1370
+			y: 1400
 			width: 80
 			height: 25
 			text: qsTr("CWIdTXLevel")
@@ -915,7 +934,7 @@ Item {
 		TextField {
 			id: _modemCWIdTXLevelEdit
 			x: 100
-			y: 1370
+			y: 1400
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -924,7 +943,7 @@ Item {
 		Text {
 			id: _modemDStarTXLevelLabel
 			x: 10
-			y: 1400
+			y: 1430
 			width: 80
 			height: 25
 			text: qsTr("DStarTXLevel")
@@ -934,7 +953,7 @@ Item {
 		TextField {
 			id: _modemDStarTXLevelEdit
 			x: 100
-			y: 1400
+			y: 1430
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -943,7 +962,7 @@ Item {
 		Text {
 			id: _modemDMRTXLevelLabel
 			x: 10
-			y: 1430
+			y: 1460
 			width: 80
 			height: 25
 			text: qsTr("DMRTXLevel")
@@ -953,7 +972,7 @@ Item {
 		TextField {
 			id: _modemDMRTXLevelEdit
 			x: 100
-			y: 1430
+			y: 1460
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -962,7 +981,7 @@ Item {
 		Text {
 			id: _modemYSFTXLevelLabel
 			x: 10
-			y: 1460
+			y: 1490
 			width: 80
 			height: 25
 			text: qsTr("YSFTXLevel")
@@ -972,7 +991,7 @@ Item {
 		TextField {
 			id: _modemYSFTXLevelEdit
 			x: 100
-			y: 1460
+			y: 1490
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -981,7 +1000,7 @@ Item {
 		Text {
 			id: _modemP25TXLevelLabel
 			x: 10
-			y: 1490
+			y: 1520
 			width: 80
 			height: 25
 			text: qsTr("P25TXLevel")
@@ -991,7 +1010,7 @@ Item {
 		TextField {
 			id: _modemP25TXLevelEdit
 			x: 100
-			y: 1490
+			y: 1520
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -1000,7 +1019,7 @@ Item {
 		Text {
 			id: _modemNXDNTXLevelLabel
 			x: 10
-			y: 1520
+			y: 1550
 			width: 80
 			height: 25
 			text: qsTr("NXDNTXLevel")
@@ -1010,7 +1029,7 @@ Item {
 		TextField {
 			id: _modemNXDNTXLevelEdit
 			x: 100
-			y: 1520
+			y: 1550
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -1019,7 +1038,7 @@ Item {
 		Text {
 			id: _vocoderURLlabel
 			x: 10
-			y: 1550
+			y: 1580
 			width: 80
 			height: 25
 			text: qsTr("Vocoder URL")
@@ -1029,7 +1048,7 @@ Item {
 		TextField {
 			id: _vocoderURLEdit
 			x: 100
-			y: 1550
+			y: 1580
 			width: parent.width - 110
 			height: 25
 			selectByMouse: true
@@ -1037,7 +1056,7 @@ Item {
 		Button {
 			id: vocoderButton
 			x: 10
-			y: 1580
+			y: 1610
 			width: 150
 			height: 30
 			text: qsTr("Download vocoder")
@@ -17,6 +17,7 @@
  */
 
 #include "YSFConvolution.h"
+#include "viterbi.h"
 
 #include <cstdio>
 #include <cassert>
@@ -30,7 +31,6 @@ const unsigned char BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U
 const uint8_t BRANCH_TABLE1[] = {0U, 0U, 0U, 0U, 1U, 1U, 1U, 1U};
 const uint8_t BRANCH_TABLE2[] = {0U, 1U, 1U, 0U, 0U, 1U, 1U, 0U};
 
-const unsigned int NUM_OF_STATES_D2 = 8U;
 const unsigned int NUM_OF_STATES = 16U;
 const uint32_t     M = 2U;
 const unsigned int K = 5U;
@@ -67,33 +67,19 @@ void CYSFConvolution::start()
 
 void CYSFConvolution::decode(uint8_t s0, uint8_t s1)
 {
-  *m_dp = 0U;
+	const uint8_t sym[2U] = {s0, s1};
 
-  for (uint8_t i = 0U; i < NUM_OF_STATES_D2; i++) {
-    uint8_t j = i * 2U;
-
-    uint16_t metric = (BRANCH_TABLE1[i] ^ s0) + (BRANCH_TABLE2[i] ^ s1);
-
-    uint16_t m0 = m_oldMetrics[i] + metric;
-    uint16_t m1 = m_oldMetrics[i + NUM_OF_STATES_D2] + (M - metric);
-    uint8_t decision0 = (m0 >= m1) ? 1U : 0U;
-    m_newMetrics[j + 0U] = decision0 != 0U ? m1 : m0;
-
-    m0 = m_oldMetrics[i] + (M - metric);
-    m1 = m_oldMetrics[i + NUM_OF_STATES_D2] + metric;
-    uint8_t decision1 = (m0 >= m1) ? 1U : 0U;
-    m_newMetrics[j + 1U] = decision1 != 0U ? m1 : m0;
-
-    *m_dp |= (uint64_t(decision1) << (j + 1U)) | (uint64_t(decision0) << (j + 0U));
-  }
-
-  ++m_dp;
+	decode(sym, 1U);
+}
 
-  assert((m_dp - m_decisions) <= 180);
+// Decodes n symbol pairs from sym[0..2n-1] in one pass
+void CYSFConvolution::decode(const uint8_t* sym, unsigned int n)
+{
+	assert(sym != NULL);
+	assert((m_dp - m_decisions) + n <= 180);
 
-  uint16_t* tmp = m_oldMetrics;
-  m_oldMetrics = m_newMetrics;
-  m_newMetrics = tmp;
+	viterbi_acs16(m_oldMetrics, m_dp, sym, n, BRANCH_TABLE1, BRANCH_TABLE2, M);
+	m_dp += n;
 }
 
 void CYSFConvolution::chainback(unsigned char* out, unsigned int nBits)
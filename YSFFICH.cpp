@@ -82,15 +82,15 @@ bool CYSFFICH::decode(const unsigned char* bytes)
 	viterbi.start();
 
 	// Deinterleave the FICH and send bits to the Viterbi decoder
+	uint8_t sym[200U];
 	for (unsigned int i = 0U; i < 100U; i++) {
 		unsigned int n = INTERLEAVE_TABLE[i];
-		uint8_t s0 = READ_BIT1(bytes, n) ? 1U : 0U;
+		sym[2U * i + 0U] = READ_BIT1(bytes, n) ? 1U : 0U;
 
 		n++;
-		uint8_t s1 = READ_BIT1(bytes, n) ? 1U : 0U;
-
-		viterbi.decode(s0, s1);
+		sym[2U * i + 1U] = READ_BIT1(bytes, n) ? 1U : 0U;
 	}
+	viterbi.decode(sym, 100U);
 
 	unsigned char output[13U];
 	viterbi.chainback(output, 96U);
@@ -0,0 +1,133 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "audiodsp.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIODSP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIODSP_NEON 1
+#endif
+
+int audiodsp_peak(const int16_t *pcm, size_t s)
+{
+	size_t i = 0;
+	int hi = 0;
+	int lo = 0;
+#if defined(AUDIODSP_SSE2)
+	__m128i vmax = _mm_setzero_si128();
+	__m128i vmin = _mm_setzero_si128();
+	for(; i + 8 <= s; i += 8){
+		__m128i x = _mm_loadu_si128((const __m128i *)(pcm + i));
+		vmax = _mm_max_epi16(vmax, x);
+		vmin = _mm_min_epi16(vmin, x);
+	}
+	int16_t tmax[8], tmin[8];
+	_mm_storeu_si128((__m128i *)tmax, vmax);
+	_mm_storeu_si128((__m128i *)tmin, vmin);
+	for(int j = 0; j < 8; ++j){
+		if(tmax[j] > hi) hi = tmax[j];
+		if(tmin[j] < lo) lo = tmin[j];
+	}
+#elif defined(AUDIODSP_NEON)
+	int16x8_t vmax = vdupq_n_s16(0);
+	int16x8_t vmin = vdupq_n_s16(0);
+	for(; i + 8 <= s; i += 8){
+		int16x8_t x = vld1q_s16(pcm + i);
+		vmax = vmaxq_s16(vmax, x);
+		vmin = vminq_s16(vmin, x);
+	}
+	int16_t tmax[8], tmin[8];
+	vst1q_s16(tmax, vmax);
+	vst1q_s16(tmin, vmin);
+	for(int j = 0; j < 8; ++j){
+		if(tmax[j] > hi) hi = tmax[j];
+		if(tmin[j] < lo) lo = tmin[j];
+	}
+#endif
+	for(; i < s; ++i){
+		if(pcm[i] > hi) hi = pcm[i];
+		if(pcm[i] < lo) lo = pcm[i];
+	}
+	return (-lo > hi) ? -lo : hi;
+}
+
+void audiodsp_gain(int16_t *pcm, size_t s, float gain, float delta, float volume, float limit)
+{
+	size_t i = 0;
+#if defined(AUDIODSP_SSE2)
+	const __m128 vdelta = _mm_set1_ps(delta);
+	const __m128 vgain = _mm_set1_ps(gain);
+	const __m128 vvol = _mm_set1_ps(volume);
+	const __m128 vhi = _mm_set1_ps(limit);
+	const __m128 vlo = _mm_set1_ps(-limit);
+	const __m128 vfour = _mm_set1_ps(4.0f);
+	__m128 idx0 = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	for(; i + 8 <= s; i += 8){
+		__m128i x = _mm_loadu_si128((const __m128i *)(pcm + i));
+		__m128i sign = _mm_srai_epi16(x, 15);
+		__m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign));
+		__m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign));
+		__m128 idx1 = _mm_add_ps(idx0, vfour);
+		__m128 g0 = _mm_add_ps(vgain, _mm_mul_ps(idx0, vdelta));
+		__m128 g1 = _mm_add_ps(vgain, _mm_mul_ps(idx1, vdelta));
+		f0 = _mm_mul_ps(_mm_mul_ps(g0, f0), vvol);
+		f1 = _mm_mul_ps(_mm_mul_ps(g1, f1), vvol);
+		f0 = _mm_max_ps(_mm_min_ps(f0, vhi), vlo);
+		f1 = _mm_max_ps(_mm_min_ps(f1, vhi), vlo);
+		__m128i r = _mm_packs_epi32(_mm_cvttps_epi32(f0), _mm_cvttps_epi32(f1));
+		_mm_storeu_si128((__m128i *)(pcm + i), r);
+		idx0 = _mm_add_ps(idx1, vfour);
+	}
+#elif defined(AUDIODSP_NEON)
+	const float32x4_t vdelta = vdupq_n_f32(delta);
+	const float32x4_t vgain = vdupq_n_f32(gain);
+	const float32x4_t vvol = vdupq_n_f32(volume);
+	const float32x4_t vhi = vdupq_n_f32(limit);
+	const float32x4_t vlo = vdupq_n_f32(-limit);
+	const float32x4_t vfour = vdupq_n_f32(4.0f);
+	const float init[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	float32x4_t idx0 = vld1q_f32(init);
+	for(; i + 8 <= s; i += 8){
+		int16x8_t x = vld1q_s16(pcm + i);
+		float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+		float32x4_t f1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+		float32x4_t idx1 = vaddq_f32(idx0, vfour);
+		float32x4_t g0 = vaddq_f32(vgain, vmulq_f32(idx0, vdelta));
+		float32x4_t g1 = vaddq_f32(vgain, vmulq_f32(idx1, vdelta));
+		f0 = vmulq_f32(vmulq_f32(g0, f0), vvol);
+		f1 = vmulq_f32(vmulq_f32(g1, f1), vvol);
+		f0 = vmaxq_f32(vminq_f32(f0, vhi), vlo);
+		f1 = vmaxq_f32(vminq_f32(f1, vhi), vlo);
+		int16x8_t r = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(f0)), vqmovn_s32(vcvtq_s32_f32(f1)));
+		vst1q_s16(pcm + i, r);
+		idx0 = vaddq_f32(idx1, vfour);
+	}
+#endif
+	for(; i < s; ++i){
+		float f = (gain + (static_cast<float>(i) * delta)) * static_cast<float>(pcm[i]) * volume;
+		if(f > limit){
+			f = limit;
+		}
+		else if(f < -limit){
+			f = -limit;
+		}
+		pcm[i] = static_cast<int16_t>(f);
+	}
+}
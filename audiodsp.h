@@ -0,0 +1,33 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIODSP_H
+#define AUDIODSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Block kernels for the AGC in AudioEngine::process_audio(), vectorized
+// with SSE2 or NEON when available.  Any block size is accepted.
+
+// Peak absolute sample value of the block
+int audiodsp_peak(const int16_t *pcm, size_t s);
+
+// pcm[i] = clamp((gain + i * delta) * pcm[i] * volume, +/-limit)
+void audiodsp_gain(int16_t *pcm, size_t s, float gain, float delta, float volume, float limit);
+
+#endif // AUDIODSP_H
@@ -16,6 +16,8 @@
 */
 
 #include "audioengine.h"
+#include "headlessaudio.h"
+#include "audiodsp.h"
 #include <QDebug>
 #include <cmath>
 
@@ -31,9 +33,17 @@ AudioEngine::AudioEngine(QString in, QString out) :
 	m_inputdevice(in),
 	m_out(nullptr),
 	m_in(nullptr),
-	m_srm(1)
+	m_outbuf(nullptr),
+	m_outrate(8000),
+	m_headless_in(nullptr),
+	m_headless_out(nullptr),
+	m_headlesstimer(nullptr),
+	m_audioinq(8192),
+	m_inresampler(nullptr),
+	m_outresampler(nullptr),
+	m_inchannels(1),
+	m_outchannels(1)
 {
-	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
 	memset(m_aout_max_buf, 0, sizeof(float) * 200);
 	m_aout_max_buf_p = m_aout_max_buf;
 	m_aout_max_buf_idx = 0;
@@ -43,9 +53,12 @@ AudioEngine::AudioEngine(QString in, QString out) :
 
 AudioEngine::~AudioEngine()
 {
+	delete m_inresampler;
+	delete m_outresampler;
+	delete m_headless_in;
+	delete m_headless_out;
 	//m_indev->disconnect();
 	//m_in->stop();
-	//m_outdev->disconnect();
 	//m_out->stop();
 	//delete m_in;
 	//delete m_out;
@@ -64,6 +77,35 @@ QStringList AudioEngine::discover_audio_devices(uint8_t d)
 	return list;
 }
 
+// Find a 16 bit signed format the device handles natively, preferring 8 kHz
+// mono and otherwise the device's preferred rate and channel count.  Any rate
+// other than 8 kHz is handled by AudioResampler instead of the backend.
+QAudioFormat AudioEngine::native_format(const QAudioDeviceInfo &info, const QAudioFormat &format)
+{
+	if(info.isFormatSupported(format)){
+		return format;
+	}
+
+	QAudioFormat f = format;
+	QAudioFormat pref = info.preferredFormat();
+	f.setSampleRate(pref.sampleRate());
+	if(info.isFormatSupported(f)){
+		return f;
+	}
+	f.setChannelCount(pref.channelCount());
+	if(info.isFormatSupported(f)){
+		return f;
+	}
+
+	qWarning() << "Raw audio format not supported by backend, trying nearest format.";
+	f = info.nearestFormat(f);
+	if((f.sampleSize() != 16) || (f.sampleType() != QAudioFormat::SignedInt)){
+		qWarning() << "Nearest format is not 16 bit signed, audio will be distorted";
+	}
+	qWarning() << "Format now set to " << f.sampleRate() << ":" << f.sampleSize() << ":" << f.channelCount();
+	return f;
+}
+
 void AudioEngine::init()
 {
 	QAudioFormat format;
@@ -79,7 +121,11 @@ void AudioEngine::init()
 
 	QList<QAudioDeviceInfo> devices = QAudioDeviceInfo::availableDevices(QAudio::AudioOutput);
 
-	if(devices.size() == 0){
+	if(HeadlessAudio::is_headless(m_outputdevice)){
+		m_headless_out = new HeadlessAudio(m_outputdevice, AUDIO_OUT);
+		m_headless_out->open();
+	}
+	else if(devices.size() == 0){
 		fprintf(stderr, "No audio playback hardware found\n");fflush(stderr);
 	}
 	else{
@@ -99,25 +145,30 @@ void AudioEngine::init()
 				info = *it;
 			}
 		}
-		if (!info.isFormatSupported(format)) {
-			qWarning() << "Raw audio format not supported by backend, trying nearest format.";
-			tempformat = info.nearestFormat(format);
-			qWarning() << "Format now set to " << format.sampleRate() << ":" << format.sampleSize();
-		}
-		else{
-			tempformat = format;
-		}
-		fprintf(stderr, "Using playback device %s\n", info.deviceName().toStdString().c_str());fflush(stderr);
+		tempformat = native_format(info, format);
+		fprintf(stderr, "Using playback device %s SR: %d CH: %d\n", info.deviceName().toStdString().c_str(), tempformat.sampleRate(), tempformat.channelCount());fflush(stderr);
 
+		m_outchannels = tempformat.channelCount();
+		if(tempformat.sampleRate() != 8000){
+			m_outresampler = new AudioResampler(8000, tempformat.sampleRate());
+		}
+		m_outrate = tempformat.sampleRate();
 		m_out = new QAudioOutput(info, tempformat, this);
-		m_out->setBufferSize(19200);
+		set_output_buffer_size(1600);
+		m_outbuf = new AudioOutputDevice((m_outrate * m_outchannels) / 2, this);
+		m_outbuf->open(QIODevice::ReadOnly);
 		connect(m_out, SIGNAL(stateChanged(QAudio::State)), this, SLOT(handleStateChanged(QAudio::State)));
-		//m_outdev = m_out->start();
 	}
 
 	devices = QAudioDeviceInfo::availableDevices(QAudio::AudioInput);
 
-	if(devices.size() == 0){
+	if(HeadlessAudio::is_headless(m_inputdevice)){
+		m_headless_in = new HeadlessAudio(m_inputdevice, AUDIO_IN);
+		m_headless_in->open();
+		m_headlesstimer = new QTimer(this);
+		connect(m_headlesstimer, SIGNAL(timeout()), this, SLOT(headless_data_received()));
+	}
+	else if(devices.size() == 0){
 		fprintf(stderr, "No audio recording hardware found\n");fflush(stderr);
 	}
 	else{
@@ -137,33 +188,30 @@ void AudioEngine::init()
 				info = *it;
 			}
 		}
-		if (!info.isFormatSupported(format)) {
-			qWarning() << "Raw audio format not supported by backend, trying nearest format.";
-			tempformat = info.nearestFormat(format);
-			qWarning() << "Format now set to " << format.sampleRate() << ":" << format.sampleSize();
-		}
-		else{
-			tempformat = format;
+		tempformat = native_format(info, format);
+		m_inchannels = tempformat.channelCount();
+		if(tempformat.sampleRate() != 8000){
+			m_inresampler = new AudioResampler(tempformat.sampleRate(), 8000);
 		}
-
-		int sr = 8000;
-		if(MACHAK){
-			sr = info.preferredFormat().sampleRate();
-			m_srm = (float)sr / 8000.0;
-		}
-		format.setSampleRate(sr);
-		m_in = new QAudioInput(info, format, this);
-		fprintf(stderr, "Capture device: %s SR: %d resample factor: %f\n", info.deviceName().toStdString().c_str(), sr, m_srm);fflush(stderr);
+		m_in = new QAudioInput(info, tempformat, this);
+		fprintf(stderr, "Capture device: %s SR: %d CH: %d\n", info.deviceName().toStdString().c_str(), tempformat.sampleRate(), tempformat.channelCount());fflush(stderr);
 	}
 }
 
 void AudioEngine::start_capture()
 {
 	m_audioinq.clear();
+	if(m_inresampler){
+		m_inresampler->reset();
+	}
+	m_audioinq.reset_stats();
 	if(m_in != nullptr){
 		m_indev = m_in->start();
 		connect(m_indev, SIGNAL(readyRead()), SLOT(input_data_received()));
 	}
+	else if((m_headlesstimer != nullptr) && !capture_fast()){
+		m_headlesstimer->start(20);
+	}
 }
 
 void AudioEngine::stop_capture()
@@ -172,48 +220,119 @@ void AudioEngine::stop_capture()
 		m_indev->disconnect();
 		m_in->stop();
 	}
+	else if(m_headlesstimer != nullptr){
+		m_headlesstimer->stop();
+	}
+	if(m_audioinq.overflows()){
+		fprintf(stderr, "Capture ring buffer overflows: %u\n", m_audioinq.overflows());fflush(stderr);
+	}
 }
 
 void AudioEngine::start_playback()
 {
+	if(m_out == nullptr){
+		return;
+	}
 	//m_out->reset();
-	m_outdev = m_out->start();
+	m_outbuf->clear();
+	m_out->start(m_outbuf);
 }
 
 void AudioEngine::stop_playback()
 {
+	if(m_out == nullptr){
+		return;
+	}
 	m_out->stop();
+	if(m_outbuf->underruns() || m_outbuf->overflows()){
+		fprintf(stderr, "Playback underruns: %u overflows: %u\n", m_outbuf->underruns(), m_outbuf->overflows());fflush(stderr);
+	}
+}
+
+// Decoder to speaker latency in ms: audio queued in the pull buffer plus
+// audio already handed to the device.
+int AudioEngine::output_latency()
+{
+	if((m_out == nullptr) || (m_outbuf == nullptr)){
+		return 0;
+	}
+	const int bytes_per_frame = sizeof(int16_t) * m_outchannels;
+	qint64 frames = m_outbuf->queued() / m_outchannels;
+
+	if(m_out->state() != QAudio::StoppedState){
+		frames += (m_out->bufferSize() - m_out->bytesFree()) / bytes_per_frame;
+	}
+	return (frames * 1000) / m_outrate;
 }
 
 void AudioEngine::input_data_received()
 {
-	QByteArray data;
 	qint64 len = m_in->bytesReady();
 
-	if (len > 0){
-		data.resize(len);
-		m_indev->read(data.data(), len);
+	// the scratch buffers only ever grow, so after the first few callbacks
+	// capture runs without touching the heap
+	if((len > 0) && ((size_t)len > m_inraw.size())){
+		m_inraw.resize(len);
+	}
+	if ((len > 0) && ((len = m_indev->read(m_inraw.data(), len)) > 0)){
+		const char *data = m_inraw.data();
 /*
 		fprintf(stderr, "AUDIOIN: ");
 		for(int i = 0; i < len; ++i){
-			fprintf(stderr, "%02x ", (unsigned char)data.data()[i]);
+			fprintf(stderr, "%02x ", (unsigned char)data[i]);
 		}
 		fprintf(stderr, "\n");
 		fflush(stderr);
 */
-		if(MACHAK){
-			std::vector<int16_t> samples;
-			for(int i = 0; i < len; i += 2){
-				samples.push_back(((data.data()[i+1] << 8) & 0xff00) | (data.data()[i] & 0xff));
-			}
-			for(float i = 0; i < (float)len/2; i += m_srm){
-				m_audioinq.enqueue(samples[i]);
-			}
+		const int n = len / (2 * m_inchannels);
+		if((size_t)n > m_insamples.size()){
+			m_insamples.resize(n);
+		}
+		for(int i = 0, j = 0; i < n; ++i, j += 2 * m_inchannels){
+			m_insamples[i] = ((data[j+1] << 8) & 0xff00) | (data[j] & 0xff);
+		}
+		if(m_inresampler){
+			m_inresampled.clear();
+			m_inresampler->process(m_insamples.data(), n, m_inresampled);
+			m_audioinq.write(m_inresampled.data(), m_inresampled.size());
 		}
 		else{
-			for(int i = 0; i < len; i += (2 * m_srm)){
-				m_audioinq.enqueue(((data.data()[i+1] << 8) & 0xff00) | (data.data()[i] & 0xff));
-			}
+			m_audioinq.write(m_insamples.data(), n);
+		}
+	}
+}
+
+// Headless capture has no device clock, so one 20 ms frame is pulled per
+// timer tick.  Pipes only deliver what the writer has produced so far.
+void AudioEngine::headless_data_received()
+{
+	int16_t pcm[160];
+	size_t n = m_headless_in->read(pcm, 160);
+
+	if(n > 0){
+		m_audioinq.write(pcm, n);
+	}
+}
+
+bool AudioEngine::capture_fast() const
+{
+	return m_headless_in && m_headless_in->fast();
+}
+
+bool AudioEngine::capture_ended() const
+{
+	return capture_fast() && m_headless_in->ended();
+}
+
+// A fast capture file has no timer, frames are pulled in as read() needs
+// them so TX runs at whatever rate its timer is fired.
+void AudioEngine::headless_fill(size_t s)
+{
+	while(m_audioinq.available() < s){
+		const size_t a = m_audioinq.available();
+		headless_data_received();
+		if(m_audioinq.available() == a){
+			break;
 		}
 	}
 }
@@ -233,7 +352,34 @@ void AudioEngine::write(int16_t *pcm, size_t s)
 		process_audio(pcm, s);
 	}
 
-	m_outdev->write((const char *) pcm, sizeof(int16_t) * s);
+	if(m_headless_out != nullptr){
+		m_headless_out->write(pcm, s);
+	}
+	else if(m_outbuf == nullptr){
+		// No playback device
+	}
+	else if(m_outresampler || (m_outchannels > 1)){
+		m_outresampled.clear();
+		if(m_outresampler){
+			m_outresampler->process(pcm, s, m_outresampled);
+		}
+		else{
+			m_outresampled.assign(pcm, pcm + s);
+		}
+		if(m_outchannels > 1){
+			const size_t n = m_outresampled.size();
+			m_outresampled.resize(n * m_outchannels);
+			for(size_t i = n; i-- > 0; ){
+				for(int c = 0; c < m_outchannels; ++c){
+					m_outresampled[i * m_outchannels + c] = m_outresampled[i];
+				}
+			}
+		}
+		m_outbuf->write_samples(m_outresampled.data(), m_outresampled.size());
+	}
+	else{
+		m_outbuf->write_samples(pcm, s);
+	}
 	for(uint32_t i = 0; i < s; ++i){
 		if(pcm[i] > m_maxlevel){
 			m_maxlevel = pcm[i];
@@ -245,21 +391,23 @@ uint16_t AudioEngine::read(int16_t *pcm, int s)
 {
 	m_maxlevel = 0;
 
-	if(m_audioinq.size() >= s){
+	if((m_in == nullptr) && (m_headless_in == nullptr)){
+		memset(pcm, 0, sizeof(int16_t) * s);
+		return 1;
+	}
+	if(capture_fast()){
+		headless_fill(s);
+	}
+	if(m_audioinq.read(pcm, s, false) == (size_t)s){
 		for(int i = 0; i < s; ++i){
-			pcm[i] = m_audioinq.dequeue();
 			if(pcm[i] > m_maxlevel){
 				m_maxlevel = pcm[i];
 			}
 		}
 		return 1;
 	}
-	else if(m_in == nullptr){
-		memset(pcm, 0, sizeof(int16_t) * s);
-		return 1;
-	}
 	else{
-		//fprintf(stderr, "audio frame not avail size == %d\n", m_audioinq.size());
+		//fprintf(stderr, "audio frame not avail size == %d\n", m_audioinq.available());
 		return 0;
 	}
 }
@@ -269,15 +417,12 @@ uint16_t AudioEngine::read(int16_t *pcm)
 	int s;
 	m_maxlevel = 0;
 
-	if(m_audioinq.size() >= 160){
-		s = 160;
-	}
-	else{
-		s = m_audioinq.size();
+	if(capture_fast()){
+		headless_fill(160);
 	}
+	s = m_audioinq.read(pcm, 160);
 
 	for(int i = 0; i < s; ++i){
-		pcm[i] = m_audioinq.dequeue();
 		if(pcm[i] > m_maxlevel){
 			m_maxlevel = pcm[i];
 		}
@@ -289,25 +434,14 @@ uint16_t AudioEngine::read(int16_t *pcm)
 // process_audio() based on code from DSD https://github.com/szechyjs/dsd
 void AudioEngine::process_audio(int16_t *pcm, size_t s)
 {
-	float aout_abs, max, gainfactor, gaindelta, maxbuf;
+	float max, gainfactor, gaindelta;
 
-	for(size_t i = 0; i < s; ++i){
-		m_audio_out_temp_buf[i] = static_cast<float>(pcm[i]);
+	if(s == 0){
+		return;
 	}
 
 	// detect max level
-	max = 0;
-	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-
-	for (size_t i = 0; i < s; i++){
-		aout_abs = fabsf(*m_audio_out_temp_buf_p);
-
-		if (aout_abs > max){
-			max = aout_abs;
-		}
-
-		m_audio_out_temp_buf_p++;
-	}
+	max = static_cast<float>(audiodsp_peak(pcm, s));
 
 	*m_aout_max_buf_p = max;
 	m_aout_max_buf_p++;
@@ -320,10 +454,8 @@ void AudioEngine::process_audio(int16_t *pcm, size_t s)
 
 	// lookup max history
 	for (size_t i = 0; i < 25; i++){
-		maxbuf = m_aout_max_buf[i];
-
-		if (maxbuf > max){
-			max = maxbuf;
+		if (m_aout_max_buf[i] > max){
+			max = m_aout_max_buf[i];
 		}
 	}
 
@@ -351,30 +483,11 @@ void AudioEngine::process_audio(int16_t *pcm, size_t s)
 		}
 	}
 
-	gaindelta /= static_cast<float>(160);
-
-	// adjust output gain
-	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-
-	for (size_t i = 0; i < 160; i++){
-		*m_audio_out_temp_buf_p = (m_aout_gain + (static_cast<float>(i) * gaindelta)) * (*m_audio_out_temp_buf_p);
-		m_audio_out_temp_buf_p++;
-	}
+	gaindelta /= static_cast<float>(s);
 
+	// adjust output gain, volume and limit in one pass
+	audiodsp_gain(pcm, s, m_aout_gain, gaindelta, m_volume, static_cast<float>(32760));
 	m_aout_gain += (static_cast<float>(s) * gaindelta);
-	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-
-	for (size_t i = 0; i < s; i++){
-		*m_audio_out_temp_buf_p *= m_volume;
-		if (*m_audio_out_temp_buf_p > static_cast<float>(32760)){
-			*m_audio_out_temp_buf_p = static_cast<float>(32760);
-		}
-		else if (*m_audio_out_temp_buf_p < static_cast<float>(-32760)){
-			*m_audio_out_temp_buf_p = static_cast<float>(-32760);
-		}
-		pcm[i] = static_cast<int16_t>(*m_audio_out_temp_buf_p);
-		m_audio_out_temp_buf_p++;
-	}
 }
 
 void AudioEngine::handleStateChanged(QAudio::State newState)
@@ -24,6 +24,12 @@
 #include <QAudioOutput>
 #include <QAudioInput>
 #include <QQueue>
+#include <QTimer>
+#include "audioringbuffer.h"
+#include "audioresampler.h"
+#include "audiooutputdevice.h"
+
+class HeadlessAudio;
 
 #define AUDIO_OUT 1
 #define AUDIO_IN  0
@@ -42,15 +48,22 @@ public:
 	void start_playback();
 	void stop_playback();
 	void write(int16_t *, size_t);
-	void set_output_buffer_size(uint32_t b) { m_out->setBufferSize(b); }
-	void set_input_buffer_size(uint32_t b) { if(m_in != nullptr) m_in->setBufferSize(b); }
-	void set_output_volume(qreal v){ m_out->setVolume(v); }
-	void set_input_volume(qreal v){ m_in->setVolume(v); }
+	// Buffer sizes are given in bytes of 8 kHz mono audio and scaled to the device format
+	void set_output_buffer_size(uint32_t b) { if(m_out != nullptr) m_out->setBufferSize(b * m_outchannels * (m_outresampler ? m_outresampler->out_rate() / 8000.0 : 1)); }
+	void set_input_buffer_size(uint32_t b) { if(m_in != nullptr) m_in->setBufferSize(b * m_inchannels * (m_inresampler ? m_inresampler->in_rate() / 8000.0 : 1)); }
+	void set_output_volume(qreal v){ if(m_out != nullptr) m_out->setVolume(v); }
+	void set_input_volume(qreal v){ if(m_in != nullptr) m_in->setVolume(v); }
 	void set_agc(bool agc) { m_agc = agc; }
-	bool frame_available() { return (m_audioinq.size() >= 320) ? true : false; }
+	bool frame_available() { return (m_audioinq.available() >= 320) ? true : false; }
+	bool capture_fast() const;
+	bool capture_ended() const;
 	uint16_t read(int16_t *, int);
 	uint16_t read(int16_t *);
 	uint16_t level() { return m_maxlevel; }
+	uint32_t capture_overflows() { return m_audioinq.overflows(); }
+	uint32_t capture_underruns() { return m_audioinq.underruns(); }
+	uint32_t playback_underruns() { return m_outbuf ? m_outbuf->underruns() : 0; }
+	int output_latency();
 signals:
 
 private:
@@ -58,15 +71,23 @@ private:
 	QString m_inputdevice;
 	QAudioOutput *m_out;
 	QAudioInput *m_in;
-	QIODevice *m_outdev;
+	AudioOutputDevice *m_outbuf;
+	int m_outrate;
 	QIODevice *m_indev;
-	QQueue<int16_t> m_audioinq;
+	HeadlessAudio *m_headless_in;
+	HeadlessAudio *m_headless_out;
+	QTimer *m_headlesstimer;
+	AudioRingBuffer<int16_t> m_audioinq;
 	uint16_t m_maxlevel;
 	bool m_agc;
-	float m_srm; // sample rate multiplier for macOS HACK
-
-	float m_audio_out_temp_buf[160];   //!< output of decoder
-	float *m_audio_out_temp_buf_p;
+	AudioResampler *m_inresampler;
+	AudioResampler *m_outresampler;
+	std::vector<char> m_inraw;
+	std::vector<int16_t> m_insamples;
+	std::vector<int16_t> m_inresampled;
+	std::vector<int16_t> m_outresampled;
+	int m_inchannels;
+	int m_outchannels;
 
 	//float m_audio_out_float_buf[1120]; //!< output of upsampler - 1 frame of 160 samples upampled up to 7 times
 	//float *m_audio_out_float_buf_p;
@@ -85,8 +106,12 @@ private:
 	float m_aout_gain;
 	float m_volume;
 
+	static QAudioFormat native_format(const QAudioDeviceInfo &, const QAudioFormat &);
+	void headless_fill(size_t s);
+
 private slots:
 	void input_data_received();
+	void headless_data_received();
 	void process_audio(int16_t *pcm, size_t s);
 	void handleStateChanged(QAudio::State newState);
 };
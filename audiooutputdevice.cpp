@@ -0,0 +1,55 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "audiooutputdevice.h"
+
+AudioOutputDevice::AudioOutputDevice(size_t samples, QObject *parent) :
+	QIODevice(parent),
+	m_ring(samples),
+	m_underruns(0),
+	m_flowing(false)
+{
+}
+
+qint64 AudioOutputDevice::bytesAvailable() const
+{
+	return (m_ring.available() * sizeof(int16_t)) + QIODevice::bytesAvailable();
+}
+
+qint64 AudioOutputDevice::readData(char *data, qint64 maxlen)
+{
+	const size_t want = maxlen / sizeof(int16_t);
+	const size_t got = m_ring.read(reinterpret_cast<int16_t *>(data), want);
+
+	if(got < want){
+		// Keep the device running on silence rather than letting it go idle
+		memset(data + (got * sizeof(int16_t)), 0, (want - got) * sizeof(int16_t));
+		if(m_flowing){
+			++m_underruns;
+		}
+		m_flowing = false;
+	}
+	else{
+		m_flowing = true;
+	}
+	return want * sizeof(int16_t);
+}
+
+qint64 AudioOutputDevice::writeData(const char *data, qint64 len)
+{
+	return m_ring.write(reinterpret_cast<const int16_t *>(data), len / sizeof(int16_t)) * sizeof(int16_t);
+}
@@ -0,0 +1,49 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOOUTPUTDEVICE_H
+#define AUDIOOUTPUTDEVICE_H
+
+#include <QIODevice>
+#include "audioringbuffer.h"
+
+// Pull mode source for QAudioOutput.  Decoded audio is written into a ring
+// buffer and the audio backend pulls it from readData() as the device needs
+// it, so only the ring and the small device buffer sit between the decoder
+// and the speaker.  Gaps are filled with silence and counted as underruns.
+class AudioOutputDevice : public QIODevice
+{
+	Q_OBJECT
+public:
+	AudioOutputDevice(size_t samples, QObject *parent = nullptr);
+	size_t write_samples(const int16_t *pcm, size_t s) { return m_ring.write(pcm, s); }
+	size_t queued() const { return m_ring.available(); }
+	uint32_t overflows() const { return m_ring.overflows(); }
+	uint32_t underruns() const { return m_underruns; }
+	void clear() { m_ring.clear(); m_flowing = false; }
+	qint64 bytesAvailable() const override;
+	bool isSequential() const override { return true; }
+protected:
+	qint64 readData(char *data, qint64 maxlen) override;
+	qint64 writeData(const char *data, qint64 len) override;
+private:
+	AudioRingBuffer<int16_t> m_ring;
+	uint32_t m_underruns;
+	bool m_flowing;
+};
+
+#endif // AUDIOOUTPUTDEVICE_H
@@ -0,0 +1,143 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "audioresampler.h"
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RESAMPLER_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#endif
+
+#define TAPS_PER_ZERO_CROSSING 16
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while(b){
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+AudioResampler::AudioResampler(uint32_t in_rate, uint32_t out_rate) :
+	m_inrate(in_rate),
+	m_outrate(out_rate),
+	m_phase(0),
+	m_pos(0)
+{
+	const uint32_t g = gcd(in_rate, out_rate);
+	m_l = out_rate / g;
+	m_m = in_rate / g;
+
+	// Taps per phase, rounded up to a multiple of 4 for the SIMD dot product.
+	// Decimation narrows the cutoff so the filter is stretched by M/L.
+	const uint32_t f = (m_m > m_l) ? m_m : m_l;
+	m_taps = (TAPS_PER_ZERO_CROSSING * f + m_l - 1) / m_l;
+	m_taps = (m_taps + 3) & ~3u;
+
+	const uint32_t n = m_l * m_taps;
+	const double fc = 0.46 / f; // cycles per sample at in_rate * L, a little below Nyquist
+	const double mid = (n - 1) / 2.0;
+	std::vector<double> h(n);
+
+	for(uint32_t i = 0; i < n; ++i){
+		const double x = i - mid;
+		const double s = (x == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+		const double w = 0.42 - 0.5 * cos(2.0 * M_PI * i / (n - 1)) + 0.08 * cos(4.0 * M_PI * i / (n - 1));
+		h[i] = s * w * m_l;
+	}
+
+	m_coeffs.resize(n);
+	for(uint32_t p = 0; p < m_l; ++p){
+		for(uint32_t q = 0; q < m_taps; ++q){
+			m_coeffs[p * m_taps + q] = static_cast<float>(h[p + (m_taps - 1 - q) * m_l]);
+		}
+	}
+	reset();
+}
+
+void AudioResampler::reset()
+{
+	m_phase = 0;
+	m_pos = 0;
+	m_hist.assign(m_taps - 1, 0.0f);
+}
+
+float AudioResampler::dot(const float *a, const float *b, size_t n)
+{
+	size_t i = 0;
+	float r = 0.0f;
+#if defined(RESAMPLER_SSE)
+	__m128 acc = _mm_setzero_ps();
+	for(; i + 4 <= n; i += 4){
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	float t[4];
+	_mm_storeu_ps(t, acc);
+	r = (t[0] + t[1]) + (t[2] + t[3]);
+#elif defined(RESAMPLER_NEON)
+	float32x4_t acc = vdupq_n_f32(0.0f);
+	for(; i + 4 <= n; i += 4){
+		acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+	}
+	float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	r = vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+	for(; i < n; ++i){
+		r += a[i] * b[i];
+	}
+	return r;
+}
+
+void AudioResampler::process(const int16_t *in, size_t n, std::vector<int16_t> &out)
+{
+	if(passthrough()){
+		out.insert(out.end(), in, in + n);
+		return;
+	}
+
+	const size_t base = m_hist.size();
+	m_hist.resize(base + n);
+	for(size_t i = 0; i < n; ++i){
+		m_hist[base + i] = static_cast<float>(in[i]);
+	}
+
+	out.reserve(out.size() + (n * m_l) / m_m + 1);
+
+	while(m_pos + m_taps <= m_hist.size()){
+		float y = dot(&m_hist[m_pos], &m_coeffs[m_phase * m_taps], m_taps);
+		if(y > 32767.0f){
+			y = 32767.0f;
+		}
+		else if(y < -32768.0f){
+			y = -32768.0f;
+		}
+		out.push_back(static_cast<int16_t>(lrintf(y)));
+		m_phase += m_m;
+		m_pos += m_phase / m_l;
+		m_phase %= m_l;
+	}
+
+	// Keep the last taps-1 samples, plus any not yet reached by m_pos
+	m_hist.erase(m_hist.begin(), m_hist.begin() + m_pos);
+	m_pos = 0;
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIORESAMPLER_H
+#define AUDIORESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Rational polyphase FIR resampler for mono 16 bit audio.  The ratio
+// out_rate/in_rate is reduced to L/M, a windowed sinc low pass prototype is
+// designed at in_rate*L and split into L phases.  Each output sample is one
+// dot product of a phase against the input history, which is vectorized with
+// SSE or NEON when available.
+class AudioResampler
+{
+public:
+	AudioResampler(uint32_t in_rate, uint32_t out_rate);
+	uint32_t in_rate() const { return m_inrate; }
+	uint32_t out_rate() const { return m_outrate; }
+	bool passthrough() const { return (m_inrate == m_outrate); }
+	// Appends the resampled output of n input samples to out
+	void process(const int16_t *in, size_t n, std::vector<int16_t> &out);
+	void reset();
+	static float dot(const float *a, const float *b, size_t n);
+private:
+	uint32_t m_inrate;
+	uint32_t m_outrate;
+	uint32_t m_l;
+	uint32_t m_m;
+	uint32_t m_taps;
+	uint32_t m_phase;
+	size_t m_pos;
+	std::vector<float> m_coeffs; // m_l phases of m_taps reversed coefficients
+	std::vector<float> m_hist;
+};
+
+#endif // AUDIORESAMPLER_H
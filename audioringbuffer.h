@@ -0,0 +1,141 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single producer / single consumer ring buffer.  One thread may call write()
+// while another calls read() without any locking.  Capacity is rounded up to
+// a power of two so indexes can be masked instead of using modulo, and the
+// producer and consumer indexes are padded onto separate cache lines.
+template <typename T>
+class AudioRingBuffer
+{
+	static_assert(std::is_trivially_copyable<T>::value, "AudioRingBuffer requires a trivially copyable type");
+public:
+	explicit AudioRingBuffer(size_t capacity) :
+		m_overflows(0),
+		m_underruns(0)
+	{
+		m_size = 1;
+		while(m_size < capacity){
+			m_size <<= 1;
+		}
+		m_mask = m_size - 1;
+		m_buf = new T[m_size];
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+	}
+	~AudioRingBuffer() { delete[] m_buf; }
+	AudioRingBuffer(const AudioRingBuffer &) = delete;
+	AudioRingBuffer &operator=(const AudioRingBuffer &) = delete;
+
+	size_t capacity() const { return m_size; }
+	size_t available() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+	size_t free_space() const { return m_size - available(); }
+	uint32_t overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+	uint32_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+
+	// Producer side.  Samples that do not fit are dropped and counted as an overflow.
+	size_t write(const T *src, size_t n)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		const size_t tail = m_tail.load(std::memory_order_acquire);
+		const size_t space = m_size - (head - tail);
+
+		if(n > space){
+			m_overflows.fetch_add(1, std::memory_order_relaxed);
+			n = space;
+		}
+		if(n == 0){
+			return 0;
+		}
+
+		const size_t idx = head & m_mask;
+		const size_t first = (n < (m_size - idx)) ? n : (m_size - idx);
+		memcpy(m_buf + idx, src, first * sizeof(T));
+		memcpy(m_buf, src + first, (n - first) * sizeof(T));
+		m_head.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer side.  With partial == false nothing is consumed unless n
+	// samples are available.  A short read is counted as an underrun.
+	size_t read(T *dst, size_t n, bool partial = true)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		const size_t head = m_head.load(std::memory_order_acquire);
+		const size_t avail = head - tail;
+
+		if(n > avail){
+			m_underruns.fetch_add(1, std::memory_order_relaxed);
+			if(!partial){
+				return 0;
+			}
+			n = avail;
+		}
+		if(n == 0){
+			return 0;
+		}
+
+		const size_t idx = tail & m_mask;
+		const size_t first = (n < (m_size - idx)) ? n : (m_size - idx);
+		memcpy(dst, m_buf + idx, first * sizeof(T));
+		memcpy(dst + first, m_buf, (n - first) * sizeof(T));
+		m_tail.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	// Only safe while neither side is active (e.g. before capture starts).
+	void clear()
+	{
+		m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+	void reset_stats()
+	{
+		m_overflows.store(0, std::memory_order_relaxed);
+		m_underruns.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	// Padding rather than alignas(64): an over-aligned member would make
+	// every owner over-aligned, which plain new does not honour before C++17.
+	// Whatever the alignment of the object, the two indexes are a full cache
+	// line apart from each other and from the neighbouring members.
+	enum { CACHE_LINE = 64 };
+	char m_pad0[CACHE_LINE];
+	std::atomic<size_t> m_head;
+	char m_pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> m_tail;
+	char m_pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+	T *m_buf;
+	size_t m_size;
+	size_t m_mask;
+	std::atomic<uint32_t> m_overflows;
+	std::atomic<uint32_t> m_underruns;
+};
+
+#endif // AUDIORINGBUFFER_H
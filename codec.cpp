@@ -15,13 +15,17 @@
 	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "codec.h"
+#include <cstring>
 #include <iostream>
-#ifdef Q_OS_WIN
-#include <windows.h>
-#else
-#include <dlfcn.h>
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
 #endif
 
+// Receive pool, one slot per datagram.  Nothing the reflectors send comes
+// close to UDP_SLOT_SIZE.
+static const int UDP_BATCH = 16;
+static const int UDP_SLOT_SIZE = 2048;
+
 #ifdef USE_FLITE
 extern "C" {
 extern cst_voice * register_cmu_us_slt(const char *);
@@ -35,15 +39,21 @@ Codec::Codec(QString callsign, char module, QString hostname, QString host, int
 	m_hostname(hostname),
 	m_tx(false),
 	m_ttsid(0),
+	m_txtimer(nullptr),
+	m_rxtimer(nullptr),
+	m_audio(nullptr),
 	m_audioin(audioin),
 	m_audioout(audioout),
 	m_rxwatchdog(0),
-#ifdef Q_OS_WIN
-	m_rxtimerint(19),
-#else
 	m_rxtimerint(20),
-#endif
-	m_txtimerint(19),
+	m_txtimerint(20),
+	m_replaying(false),
+	m_replayfast(false),
+	m_replayclock(0),
+	m_txfast(false),
+	m_mbevocoder(nullptr),
+	m_swvocoder(nullptr),
+	m_swdropbase(0),
 	m_vocoder(vocoder),
 	m_modemport(modem),
 	m_modem(nullptr),
@@ -65,6 +75,14 @@ Codec::Codec(QString callsign, char module, QString hostname, QString host, int
 	m_modeinfo.stream_state = STREAM_IDLE;
 	m_modeinfo.sw_vocoder_loaded = false;
 	m_modeinfo.hw_vocoder_loaded = false;
+	m_modeinfo.jitter_depth = 0;
+	m_modeinfo.jitter_late = 0;
+	m_modeinfo.jitter_lost = 0;
+	m_modeinfo.jitter_reordered = 0;
+	m_modeinfo.audio_latency = 0;
+	m_modeinfo.fec_corrected = 0;
+	m_modeinfo.stats = m_stats.summary();
+	m_rxpool.resize(UDP_BATCH * UDP_SLOT_SIZE);
 #ifdef USE_FLITE
 	flite_init();
 	voice_slt = register_cmu_us_slt(nullptr);
@@ -75,6 +93,176 @@ Codec::Codec(QString callsign, char module, QString hostname, QString host, int
 
 Codec::~Codec()
 {
+	sw_vocoder_stop();
+	delete m_mbevocoder;
+}
+
+// Connected to m_udp's readyRead by every codec.  Reads all datagrams that
+// are queued rather than one per wakeup, into the preallocated pool, and hands
+// each one to process_udp() as a QByteArray that only references the pool
+// slot, valid for the duration of the call.  The first read goes through
+// QUdpSocket so it re-arms its read notifier, the rest of the queue is pulled
+// with recvmmsg() where we have it.
+void Codec::drain_udp()
+{
+	char *slot = m_rxpool.data();
+	while(m_udp && m_udp->hasPendingDatagrams()){
+		qint64 size = m_udp->readDatagram(slot, UDP_SLOT_SIZE);
+		if(size < 0){
+			break;
+		}
+		if(m_capture.is_open()){
+			m_capture.write(FrameCapture::UdpRx, (const uint8_t *)slot, size);
+		}
+		process_udp(QByteArray::fromRawData(slot, size));
+
+#ifdef Q_OS_LINUX
+		struct mmsghdr msgs[UDP_BATCH];
+		struct iovec iovecs[UDP_BATCH];
+		const int fd = m_udp ? m_udp->socketDescriptor() : -1;
+		int n = UDP_BATCH;
+		while((fd >= 0) && (n == UDP_BATCH)){
+			::memset(msgs, 0, sizeof(msgs));
+			for(int i = 0; i < UDP_BATCH; ++i){
+				iovecs[i].iov_base = m_rxpool.data() + (i * UDP_SLOT_SIZE);
+				iovecs[i].iov_len = UDP_SLOT_SIZE;
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			n = ::recvmmsg(fd, msgs, UDP_BATCH, MSG_DONTWAIT, nullptr);
+			for(int i = 0; i < n; ++i){
+				if(msgs[i].msg_hdr.msg_flags & MSG_TRUNC){
+					continue;
+				}
+				if(m_capture.is_open()){
+					m_capture.write(FrameCapture::UdpRx, (const uint8_t *)iovecs[i].iov_base, msgs[i].msg_len);
+				}
+				process_udp(QByteArray::fromRawData((const char *)iovecs[i].iov_base, msgs[i].msg_len));
+				if(m_udp == nullptr){
+					return;
+				}
+			}
+		}
+		return;
+#endif
+	}
+}
+
+// Connected to the modem's modem_data_ready by the codecs that support one,
+// the counterpart of drain_udp() for frames from the radio.
+void Codec::modem_rx(QByteArray d)
+{
+	if(m_capture.is_open()){
+		m_capture.write(FrameCapture::ModemRx, (const uint8_t *)d.data(), d.size());
+	}
+	process_modem_data(d);
+}
+
+// DROIDSTAR_CAPTURE=<file or directory> records every datagram and modem
+// frame handed to process_udp()/process_modem_data() in a FrameCapture file,
+// named <mode>-<date>-<time>.dscap when a directory is given.
+// DROIDSTAR_REPLAY=<file>[,fast] feeds such a capture back through the same
+// calls once the codec has its socket, in real time or, with "fast", as fast
+// as possible on the capture's own clock.  The network connection is still
+// made, so point the host at nothing (or tools/mockreflector) when replaying.
+void Codec::capture_setup()
+{
+	const QString mode = QString(metaObject()->className()).remove("Codec");
+	const QString cap = QString::fromLocal8Bit(qgetenv("DROIDSTAR_CAPTURE"));
+	const QStringList rep = QString::fromLocal8Bit(qgetenv("DROIDSTAR_REPLAY")).split(',');
+
+	if(!cap.isEmpty()){
+		QString path = cap;
+		if(QFileInfo(cap).isDir()){
+			path = QDir(cap).filePath(mode + QDateTime::currentDateTime().toString("-yyyyMMdd-hhmmss") + ".dscap");
+		}
+		if(m_capture.open_write(path.toStdString(), mode.toStdString())){
+			DSLOG(Logger::App, Logger::Info, "Capturing %s frames to %s", qPrintable(mode), qPrintable(path));
+		}
+	}
+	if(!rep[0].isEmpty() && m_replay.open_read(rep[0].toStdString())){
+		if(m_replay.mode() != mode.toStdString()){
+			DSLOG(Logger::App, Logger::Warn, "Replaying a %s capture into %s", m_replay.mode().c_str(), qPrintable(mode));
+		}
+		m_replayfast = (rep.size() > 1) && (rep[1] == "fast");
+		m_replaying = m_replay.read(m_replayrec);
+		m_replaycount = 0;
+		m_replayclock = 0;
+		QTimer::singleShot(0, this, SLOT(replay_next()));
+	}
+}
+
+void Codec::replay_next()
+{
+	if((m_udp == nullptr) && (m_modem == nullptr)){
+		QTimer::singleShot(10, this, SLOT(replay_next()));
+		return;
+	}
+	if(m_replaying && (m_replaycount == 0)){
+		m_replaystart = StreamStats::now_us();
+		m_replayorigin = m_replayrec.t_us;
+		m_replaytick = m_replayrec.t_us;
+	}
+
+	int batch = 0;
+	while(m_replaying){
+		if(m_replayfast){
+			replay_advance(m_replayrec.t_us);
+		}
+		else{
+			const int64_t wait = (m_replayrec.t_us - m_replayorigin) - (StreamStats::now_us() - m_replaystart);
+			if(wait >= 1000){
+				QTimer::singleShot(wait / 1000, Qt::PreciseTimer, this, SLOT(replay_next()));
+				return;
+			}
+		}
+		const QByteArray d = QByteArray::fromRawData((const char *)m_replayrec.data.data(), m_replayrec.data.size());
+		if(m_replayrec.kind == FrameCapture::UdpRx){
+			process_udp(d);
+		}
+		else if(m_replayrec.kind == FrameCapture::ModemRx){
+			process_modem_data(QByteArray(d.data(), d.size()));
+		}
+		++m_replaycount;
+		m_replaying = m_replay.read(m_replayrec);
+		// hand back to the event loop now and then so queued signals get through
+		if(m_replayfast && m_replaying && (++batch == 64)){
+			QTimer::singleShot(0, this, SLOT(replay_next()));
+			return;
+		}
+	}
+
+	if(m_replayfast){
+		replay_advance(m_replayclock + 2000000);
+		if(m_rxtimer){
+			m_rxtimer->set_manual(false);
+		}
+	}
+	const double captured = (m_replayclock - m_replayorigin) / 1e6;
+	const double took = (StreamStats::now_us() - m_replaystart) / 1e6;
+	DSLOG(Logger::App, Logger::Info, "Replayed %u frames, %.3f s of capture in %.3f s", (unsigned int)m_replaycount, captured, took);
+	m_replayfast = false;
+	m_replay.close();
+}
+
+// Fast replay runs on the capture's clock: RX timer ticks due before the next
+// record are fired back to back, so the jitter buffer and decoders see the
+// arrival pattern of the capture without waiting for it.
+void Codec::replay_advance(int64_t t_us)
+{
+	if(m_rxtimer && m_rxtimer->isActive() && (m_rxtimer->interval() > 0)){
+		m_rxtimer->set_manual(true);
+		const int64_t period = m_rxtimer->interval() * 1000;
+		while(m_rxtimer->isActive() && (m_replaytick + period <= t_us)){
+			m_replaytick += period;
+			m_replayclock = m_replaytick;
+			m_rxtimer->fire();
+		}
+	}
+	else{
+		m_replaytick = t_us;
+	}
+	m_replayclock = t_us;
 }
 
 void Codec::in_audio_vol_changed(qreal v)
@@ -93,9 +281,35 @@ void Codec::agc_state_changed(int s)
 	m_audio->set_agc(s);
 }
 
+void Codec::update_jitter_info()
+{
+	m_modeinfo.jitter_depth = m_jitter.depth_ms();
+	m_modeinfo.jitter_late = m_jitter.late();
+	m_modeinfo.jitter_lost = m_jitter.lost();
+	m_modeinfo.jitter_reordered = m_jitter.reordered();
+	m_modeinfo.audio_latency = m_audio ? m_audio->output_latency() : 0;
+}
+
+// TX frame clock, connected next to each codec's transmit() so the spacing
+// of our own frames shows up in the stream stats
+void Codec::tx_tick()
+{
+	m_stats.tx(StreamStats::now_us());
+	m_modeinfo.stats = m_stats.summary();
+}
+
+// Fade applied to frames concealed by the jitter buffer
+void Codec::apply_gain(int16_t *pcm, int s, float gain)
+{
+	for(int i = 0; i < s; ++i){
+		pcm[i] = (int16_t)(pcm[i] * gain);
+	}
+}
+
 void Codec::send_connect()
 {
 	m_modeinfo.status = CONNECTING;
+	capture_setup();
 
 	if(m_modeinfo.host == "MMDVM_DIRECT"){
 		mmdvm_direct_connect();
@@ -143,82 +357,208 @@ void Codec::start_tx()
 	}
 #endif
 	if(!m_txtimer->isActive()){
+		m_stats.reset_tx(m_txtimerint);
+		connect(m_txtimer, SIGNAL(timeout()), this, SLOT(tx_tick()), Qt::UniqueConnection);
 		if(m_ttsid == 0){
 			m_audio->set_input_buffer_size(640);
 			m_audio->start_capture();
 			//audioin->start(&audio_buffer);
 		}
 		m_txtimer->start(m_txtimerint);
+		if((m_ttsid == 0) && !m_hwtx && m_audio->capture_fast()){
+			m_txtimer->set_manual(true);
+			m_txfast = true;
+			m_txfaststart = StreamStats::now_us();
+			m_txfastframes = 0;
+			QTimer::singleShot(0, this, SLOT(tx_fast_next()));
+		}
 	}
 }
 
+// TX from a "file:<path>,fast" capture: the TX timer is fired back to back
+// instead of every m_txtimerint ms, handing back to the event loop now and
+// then, and the end of the file ends the transmission.  Runs the whole TX
+// chain (capture, vocoder, framing, send) as fast as the CPU allows.
+void Codec::tx_fast_next()
+{
+	int batch = 0;
+
+	while(m_txtimer->isActive() && (batch++ < 64)){
+		if(m_tx && m_audio->capture_ended()){
+			stop_tx();
+		}
+		m_txtimer->fire();
+		++m_txfastframes;
+	}
+	if(m_txtimer->isActive()){
+		QTimer::singleShot(0, this, SLOT(tx_fast_next()));
+		return;
+	}
+	m_txtimer->set_manual(false);
+	m_txfast = false;
+	const double took = (StreamStats::now_us() - m_txfaststart) / 1e6;
+	DSLOG(Logger::App, Logger::Info, "Transmitted %u frames, %.3f s of audio in %.3f s", (unsigned int)m_txfastframes, m_txfastframes * m_txtimerint / 1000.0, took);
+}
+
 void Codec::stop_tx()
 {
 	m_tx = false;
 }
 
-bool Codec::load_vocoder_plugin()
+// The plugin itself is loaded once per process by VocoderLoader, each
+// connection only opens a stream on it.  Also starts the software vocoder
+// stage at that rate unless the codec has set up its own, without a plugin
+// it decodes to silence and encodes to zeros like the inline code did.
+bool Codec::load_vocoder_plugin(uint32_t rate)
 {
-	QString config_path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
-#if !defined(Q_OS_ANDROID) && !defined(Q_OS_WIN)
-	config_path += "/dudetronics";
-#endif
-#if defined(Q_OS_ANDROID)
-	QString voc = config_path + "/vocoder_plugin." + QSysInfo::productType() + "." + QSysInfo::currentCpuArchitecture();
-#else
-	QString voc = config_path + "/vocoder_plugin." + QSysInfo::kernelType() + "." + QSysInfo::currentCpuArchitecture();
-#endif
-#if !defined(Q_OS_WIN)
-	//QString voc = "/mnt/data/src/mbe_vocoder/vocoder_plugin.linux.x86_64.so";
-	void* a = dlopen(voc.toLocal8Bit(), RTLD_LAZY);
-	if (!a) {
-		qDebug() << "Cannot load library: " << QString::fromLocal8Bit(dlerror());
-		return false;
+	if(!m_mbevocoder){
+		m_mbevocoder = VocoderLoader::instance()->open_stream(rate);
+	}
+	if(!m_swvocoder){
+		const int bytes = (rate == VOCODER_RATE_2450) ? 7 : 9;
+		sw_vocoder_start(
+			[this, rate](int16_t *pcm, const uint8_t *codec, int) {
+				if(m_mbevocoder){
+					m_mbevocoder->decode(rate, pcm, codec, 1);
+				}
+				else{
+					memset(pcm, 0, 160 * sizeof(int16_t));
+				}
+				return 160;
+			},
+			[this, rate, bytes](uint8_t *codec, const int16_t *pcm, int) {
+				if(m_mbevocoder){
+					m_mbevocoder->encode(rate, codec, pcm, 1);
+				}
+				else{
+					memset(codec, 0, bytes);
+				}
+				return bytes;
+			});
 	}
-	dlerror();
+	return m_mbevocoder != nullptr;
+}
 
-	create_t* create_a = (create_t*) dlsym(a, "create");
-	const char* dlsym_error = dlerror();
+// Software decode and encode run on a VocoderWorker thread so a slow vocoder
+// never holds up the network, modem and timer work of the codec thread.
+// Results come back through vocoder_ready() in submission order.
+void Codec::sw_vocoder_start(VocoderStage::DecodeFn decode, VocoderStage::EncodeFn encode)
+{
+	sw_vocoder_stop();
+	m_swvocoder = new VocoderStage(this, decode, encode);
+	m_swdropbase = 0;
+}
 
-	if (dlsym_error) {
-		qDebug() << "Cannot load symbol create: " << QString::fromLocal8Bit(dlsym_error);
-		return false;
+// Blocks until the worker is out of this stage, the functions it runs
+// reference the codec.
+void Codec::sw_vocoder_stop()
+{
+	if(m_swvocoder){
+		delete m_swvocoder;
+		m_swvocoder = nullptr;
 	}
+}
 
-	m_mbevocoder = create_a();
-	qDebug() << voc + " loaded";
-	return true;
-#else
-	HINSTANCE hinstvoclib;
-	hinstvoclib = LoadLibrary(reinterpret_cast<LPCWSTR>(voc.utf16()));
+// Fast replay and fast TX fire their ticks back to back, far quicker than
+// the worker turns frames around, so there each frame is waited for and
+// collected right away instead of overflowing the rings.  Every frame is
+// then coded, in the same order on every run.
+void Codec::sw_decode(const uint8_t *codec, int len, float gain, int flags)
+{
+	if(!m_swvocoder){
+		return;
+	}
+	if(!m_swvocoder->decode(codec, len, gain, flags)){
+		stats_dropped();
+	}
+	else if(m_replayfast){
+		m_swvocoder->wait();
+		vocoder_ready();
+	}
+}
+
+void Codec::sw_encode(const int16_t *pcm, int samples, int flags)
+{
+	if(!m_swvocoder){
+		return;
+	}
+	if(!m_swvocoder->encode(pcm, samples, flags)){
+		stats_dropped();
+	}
+	else if(m_txfast){
+		m_swvocoder->wait();
+		vocoder_ready();
+	}
+}
 
-	if (hinstvoclib != NULL) {
-		create_t* create_a = (create_t*)GetProcAddress(hinstvoclib, "create");
+// Decoded audio goes to the output, encoded frames are appended to
+// m_txcodecq where the tx path picks them up as it does for the hardware
+// vocoder.
+void Codec::vocoder_ready()
+{
+	VocoderStage::Frame f;
 
-		if (create_a != NULL) {
-			m_mbevocoder = create_a();
-			qDebug() << voc + " loaded";
-			return true;
+	while(m_swvocoder && m_swvocoder->get(f)){
+		if(f.op == VocoderStage::DECODE){
+			stats_decode_time(f.us);
+			m_audio->write(f.pcm, f.len);
+			emit update_output_level(m_audio->level());
 		}
 		else{
-			return false;
+			for(int i = 0; i < f.len; ++i){
+				m_txcodecq.append(f.codec[i]);
+			}
 		}
 	}
-	else{
-		return false;
+	if(m_swvocoder){
+		stats_dropped();
 	}
-#endif
+}
+
+// Takes a hardware vocoder channel for this stream from the pool.  Without
+// one (no device given, or all channels busy) the software vocoder is used.
+void Codec::open_hw_vocoder(QString protocol)
+{
+	m_ambedev = (m_vocoder != "") ? VocoderPool::instance()->acquire(protocol, m_vocoder) : nullptr;
+	m_hwrx = m_hwtx = m_modeinfo.hw_vocoder_loaded = (m_ambedev != nullptr);
+	if(m_ambedev){
+		connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
+		connect(m_ambedev, SIGNAL(failed()), this, SLOT(hw_vocoder_failed()));
+	}
+}
+
+void Codec::hw_vocoder_failed()
+{
+	DSLOG(Logger::Ambe, Logger::Warn, "Hardware vocoder lost, falling back to software vocoder");
+	m_hwrx = false;
+	m_hwtx = false;
+	m_modeinfo.hw_vocoder_loaded = false;
+	if(m_ambedev){
+		VocoderPool::instance()->release(m_ambedev);
+		m_ambedev = nullptr;
+	}
+	emit update(m_modeinfo);
 }
 
 void Codec::deleteLater()
 {
+	// the scheduler keeps ticking a timer until it is stopped, also once
+	// this thread is gone
+	if(m_txtimer){
+		m_txtimer->stop();
+	}
+	if(m_rxtimer){
+		m_rxtimer->stop();
+	}
 	if(m_modeinfo.status == CONNECTED_RW){
 		//m_udp->disconnect();
 		//m_ping_timer->stop();
 		send_disconnect();
+		sw_vocoder_stop();
 		delete m_audio;
-		if(m_hwtx){
-			delete m_ambedev;
+		if(m_ambedev){
+			VocoderPool::instance()->release(m_ambedev);
+			m_ambedev = nullptr;
 		}
 		if(m_modem){
 			delete m_modem;
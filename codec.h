@@ -24,10 +24,17 @@
 #include <flite/flite.h>
 #endif
 #include <imbe_vocoder_api.h>
-#include "vocoder_plugin.h"
+#include "vocoderloader.h"
 #include "audioengine.h"
-#include "serialambe.h"
+#include "vocoderpool.h"
+#include "vocoderstage.h"
 #include "serialmodem.h"
+#include "jitterbuffer.h"
+#include "framecapture.h"
+#include "logger.h"
+#include "mediascheduler.h"
+#include "streamstats.h"
+#include <vector>
 
 class Codec : public QObject
 {
@@ -58,6 +65,7 @@ public:
 	void set_hostname(std::string);
 	void set_callsign(std::string);
 	void set_input_src(uint8_t s, QString t) { m_ttsid = s; m_ttstext = t; }
+	void set_jitter_target(int ms) { m_jitter.set_target_ms(ms); }
 	struct MODEINFO {
 		qint64 ts;
 		int status;
@@ -83,6 +91,13 @@ public:
 		bool mode;
 		bool sw_vocoder_loaded;
 		bool hw_vocoder_loaded;
+		int jitter_depth;
+		uint32_t jitter_late;
+		uint32_t jitter_lost;
+		uint32_t jitter_reordered;
+		int audio_latency;
+		uint32_t fec_corrected;
+		StreamStats::Summary stats;
 	} m_modeinfo;
 	enum{
 		DISCONNECTED,
@@ -119,17 +134,44 @@ protected slots:
 	void deleteLater();
 	void in_audio_vol_changed(qreal);
 	void out_audio_vol_changed(qreal);
-	bool load_vocoder_plugin();
-	void swrx_state_changed(int s) {m_hwrx = !s; }
-	void swtx_state_changed(int s) {m_hwtx = !s; }
+	bool load_vocoder_plugin(uint32_t rate);
+	void swrx_state_changed(int s) {m_hwrx = !s && m_ambedev; }
+	void swtx_state_changed(int s) {m_hwtx = !s && m_ambedev; }
+	void hw_vocoder_failed();
 	void agc_state_changed(int s);
 	void mycall_changed(QString mc) { m_txmycall = mc; }
 	void urcall_changed(QString uc) { m_txurcall = uc; }
 	void rptr1_changed(QString r1) { m_txrptr1 = r1; }
 	void rptr2_changed(QString r2) { m_txrptr2 = r2; }
 	void module_changed(char m) { m_module = m; m_modeinfo.streamid = 0; qDebug() << "Codec::module_changed() m == " << m; }
+	void drain_udp();
+	void modem_rx(QByteArray);
+	void tx_tick();
+	void replay_next();
+	void tx_fast_next();
+	void vocoder_ready();
 protected:
+	virtual void process_udp(const QByteArray &){}
+	virtual void process_modem_data(QByteArray){}
+	void open_hw_vocoder(QString protocol);
+	void sw_vocoder_start(VocoderStage::DecodeFn decode, VocoderStage::EncodeFn encode);
+	void sw_vocoder_stop();
+	void sw_decode(const uint8_t *codec, int len, float gain, int flags = 0);
+	void sw_encode(const int16_t *pcm, int samples, int flags = 0);
+	void capture_setup();
+	void replay_advance(int64_t t_us);
+	int64_t media_us() const { return m_replayfast ? m_replayclock : StreamStats::now_us(); }
+	qint64 media_ms() const { return m_replayfast ? m_replayclock / 1000 : QDateTime::currentMSecsSinceEpoch(); }
+	void update_jitter_info();
+	void stats_start(int packet_ms, uint32_t modulus) { m_stats.reset(packet_ms, modulus); m_swdropbase = m_swvocoder ? m_swvocoder->dropped() : 0; m_modeinfo.stats = m_stats.summary(); }
+	void stats_dropped() { m_stats.vocoder_dropped(m_swvocoder->dropped() - m_swdropbase); m_modeinfo.stats = m_stats.summary(); }
+	void stats_rx(uint32_t seq) { m_stats.rx(seq, media_us()); m_modeinfo.stats = m_stats.summary(); }
+	void stats_rx() { m_stats.rx(media_us()); m_modeinfo.stats = m_stats.summary(); }
+	void stats_fec(uint32_t bits) { m_stats.fec(bits); m_modeinfo.stats = m_stats.summary(); }
+	void stats_decode_time(int64_t us) { m_stats.decoded(us); m_modeinfo.stats = m_stats.summary(); }
+	void apply_gain(int16_t *pcm, int s, float gain);
 	QUdpSocket *m_udp = nullptr;
+	std::vector<char> m_rxpool;
 	QHostAddress m_address;
 	char m_module;
 	QString m_hostname;
@@ -149,8 +191,8 @@ protected:
 	cst_wave *tts_audio;
 #endif
 	QTimer *m_ping_timer;
-	QTimer *m_txtimer;
-	QTimer *m_rxtimer;
+	MediaTimer *m_txtimer;
+	MediaTimer *m_rxtimer;
 	AudioEngine *m_audio;
 	QString m_audioin;
 	QString m_audioout;
@@ -159,13 +201,29 @@ protected:
 	uint8_t m_txtimerint;
 	QQueue<uint8_t> m_rxcodecq;
 	QQueue<uint8_t> m_txcodecq;
-	QQueue<uint8_t> m_rxmodemq;
+	JitterBuffer m_jitter;
+	StreamStats m_stats;
+	FrameCapture m_capture;
+	FrameCapture m_replay;
+	FrameCapture::Record m_replayrec;
+	bool m_replaying;
+	bool m_replayfast;
+	int64_t m_replaystart;
+	int64_t m_replayorigin;
+	int64_t m_replayclock;
+	int64_t m_replaytick;
+	uint32_t m_replaycount;
+	bool m_txfast;
+	int64_t m_txfaststart;
+	uint32_t m_txfastframes;
 	imbe_vocoder vocoder;
-	Vocoder *m_mbevocoder;
+	VocoderStream *m_mbevocoder;
+	VocoderStage *m_swvocoder;
+	uint32_t m_swdropbase;
 	QString m_vocoder;
 	QString m_modemport;
 	SerialModem *m_modem;
-	SerialAMBE *m_ambedev;
+	VocoderChannel *m_ambedev;
 	bool m_hwrx;
 	bool m_hwtx;
 	bool m_ipv6;
@@ -38,12 +38,21 @@
 #include "quantise.h"
 #include "codec2.h"
 #include "codec2_internal.h"
+#include "profile.h"
 
 #define HPF_BETA 0.125
 #define BPF_N 101
 
 CKissFFT kiss;
 
+#ifdef CODEC2_PROFILE
+c2_stage_stats c2_profile[C2_STAGE_COUNT];
+const char *c2_stage_names[C2_STAGE_COUNT] = {
+	"encode", "decode", "dft_speech", "nlp", "two_stage_pitch_refinement", "estimate_amplitudes",
+	"est_voicing_mbe", "lpc_to_lsp", "aks_to_M2", "synthesise"
+};
+#endif
+
 /*---------------------------------------------------------------------------* \
 
                              FUNCTION HEADERS
@@ -167,10 +176,16 @@ CCodec2::~CCodec2()
 	c2.bpf_buf.clear();
 	nlp.nlp_destroy();
 	c2.fft_fwd_cfg.twiddles.clear();
+	c2.fft_fwd_cfg.radix4_tw.clear();
+	c2.fft_fwd_cfg.radix4_buf.clear();
 	c2.fftr_fwd_cfg.substate.twiddles.clear();
+	c2.fftr_fwd_cfg.substate.radix4_tw.clear();
+	c2.fftr_fwd_cfg.substate.radix4_buf.clear();
 	c2.fftr_fwd_cfg.tmpbuf.clear();
 	c2.fftr_fwd_cfg.super_twiddles.clear();
 	c2.fftr_inv_cfg.substate.twiddles.clear();
+	c2.fftr_inv_cfg.substate.radix4_tw.clear();
+	c2.fftr_inv_cfg.substate.radix4_buf.clear();
 	c2.fftr_inv_cfg.tmpbuf.clear();
 	c2.fftr_inv_cfg.super_twiddles.clear();
 	c2.Pn.clear();
@@ -229,6 +244,7 @@ int CCodec2::codec2_samples_per_frame()
 
 void CCodec2::codec2_encode(unsigned char *bits, const short *speech)
 {
+	C2_PROFILE(C2_STAGE_ENCODE);
 	assert(encode != NULL);
 
 	(*this.*encode)(bits, speech);
@@ -236,6 +252,7 @@ void CCodec2::codec2_encode(unsigned char *bits, const short *speech)
 
 void CCodec2::codec2_decode(short *speech, const unsigned char *bits)
 {
+	C2_PROFILE(C2_STAGE_DECODE);
 	assert(decode != NULL);
 
 	(*this.*decode)(speech, bits);
@@ -636,7 +653,7 @@ void CCodec2::analyse_one_frame(MODEL *model, const short *speech)
 	for(i=0; i<n_samp; i++)
 		c2.Sn[i+m_pitch-n_samp] = speech[i];
 
-	dft_speech(&c2.c2const, c2.fft_fwd_cfg, Sw, c2.Sn.data(), c2.w.data());
+	dft_speech(&c2.c2const, c2.fftr_fwd_cfg, Sw, c2.Sn.data(), c2.w.data());
 
 	/* Estimate pitch */
 	nlp.nlp(c2.Sn.data(), n_samp, &pitch, &c2.prev_f0_enc);
@@ -1119,14 +1136,16 @@ void CCodec2::make_analysis_window(C2CONST *c2const, FFT_STATE *fft_fwd_cfg, flo
 
 \*---------------------------------------------------------------------------*/
 
-void CCodec2::dft_speech(C2CONST *c2const, FFT_STATE &fft_fwd_cfg, std::complex<float> Sw[], float Sn[], float w[])
+void CCodec2::dft_speech(C2CONST *c2const, FFTR_STATE &fftr_fwd_cfg, std::complex<float> Sw[], float Sn[], float w[])
 {
+    C2_PROFILE(C2_STAGE_DFT_SPEECH);
     int  i;
     int  m_pitch = c2const->m_pitch;
     int   nw      = c2const->nw;
+    float sw[FFT_ENC];
 
     for(i=0; i<FFT_ENC; i++) {
-		Sw[i] = std::complex<float>(0.0f, 0.0f);
+		sw[i] = 0.0f;
     }
 
     /* Centre analysis window on time axis, we need to arrange input
@@ -1135,14 +1154,15 @@ void CCodec2::dft_speech(C2CONST *c2const, FFT_STATE &fft_fwd_cfg, std::complex<
     /* move 2nd half to start of FFT input vector */
 
     for(i=0; i<nw/2; i++)
-        Sw[i].real(Sn[i+m_pitch/2]*w[i+m_pitch/2]);
+        sw[i] = Sn[i+m_pitch/2]*w[i+m_pitch/2];
 
     /* move 1st half to end of FFT input vector */
 
     for(i=0; i<nw/2; i++)
-        Sw[FFT_ENC-nw/2+i].real(Sn[i+m_pitch/2-nw/2]*w[i+m_pitch/2-nw/2]);
+        sw[FFT_ENC-nw/2+i] = Sn[i+m_pitch/2-nw/2]*w[i+m_pitch/2-nw/2];
 
-    nlp.codec2_fft_inplace(fft_fwd_cfg, Sw);
+    /* input is real, so a half size complex FFT does the job */
+    kiss.fftr_full(fftr_fwd_cfg, sw, Sw);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -1158,6 +1178,7 @@ void CCodec2::dft_speech(C2CONST *c2const, FFT_STATE &fft_fwd_cfg, std::complex<
 
 void CCodec2::two_stage_pitch_refinement(C2CONST *c2const, MODEL *model, std::complex<float> Sw[])
 {
+	C2_PROFILE(C2_STAGE_PITCH_REFINEMENT);
 	float pmin,pmax,pstep;	/* pitch refinment minimum, maximum and step */
 
 	/* Coarse refinement */
@@ -1264,6 +1285,7 @@ void CCodec2::hs_pitch_refinement(MODEL *model, std::complex<float> Sw[], float
 
 void CCodec2::estimate_amplitudes(MODEL *model, std::complex<float> Sw[], int est_phase)
 {
+	C2_PROFILE(C2_STAGE_AMPLITUDES);
 	int   i,m;		/* loop variables */
 	int   am,bm;		/* bounds of current harmonic */
 	float den;		/* denominator of amplitude expression */
@@ -1311,6 +1333,7 @@ void CCodec2::estimate_amplitudes(MODEL *model, std::complex<float> Sw[], int es
 
 float CCodec2::est_voicing_mbe( C2CONST *c2const, MODEL *model, std::complex<float> Sw[], float  W[])
 {
+	C2_PROFILE(C2_STAGE_VOICING);
 	int   l,al,bl,m;    /* loop variables */
 	std::complex<float>  Am;             /* amplitude sample for this band */
 	int   offset;         /* centers Hw[] about current harmonic */
@@ -1474,6 +1497,7 @@ void CCodec2::synthesise(
 	int    shift          /* flag used to handle transition frames       */
 )
 {
+	C2_PROFILE(C2_STAGE_SYNTHESISE);
 	int   i,l,j,b;	        /* loop variables */
 	std::complex<float>  Sw_[FFT_DEC/2+1];	/* DFT of synthesised signal */
 	float sw_[FFT_DEC];	        /* synthesised signal */
@@ -111,6 +111,9 @@ using FFT_STATE = struct fft_state_tag
     bool inverse;
     int  factors[2*MAXFACTORS];
     std::vector<std::complex<float>> twiddles;
+    bool radix4;                   /* power of two size, use the vectorized radix-4 path */
+    std::vector<float> radix4_tw;  /* per stage w^p, w^2p, w^3p as split re/im arrays    */
+    std::vector<float> radix4_buf; /* split re/im ping-pong work buffers                 */
 };
 
 using FFTR_STATE = struct fftr_state_tag
@@ -14,10 +14,97 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <cstring>
 #include <cassert>
+#include <utility>
 
 #include "defines.h"
 #include "kiss_fft.h"
 
+/* 4 wide float vectors for the radix-4 path.  SSE or NEON when the target
+ * has it, otherwise plain arrays that the compiler can still unroll. */
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+typedef __m128 v4sf;
+static inline v4sf v4_ld(const float *p) { return _mm_loadu_ps(p); }
+static inline void v4_st(float *p, v4sf a) { _mm_storeu_ps(p, a); }
+static inline v4sf v4_set1(float f) { return _mm_set1_ps(f); }
+static inline v4sf v4_add(v4sf a, v4sf b) { return _mm_add_ps(a, b); }
+static inline v4sf v4_sub(v4sf a, v4sf b) { return _mm_sub_ps(a, b); }
+static inline v4sf v4_mul(v4sf a, v4sf b) { return _mm_mul_ps(a, b); }
+static inline void v4_transpose(v4sf &a, v4sf &b, v4sf &c, v4sf &d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+typedef float32x4_t v4sf;
+static inline v4sf v4_ld(const float *p) { return vld1q_f32(p); }
+static inline void v4_st(float *p, v4sf a) { vst1q_f32(p, a); }
+static inline v4sf v4_set1(float f) { return vdupq_n_f32(f); }
+static inline v4sf v4_add(v4sf a, v4sf b) { return vaddq_f32(a, b); }
+static inline v4sf v4_sub(v4sf a, v4sf b) { return vsubq_f32(a, b); }
+static inline v4sf v4_mul(v4sf a, v4sf b) { return vmulq_f32(a, b); }
+static inline void v4_transpose(v4sf &a, v4sf &b, v4sf &c, v4sf &d)
+{
+	float32x4x2_t ab = vtrnq_f32(a, b);
+	float32x4x2_t cd = vtrnq_f32(c, d);
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#else
+struct v4sf { float v[4]; };
+static inline v4sf v4_ld(const float *p) { v4sf r; for (int i=0; i<4; ++i) r.v[i] = p[i]; return r; }
+static inline void v4_st(float *p, v4sf a) { for (int i=0; i<4; ++i) p[i] = a.v[i]; }
+static inline v4sf v4_set1(float f) { v4sf r; for (int i=0; i<4; ++i) r.v[i] = f; return r; }
+static inline v4sf v4_add(v4sf a, v4sf b) { for (int i=0; i<4; ++i) a.v[i] += b.v[i]; return a; }
+static inline v4sf v4_sub(v4sf a, v4sf b) { for (int i=0; i<4; ++i) a.v[i] -= b.v[i]; return a; }
+static inline v4sf v4_mul(v4sf a, v4sf b) { for (int i=0; i<4; ++i) a.v[i] *= b.v[i]; return a; }
+static inline void v4_transpose(v4sf &a, v4sf &b, v4sf &c, v4sf &d)
+{
+	v4sf r[4] = { a, b, c, d };
+	for (int i=0; i<4; ++i)
+	{
+		a.v[i] = r[i].v[0];
+		b.v[i] = r[i].v[1];
+		c.v[i] = r[i].v[2];
+		d.v[i] = r[i].v[3];
+	}
+}
+#endif
+
+static inline float v4_add(float a, float b) { return a + b; }
+static inline float v4_sub(float a, float b) { return a - b; }
+static inline float v4_mul(float a, float b) { return a * b; }
+
+/* One radix-4 Stockham butterfly on split complex values, either a single
+ * point (V = float) or four points at once (V = v4sf).  On return a..d hold
+ * y[4p+0..3].  The inverse transform uses conjugate twiddles and the
+ * opposite rotation of (b-d). */
+template <typename V>
+static inline void radix4_bfly(V &ar, V &ai, V &br, V &bi, V &cr, V &ci, V &dr, V &di,
+	const V &w1r, const V &w1i, const V &w2r, const V &w2i, const V &w3r, const V &w3i, bool inverse)
+{
+	V apcr = v4_add(ar, cr), apci = v4_add(ai, ci);
+	V amcr = v4_sub(ar, cr), amci = v4_sub(ai, ci);
+	V bpdr = v4_add(br, dr), bpdi = v4_add(bi, di);
+	V bmdr = v4_sub(br, dr), bmdi = v4_sub(bi, di);
+	V ur = v4_add(amcr, bmdi), ui = v4_sub(amci, bmdr);
+	V vr = v4_sub(amcr, bmdi), vi = v4_add(amci, bmdr);
+	if (inverse)
+	{
+		std::swap(ur, vr);
+		std::swap(ui, vi);
+	}
+	V y2r = v4_sub(apcr, bpdr), y2i = v4_sub(apci, bpdi);
+
+	ar = v4_add(apcr, bpdr);
+	ai = v4_add(apci, bpdi);
+	br = v4_sub(v4_mul(ur, w1r), v4_mul(ui, w1i));
+	bi = v4_add(v4_mul(ur, w1i), v4_mul(ui, w1r));
+	cr = v4_sub(v4_mul(y2r, w2r), v4_mul(y2i, w2i));
+	ci = v4_add(v4_mul(y2r, w2i), v4_mul(y2i, w2r));
+	dr = v4_sub(v4_mul(vr, w3r), v4_mul(vi, w3i));
+	di = v4_add(v4_mul(vr, w3i), v4_mul(vi, w3r));
+}
+
 void CKissFFT::kf_bfly2(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m)
 {
 	std::complex<float> *Fout2;
@@ -315,12 +402,173 @@ void CKissFFT::fft_alloc(FFT_STATE &state, const int nfft, bool inverse_fft)
 	}
 
 	kf_factor(nfft, state.factors);
+	radix4_alloc(state);
+}
+
+/* Power of two sizes (FFT_ENC, FFT_DEC and the halved real FFTs built on
+ * them) run as a radix-4 Stockham FFT on split re/im arrays, with a final
+ * radix-2 pass for odd powers of two.  Each stage reads contiguous runs, so
+ * the butterflies are done four at a time.  Other sizes use kf_work(). */
+void CKissFFT::radix4_alloc(FFT_STATE &st)
+{
+	const int nfft = st.nfft;
+	const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+	const double sign = st.inverse ? 1.0 : -1.0;
+
+	st.radix4 = (nfft >= 4) && ((nfft & (nfft - 1)) == 0);
+	st.radix4_tw.clear();
+	st.radix4_buf.clear();
+	if (!st.radix4)
+		return;
+
+	for (int n = nfft; n >= 4; n /= 4)
+	{
+		const int n0 = n / 4;
+		const size_t base = st.radix4_tw.size();
+		st.radix4_tw.resize(base + 6 * n0);
+		float *tw = st.radix4_tw.data() + base;
+		for (int p = 0; p < n0; ++p)
+		{
+			for (int k = 1; k <= 3; ++k)
+			{
+				double phase = sign * 2.0 * pi * k * p / n;
+				tw[(2 * k - 2) * n0 + p] = float(cos(phase));
+				tw[(2 * k - 1) * n0 + p] = float(sin(phase));
+			}
+		}
+	}
+	st.radix4_buf.resize(4 * nfft);
+}
+
+void CKissFFT::radix4_work(FFT_STATE &st, const std::complex<float> *fin, std::complex<float> *fout)
+{
+	const int nfft = st.nfft;
+	const bool inverse = st.inverse;
+	const float *tw = st.radix4_tw.data();
+	float *xr = st.radix4_buf.data();
+	float *xi = xr + nfft;
+	float *yr = xi + nfft;
+	float *yi = yr + nfft;
+
+	for (int i = 0; i < nfft; ++i)
+	{
+		xr[i] = fin[i].real();
+		xi[i] = fin[i].imag();
+	}
+
+	int n = nfft;
+	int s = 1;
+	for (; n >= 4; n /= 4, s *= 4)
+	{
+		const int n0 = n / 4;
+		const float *w1r = tw, *w1i = tw + n0;
+		const float *w2r = tw + 2 * n0, *w2i = tw + 3 * n0;
+		const float *w3r = tw + 4 * n0, *w3i = tw + 5 * n0;
+
+		if ((s == 1) && (n0 >= 4))
+		{
+			/* first stage: vectorize across p, then transpose so that
+			 * y[4p..4p+3] land in consecutive lanes */
+			for (int p = 0; p < n0; p += 4)
+			{
+				v4sf ar = v4_ld(xr + p), ai = v4_ld(xi + p);
+				v4sf br = v4_ld(xr + p + n0), bi = v4_ld(xi + p + n0);
+				v4sf cr = v4_ld(xr + p + 2 * n0), ci = v4_ld(xi + p + 2 * n0);
+				v4sf dr = v4_ld(xr + p + 3 * n0), di = v4_ld(xi + p + 3 * n0);
+				radix4_bfly(ar, ai, br, bi, cr, ci, dr, di,
+					v4_ld(w1r + p), v4_ld(w1i + p), v4_ld(w2r + p), v4_ld(w2i + p), v4_ld(w3r + p), v4_ld(w3i + p), inverse);
+				v4_transpose(ar, br, cr, dr);
+				v4_transpose(ai, bi, ci, di);
+				v4_st(yr + 4 * p, ar);
+				v4_st(yr + 4 * p + 4, br);
+				v4_st(yr + 4 * p + 8, cr);
+				v4_st(yr + 4 * p + 12, dr);
+				v4_st(yi + 4 * p, ai);
+				v4_st(yi + 4 * p + 4, bi);
+				v4_st(yi + 4 * p + 8, ci);
+				v4_st(yi + 4 * p + 12, di);
+			}
+		}
+		else if (s >= 4)
+		{
+			/* later stages: vectorize across q, twiddles are constant */
+			for (int p = 0; p < n0; ++p)
+			{
+				const v4sf vw1r = v4_set1(w1r[p]), vw1i = v4_set1(w1i[p]);
+				const v4sf vw2r = v4_set1(w2r[p]), vw2i = v4_set1(w2i[p]);
+				const v4sf vw3r = v4_set1(w3r[p]), vw3i = v4_set1(w3i[p]);
+				const float *x0r = xr + s * p, *x0i = xi + s * p;
+				float *y0r = yr + s * 4 * p, *y0i = yi + s * 4 * p;
+				const int sn0 = s * n0;
+				for (int q = 0; q < s; q += 4)
+				{
+					v4sf ar = v4_ld(x0r + q), ai = v4_ld(x0i + q);
+					v4sf br = v4_ld(x0r + q + sn0), bi = v4_ld(x0i + q + sn0);
+					v4sf cr = v4_ld(x0r + q + 2 * sn0), ci = v4_ld(x0i + q + 2 * sn0);
+					v4sf dr = v4_ld(x0r + q + 3 * sn0), di = v4_ld(x0i + q + 3 * sn0);
+					radix4_bfly(ar, ai, br, bi, cr, ci, dr, di, vw1r, vw1i, vw2r, vw2i, vw3r, vw3i, inverse);
+					v4_st(y0r + q, ar);
+					v4_st(y0i + q, ai);
+					v4_st(y0r + q + s, br);
+					v4_st(y0i + q + s, bi);
+					v4_st(y0r + q + 2 * s, cr);
+					v4_st(y0i + q + 2 * s, ci);
+					v4_st(y0r + q + 3 * s, dr);
+					v4_st(y0i + q + 3 * s, di);
+				}
+			}
+		}
+		else
+		{
+			/* sizes 4 and 8 */
+			for (int p = 0; p < n0; ++p)
+			{
+				float ar = xr[p], ai = xi[p];
+				float br = xr[p + n0], bi = xi[p + n0];
+				float cr = xr[p + 2 * n0], ci = xi[p + 2 * n0];
+				float dr = xr[p + 3 * n0], di = xi[p + 3 * n0];
+				radix4_bfly(ar, ai, br, bi, cr, ci, dr, di, w1r[p], w1i[p], w2r[p], w2i[p], w3r[p], w3i[p], inverse);
+				yr[4 * p] = ar;
+				yi[4 * p] = ai;
+				yr[4 * p + 1] = br;
+				yi[4 * p + 1] = bi;
+				yr[4 * p + 2] = cr;
+				yi[4 * p + 2] = ci;
+				yr[4 * p + 3] = dr;
+				yi[4 * p + 3] = di;
+			}
+		}
+		tw += 6 * n0;
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	if (n == 2)
+	{
+		for (int q = 0; q < s; ++q)
+		{
+			yr[q] = xr[q] + xr[q + s];
+			yi[q] = xi[q] + xi[q + s];
+			yr[q + s] = xr[q] - xr[q + s];
+			yi[q + s] = xi[q] - xi[q + s];
+		}
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	for (int i = 0; i < nfft; ++i)
+		fout[i] = std::complex<float>(xr[i], xi[i]);
 }
 
 
 void CKissFFT::fft_stride(FFT_STATE &st, const std::complex<float> *fin, std::complex<float> *fout, int in_stride)
 {
-	if (fin == fout)
+	if (st.radix4 && (in_stride == 1))
+	{
+		// works from its own buffers, so fin == fout is fine
+		radix4_work(st, fin, fout);
+	}
+	else if (fin == fout)
 	{
 		//NOTE: this is not really an in-place FFT algorithm.
 		//It just performs an out-of-place FFT into a temp buffer
@@ -433,3 +681,15 @@ void CKissFFT::fftri(FFTR_STATE &st, const std::complex<float> *freqdata, float
 	}
 	fft (st.substate, st.tmpbuf.data(), (std::complex<float> *)timedata);
 }
+
+/* Forward real FFT returning all nfft bins, the upper half filled in from
+ * the conjugate symmetry of a real input.  Replaces a complex FFT of the
+ * same size on real data at roughly half the cost. */
+void CKissFFT::fftr_full(FFTR_STATE &st, const float *timedata, std::complex<float> *freqdata)
+{
+	auto ncfft = st.substate.nfft;
+
+	fftr(st, timedata, freqdata);
+	for (int k=1; k < ncfft; ++k)
+		freqdata[2*ncfft - k] = std::conj(freqdata[k]);
+}
@@ -23,7 +23,10 @@ public:
 	void fftr_alloc(FFTR_STATE &state, int nfft, const bool inverse_fft);
 	void fftr(FFTR_STATE &cfg,const float *timedata,std::complex<float> *freqdata);
 	void fftri(FFTR_STATE &cfg,const std::complex<float> *freqdata,float *timedata);
+	void fftr_full(FFTR_STATE &cfg, const float *timedata, std::complex<float> *freqdata);
 private:
+	void radix4_alloc(FFT_STATE &st);
+	void radix4_work(FFT_STATE &st, const std::complex<float> *fin, std::complex<float> *fout);
 	void kf_bfly2(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
 	void kf_bfly3(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
 	void kf_bfly4(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
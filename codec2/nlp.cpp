@@ -32,6 +32,7 @@
 #include "defines.h"
 #include "nlp.h"
 #include "kiss_fft.h"
+#include "profile.h"
 
 extern CKissFFT kiss;
 
@@ -194,7 +195,7 @@ void Cnlp::nlp_create(C2CONST *c2const)
 	for(i=0; i<NLP_NTAP; i++)
 		snlp.mem_fir[i] = 0.0;
 
-	kiss.fft_alloc(snlp.fft_cfg, PE_FFT_SIZE, false);
+	kiss.fftr_alloc(snlp.fftr_cfg, PE_FFT_SIZE, false);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -207,7 +208,11 @@ void Cnlp::nlp_create(C2CONST *c2const)
 
 void Cnlp::nlp_destroy()
 {
-	snlp.fft_cfg.twiddles.clear();
+	snlp.fftr_cfg.substate.twiddles.clear();
+	snlp.fftr_cfg.substate.radix4_tw.clear();
+	snlp.fftr_cfg.substate.radix4_buf.clear();
+	snlp.fftr_cfg.tmpbuf.clear();
+	snlp.fftr_cfg.super_twiddles.clear();
 }
 
 /*---------------------------------------------------------------------------*\
@@ -249,6 +254,7 @@ float Cnlp::nlp(
 	float *prev_f0 /* previous pitch f0 in Hz, memory for pitch tracking */
 )
 {
+	C2_PROFILE(C2_STAGE_NLP);
 	float  notch;		    /* current notch filter output          */
 	std::complex<float>   Fw[PE_FFT_SIZE]; /* DFT of squared signal (input/output) */
 	float  gmax;
@@ -329,19 +335,18 @@ float Cnlp::nlp(
 
 	/* Decimate and DFT */
 
+	float fw[PE_FFT_SIZE];
 	for(i=0; i<PE_FFT_SIZE; i++)
 	{
-		Fw[i].real(0);
-		Fw[i].imag(0);
+		fw[i] = 0;
 	}
 	for(i=0; i<m/DEC; i++)
 	{
-		Fw[i].real(snlp.sq[i*DEC]*snlp.w[i]);
+		fw[i] = snlp.sq[i*DEC]*snlp.w[i];
 	}
 
-	// FIXME: check if this can be converted to a real fft
-	// since all imag inputs are 0
-	codec2_fft_inplace(snlp.fft_cfg, Fw);
+	// all imag inputs are 0, so use a real fft
+	kiss.fftr_full(snlp.fftr_cfg, fw, Fw);
 
 	for(i=0; i<PE_FFT_SIZE; i++)
 		Fw[i].real(Fw[i].real() * Fw[i].real() + Fw[i].imag() * Fw[i].imag());
@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: profile.h
+
+  Optional per-stage timing of the codec2 encoder and decoder.  Only
+  compiled in when CODEC2_PROFILE is defined (see tools/codec2bench),
+  otherwise C2_PROFILE() expands to nothing.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_PROFILE__
+#define __CODEC2_PROFILE__
+
+#ifdef CODEC2_PROFILE
+
+#include <chrono>
+#include <cstdint>
+
+enum C2_STAGE
+{
+	C2_STAGE_ENCODE,
+	C2_STAGE_DECODE,
+	C2_STAGE_DFT_SPEECH,
+	C2_STAGE_NLP,
+	C2_STAGE_PITCH_REFINEMENT,
+	C2_STAGE_AMPLITUDES,
+	C2_STAGE_VOICING,
+	C2_STAGE_LPC_TO_LSP,
+	C2_STAGE_AKS_TO_M2,
+	C2_STAGE_SYNTHESISE,
+	C2_STAGE_COUNT
+};
+
+struct c2_stage_stats
+{
+	uint64_t ns;
+	uint64_t calls;
+};
+
+extern c2_stage_stats c2_profile[C2_STAGE_COUNT];
+extern const char *c2_stage_names[C2_STAGE_COUNT];
+
+class C2ProfileScope
+{
+public:
+	explicit C2ProfileScope(C2_STAGE s) : stage(s), start(std::chrono::steady_clock::now()) {}
+	~C2ProfileScope()
+	{
+		c2_profile[stage].ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		c2_profile[stage].calls++;
+	}
+private:
+	C2_STAGE stage;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define C2_PROFILE(stage) C2ProfileScope c2_profile_scope(stage)
+
+#else
+
+#define C2_PROFILE(stage)
+
+#endif
+
+#endif
@@ -35,6 +35,7 @@
 #include "quantise.h"
 #include "lpc.h"
 #include "kiss_fft.h"
+#include "profile.h"
 
 extern CKissFFT kiss;
 
@@ -335,6 +336,7 @@ void CQuantize::aks_to_M2(
 	std::complex<float>          Aw[]         /* output power spectrum */
 )
 {
+	C2_PROFILE(C2_STAGE_AKS_TO_M2);
 	int i,m;		/* loop variables */
 	int am,bm;		/* limits of current band */
 	float r;		/* no. rads/bin */
@@ -730,6 +732,7 @@ int CQuantize::lpc_to_lsp(float *a, int order, float *freq, int nb, float delta)
 /*  int nb			number of sub-intervals (4) 		*/
 /*  float delta			grid spacing interval (0.02) 		*/
 {
+	C2_PROFILE(C2_STAGE_LPC_TO_LSP);
 	float psuml,psumr,psumm,temp_xr,xl,xr,xm = 0;
 	float temp_psumr;
 	int i,j,m,flag,k;
@@ -31,27 +31,13 @@ DCSCodec::~DCSCodec()
 {
 }
 
-void DCSCodec::process_udp()
+void DCSCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
 	static bool sd_sync = 0;
 	static int sd_seq = 0;
 	static char user_data[21];
-	buf.resize(200);
-	//qDebug() << "buf size before == " << buf.size();
-	//buf.resize(m_udp->pendingDatagramSize());
-	//qDebug() << "buf size after == " << buf.size();
-	int size = m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < size; ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	int size = buf.size();
+	DSLOG_HEX(Logger::DCS, "RECV", buf.data(), size);
 	if(size == 22){ //2 way keep alive ping
 		m_modeinfo.count++;
 		m_modeinfo.netmsg.clear();
@@ -63,29 +49,18 @@ void DCSCodec::process_udp()
 	if( (m_modeinfo.status == CONNECTING) && (size == 14) && (!memcmp(buf.data()+10, "ACK", 3)) ){
 		qDebug() << "Connected to DCS";
 		m_modeinfo.status = CONNECTED_RW;
-		m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-		if(m_vocoder != ""){
-			m_hwrx = true;
-			m_hwtx = true;
-			m_modeinfo.hw_vocoder_loaded = true;
-			m_ambedev = new SerialAMBE("DCS");
-			m_ambedev->connect_to_serial(m_vocoder);
-			connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-		}
-		else{
-			m_hwrx = false;
-			m_hwtx = false;
-		}
+		m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2400x1200);
+		open_hw_vocoder("DCS");
 		if(m_modemport != ""){
 			m_modem = new SerialModem("DCS");
 			m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 			m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 			m_modem->connect_to_serial(m_modemport);
-			connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+			connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 		}
-		m_rxtimer = new QTimer();
+		m_rxtimer = new MediaTimer(this);
 		connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
-		m_txtimer = new QTimer();
+		m_txtimer = new MediaTimer(this);
 		connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 		m_ping_timer = new QTimer();
 		connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
@@ -98,7 +73,7 @@ void DCSCodec::process_udp()
 	if(m_modeinfo.status != CONNECTED_RW) return;
 	if(size == 35){
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-		m_modeinfo.netmsg = QString(buf.data());
+		m_modeinfo.netmsg = QString::fromUtf8(buf.data(), qstrnlen(buf.data(), size));
 	}
 	if((size == 100) && (!memcmp(buf.data(), "0001", 4)) ){
 		m_rxwatchdog = 0;
@@ -109,6 +84,7 @@ void DCSCodec::process_udp()
 			m_modeinfo.streamid = streamid;
 			m_modeinfo.stream_state = STREAM_NEW;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
+			stats_start(20, 21);
 
 			if(!m_rxtimer->isActive()){
 				m_audio->start_playback();
@@ -141,12 +117,9 @@ void DCSCodec::process_udp()
 				memcpy(out + 30, m_modeinfo.src.toLocal8Bit().data(), 8);
 				memcpy(out + 38, buf.data() + 52, 4);
 				CCRC::addCCITT161((uint8_t *)out + 3, 41);
-				for(int i = 0; i < 44; ++i){
-					m_rxmodemq.append(out[i]);
-				}
-				//m_modem->write(out);
+				m_modem->write(QByteArray((char *)out, 44));
 			}
-			qDebug() << "New stream from " << m_modeinfo.src << " to " << m_modeinfo.dst << " id == " << QString::number(m_modeinfo.streamid, 16);
+			DSLOG(Logger::DCS, Logger::Info, "New stream from %s to %s id == %x", qPrintable(m_modeinfo.src), qPrintable(m_modeinfo.dst), m_modeinfo.streamid);
 		}
 		else{
 			m_modeinfo.stream_state = STREAMING;
@@ -206,28 +179,28 @@ void DCSCodec::process_udp()
 			m_modeinfo.usertxt = QString(user_data);
 		}
 		if(buf.data()[45] & 0x40){
-			qDebug() << "DCS RX stream ended ";
+			DSLOG(Logger::DCS, Logger::Info, "DCS RX stream ended");
 			m_rxwatchdog = 0;
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 			emit update(m_modeinfo);
 			m_modeinfo.streamid = 0;
 			if(m_modem){
-				m_rxmodemq.append(MMDVM_FRAME_START);
-				m_rxmodemq.append(3);
-				m_rxmodemq.append(MMDVM_DSTAR_EOT);
+				const char eot[3] = { (char)MMDVM_FRAME_START, 3, MMDVM_DSTAR_EOT };
+				m_modem->write(QByteArray(eot, 3));
 			}
 		}
 		else if(m_modeinfo.stream_state == STREAMING){
 			if(m_modem){
-				m_rxmodemq.append(MMDVM_FRAME_START);
-				m_rxmodemq.append(15);
-				m_rxmodemq.append(MMDVM_DSTAR_DATA);
-				for(int i = 0; i < 12; ++i){
-					m_rxmodemq.append(buf.data()[46+i]);
-				}
+				QByteArray out;
+				out.append((char)MMDVM_FRAME_START);
+				out.append(15);
+				out.append(MMDVM_DSTAR_DATA);
+				out.append(buf.constData() + 46, 12);
+				m_modem->write(out);
 			}
 		}
+		stats_rx(buf.data()[0x2d] & 0x1f);
 		for(int i = 0; i < 9; ++i){
 			m_rxcodecq.append(buf.data()[46+i]);
 		}
@@ -254,16 +227,9 @@ void DCSCodec::hostname_lookup(QHostInfo i)
 		//out.append(508, 0);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::DCS, "CONN", out.data(), out.size());
 	}
 }
 
@@ -279,14 +245,7 @@ void DCSCodec::send_ping()
 	out.append('\x00');
 	out.append(m_module);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DCS, "PING", out.data(), out.size());
 }
 
 void DCSCodec::send_disconnect()
@@ -298,14 +257,7 @@ void DCSCodec::send_disconnect()
 	out.append(' ');
 	out.append('\x00');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DCS, "SEND", out.data(), out.size());
 }
 
 void DCSCodec::format_callsign(QString &s)
@@ -398,22 +350,19 @@ void DCSCodec::transmit()
 	}
 	if(m_hwtx){
 		m_ambedev->encode(pcm);
-		if(m_tx && (m_txcodecq.size() >= 9)){
-			for(int i = 0; i < 9; ++i){
-				ambe[i] = m_txcodecq.dequeue();
-			}
-			send_frame(ambe);
-		}
-		else if(!m_tx){
-			send_frame(ambe);
-		}
 	}
 	else{
-		if(m_modeinfo.sw_vocoder_loaded){
-			m_mbevocoder->encode_2400x1200(pcm, ambe);
+		sw_encode(pcm, 160);
+	}
+	if(m_tx && (m_txcodecq.size() >= 9)){
+		for(int i = 0; i < 9; ++i){
+			ambe[i] = m_txcodecq.dequeue();
 		}
 		send_frame(ambe);
 	}
+	else if(!m_tx){
+		send_frame(ambe);
+	}
 }
 
 void DCSCodec::send_frame(uint8_t *ambe)
@@ -526,14 +475,7 @@ void DCSCodec::send_frame(uint8_t *ambe)
 	emit update_output_level(m_audio->level());
 	update(m_modeinfo);
 
-#ifdef DEBUG
-	fprintf(stderr, "SEND:%d: ", txdata.size());
-	for(int i = 0; i < txdata.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DCS, "SEND", txdata.data(), txdata.size());
 }
 
 void DCSCodec::get_ambe()
@@ -553,7 +495,7 @@ void DCSCodec::process_rx_data()
 	uint8_t ambe[9];
 
 	if(m_rxwatchdog++ > 100){
-		qDebug() << "DCS RX stream timeout ";
+		DSLOG(Logger::DCS, Logger::Info, "DCS RX stream timeout");
 		m_rxwatchdog = 0;
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -561,17 +503,6 @@ void DCSCodec::process_rx_data()
 		m_modeinfo.streamid = 0;
 	}
 
-	if(m_rxmodemq.size() > 2){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == MMDVM_FRAME_START) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-	}
-
 	if((!m_tx) && (m_rxcodecq.size() > 8) ){
 		for(int i = 0; i < 9; ++i){
 			ambe[i] = m_rxcodecq.dequeue();
@@ -585,14 +516,7 @@ void DCSCodec::process_rx_data()
 			}
 		}
 		else{
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->decode_2400x1200(pcm, ambe);
-			}
-			else{
-				memset(pcm, 0, 160 * sizeof(int16_t));
-			}
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+			sw_decode(ambe, 9, 1.0f);
 		}
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -601,7 +525,7 @@ void DCSCodec::process_rx_data()
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
 		m_rxcodecq.clear();
-		qDebug() << "DCS playback stopped";
+		DSLOG(Logger::DCS, Logger::Info, "DCS playback stopped");
 		return;
 	}
 }
@@ -33,7 +33,7 @@ private:
 private slots:
 	void toggle_tx(bool);
 	void start_tx();
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_modem_data(QByteArray);
 	void process_rx_data();
 	void get_ambe();
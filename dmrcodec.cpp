@@ -70,26 +70,14 @@ DMRCodec::~DMRCodec()
 {
 }
 
-void DMRCodec::process_udp()
+void DMRCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray in;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
 	CSHA256 sha256;
 	char buffer[400U];
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DMR, "RECV", buf.data(), buf.size());
 	if((m_modeinfo.status != CONNECTED_RW) && (::memcmp(buf.data() + 3, "NAK", 3U) == 0)){
 		//m_udp->disconnect();
 		//m_udp->close();
@@ -192,13 +180,17 @@ void DMRCodec::process_udp()
 		m_rxwatchdog = 0;
 		uint8_t t;
 		if((uint8_t)buf.data()[15] & 0x02){
-			qDebug() << "DMR RX EOT";
+			DSLOG(Logger::DMR, Logger::Info, "DMR RX EOT");
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 			m_modeinfo.streamid = 0;
+			m_jitter.set_ended();
 			t = 0x42;
 		}
 		else if((uint8_t)buf.data()[15] & 0x01){
+			m_jitter.reset();
+			m_jitter.configure(20, 9, 256);
+			stats_start(60, 256);
 			m_audio->start_playback();
 			if(!m_rxtimer->isActive()){
 				m_rxtimer->start(m_rxtimerint);
@@ -211,19 +203,16 @@ void DMRCodec::process_udp()
 			m_modeinfo.streamid = (uint32_t)((buf.data()[16] << 24) | ((buf.data()[17] << 16) & 0xff0000) | ((buf.data()[18] << 8) & 0xff00) | (buf.data()[19] & 0xff));
 			m_modeinfo.frame_number = buf.data()[4];
 			t = 0x41;
-			qDebug() << "New DMR stream from " << m_modeinfo.srcid << " to " << m_modeinfo.dstid;
+			DSLOG(Logger::DMR, Logger::Info, "New DMR stream from %u to %u", m_modeinfo.srcid, m_modeinfo.dstid);
 		}
 		if(m_modem){
-			m_rxmodemq.append(MMDVM_FRAME_START);
-			m_rxmodemq.append(0x25);
-			m_rxmodemq.append(MMDVM_DMR_DATA2);
-			m_rxmodemq.append(t);
-
-			for(int i = 0; i < 33; ++i){
-				m_rxmodemq.append(buf.data()[20+i]);
-			};
-			//m_rxmodemq.append('\x00');
-			//m_rxmodemq.append(0x2f);
+			QByteArray frame;
+			frame.append((char)MMDVM_FRAME_START);
+			frame.append(0x25);
+			frame.append(MMDVM_DMR_DATA2);
+			frame.append(t);
+			frame.append(buf.constData() + 20, 33);
+			m_modem->write(frame);
 		}
 	}
 	if((buf.size() == 55) &&
@@ -232,6 +221,9 @@ void DMRCodec::process_udp()
 		(m_modeinfo.status == CONNECTED_RW))
 	{
 		if(!m_tx && ( (m_modeinfo.stream_state == STREAM_LOST) || (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_IDLE) )){
+			m_jitter.reset();
+			m_jitter.configure(20, 9, 256);
+			stats_start(60, 256);
 			m_audio->start_playback();
 			if(!m_rxtimer->isActive()){
 				m_rxtimer->start(m_rxtimerint);
@@ -267,66 +259,45 @@ void DMRCodec::process_udp()
 			uint8_t t = ((uint8_t)buf.data()[15] & 0x0f);
 			if(!t) t = 0x20;
 
-			m_rxmodemq.append(MMDVM_FRAME_START);
-			m_rxmodemq.append(0x25);
-			m_rxmodemq.append(MMDVM_DMR_DATA2);
-			m_rxmodemq.append(t);
-
-			for(int i = 0; i < 33; ++i){
-				m_rxmodemq.append(buf.data()[20+i]);
-			}
+			QByteArray frame;
+			frame.append((char)MMDVM_FRAME_START);
+			frame.append(0x25);
+			frame.append(MMDVM_DMR_DATA2);
+			frame.append(t);
+			frame.append(buf.constData() + 20, 33);
+			m_modem->write(frame);
 		}
 
-		for(int i = 0; i < 3; ++i){
-			for(int j = 0; j < 9; ++j){
-				m_rxcodecq.append(dmr3ambe[j + (9*i)]);
-			}
-		}
+		stats_rx((uint8_t)buf.data()[4]);
+		m_jitter.push((uint8_t)buf.data()[4], dmr3ambe, 3, media_ms());
 		//uint32_t id = (uint32_t)((buf.data()[5] << 16) | ((buf.data()[6] << 8) & 0xff00) | (buf.data()[7] & 0xff));
 	}
+	update_jitter_info();
 	emit update(m_modeinfo);
-#ifdef DEBUG
 	if(out.size() > 0){
-		fprintf(stderr, "SEND: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		DSLOG_HEX(Logger::DMR, "SEND", out.data(), out.size());
 	}
-#endif
 }
 
 void DMRCodec::setup_connection()
 {
 	m_modeinfo.status = CONNECTED_RW;
 	//m_mbeenc->set_gain_adjust(2.5);
-	m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-	m_txtimer = new QTimer();
+	m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2450x1150);
+	m_txtimer = new MediaTimer(this);
 	connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
-	m_rxtimer = new QTimer();
+	m_rxtimer = new MediaTimer(this);
 	connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
 	m_ping_timer = new QTimer();
 	connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
 	m_ping_timer->start(5000);
-	if(m_vocoder != ""){
-		m_hwrx = true;
-		m_hwtx = true;
-		m_modeinfo.hw_vocoder_loaded = true;
-		m_ambedev = new SerialAMBE("DMR");
-		m_ambedev->connect_to_serial(m_vocoder);
-		connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-	}
-	else{
-		m_hwrx = false;
-		m_hwtx = false;
-	}
+	open_hw_vocoder("DMR");
 	if(m_modemport != ""){
 		m_modem = new SerialModem("DMR");
 		m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 		m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 		m_modem->connect_to_serial(m_modemport);
-		connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+		connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 	}
 	m_audio = new AudioEngine(m_audioin, m_audioout);
 	m_audio->init();
@@ -346,16 +317,9 @@ void DMRCodec::hostname_lookup(QHostInfo i)
 		out.append((m_essid >> 0) & 0xff);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::DMR, "CONN", out.data(), out.size());
 	}
 }
 
@@ -369,14 +333,7 @@ void DMRCodec::send_ping()
 	out.append((m_essid >> 8) & 0xff);
 	out.append((m_essid >> 0) & 0xff);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DMR, "PING", out.data(), out.size());
 }
 
 void DMRCodec::send_disconnect()
@@ -392,14 +349,7 @@ void DMRCodec::send_disconnect()
 	out.append((m_essid >> 8) & 0xff);
 	out.append((m_essid >> 0) & 0xff);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DMR, "SEND", out.data(), out.size());
 }
 
 void DMRCodec::process_modem_data(QByteArray d)
@@ -437,19 +387,11 @@ void DMRCodec::process_modem_data(QByteArray d)
 		m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
 		++m_dmrcnt;
 	}
-#ifdef DEBUG
-	fprintf(stderr, "SEND:%d: ", txdata.size());
-	for(int i = 0; i < txdata.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DMR, "SEND", txdata.data(), txdata.size());
 }
 
 void DMRCodec::transmit()
 {
-	uint8_t ambe[72];
 	int16_t pcm[160];
 
 #ifdef USE_FLITE
@@ -477,12 +419,7 @@ void DMRCodec::transmit()
 		m_ambedev->encode(pcm);
 	}
 	else{
-		if(m_modeinfo.sw_vocoder_loaded){
-			m_mbevocoder->encode_2450x1150(pcm, ambe);
-		}
-		for(int i = 0; i < 9; ++i){
-			m_txcodecq.append(ambe[i]);
-		}
+		sw_encode(pcm, 160);
 	}
 
 	if(m_tx && (m_txcodecq.size() >= 27)){
@@ -559,14 +496,7 @@ void DMRCodec::send_frame()
 	}
 	emit update_output_level(m_audio->level());
 	emit update(m_modeinfo);
-#ifdef DEBUG
-	fprintf(stderr, "SEND:%d: ", txdata.size());
-	for(int i = 0; i < txdata.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::DMR, "SEND", txdata.data(), txdata.size());
 }
 
 unsigned char * DMRCodec::get_eot()
@@ -918,50 +848,34 @@ void DMRCodec::process_rx_data()
 {
 	int16_t pcm[160];
 	uint8_t ambe[9];
-	static uint8_t cnt = 0;
 
 	if(m_rxwatchdog++ > 100){
-		qDebug() << "DMR RX stream timeout ";
+		DSLOG(Logger::DMR, Logger::Info, "DMR RX stream timeout");
 		m_rxwatchdog = 0;
+		m_jitter.set_ended();
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 		emit update(m_modeinfo);
 		m_modeinfo.streamid = 0;
 	}
 
-	if((m_rxmodemq.size() > 2) && (++cnt >= 3)){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == MMDVM_FRAME_START) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-		cnt = 0;
-	}
+	float gain;
+	int r = JitterBuffer::EMPTY;
 
-	if((!m_tx) && (m_rxcodecq.size() > 8) ){
-		for(int i = 0; i < 9; ++i){
-			ambe[i] = m_rxcodecq.dequeue();
-		}
+	if((!m_tx) && ((r = m_jitter.pop(ambe, gain)) != JitterBuffer::EMPTY) ){
 		if(m_hwrx){
 			m_ambedev->decode(ambe);
 
 			if(m_ambedev->get_audio(pcm)){
+				if(r == JitterBuffer::CONCEALED){
+					apply_gain(pcm, 160, gain);
+				}
 				m_audio->write(pcm, 160);
 				emit update_output_level(m_audio->level());
 			}
 		}
 		else{
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->decode_2450x1150(pcm, ambe);
-			}
-			else{
-				memset(pcm, 0, 160 * sizeof(int16_t));
-			}
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+			sw_decode(ambe, 9, (r == JitterBuffer::CONCEALED) ? gain : 1.0f);
 		}
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -969,8 +883,8 @@ void DMRCodec::process_rx_data()
 		m_audio->stop_playback();
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
-		m_rxcodecq.clear();
-		qDebug() << "DMR playback stopped";
+		DSLOG(Logger::DMR, Logger::Info, "DMR playback stopped, jitter buffer late: %u lost: %u reordered: %u", m_jitter.late(), m_jitter.lost(), m_jitter.reordered());
+		m_jitter.reset();
 		return;
 	}
 }
@@ -34,7 +34,7 @@ public:
 	void set_slot(uint32_t s){m_slot = s;}
 	void set_calltype(uint8_t c){m_flco = FLCO(c);}
 private slots:
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_rx_data();
 	void process_modem_data(QByteArray);
 	void get_ambe();
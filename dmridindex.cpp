@@ -0,0 +1,299 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "dmridindex.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <QHash>
+#include <QSaveFile>
+#include <QDebug>
+
+// Index file layout, native endian:
+//   header
+//   records  count x { uint32 id, uint32 callsign offset into blob }
+//   hash     hash_size x uint32 record index + 1, 0 == empty slot
+//   blob     NUL terminated callsigns, each stored once
+namespace {
+const char IDX_MAGIC[4] = {'D', 'S', 'I', 'D'};
+const uint32_t IDX_VERSION = 1;
+
+struct idx_header {
+	char magic[4];
+	uint32_t version;
+	int64_t src_size;
+	int64_t src_mtime;
+	uint32_t count;
+	uint32_t hash_size;
+	uint32_t blob_size;
+	uint32_t reserved;
+};
+
+uint32_t hash_callsign(const char *cs, int len)
+{
+	uint32_t h = 2166136261U;
+	for(int i = 0; i < len; ++i){
+		h ^= (uint8_t)cs[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+bool is_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+}
+
+DMRIDIndex::DMRIDIndex() :
+	m_base(nullptr),
+	m_records(nullptr),
+	m_hash(nullptr),
+	m_blob(nullptr),
+	m_count(0),
+	m_hashmask(0),
+	m_blobsize(0)
+{
+}
+
+DMRIDIndex::~DMRIDIndex()
+{
+	close();
+}
+
+void DMRIDIndex::close()
+{
+	if(m_base){
+		m_file.unmap((uchar *)m_base);
+	}
+	m_file.close();
+	m_base = nullptr;
+	m_records = nullptr;
+	m_hash = nullptr;
+	m_blob = nullptr;
+	m_count = 0;
+	m_hashmask = 0;
+	m_blobsize = 0;
+}
+
+bool DMRIDIndex::open(const QString &datfile)
+{
+	close();
+
+	QFileInfo src(datfile);
+	if(!src.exists() || !src.isFile()){
+		return false;
+	}
+
+	const QString idxfile = src.absolutePath() + "/" + src.completeBaseName() + ".idx";
+	if(map(idxfile, src)){
+		return true;
+	}
+
+	if(!build(datfile, idxfile)){
+		qDebug() << "Failed to build DMR ID index " << idxfile;
+		return false;
+	}
+	return map(idxfile, src);
+}
+
+bool DMRIDIndex::map(const QString &idxfile, const QFileInfo &src)
+{
+	m_file.setFileName(idxfile);
+	if(!m_file.open(QIODevice::ReadOnly)){
+		return false;
+	}
+
+	const qint64 fsize = m_file.size();
+	idx_header h;
+	if((fsize < (qint64)sizeof(h)) || (m_file.read((char *)&h, sizeof(h)) != sizeof(h)) ||
+		::memcmp(h.magic, IDX_MAGIC, 4) || (h.version != IDX_VERSION) ||
+		(h.src_size != src.size()) || (h.src_mtime != src.lastModified().toMSecsSinceEpoch()) ||
+		(h.hash_size == 0) || (h.hash_size & (h.hash_size - 1)) ||
+		(fsize != (qint64)(sizeof(h) + (qint64)h.count * 8 + (qint64)h.hash_size * 4 + h.blob_size)))
+	{
+		m_file.close();
+		return false;
+	}
+
+	m_base = m_file.map(0, fsize);
+	if(m_base == nullptr){
+		m_file.close();
+		return false;
+	}
+	m_records = (const uint32_t *)(m_base + sizeof(h));
+	m_hash = m_records + (h.count * 2);
+	m_blob = (const char *)(m_hash + h.hash_size);
+	m_count = h.count;
+	m_hashmask = h.hash_size - 1;
+	m_blobsize = h.blob_size;
+	return true;
+}
+
+bool DMRIDIndex::build(const QString &datfile, const QString &idxfile)
+{
+	QFile f(datfile);
+	if(!f.open(QIODevice::ReadOnly)){
+		return false;
+	}
+	QFileInfo src(datfile);
+	const QByteArray data = f.readAll();
+	f.close();
+
+	struct entry {
+		uint32_t id;
+		uint32_t line;
+		uint32_t cs;
+	};
+	std::vector<entry> entries;
+	entries.reserve(data.size() / 24);
+	QHash<QByteArray, uint32_t> interned;
+	QByteArray blob;
+
+	const char *p = data.constData();
+	const char *end = p + data.size();
+	uint32_t line = 0;
+	while(p < end){
+		const char *eol = (const char *)::memchr(p, '\n', end - p);
+		if(eol == nullptr){
+			eol = end;
+		}
+		const char *c = p;
+		while((c < eol) && is_space(*c)) ++c;
+		if((c < eol) && (*c != '#')){
+			uint64_t id = 0;
+			const char *d = c;
+			while((d < eol) && (*d >= '0') && (*d <= '9')){
+				id = id * 10 + (*d - '0');
+				++d;
+			}
+			const char *cs = d;
+			while((cs < eol) && is_space(*cs)) ++cs;
+			const char *cse = cs;
+			while((cse < eol) && !is_space(*cse)) ++cse;
+			if((d > c) && (id <= 0xFFFFFFFFULL) && (cse > cs) && (cs > d)){
+				const QByteArray key(cs, cse - cs);
+				auto it = interned.constFind(key);
+				uint32_t off;
+				if(it == interned.constEnd()){
+					off = blob.size();
+					blob.append(key);
+					blob.append('\0');
+					interned.insert(key, off);
+				}
+				else{
+					off = it.value();
+				}
+				entries.push_back({(uint32_t)id, line++, off});
+			}
+		}
+		p = eol + 1;
+	}
+
+	// Later lines win for a repeated ID, as they did with the QMap
+	std::sort(entries.begin(), entries.end(), [](const entry &a, const entry &b){
+		return (a.id != b.id) ? (a.id < b.id) : (a.line > b.line);
+	});
+	entries.erase(std::unique(entries.begin(), entries.end(), [](const entry &a, const entry &b){
+		return a.id == b.id;
+	}), entries.end());
+
+	idx_header h;
+	::memset(&h, 0, sizeof(h));
+	::memcpy(h.magic, IDX_MAGIC, 4);
+	h.version = IDX_VERSION;
+	h.src_size = src.size();
+	h.src_mtime = src.lastModified().toMSecsSinceEpoch();
+	h.count = entries.size();
+	h.hash_size = 16;
+	while(h.hash_size < (h.count * 2)){
+		h.hash_size <<= 1;
+	}
+	h.blob_size = blob.size();
+
+	std::vector<uint32_t> records(h.count * 2);
+	std::vector<uint32_t> hash(h.hash_size, 0);
+	const uint32_t mask = h.hash_size - 1;
+	for(uint32_t i = 0; i < h.count; ++i){
+		records[i*2] = entries[i].id;
+		records[i*2+1] = entries[i].cs;
+
+		// Records are in ID order, so the first one in for a callsign is its
+		// lowest ID.  Same answer QMap::key() gave.
+		const char *cs = blob.constData() + entries[i].cs;
+		const int len = ::strlen(cs);
+		uint32_t slot = hash_callsign(cs, len) & mask;
+		bool dup = false;
+		while(hash[slot]){
+			if(!::strcmp(blob.constData() + records[(hash[slot] - 1) * 2 + 1], cs)){
+				dup = true;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+		if(!dup){
+			hash[slot] = i + 1;
+		}
+	}
+
+	QSaveFile out(idxfile);
+	if(!out.open(QIODevice::WriteOnly)){
+		return false;
+	}
+	out.write((const char *)&h, sizeof(h));
+	out.write((const char *)records.data(), records.size() * sizeof(uint32_t));
+	out.write((const char *)hash.data(), hash.size() * sizeof(uint32_t));
+	out.write(blob);
+	return out.commit();
+}
+
+QString DMRIDIndex::callsign(uint32_t id) const
+{
+	uint32_t lo = 0;
+	uint32_t hi = m_count;
+	while(lo < hi){
+		const uint32_t mid = lo + ((hi - lo) >> 1);
+		const uint32_t v = m_records[mid*2];
+		if(v == id){
+			return QString::fromLatin1(m_blob + m_records[mid*2+1]);
+		}
+		if(v < id){
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+	return QString();
+}
+
+uint32_t DMRIDIndex::id(const QString &callsign) const
+{
+	if(m_hash == nullptr){
+		return 0;
+	}
+	const QByteArray cs = callsign.toLatin1();
+	uint32_t slot = hash_callsign(cs.constData(), cs.size()) & m_hashmask;
+	while(m_hash[slot]){
+		const uint32_t r = m_hash[slot] - 1;
+		if(!::strcmp(m_blob + m_records[r*2+1], cs.constData())){
+			return m_records[r*2];
+		}
+		slot = (slot + 1) & m_hashmask;
+	}
+	return 0;
+}
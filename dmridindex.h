@@ -0,0 +1,57 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMRIDINDEX_H
+#define DMRIDINDEX_H
+
+#include <cstdint>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+
+// Read only ID <-> callsign lookup over DMRIDs.dat.  The text file is
+// converted once into a binary index next to it (DMRIDs.idx) that is mapped
+// into memory instead of being loaded into a QMap.  The index holds ID
+// records sorted for binary search, an open addressed hash of callsigns for
+// the reverse lookup and a blob of interned callsign strings.  It is rebuilt
+// whenever the size or modification time of the source file changes.
+class DMRIDIndex
+{
+public:
+	DMRIDIndex();
+	~DMRIDIndex();
+	bool open(const QString &datfile);
+	void close();
+	bool is_open() const { return m_base != nullptr; }
+	uint32_t size() const { return m_count; }
+	QString callsign(uint32_t id) const;
+	uint32_t id(const QString &callsign) const;
+	static bool build(const QString &datfile, const QString &idxfile);
+private:
+	bool map(const QString &idxfile, const QFileInfo &src);
+
+	QFile m_file;
+	const uint8_t *m_base;
+	const uint32_t *m_records;
+	const uint32_t *m_hash;
+	const char *m_blob;
+	uint32_t m_count;
+	uint32_t m_hashmask;
+	uint32_t m_blobsize;
+};
+
+#endif // DMRIDINDEX_H
@@ -43,8 +43,11 @@ DroidStar::DroidStar(QObject *parent) :
 	m_outlevel(0)
 {
 	qRegisterMetaType<M17Codec::MODEINFO>("Codec::MODEINFO");
+	qRegisterMetaType<HostMap>("HostMap");
 	m_settings_processed = false;
 	m_modelchange = false;
+	m_hostgen = 0;
+	m_laststreamstate = Codec::STREAM_IDLE;
 	connect_status = Codec::DISCONNECTED;
 	m_settings = new QSettings(QSettings::IniFormat, QSettings::UserScope, "dudetronics", "droidstar", this);
 	config_path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
@@ -64,6 +67,28 @@ DroidStar::DroidStar(QObject *parent) :
 	}
 #endif
 
+	m_hostloader = new HostLoader(config_path);
+	m_hostthread = new QThread;
+	m_hostloader->moveToThread(m_hostthread);
+	connect(this, SIGNAL(load_hosts(QString, QString, QString, quint64)), m_hostloader, SLOT(load(QString, QString, QString, quint64)));
+	connect(m_hostloader, SIGNAL(hosts_loaded(QString, quint64, HostMap)), this, SLOT(hosts_loaded(QString, quint64, HostMap)));
+	connect(m_hostthread, SIGNAL(finished()), m_hostloader, SLOT(deleteLater()));
+	m_hostprober = new HostProber;
+	m_hostprober->moveToThread(m_hostthread);
+	connect(this, SIGNAL(start_probe(QString, HostMap, quint32, bool)), m_hostprober, SLOT(probe(QString, HostMap, quint32, bool)));
+	connect(m_hostprober, SIGNAL(probe_finished(QString, QVariantList)), this, SLOT(probe_finished(QString, QVariantList)));
+	connect(m_hostthread, SIGNAL(finished()), m_hostprober, SLOT(deleteLater()));
+	m_hostthread->start();
+
+	m_http = new HttpManager;
+	m_httpthread = new QThread;
+	m_http->moveToThread(m_httpthread);
+	connect(this, SIGNAL(start_download(QString, bool)), m_http, SLOT(download(QString, bool)));
+	connect(m_http, SIGNAL(file_downloaded(QString)), this, SLOT(file_downloaded(QString)));
+	connect(m_http, SIGNAL(url_downloaded(QString)), this, SLOT(url_downloaded(QString)));
+	connect(m_httpthread, SIGNAL(finished()), m_http, SLOT(deleteLater()));
+	m_httpthread->start();
+
 	check_host_files();
 	discover_devices();
 	process_settings();
@@ -81,6 +106,12 @@ DroidStar::DroidStar(QObject *parent) :
 
 DroidStar::~DroidStar()
 {
+	m_hostthread->quit();
+	m_hostthread->wait();
+	delete m_hostthread;
+	m_httpthread->quit();
+	m_httpthread->wait();
+	delete m_httpthread;
 }
 
 #ifdef Q_OS_ANDROID
@@ -120,6 +151,8 @@ void DroidStar::discover_devices()
 	m_modems.append("None");
 	m_playbacks.append(AudioEngine::discover_audio_devices(AUDIO_OUT));
 	m_captures.append(AudioEngine::discover_audio_devices(AUDIO_IN));
+	m_playbacks.append("Null");
+	m_captures.append("Null");
 
 	QMap<QString, QString> l = SerialAMBE::discover_devices();
 	QMap<QString, QString>::const_iterator i = l.constBegin();
@@ -134,18 +167,7 @@ void DroidStar::discover_devices()
 void DroidStar::download_file(QString f, bool u)
 {
 	qDebug() << "download_file() " << f << ":" << u;
-	HttpManager *http = new HttpManager(f, u);
-	QThread *httpThread = new QThread;
-	http->moveToThread(httpThread);
-	connect(httpThread, SIGNAL(started()), http, SLOT(process()));
-	if(u){
-		connect(http, SIGNAL(file_downloaded(QString)), this, SLOT(url_downloaded(QString)));
-	}
-	else{
-		connect(http, SIGNAL(file_downloaded(QString)), this, SLOT(file_downloaded(QString)));
-	}
-	connect(httpThread, SIGNAL(finished()), http, SLOT(deleteLater()));
-	httpThread->start();
+	emit start_download(f, u);
 }
 
 void DroidStar::url_downloaded(QString url)
@@ -223,7 +245,7 @@ void DroidStar::process_connect()
 
 		if( (m_callsign.size() < 4) ||
 			(m_dmrid < 250000) ||
-			(m_callsign != m_dmrids[m_dmrid]))
+			(m_callsign != m_dmrids.callsign(m_dmrid)))
 		{
 			emit connect_status_changed(4);
 			return;
@@ -406,6 +428,7 @@ void DroidStar::process_connect()
 			m_dmr = new DMRCodec(m_callsign, m_dmrid, m_essid, dmrpass, m_latitude, m_longitude, m_location, m_description, m_freq, m_url, m_swid, m_pkgid, m_dmropts, m_dmr_destid, m_hostname, m_port, false, vocoder, modem, m_playback, m_capture);
 			m_dmr->set_modem_flags(rxInvert, txInvert, pttInvert, useCOSAsLockout, duplex);
 			m_dmr->set_modem_params(m_modemRxFreq.toInt(), m_modemTxFreq.toInt(), m_modemTxDelay.toInt(), m_modemRxLevel.toFloat(), m_modemRFLevel.toFloat(), ysfTXHang, m_modemCWIdTxLevel.toFloat(), m_modemDstarTxLevel.toFloat(), m_modemDMRTxLevel.toFloat(), m_modemYSFTxLevel.toFloat(), m_modemP25TxLevel.toFloat(), m_modemNXDNTxLevel.toFloat(), pocsagTXLevel, m17TXLevel);
+			m_dmr->set_jitter_target(m_jitter_target);
 			m_dmr->set_cc(1);
 			m_modethread = new QThread;
 			m_dmr->moveToThread(m_modethread);
@@ -428,6 +451,7 @@ void DroidStar::process_connect()
 			m_ysf = new YSFCodec(m_callsign, m_host, m_hostname, m_port, false, vocoder, modem, m_playback, m_capture);
 			m_ysf->set_modem_flags(rxInvert, txInvert, pttInvert, useCOSAsLockout, duplex);
 			m_ysf->set_modem_params(m_modemRxFreq.toInt(), m_modemTxFreq.toInt(), m_modemTxDelay.toInt(), m_modemRxLevel.toFloat(), m_modemRFLevel.toFloat(), ysfTXHang, m_modemCWIdTxLevel.toFloat(), m_modemDstarTxLevel.toFloat(), m_modemDMRTxLevel.toFloat(), m_modemYSFTxLevel.toFloat(), m_modemP25TxLevel.toFloat(), m_modemNXDNTxLevel.toFloat(), pocsagTXLevel, m17TXLevel);
+			m_ysf->set_jitter_target(m_jitter_target);
 			m_modethread = new QThread;
 			m_ysf->moveToThread(m_modethread);
 			connect(m_ysf, SIGNAL(update(Codec::MODEINFO)), this, SLOT(update_ysf_data(Codec::MODEINFO)));
@@ -445,7 +469,7 @@ void DroidStar::process_connect()
 			m_modethread->start();
 		}
 		if(m_protocol == "P25"){
-			m_dmrid = m_dmrids.key(m_callsign);
+			m_dmrid = m_dmrids.id(m_callsign);
 			m_dmr_destid = m_host.toUInt();
 			m_p25 = new P25Codec(m_callsign, m_dmrid, m_dmr_destid, m_hostname, m_port, false, modem, m_playback, m_capture);
 			m_modethread = new QThread;
@@ -483,6 +507,7 @@ void DroidStar::process_connect()
 			m_m17 = new M17Codec(m_callsign, m_module, m_host, m_hostname, m_port, false, modem, m_playback, m_capture);
 			m_m17->set_modem_flags(rxInvert, txInvert, pttInvert, useCOSAsLockout, duplex);
 			m_m17->set_modem_params(m_modemRxFreq.toInt(), m_modemTxFreq.toInt(), m_modemTxDelay.toInt(), m_modemRxLevel.toFloat(), m_modemRFLevel.toFloat(), ysfTXHang, m_modemCWIdTxLevel.toFloat(), m_modemDstarTxLevel.toFloat(), m_modemDMRTxLevel.toFloat(), m_modemYSFTxLevel.toFloat(), m_modemP25TxLevel.toFloat(), m_modemNXDNTxLevel.toFloat(), pocsagTXLevel, m17TXLevel);
+			m_m17->set_jitter_target(m_jitter_target);
 			m_modethread = new QThread;
 			m_m17->moveToThread(m_modethread);
 			connect(m_m17, SIGNAL(update(Codec::MODEINFO)), this, SLOT(update_m17_data(Codec::MODEINFO)));
@@ -693,6 +718,7 @@ void DroidStar::save_settings()
 	m_settings->setValue("RPTR1", m_rptr1);
 	m_settings->setValue("RPTR2", m_rptr2);
 	m_settings->setValue("TXTIMEOUT", m_txtimeout);
+	m_settings->setValue("JITTERTARGET", m_jitter_target);
 	m_settings->setValue("TXTOGGLE", m_toggletx ? "true" : "false");
 	m_settings->setValue("XRF2REF", m_xrf2ref ? "true" : "false");
 	m_settings->setValue("USRTXT", m_dstarusertxt);
@@ -757,6 +783,7 @@ void DroidStar::process_settings()
 	m_rptr1 = m_settings->value("RPTR1").toString().simplified();
 	m_rptr2 = m_settings->value("RPTR2").toString().simplified();
 	m_txtimeout = m_settings->value("TXTIMEOUT", "300").toString().simplified().toUInt();
+	m_jitter_target = m_settings->value("JITTERTARGET", "60").toString().simplified().toUInt();
 	m_toggletx = (m_settings->value("TXTOGGLE", "true").toString().simplified() == "true") ? true : false;
 	m_dstarusertxt = m_settings->value("USRTXT").toString().simplified();
 	m_xrf2ref = (m_settings->value("XRF2REF").toString().simplified() == "true") ? true : false;
@@ -795,405 +822,123 @@ void DroidStar::update_custom_hosts(QString h)
 	m_localhosts = m_settings->value("LOCALHOSTS").toString();
 }
 
-void DroidStar::process_ref_hosts()
+void DroidStar::request_hosts(QString protocol, QString file)
 {
 	m_hostmap.clear();
 	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/dplus.txt");
+	if(protocol == "M17"){
+		m_hostmap["MMDVM_DIRECT"] = "MMDVM_DIRECT";
+	}
+	++m_hostgen;
 
+	QFileInfo check_file(config_path + "/" + file);
 	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/dplus.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.split('\t');
-				if(ll.size() > 1){
-					m_hostmap[ll.at(0).simplified()] = ll.at(1).simplified() + ",20001";
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "REF"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
+		emit load_hosts(protocol, config_path + "/" + file, m_localhosts, m_hostgen);
 	}
 	else{
-		download_file("/dplus.txt");
+		download_file("/" + file);
 	}
 }
 
-void DroidStar::process_dcs_hosts()
+void DroidStar::hosts_loaded(QString protocol, quint64 gen, HostMap hosts)
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/dcs.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/dcs.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.split('\t');
-				if(ll.size() > 1){
-					m_hostmap[ll.at(0).simplified()] = ll.at(1).simplified() + ",30051";
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "DCS"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/dcs.txt");
+	// Drop results from a mode we have already switched away from
+	if((gen != m_hostgen) || (protocol != m_protocol)){
+		return;
 	}
+	m_hostmap.swap(hosts);
+	m_hostsmodel = m_hostmap.keys();
+	m_proberesults.clear();
+	emit hosts_changed();
+	emit probe_results_changed();
 }
 
-void DroidStar::process_xrf_hosts()
+void DroidStar::probe_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/dextra.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/dextra.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.split('\t');
-				if(ll.size() > 1){
-					m_hostmap[ll.at(0).simplified()] = ll.at(1).simplified() + ",30001";
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "XRF"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
+	emit start_probe(m_protocol, m_hostmap, m_dmrid, true);
+}
 
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/dextra.txt");
+void DroidStar::probe_finished(QString protocol, QVariantList results)
+{
+	if(protocol != m_protocol){
+		return;
 	}
+	m_proberesults = results;
+	emit probe_results_changed();
 }
 
-void DroidStar::process_ysf_hosts()
+void DroidStar::select_host(QString h)
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/YSFHosts.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/YSFHosts.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.split(';');
-				if(ll.size() > 4){
-					m_hostmap[ll.at(1).simplified()] = ll.at(3) + "," + ll.at(4);
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
+	process_host_change(h);
+	emit hosts_changed();
+}
 
-				if(line.at(0) == "YSF"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
+QString DroidStar::get_saved_host()
+{
+	if(m_protocol == "REF") return m_saved_refhost;
+	if(m_protocol == "DCS") return m_saved_dcshost;
+	if(m_protocol == "XRF") return m_saved_xrfhost;
+	if(m_protocol == "YSF") return m_saved_ysfhost;
+	if(m_protocol == "FCS") return m_saved_fcshost;
+	if(m_protocol == "DMR") return m_saved_dmrhost;
+	if(m_protocol == "P25") return m_saved_p25host;
+	if(m_protocol == "NXDN") return m_saved_nxdnhost;
+	if(m_protocol == "M17") return m_saved_m17host;
+	return QString();
+}
 
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-		//process_fcs_rooms();
-	}
-	else{
-		download_file("/YSFHosts.txt");
-	}
+void DroidStar::process_ref_hosts()
+{
+	request_hosts("REF", "dplus.txt");
 }
 
-void DroidStar::process_fcs_rooms()
+void DroidStar::process_dcs_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/FCSHosts.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/FCSHosts.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.split(';');
-				if(ll.size() > 4){
-					if(ll.at(1).simplified() != "nn"){
-						m_hostmap[ll.at(0).simplified() + " - " + ll.at(1).simplified()] = ll.at(2).left(6).toLower() + ".xreflector.net,62500";
-					}
-				}
-			}
+	request_hosts("DCS", "dcs.txt");
+}
 
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
+void DroidStar::process_xrf_hosts()
+{
+	request_hosts("XRF", "dextra.txt");
+}
 
-				if(line.at(0) == "FCS"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
+void DroidStar::process_ysf_hosts()
+{
+	request_hosts("YSF", "YSFHosts.txt");
+}
 
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/FCSHosts.txt");
-	}
+void DroidStar::process_fcs_rooms()
+{
+	request_hosts("FCS", "FCSHosts.txt");
 }
 
 void DroidStar::process_dmr_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/DMRHosts.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/DMRHosts.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.simplified().split(' ');
-				if(ll.size() > 4){
-					if( (ll.at(0).simplified() != "DMRGateway")
-					 && (ll.at(0).simplified() != "DMR2YSF")
-					 && (ll.at(0).simplified() != "DMR2NXDN"))
-					{
-						m_hostmap[ll.at(0).simplified()] = ll.at(2) + "," + ll.at(4) + "," + ll.at(3);
-					}
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "DMR"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified() + "," + line.at(4).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/DMRHosts.txt");
-	}
+	request_hosts("DMR", "DMRHosts.txt");
 }
 
 void DroidStar::process_p25_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/P25Hosts.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/P25Hosts.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.simplified().split(' ');
-				if(ll.size() > 2){
-					m_hostmap[ll.at(0).simplified()] = ll.at(1) + "," + ll.at(2);
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "P25"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/P25Hosts.txt");
-	}
+	request_hosts("P25", "P25Hosts.txt");
 }
 
 void DroidStar::process_nxdn_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	QFileInfo check_file(config_path + "/NXDNHosts.txt");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/NXDNHosts.txt");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.simplified().split(' ');
-				if(ll.size() > 2){
-					m_hostmap[ll.at(0).simplified()] = ll.at(1) + "," + ll.at(2);
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "NXDN"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/NXDNHosts.txt");
-	}
+	request_hosts("NXDN", "NXDNHosts.txt");
 }
 
 void DroidStar::process_m17_hosts()
 {
-	m_hostmap.clear();
-	m_hostsmodel.clear();
-	m_hostmap["MMDVM_DIRECT"] = "MMDVM_DIRECT";
-
-	QFileInfo check_file(config_path + "/M17Hosts-full.csv");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/M17Hosts-full.csv");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString l = f.readLine();
-				if(l.at(0) == '#'){
-					continue;
-				}
-				QStringList ll = l.simplified().split(',');
-				if(ll.size() > 3){
-					m_hostmap[ll.at(0).simplified()] = ll.at(2) + "," + ll.at(4) + "," + ll.at(3);
-				}
-			}
-
-			m_customhosts = m_localhosts.split('\n');
-			for (const auto& i : m_customhosts){
-				QStringList line = i.simplified().split(' ');
-
-				if(line.at(0) == "M17"){
-					m_hostmap[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
-				}
-			}
-
-			QMap<QString, QString>::const_iterator i = m_hostmap.constBegin();
-			while (i != m_hostmap.constEnd()) {
-				m_hostsmodel.append(i.key());
-				++i;
-			}
-		}
-		f.close();
-	}
-	else{
-		download_file("/M17Hosts-full.csv");
-	}
+	request_hosts("M17", "M17Hosts-full.csv");
 }
 
 void DroidStar::process_dmr_ids()
 {
 	QFileInfo check_file(config_path + "/DMRIDs.dat");
 	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/DMRIDs.dat");
-		if(f.open(QIODevice::ReadOnly)){
-			while(!f.atEnd()){
-				QString lids = f.readLine();
-				if(lids.at(0) == '#'){
-					continue;
-				}
-				QStringList llids = lids.simplified().split(' ');
-
-				if(llids.size() >= 2){
-					m_dmrids[llids.at(0).toUInt()] = llids.at(1);
-				}
-			}
+		if(!m_dmrids.open(config_path + "/DMRIDs.dat")){
+			qDebug() << "Unable to load DMRIDs.dat";
 		}
-		f.close();
 	}
 	else{
 		download_file("/DMRIDs.dat");
@@ -1202,12 +947,9 @@ void DroidStar::process_dmr_ids()
 
 void DroidStar::update_dmr_ids()
 {
-	QFileInfo check_file(config_path + "/DMRIDs.dat");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/DMRIDs.dat");
-		f.remove();
-	}
-	process_dmr_ids();
+	// The current file stays in use until the new one has been downloaded,
+	// file_downloaded() then reloads it.  Unchanged files are not refetched.
+	download_file("/DMRIDs.dat");
 	update_nxdn_ids();
 }
 
@@ -1238,12 +980,7 @@ void DroidStar::process_nxdn_ids()
 
 void DroidStar::update_nxdn_ids()
 {
-	QFileInfo check_file(config_path + "/NXDN.csv");
-	if(check_file.exists() && check_file.isFile()){
-		QFile f(config_path + "/NXDN.csv");
-		f.remove();
-	}
-	process_nxdn_ids();
+	download_file("/NXDN.csv");
 }
 
 void DroidStar::update_host_files()
@@ -1405,6 +1142,7 @@ void DroidStar::update_ref_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " XRF RX lost id: " + QString::number(info.streamid, 16) + " src: " + info.src + " dst: " + info.gw2);
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1461,6 +1199,7 @@ void DroidStar::update_dcs_data(Codec::MODEINFO info)
 		emit update_log(t + " XRF RX lost id: " + QString::number(info.streamid, 16) + " src: " + info.src + " dst: " + info.gw2);
 	}
 
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1516,6 +1255,7 @@ void DroidStar::update_xrf_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " XRF RX lost id: " + QString::number(info.streamid, 16) + " src: " + info.src + " dst: " + info.gw2);
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1567,6 +1307,7 @@ void DroidStar::update_nxdn_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " NXDN RX lost id: " + QString::number(info.streamid, 16) + " src: " + QString::number(info.srcid) + " dst: " + QString::number(info.dstid));
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1609,7 +1350,7 @@ void DroidStar::update_dmr_data(Codec::MODEINFO info)
 		m_data6.clear();
 	}
 	else{
-		m_data1 = m_dmrids[info.srcid];
+		m_data1 = m_dmrids.callsign(info.srcid);
 		m_data2 = info.srcid ? QString::number(info.srcid) : "";
 		m_data3 = info.dstid ? QString::number(info.dstid) : "";
 		m_data4 = info.gwid ? QString::number(info.gwid) : "";
@@ -1629,6 +1370,7 @@ void DroidStar::update_dmr_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " DMR RX lost id: " + QString::number(info.streamid, 16) + " src: " + QString::number(info.srcid) + " dst: " + QString::number(info.dstid));
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1699,6 +1441,7 @@ void DroidStar::update_ysf_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " YSF RX lost");
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1720,7 +1463,7 @@ void DroidStar::update_p25_data(Codec::MODEINFO info)
 		m_data6.clear();
 	}
 	else{
-		m_data1 = m_dmrids[info.srcid];
+		m_data1 = m_dmrids.callsign(info.srcid);
 		m_data2 = info.srcid ? QString::number(info.srcid) : "";
 		m_data3 = info.dstid ? QString::number(info.dstid) : "";
 		m_data4 = info.srcid ? QString::number(info.srcid) : "";
@@ -1739,6 +1482,7 @@ void DroidStar::update_p25_data(Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " P25 RX lost id: " + QString::number(info.streamid, 16) + " src: " + QString::number(info.srcid) + " dst: " + QString::number(info.dstid));
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
@@ -1779,9 +1523,33 @@ void DroidStar::update_m17_data(M17Codec::MODEINFO info)
 	if(info.stream_state == Codec::STREAM_LOST){
 		emit update_log(t + " M17 RX lost id: " + QString::number(info.streamid, 16) + " src: " + info.src + " dst: " + info.dst);
 	}
+	update_stream_stats(info);
 	emit update_data();
 }
 
+// One line of RX/TX quality for the current stream under the status text,
+// logged once when the stream ends so choppy audio can be put down to the
+// network (loss, jitter), the reflector (duplicates, reordering) or our CPU
+// (decode time).
+void DroidStar::update_stream_stats(const Codec::MODEINFO &info)
+{
+	const StreamStats::Summary &s = info.stats;
+	if(s.packets || s.tx_frames){
+		m_statstxt = QString("RX %1 pkts %2 lost %3 dup %4 ooo jitter %5 ms FEC %6")
+			.arg(s.packets).arg(s.lost).arg(s.duplicates).arg(s.reordered).arg(s.jitter_ms, 0, 'f', 1).arg(s.fec_corrected);
+		m_statstxt += QString(" dec %1/%2 us %3 drop TX %4 jitter %5 ms")
+			.arg(s.decode_us).arg(s.decode_us_max).arg(s.vocoder_dropped).arg(s.tx_frames).arg(s.tx_jitter_ms, 0, 'f', 1);
+	}
+	else{
+		m_statstxt.clear();
+	}
+	if(((info.stream_state == Codec::STREAM_END) || (info.stream_state == Codec::STREAM_LOST)) && (info.stream_state != m_laststreamstate) && s.packets){
+		DSLOG(Logger::App, Logger::Info, "Stream stats: %s", qPrintable(m_statstxt));
+		emit update_log("Stream stats: " + m_statstxt);
+	}
+	m_laststreamstate = info.stream_state;
+}
+
 void DroidStar::update_iax_data()
 {
 	if((connect_status == Codec::CONNECTING) && (m_iax->get_status() == Codec::DISCONNECTED)){
@@ -29,6 +29,10 @@
 #include "nxdncodec.h"
 #include "m17codec.h"
 #include "iaxcodec.h"
+#include "dmridindex.h"
+#include "hostloader.h"
+#include "hostprober.h"
+#include "httpmanager.h"
 
 class DroidStar : public QObject
 {
@@ -43,6 +47,11 @@ signals:
 	void module_changed(char);
 	void update_data();
 	void update_log(QString);
+	void hosts_changed();
+	void probe_results_changed();
+	void start_probe(QString, HostMap, quint32, bool);
+	void load_hosts(QString, QString, QString, quint64);
+	void start_download(QString, bool);
 	void open_vocoder_dialog();
 	void update_settings();
 	void connect_status_changed(int c);
@@ -105,6 +114,7 @@ public slots:
 	void set_rptr1(const QString &rptr1) { m_rptr1 = rptr1; save_settings(); emit rptr1_changed(rptr1); }
 	void set_rptr2(const QString &rptr2) { m_rptr2 = rptr2; save_settings(); emit rptr2_changed(rptr2); }
 	void set_txtimeout(const QString &t) { m_txtimeout = t.simplified().toUInt(); save_settings();}
+	void set_jitter_target(const QString &t) { m_jitter_target = t.simplified().toUInt(); save_settings();}
 	void set_toggletx(bool x) { m_toggletx = x; save_settings(); }
 	void set_xrf2ref(bool x) { m_xrf2ref = x; save_settings(); }
 	void set_ipv6(bool ipv6) { m_ipv6 = ipv6; save_settings(); }
@@ -162,6 +172,7 @@ public slots:
 	QString get_data5() { return m_data5; }
 	QString get_data6() { return m_data6; }
 	QString get_statustxt() { return m_statustxt; }
+	QString get_statstxt() { return m_statstxt; }
 	QString get_mode() { return m_protocol; }
 	QString get_host() { return m_host; }
 	QString get_module() { return QString(m_module); }
@@ -181,6 +192,11 @@ public slots:
 	QString get_dmr_options() { return m_dmropts; }
 	QString get_dmrtgid() { return m_dmr_destid ? QString::number(m_dmr_destid) : ""; }
 	QStringList get_hosts() { return m_hostsmodel; }
+	QString get_saved_host();
+	QVariantList get_probe_results() { return m_proberesults; }
+	bool get_probe_supported() { return HostProber::supported(m_protocol); }
+	void probe_hosts();
+	void select_host(QString h);
 	QString get_ref_host() { return m_saved_refhost; }
 	QString get_dcs_host() { return m_saved_dcshost; }
 	QString get_xrf_host() { return m_saved_xrfhost; }
@@ -200,6 +216,7 @@ public slots:
 	QString get_rptr1() { return m_rptr1; }
 	QString get_rptr2() { return m_rptr2; }
 	QString get_txtimeout() { return QString::number(m_txtimeout); }
+	QString get_jitter_target() { return QString::number(m_jitter_target); }
 	QString get_error_text() { return m_errortxt; }
 	bool get_toggletx() { return m_toggletx; }
 	bool get_ipv6() { return m_ipv6; }
@@ -276,7 +293,7 @@ private:
 	uint8_t m_essid;
 	uint32_t m_dmr_srcid;
 	uint32_t m_dmr_destid;
-	QMap<uint32_t, QString> m_dmrids;
+	DMRIDIndex m_dmrids;
 	QMap<uint16_t, QString> m_nxdnids;
 	char m_module;
 	int m_port;
@@ -293,16 +310,25 @@ private:
 	QString m_data5;
 	QString m_data6;
 	QString m_statustxt;
+	QString m_statstxt;
+	int m_laststreamstate;
 	QString m_mycall;
 	QString m_urcall;
 	QString m_rptr1;
 	QString m_rptr2;
 	int m_txtimeout;
+	int m_jitter_target;
 	bool m_toggletx;
 	QString m_dstarusertxt;
 	QStringList m_hostsmodel;
 	QMap<QString, QString> m_hostmap;
-	QStringList m_customhosts;
+	QThread *m_hostthread;
+	HostLoader *m_hostloader;
+	HostProber *m_hostprober;
+	QVariantList m_proberesults;
+	quint64 m_hostgen;
+	QThread *m_httpthread;
+	HttpManager *m_http;
 	QThread *m_modethread;
 	REFCodec *m_ref;
 	DCSCodec *m_dcs;
@@ -370,6 +396,9 @@ private slots:
 	void process_p25_hosts();
 	void process_nxdn_hosts();
 	void process_m17_hosts();
+	void request_hosts(QString protocol, QString file);
+	void hosts_loaded(QString protocol, quint64 gen, HostMap hosts);
+	void probe_finished(QString protocol, QVariantList results);
 	void process_dmr_ids();
 	void process_nxdn_ids();
 	void update_dmr_data(Codec::MODEINFO);
@@ -381,6 +410,7 @@ private slots:
 	void update_ysf_data(Codec::MODEINFO);
 	void update_m17_data(Codec::MODEINFO);
 	void update_iax_data();
+	void update_stream_stats(const Codec::MODEINFO &info);
 	void save_settings();
 	void update_output_level(unsigned short l){ m_outlevel = l;}
 	//void load_md380_fw();
@@ -0,0 +1,131 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstring>
+#include "framecapture.h"
+#include "logger.h"
+
+static const char DSCAP_MAGIC[5] = {'D', 'S', 'C', 'A', 'P'};
+static const uint8_t DSCAP_VERSION = 1;
+static const size_t DSCAP_HEADER = 22;
+static const size_t DSCAP_RECORD = 12;
+
+FrameCapture::FrameCapture() :
+	m_fp(nullptr),
+	m_writing(false),
+	m_start_us(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	close();
+}
+
+uint64_t FrameCapture::now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool FrameCapture::open_write(const std::string &path, const std::string &mode)
+{
+	close();
+	m_fp = fopen(path.c_str(), "wb");
+	if(m_fp == nullptr){
+		DSLOG(Logger::App, Logger::Error, "FrameCapture: unable to create %s", path.c_str());
+		return false;
+	}
+	uint8_t h[DSCAP_HEADER];
+	memset(h, 0, sizeof(h));
+	memcpy(h, DSCAP_MAGIC, 5);
+	h[5] = DSCAP_VERSION;
+	memcpy(h + 6, mode.c_str(), (mode.size() < 16) ? mode.size() : 16);
+	fwrite(h, 1, sizeof(h), m_fp);
+	m_writing = true;
+	m_mode = mode;
+	m_start_us = now_us();
+	return true;
+}
+
+bool FrameCapture::open_read(const std::string &path)
+{
+	close();
+	m_fp = fopen(path.c_str(), "rb");
+	if(m_fp == nullptr){
+		DSLOG(Logger::App, Logger::Error, "FrameCapture: unable to open %s", path.c_str());
+		return false;
+	}
+	uint8_t h[DSCAP_HEADER];
+	if((fread(h, 1, sizeof(h), m_fp) != sizeof(h)) || memcmp(h, DSCAP_MAGIC, 5) || (h[5] != DSCAP_VERSION)){
+		DSLOG(Logger::App, Logger::Error, "FrameCapture: %s is not a version %d capture", path.c_str(), DSCAP_VERSION);
+		close();
+		return false;
+	}
+	char mode[17];
+	memcpy(mode, h + 6, 16);
+	mode[16] = '\0';
+	m_mode = mode;
+	m_writing = false;
+	return true;
+}
+
+void FrameCapture::close()
+{
+	if(m_fp != nullptr){
+		fclose(m_fp);
+		m_fp = nullptr;
+	}
+	m_writing = false;
+}
+
+void FrameCapture::write(uint8_t kind, const uint8_t *data, uint16_t len)
+{
+	write(kind, now_us() - m_start_us, data, len);
+}
+
+void FrameCapture::write(uint8_t kind, uint64_t t_us, const uint8_t *data, uint16_t len)
+{
+	if(!m_writing){
+		return;
+	}
+	uint8_t r[DSCAP_RECORD];
+	for(int i = 0; i < 8; ++i){
+		r[i] = (t_us >> (8 * i)) & 0xff;
+	}
+	r[8] = kind;
+	r[9] = 0;
+	r[10] = len & 0xff;
+	r[11] = len >> 8;
+	fwrite(r, 1, sizeof(r), m_fp);
+	fwrite(data, 1, len, m_fp);
+}
+
+bool FrameCapture::read(Record &rec)
+{
+	uint8_t r[DSCAP_RECORD];
+	if((m_fp == nullptr) || m_writing || (fread(r, 1, sizeof(r), m_fp) != sizeof(r))){
+		return false;
+	}
+	rec.t_us = 0;
+	for(int i = 0; i < 8; ++i){
+		rec.t_us |= (uint64_t)r[i] << (8 * i);
+	}
+	rec.kind = r[8];
+	rec.data.resize(r[10] | (r[11] << 8));
+	return rec.data.empty() || (fread(rec.data.data(), 1, rec.data.size(), m_fp) == rec.data.size());
+}
@@ -0,0 +1,60 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Timestamped capture of the raw frames a codec exchanges with the network
+// and the modem.  A file is a header ("DSCAP", version byte, 16 byte NUL
+// padded mode name such as "M17" or "DMR") followed by records of
+//   uint64 t_us, uint8 kind, uint8 reserved, uint16 len, len bytes payload
+// all little endian, t_us counted from when the file was opened for writing.
+// Directions are from DroidStar's side, so UdpRx is what a reflector sent us.
+// Used by the codecs for record/replay and by tools/mockreflector.
+class FrameCapture
+{
+public:
+	enum Kind { UdpRx = 0, UdpTx = 1, ModemRx = 2, ModemTx = 3 };
+	struct Record {
+		uint64_t t_us;
+		uint8_t kind;
+		std::vector<uint8_t> data;
+	};
+	FrameCapture();
+	~FrameCapture();
+	bool open_write(const std::string &path, const std::string &mode);
+	bool open_read(const std::string &path);
+	void close();
+	bool is_open() const { return m_fp != nullptr; }
+	const std::string &mode() const { return m_mode; }
+	void write(uint8_t kind, const uint8_t *data, uint16_t len);
+	void write(uint8_t kind, uint64_t t_us, const uint8_t *data, uint16_t len);
+	bool read(Record &r);
+	static uint64_t now_us();
+private:
+	FILE *m_fp;
+	bool m_writing;
+	uint64_t m_start_us;
+	std::string m_mode;
+};
+
+#endif // FRAMECAPTURE_H
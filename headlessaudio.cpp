@@ -0,0 +1,260 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "headlessaudio.h"
+#include "audioengine.h"
+#include <QtEndian>
+#include <cstring>
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+HeadlessAudio::HeadlessAudio(const QString &name, uint8_t dir) :
+	m_type(HEADLESS_NULL),
+	m_dir(dir),
+	m_wav(false),
+	m_fast(false),
+	m_eof(false),
+	m_channels(1),
+	m_rate(8000),
+	m_datasize(0),
+	m_resampler(nullptr)
+{
+	if(name.startsWith("file:")){
+		m_type = HEADLESS_FILE;
+		m_path = name.mid(5);
+		if((dir == AUDIO_IN) && m_path.endsWith(",fast")){
+			m_path.chop(5);
+			m_fast = true;
+		}
+		m_wav = m_path.endsWith(".wav", Qt::CaseInsensitive);
+	}
+	else if(name.startsWith("pipe:")){
+		m_type = HEADLESS_PIPE;
+		m_path = name.mid(5);
+	}
+}
+
+HeadlessAudio::~HeadlessAudio()
+{
+	close();
+	delete m_resampler;
+}
+
+bool HeadlessAudio::is_headless(const QString &name)
+{
+	return (name == "Null") || name.startsWith("file:") || name.startsWith("pipe:");
+}
+
+bool HeadlessAudio::open()
+{
+	bool ok = true;
+
+	if(m_type == HEADLESS_PIPE){
+		ok = open_pipe();
+	}
+	else if(m_type == HEADLESS_FILE){
+		m_file.setFileName(m_path);
+		if(m_dir == AUDIO_OUT){
+			ok = m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+			if(ok && m_wav){
+				write_wav_header();
+			}
+		}
+		else{
+			ok = m_file.open(QIODevice::ReadOnly);
+			if(ok && m_wav){
+				ok = read_wav_header();
+			}
+		}
+	}
+
+	if(!ok){
+		fprintf(stderr, "Unable to open headless audio %s\n", m_path.toStdString().c_str());fflush(stderr);
+	}
+	else{
+		fprintf(stderr, "Using headless %s %s %s\n", (m_dir == AUDIO_OUT) ? "playback" : "capture", (m_type == HEADLESS_NULL) ? "null" : (m_type == HEADLESS_FILE) ? "file" : "pipe", m_path.toStdString().c_str());fflush(stderr);
+	}
+	return ok;
+}
+
+void HeadlessAudio::close()
+{
+	if(!m_file.isOpen()){
+		return;
+	}
+	if(m_wav && (m_dir == AUDIO_OUT)){
+		write_wav_header();
+	}
+	m_file.close();
+}
+
+bool HeadlessAudio::open_pipe()
+{
+#ifdef Q_OS_WIN
+	m_file.setFileName(m_path);
+	return m_file.open(((m_dir == AUDIO_OUT) ? QIODevice::WriteOnly : QIODevice::ReadOnly) | QIODevice::Unbuffered);
+#else
+	if(!QFile::exists(m_path) && (::mkfifo(m_path.toLocal8Bit().constData(), 0666) != 0)){
+		return false;
+	}
+	// Non-blocking so a missing reader or writer never stalls the codec thread.
+	// O_RDWR keeps a playback FIFO open without a reader attached.
+	int fd = ::open(m_path.toLocal8Bit().constData(), ((m_dir == AUDIO_OUT) ? O_RDWR : O_RDONLY) | O_NONBLOCK);
+	if(fd < 0){
+		return false;
+	}
+	return m_file.open(fd, ((m_dir == AUDIO_OUT) ? QIODevice::WriteOnly : QIODevice::ReadOnly) | QIODevice::Unbuffered, QFileDevice::AutoCloseHandle);
+#endif
+}
+
+bool HeadlessAudio::read_wav_header()
+{
+	char hdr[12];
+	char chunk[8];
+
+	if((m_file.read(hdr, 12) != 12) || ::memcmp(hdr, "RIFF", 4) || ::memcmp(hdr + 8, "WAVE", 4)){
+		fprintf(stderr, "%s is not a WAV file\n", m_path.toStdString().c_str());fflush(stderr);
+		return false;
+	}
+
+	while(m_file.read(chunk, 8) == 8){
+		uint32_t len = qFromLittleEndian<quint32>((const uchar *)chunk + 4);
+
+		if(::memcmp(chunk, "fmt ", 4) == 0){
+			QByteArray fmt = m_file.read(len + (len & 1));
+			if(fmt.size() < 16){
+				return false;
+			}
+			const uchar *f = (const uchar *)fmt.constData();
+			uint16_t format = qFromLittleEndian<quint16>(f);
+			m_channels = qFromLittleEndian<quint16>(f + 2);
+			m_rate = qFromLittleEndian<quint32>(f + 4);
+			uint16_t bits = qFromLittleEndian<quint16>(f + 14);
+
+			if((format != 1) || (bits != 16) || (m_channels < 1)){
+				fprintf(stderr, "%s must be 16 bit PCM\n", m_path.toStdString().c_str());fflush(stderr);
+				return false;
+			}
+		}
+		else if(::memcmp(chunk, "data", 4) == 0){
+			if(m_rate != 8000){
+				m_resampler = new AudioResampler(m_rate, 8000);
+			}
+			return true;
+		}
+		else{
+			m_file.seek(m_file.pos() + len + (len & 1));
+		}
+	}
+	return false;
+}
+
+void HeadlessAudio::write_wav_header()
+{
+	uchar hdr[44];
+
+	::memcpy(hdr, "RIFF", 4);
+	qToLittleEndian<quint32>(36 + m_datasize, hdr + 4);
+	::memcpy(hdr + 8, "WAVEfmt ", 8);
+	qToLittleEndian<quint32>(16, hdr + 16);
+	qToLittleEndian<quint16>(1, hdr + 20);
+	qToLittleEndian<quint16>(1, hdr + 22);
+	qToLittleEndian<quint32>(8000, hdr + 24);
+	qToLittleEndian<quint32>(16000, hdr + 28);
+	qToLittleEndian<quint16>(2, hdr + 32);
+	qToLittleEndian<quint16>(16, hdr + 34);
+	::memcpy(hdr + 36, "data", 4);
+	qToLittleEndian<quint32>(m_datasize, hdr + 40);
+
+	qint64 pos = m_file.pos();
+	m_file.seek(0);
+	m_file.write((const char *)hdr, 44);
+	if(pos > 44){
+		m_file.seek(pos);
+	}
+}
+
+size_t HeadlessAudio::read(int16_t *pcm, size_t s)
+{
+	if(m_type == HEADLESS_NULL){
+		memset(pcm, 0, s * sizeof(int16_t));
+		return s;
+	}
+	if(!m_file.isOpen()){
+		return 0;
+	}
+
+	if(m_type == HEADLESS_PIPE){
+		qint64 n = m_file.read((char *)pcm, s * sizeof(int16_t));
+		return (n > 0) ? (n / sizeof(int16_t)) : 0;
+	}
+
+	// Files are read one block per call, resampled to 8 kHz mono, and
+	// padded with silence once the end is reached.
+	size_t c;
+
+	if(m_resampler){
+		while((m_resampled.size() < s) && !m_eof){
+			size_t n = read_block((s * m_rate) / 8000);
+			m_resampler->process(m_buf.data(), n, m_resampled);
+		}
+		c = (m_resampled.size() < s) ? m_resampled.size() : s;
+		memcpy(pcm, m_resampled.data(), c * sizeof(int16_t));
+		m_resampled.erase(m_resampled.begin(), m_resampled.begin() + c);
+	}
+	else{
+		c = read_block(s);
+		memcpy(pcm, m_buf.data(), c * sizeof(int16_t));
+	}
+	memset(pcm + c, 0, (s - c) * sizeof(int16_t));
+	return s;
+}
+
+// Reads up to frames sample frames from the file into m_buf as mono
+size_t HeadlessAudio::read_block(size_t frames)
+{
+	m_buf.resize(frames * m_channels);
+	qint64 n = m_eof ? 0 : m_file.read((char *)m_buf.data(), m_buf.size() * sizeof(int16_t));
+
+	if(n <= 0){
+		n = 0;
+		if(!m_eof){
+			m_eof = true;
+			fprintf(stderr, "End of capture file %s\n", m_path.toStdString().c_str());fflush(stderr);
+		}
+	}
+
+	frames = n / (sizeof(int16_t) * m_channels);
+	for(size_t i = 0; i < frames; ++i){
+		m_buf[i] = qFromLittleEndian<qint16>(m_buf[i * m_channels]);
+	}
+	return frames;
+}
+
+void HeadlessAudio::write(const int16_t *pcm, size_t s)
+{
+	if((m_type == HEADLESS_NULL) || !m_file.isOpen()){
+		return;
+	}
+
+	qint64 n = m_file.write((const char *)pcm, s * sizeof(int16_t));
+	if(n > 0){
+		m_datasize += n;
+	}
+}
@@ -0,0 +1,72 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADLESSAUDIO_H
+#define HEADLESSAUDIO_H
+
+#include <QFile>
+#include <QString>
+#include <vector>
+#include "audioresampler.h"
+
+// Audio source/sink for running without sound hardware, selected by the
+// playback/capture device name:
+//   "Null"         discards playback, captures silence
+//   "file:<path>"  WAV (by .wav extension) or raw 8 kHz S16LE mono file
+//   "file:<path>,fast"  capture only, read as fast as TX consumes it rather
+//                  than in real time, for benchmarking the TX chain
+//   "pipe:<path>"  raw 8 kHz S16LE mono FIFO (created if missing) or Windows named pipe
+class HeadlessAudio
+{
+public:
+	enum{
+		HEADLESS_NULL,
+		HEADLESS_FILE,
+		HEADLESS_PIPE
+	};
+	HeadlessAudio(const QString &name, uint8_t dir);
+	~HeadlessAudio();
+	static bool is_headless(const QString &name);
+	bool open();
+	void close();
+	size_t read(int16_t *pcm, size_t s);
+	void write(const int16_t *pcm, size_t s);
+	int type() const { return m_type; }
+	bool fast() const { return m_fast; }
+	bool ended() const { return m_eof && m_resampled.empty(); }
+private:
+	bool open_pipe();
+	size_t read_block(size_t frames);
+	bool read_wav_header();
+	void write_wav_header();
+
+	int m_type;
+	uint8_t m_dir;
+	QString m_path;
+	QFile m_file;
+	bool m_wav;
+	bool m_fast;
+	bool m_eof;
+	int m_channels;
+	uint32_t m_rate;
+	uint32_t m_datasize;
+	AudioResampler *m_resampler;
+	std::vector<int16_t> m_buf;
+	std::vector<int16_t> m_resampled;
+};
+
+#endif // HEADLESSAUDIO_H
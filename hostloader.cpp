@@ -0,0 +1,182 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "hostloader.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+const quint32 SNAPSHOT_MAGIC = 0x44534843; // DSHC
+const quint32 SNAPSHOT_VERSION = 1;
+}
+
+HostLoader::HostLoader(QString config_path) :
+	QObject(nullptr),
+	m_config_path(config_path)
+{
+}
+
+void HostLoader::load(QString protocol, QString file, QString localhosts, quint64 gen)
+{
+	QFileInfo src(file);
+	if(!src.exists() || !src.isFile()){
+		return;
+	}
+
+	const qint64 mtime = src.lastModified().toMSecsSinceEpoch();
+	const QString snapfile = m_config_path + "/hostcache/" + src.fileName() + ".bin";
+	HostMap hosts;
+
+	auto it = m_cache.constFind(file);
+	if((it != m_cache.constEnd()) && (it->size == src.size()) && (it->mtime == mtime)){
+		hosts = it->hosts;
+	}
+	else{
+		if(!read_snapshot(snapfile, src, hosts)){
+			parse_file(protocol, file, hosts);
+			write_snapshot(snapfile, src, hosts);
+		}
+		m_cache.insert(file, {src.size(), mtime, hosts});
+	}
+
+	add_custom_hosts(protocol, localhosts, hosts);
+	emit hosts_loaded(protocol, gen, hosts);
+}
+
+bool HostLoader::read_snapshot(const QString &snapfile, const QFileInfo &src, HostMap &hosts)
+{
+	QFile f(snapfile);
+	if(!f.open(QIODevice::ReadOnly)){
+		return false;
+	}
+	QDataStream s(&f);
+	s.setVersion(QDataStream::Qt_5_0);
+	quint32 magic, version;
+	qint64 size, mtime;
+	s >> magic >> version >> size >> mtime;
+	if((magic != SNAPSHOT_MAGIC) || (version != SNAPSHOT_VERSION) ||
+		(size != src.size()) || (mtime != src.lastModified().toMSecsSinceEpoch()))
+	{
+		return false;
+	}
+	s >> hosts;
+	if(s.status() != QDataStream::Ok){
+		hosts.clear();
+		return false;
+	}
+	return true;
+}
+
+void HostLoader::write_snapshot(const QString &snapfile, const QFileInfo &src, const HostMap &hosts)
+{
+	QDir().mkpath(QFileInfo(snapfile).absolutePath());
+	QSaveFile f(snapfile);
+	if(!f.open(QIODevice::WriteOnly)){
+		qDebug() << "Unable to write host snapshot " << snapfile;
+		return;
+	}
+	QDataStream s(&f);
+	s.setVersion(QDataStream::Qt_5_0);
+	s << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << (qint64)src.size() << (qint64)src.lastModified().toMSecsSinceEpoch() << hosts;
+	f.commit();
+}
+
+void HostLoader::parse_file(const QString &protocol, const QString &file, HostMap &hosts)
+{
+	if(protocol == "M17"){
+		hosts["MMDVM_DIRECT"] = "MMDVM_DIRECT";
+	}
+
+	QFile f(file);
+	if(!f.open(QIODevice::ReadOnly)){
+		return;
+	}
+
+	while(!f.atEnd()){
+		QString l = f.readLine();
+		if(l.isEmpty() || (l.at(0) == '#')){
+			continue;
+		}
+		if((protocol == "REF") || (protocol == "DCS") || (protocol == "XRF")){
+			QStringList ll = l.split('\t');
+			if(ll.size() > 1){
+				QString port = (protocol == "REF") ? ",20001" : (protocol == "DCS") ? ",30051" : ",30001";
+				hosts[ll.at(0).simplified()] = ll.at(1).simplified() + port;
+			}
+		}
+		else if(protocol == "YSF"){
+			QStringList ll = l.split(';');
+			if(ll.size() > 4){
+				hosts[ll.at(1).simplified()] = ll.at(3) + "," + ll.at(4);
+			}
+		}
+		else if(protocol == "FCS"){
+			QStringList ll = l.split(';');
+			if(ll.size() > 4){
+				if(ll.at(1).simplified() != "nn"){
+					hosts[ll.at(0).simplified() + " - " + ll.at(1).simplified()] = ll.at(2).left(6).toLower() + ".xreflector.net,62500";
+				}
+			}
+		}
+		else if(protocol == "DMR"){
+			QStringList ll = l.simplified().split(' ');
+			if(ll.size() > 4){
+				if( (ll.at(0).simplified() != "DMRGateway")
+				 && (ll.at(0).simplified() != "DMR2YSF")
+				 && (ll.at(0).simplified() != "DMR2NXDN"))
+				{
+					hosts[ll.at(0).simplified()] = ll.at(2) + "," + ll.at(4) + "," + ll.at(3);
+				}
+			}
+		}
+		else if((protocol == "P25") || (protocol == "NXDN")){
+			QStringList ll = l.simplified().split(' ');
+			if(ll.size() > 2){
+				hosts[ll.at(0).simplified()] = ll.at(1) + "," + ll.at(2);
+			}
+		}
+		else if(protocol == "M17"){
+			QStringList ll = l.simplified().split(',');
+			if(ll.size() > 4){
+				hosts[ll.at(0).simplified()] = ll.at(2) + "," + ll.at(4) + "," + ll.at(3);
+			}
+		}
+	}
+	f.close();
+}
+
+void HostLoader::add_custom_hosts(const QString &protocol, const QString &localhosts, HostMap &hosts)
+{
+	const QStringList customhosts = localhosts.split('\n');
+	for (const auto& i : customhosts){
+		QStringList line = i.simplified().split(' ');
+
+		if((line.at(0) == protocol) && (line.size() > 3)){
+			if((protocol == "DMR") && (line.size() > 4)){
+				hosts[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified() + "," + line.at(4).simplified();
+			}
+			else if(protocol != "DMR"){
+				hosts[line.at(1).simplified()] = line.at(2).simplified() + "," + line.at(3).simplified();
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOSTLOADER_H
+#define HOSTLOADER_H
+
+#include <QObject>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QString>
+
+typedef QMap<QString, QString> HostMap;
+
+// Parses the reflector/host list files off the GUI thread.  Each parsed file
+// is kept in memory and as a binary snapshot under <config>/hostcache, both
+// keyed by the source file's size and mtime, so switching modes back and forth
+// normally never touches the text files.  Custom hosts from the settings are
+// merged on top of the cached list for every request.
+class HostLoader : public QObject
+{
+	Q_OBJECT
+public:
+	explicit HostLoader(QString config_path);
+signals:
+	void hosts_loaded(QString protocol, quint64 gen, HostMap hosts);
+public slots:
+	void load(QString protocol, QString file, QString localhosts, quint64 gen);
+private:
+	struct cache_entry {
+		qint64 size;
+		qint64 mtime;
+		HostMap hosts;
+	};
+	bool read_snapshot(const QString &snapfile, const QFileInfo &src, HostMap &hosts);
+	void write_snapshot(const QString &snapfile, const QFileInfo &src, const HostMap &hosts);
+	static void parse_file(const QString &protocol, const QString &file, HostMap &hosts);
+	static void add_custom_hosts(const QString &protocol, const QString &localhosts, HostMap &hosts);
+
+	QString m_config_path;
+	QHash<QString, cache_entry> m_cache;
+};
+
+#endif // HOSTLOADER_H
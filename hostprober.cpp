@@ -0,0 +1,293 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "hostprober.h"
+#include <algorithm>
+#include <QDateTime>
+#include "logger.h"
+
+namespace {
+const int PROBE_ROUNDS = 3;
+const int PROBE_ROUND_MS = 1000;
+const int PROBE_TIMEOUT_MS = 1500;
+const int PROBE_TICK_MS = 5;
+const int PROBE_BURST = 20;
+const qint64 PROBE_CACHE_MS = 10 * 60 * 1000;
+
+quint64 addr_key(quint32 addr, quint16 port)
+{
+	return ((quint64)addr << 16) | port;
+}
+}
+
+HostProber::HostProber(QObject *parent) :
+	QObject(parent),
+	m_udp(nullptr),
+	m_sendtimer(nullptr),
+	m_finishtimer(nullptr),
+	m_round(0),
+	m_next(0),
+	m_roundstart(0)
+{
+}
+
+QByteArray HostProber::probe_packet(const QString &protocol, quint32 dmrid)
+{
+	QByteArray out;
+	if(protocol == "YSF"){
+		// Status request, unlike the YSFP poll it does not link us
+		out.append("YSFS", 4);
+	}
+	else if(protocol == "DMR"){
+		out.append("RPTPING", 7);
+		out.append((dmrid >> 24) & 0xff);
+		out.append((dmrid >> 16) & 0xff);
+		out.append((dmrid >> 8) & 0xff);
+		out.append((dmrid >> 0) & 0xff);
+	}
+	return out;
+}
+
+void HostProber::reset()
+{
+	m_sendtimer->stop();
+	m_finishtimer->stop();
+	for(auto i = m_lookups.constBegin(); i != m_lookups.constEnd(); ++i){
+		QHostInfo::abortHostLookup(i.key());
+	}
+	m_targets.clear();
+	m_index.clear();
+	m_lookups.clear();
+	m_round = 0;
+	m_next = 0;
+}
+
+void HostProber::probe(QString protocol, HostMap hosts, quint32 dmrid, bool force)
+{
+	if(m_udp == nullptr){
+		m_udp = new QUdpSocket(this);
+		m_udp->bind(QHostAddress::AnyIPv4, 0);
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		m_sendtimer = new QTimer(this);
+		connect(m_sendtimer, SIGNAL(timeout()), this, SLOT(send_next()));
+		m_finishtimer = new QTimer(this);
+		m_finishtimer->setSingleShot(true);
+		connect(m_finishtimer, SIGNAL(timeout()), this, SLOT(finish()));
+		m_clock.start();
+	}
+
+	if(!force && m_cache.contains(protocol) &&
+		((QDateTime::currentMSecsSinceEpoch() - m_cachetime[protocol]) < PROBE_CACHE_MS))
+	{
+		emit probe_finished(protocol, sorted_results(m_cache[protocol]));
+		return;
+	}
+
+	reset();
+	m_protocol = protocol;
+
+	if(!supported(protocol)){
+		emit probe_finished(protocol, QVariantList());
+		return;
+	}
+
+	for(HostMap::const_iterator i = hosts.constBegin(); i != hosts.constEnd(); ++i){
+		QStringList sl = i.value().split(',');
+		if(sl.size() < 2){
+			continue;
+		}
+		target t;
+		t.name = i.key();
+		t.host = sl.at(0).simplified();
+		t.port = sl.at(1).simplified().toUShort();
+		t.addr = 0;
+		t.packet = probe_packet(protocol, dmrid);
+		t.sent = t.received = 0;
+		t.sent_ns = 0;
+		t.rtt_sum_us = 0;
+		t.rtt_min_us = 0;
+		if(t.port == 0 || t.packet.isEmpty()){
+			continue;
+		}
+		m_targets.append(t);
+	}
+
+	// Resolve everything up front, one lookup per distinct host name
+	QHash<QString, int> pending;
+	for(int i = 0; i < m_targets.size(); ++i){
+		target &t = m_targets[i];
+		QHostAddress a;
+		if(a.setAddress(t.host) && (a.protocol() == QAbstractSocket::IPv4Protocol)){
+			t.addr = a.toIPv4Address();
+		}
+		else if(m_dns.contains(t.host)){
+			t.addr = m_dns[t.host];
+		}
+		else if(pending.contains(t.host)){
+			m_lookups[pending[t.host]].append(i);
+			continue;
+		}
+		else{
+			int id = QHostInfo::lookupHost(t.host, this, SLOT(lookup_done(QHostInfo)));
+			pending[t.host] = id;
+			m_lookups[id].append(i);
+			continue;
+		}
+		if(t.addr){
+			m_index[addr_key(t.addr, t.port)].append(i);
+		}
+	}
+
+	DSLOG(Logger::App, Logger::Info, "HostProber::probe() %s hosts == %d", qPrintable(protocol), m_targets.size());
+	m_roundstart = m_clock.elapsed();
+	m_sendtimer->start(PROBE_TICK_MS);
+}
+
+void HostProber::lookup_done(QHostInfo info)
+{
+	if(!m_lookups.contains(info.lookupId())){
+		return;
+	}
+	const QVector<int> idx = m_lookups.take(info.lookupId());
+	quint32 addr = 0;
+	for(const QHostAddress &a : info.addresses()){
+		if(a.protocol() == QAbstractSocket::IPv4Protocol){
+			addr = a.toIPv4Address();
+			break;
+		}
+	}
+	if(addr == 0){
+		return;
+	}
+	for(int i : idx){
+		target &t = m_targets[i];
+		t.addr = addr;
+		m_dns[t.host] = addr;
+		m_index[addr_key(addr, t.port)].append(i);
+	}
+}
+
+void HostProber::send_next()
+{
+	const qint64 now = m_clock.elapsed();
+	if(m_next >= m_targets.size()){
+		if(m_round + 1 >= PROBE_ROUNDS){
+			m_sendtimer->stop();
+			m_finishtimer->start(PROBE_TIMEOUT_MS);
+			return;
+		}
+		if((now - m_roundstart) < PROBE_ROUND_MS){
+			return;
+		}
+		++m_round;
+		m_next = 0;
+		m_roundstart = now;
+	}
+
+	for(int n = 0; (n < PROBE_BURST) && (m_next < m_targets.size()); ++m_next){
+		target &t = m_targets[m_next];
+		if(t.addr == 0){
+			continue;
+		}
+		t.sent_ns = m_clock.nsecsElapsed();
+		m_udp->writeDatagram(t.packet, QHostAddress(t.addr), t.port);
+		++t.sent;
+		++n;
+	}
+}
+
+void HostProber::process_udp()
+{
+	QByteArray buf;
+	QHostAddress sender;
+	quint16 senderPort;
+
+	while(m_udp->hasPendingDatagrams()){
+		buf.resize(m_udp->pendingDatagramSize());
+		m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
+		const qint64 now = m_clock.nsecsElapsed();
+
+		bool ok;
+		quint32 addr = sender.toIPv4Address(&ok);
+		if(!ok){
+			continue;
+		}
+		auto it = m_index.constFind(addr_key(addr, senderPort));
+		if(it == m_index.constEnd()){
+			continue;
+		}
+		for(int i : *it){
+			target &t = m_targets[i];
+			// One reply per probe, late or duplicate replies are ignored
+			if(t.sent_ns == 0){
+				continue;
+			}
+			const qint64 rtt = (now - t.sent_ns) / 1000;
+			t.sent_ns = 0;
+			if((t.received == 0) || (rtt < t.rtt_min_us)){
+				t.rtt_min_us = rtt;
+			}
+			t.rtt_sum_us += rtt;
+			++t.received;
+		}
+	}
+}
+
+void HostProber::finish()
+{
+	QHash<QString, result> results;
+	for(const target &t : m_targets){
+		result r;
+		r.rtt_ms = t.received ? (int)(t.rtt_sum_us / t.received / 1000) : -1;
+		r.loss = t.sent ? (100 * (t.sent - t.received) / t.sent) : 100;
+		results[t.name] = r;
+	}
+	m_cache[m_protocol] = results;
+	m_cachetime[m_protocol] = QDateTime::currentMSecsSinceEpoch();
+	emit probe_finished(m_protocol, sorted_results(results));
+	reset();
+}
+
+QVariantList HostProber::sorted_results(const QHash<QString, result> &results)
+{
+	QVector<QPair<QString, result>> v;
+	for(auto i = results.constBegin(); i != results.constEnd(); ++i){
+		v.append(qMakePair(i.key(), i.value()));
+	}
+	std::sort(v.begin(), v.end(), [](const QPair<QString, result> &a, const QPair<QString, result> &b){
+		if((a.second.rtt_ms < 0) != (b.second.rtt_ms < 0)){
+			return b.second.rtt_ms < 0;
+		}
+		if(a.second.loss != b.second.loss){
+			return a.second.loss < b.second.loss;
+		}
+		if(a.second.rtt_ms != b.second.rtt_ms){
+			return a.second.rtt_ms < b.second.rtt_ms;
+		}
+		return a.first < b.first;
+	});
+
+	QVariantList l;
+	for(const auto &p : v){
+		QVariantMap m;
+		m["name"] = p.first;
+		m["rtt"] = p.second.rtt_ms;
+		m["loss"] = p.second.loss;
+		l.append(m);
+	}
+	return l;
+}
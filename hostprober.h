@@ -0,0 +1,93 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOSTPROBER_H
+#define HOSTPROBER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostInfo>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVariantList>
+#include <QVector>
+#include "hostloader.h"
+
+// Measures round trip time and loss to every host in a host list by sending
+// a request that the host answers without linking us, from a single UDP
+// socket.  Only YSF (YSFS status request) and DMR (RPTPING, which a master
+// answers with MSTNAK when we are not logged in) have one.  D-STAR and M17
+// reflectors only answer keepalives from linked clients and the P25/NXDN
+// poll is the link request itself, so those modes are not probed.  Sends
+// are paced across a few rounds so thousands of YSF hosts do not go out in
+// one burst, and any datagram coming back from a host's address and port
+// counts as the reply.  Results are cached per protocol and published sorted
+// by loss, then RTT.
+class HostProber : public QObject
+{
+	Q_OBJECT
+public:
+	explicit HostProber(QObject *parent = nullptr);
+	static bool supported(const QString &protocol) { return (protocol == "YSF") || (protocol == "DMR"); }
+	static QByteArray probe_packet(const QString &protocol, quint32 dmrid);
+signals:
+	void probe_finished(QString protocol, QVariantList results);
+public slots:
+	void probe(QString protocol, HostMap hosts, quint32 dmrid, bool force);
+private slots:
+	void process_udp();
+	void send_next();
+	void lookup_done(QHostInfo info);
+	void finish();
+private:
+	struct target {
+		QString name;
+		QString host;
+		quint32 addr;
+		quint16 port;
+		QByteArray packet;
+		int sent;
+		int received;
+		qint64 sent_ns;
+		qint64 rtt_sum_us;
+		qint64 rtt_min_us;
+	};
+	struct result {
+		int rtt_ms;
+		int loss;
+	};
+	static QVariantList sorted_results(const QHash<QString, result> &results);
+	void reset();
+
+	QUdpSocket *m_udp;
+	QTimer *m_sendtimer;
+	QTimer *m_finishtimer;
+	QElapsedTimer m_clock;
+	QString m_protocol;
+	QVector<target> m_targets;
+	QHash<quint64, QVector<int>> m_index;
+	QHash<int, QVector<int>> m_lookups;
+	QHash<QString, quint32> m_dns;
+	QHash<QString, QHash<QString, result>> m_cache;
+	QHash<QString, qint64> m_cachetime;
+	int m_round;
+	int m_next;
+	qint64 m_roundstart;
+};
+
+#endif // HOSTPROBER_H
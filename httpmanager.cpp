@@ -16,61 +16,147 @@
 */
 
 #include "httpmanager.h"
+#include <QSaveFile>
 
-HttpManager::HttpManager(QString f, bool u) : QObject(nullptr)
+HttpManager::HttpManager(QObject *parent) : QObject(parent)
 {
-	m_qnam = new QNetworkAccessManager(this);
-	QObject::connect(m_qnam, SIGNAL(finished(QNetworkReply*)), this, SLOT(http_finished(QNetworkReply*)));
+	m_qnam = nullptr;
+	m_cache = nullptr;
 	m_config_path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
-	m_url = u;
 #if !defined(Q_OS_ANDROID) && !defined(Q_OS_WIN)
 	m_config_path += "/dudetronics";
 #endif
-	m_filename = f;
+	// Point at a local server for testing
+	m_baseurl = QString::fromLocal8Bit(qgetenv("DROIDSTAR_DOWNLOAD_URL"));
+	if(m_baseurl.isEmpty()){
+		m_baseurl = "http://www.dudetronics.com/ar-dns";
+	}
+}
+
+void HttpManager::download(QString f, bool u)
+{
+	// Created on first use so they belong to the download thread
+	if(m_qnam == nullptr){
+		m_qnam = new QNetworkAccessManager(this);
+		QObject::connect(m_qnam, SIGNAL(finished(QNetworkReply*)), this, SLOT(http_finished(QNetworkReply*)));
+		m_cache = new QSettings(m_config_path + "/httpcache.ini", QSettings::IniFormat, this);
+	}
+
+	transfer t;
+	t.url = u;
+	t.file = nullptr;
+	QUrl url;
+	if(u){
+		url = QUrl(f);
+		t.filename = "/" + url.fileName();
+	}
+	else{
+		url = QUrl(m_baseurl + f);
+		t.filename = f;
+	}
+
+	QNetworkRequest request(url);
+
+	// Only ask for changes if the copy we have is the one the validators
+	// belong to
+	QFileInfo local(m_config_path + t.filename);
+	const QString key = t.filename.mid(1);
+	if(local.exists() && (m_cache->value(key + "/size").toLongLong() == local.size())){
+		const QByteArray etag = m_cache->value(key + "/etag").toByteArray();
+		const QByteArray modified = m_cache->value(key + "/modified").toByteArray();
+		if(!etag.isEmpty()){
+			request.setRawHeader("If-None-Match", etag);
+		}
+		if(!modified.isEmpty()){
+			request.setRawHeader("If-Modified-Since", modified);
+		}
+	}
+
+	QNetworkReply *reply = m_qnam->get(request);
+	m_transfers.insert(reply, t);
+	QObject::connect(reply, SIGNAL(readyRead()), this, SLOT(http_ready_read()));
+	qDebug() << "download() " << url.toString();
 }
 
-void HttpManager::process()
+void HttpManager::http_ready_read()
 {
-	QMetaObject::invokeMethod(this,"doRequest");
+	QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+	if(reply != nullptr){
+		write_reply(reply);
+	}
 }
 
-void HttpManager::doRequest()
+void HttpManager::write_reply(QNetworkReply *reply)
 {
-	if(m_url){
-		m_qnam->get(QNetworkRequest(QUrl(m_filename)));
+	if(!m_transfers.contains(reply)){
+		return;
 	}
-	else{
-		m_qnam->get(QNetworkRequest(QUrl("http://www.dudetronics.com/ar-dns" + m_filename)));
+	transfer &t = m_transfers[reply];
+
+	if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200){
+		reply->readAll();
+		return;
 	}
-	//qDebug() << "doRequest() called m_filename == " << m_filename;
+
+	if(t.file == nullptr){
+		QDir().mkpath(m_config_path);
+		t.file = new QSaveFile(m_config_path + t.filename);
+		if(!t.file->open(QIODevice::WriteOnly)){
+			qDebug() << "http_ready_read() unable to open " << t.file->fileName();
+			reply->abort();
+			return;
+		}
+	}
+	t.file->write(reply->readAll());
 }
 
 void HttpManager::http_finished(QNetworkReply *reply)
 {
-	qDebug() << "http_finished() called";
-	if (reply->error()) {
+	if(!m_transfers.contains(reply)){
 		reply->deleteLater();
-		reply = nullptr;
-		qDebug() << "http_finished() error()";
 		return;
 	}
-	else{
-		if(m_url){
-			QStringList l = m_filename.split('/');
-			m_filename = "/" + l.at(l.size() - 1);
+	if(reply->bytesAvailable()){
+		write_reply(reply);
+	}
+	transfer t = m_transfers.take(reply);
+	const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	const QString key = t.filename.mid(1);
+
+	if(reply->error() || (status != 200) || (t.file == nullptr)){
+		if(t.file){
+			t.file->cancelWriting();
+			delete t.file;
+		}
+		if(status == 304){
+			qDebug() << "http_finished() " << t.filename << " not modified";
+		}
+		else{
+			qDebug() << "http_finished() error " << t.filename << ":" << reply->errorString();
 		}
-		qDebug() << "m_filename = " << m_filename;
-		QFile *hosts_file = new QFile(m_config_path + m_filename);
-		qDebug() << "m_config_path + m_filename = " << m_config_path + m_filename;
-		hosts_file->open(QIODevice::WriteOnly);
-		QFileInfo fileInfo(hosts_file->fileName());
-		QString filename(fileInfo.fileName());
-		hosts_file->write(reply->readAll());
-		hosts_file->flush();
-		hosts_file->close();
-		delete hosts_file;
-		emit file_downloaded(filename);
-		//fprintf(stderr, "Downloaded %s\n", filename.toStdString().c_str());fflush(stderr);
+		reply->deleteLater();
+		return;
+	}
+
+	const bool ok = t.file->commit();
+	delete t.file;
+	if(!ok){
+		qDebug() << "http_finished() unable to save " << t.filename;
+		reply->deleteLater();
+		return;
+	}
+
+	m_cache->setValue(key + "/etag", reply->rawHeader("ETag"));
+	m_cache->setValue(key + "/modified", reply->rawHeader("Last-Modified"));
+	m_cache->setValue(key + "/size", QFileInfo(m_config_path + t.filename).size());
+	m_cache->sync();
+
+	qDebug() << "http_finished() saved " << m_config_path + t.filename;
+	if(t.url){
+		emit url_downloaded(key);
+	}
+	else{
+		emit file_downloaded(key);
 	}
-	QThread::currentThread()->quit();
+	reply->deleteLater();
 }
@@ -21,25 +21,43 @@
 #include <QObject>
 #include <QtNetwork>
 
+class QSaveFile;
+
+// Downloads host lists, ID files and vocoder plugins.  One instance lives on
+// its own thread and all requests share its QNetworkAccessManager, which runs
+// several transfers to the same server in parallel.  Requests are conditional
+// on the ETag/Last-Modified of the copy we already have, bodies are streamed
+// into a temporary file that only replaces the old one once complete, and
+// QNAM's own gzip negotiation keeps the transfer size down.
 class HttpManager : public QObject
 {
 	Q_OBJECT
 public:
-	explicit HttpManager(QString, bool u = false);
-	//void start_request(QString file);
+	explicit HttpManager(QObject *parent = nullptr);
 
 signals:
 	void file_downloaded(QString);
+	void url_downloaded(QString);
+
+public slots:
+	void download(QString, bool u = false);
 
 private:
-	QString m_filename;
+	struct transfer {
+		QString filename;
+		bool url;
+		QSaveFile *file;
+	};
 	QString m_config_path;
+	QString m_baseurl;
 	QNetworkAccessManager *m_qnam;
-	bool m_url;
+	QSettings *m_cache;
+	QHash<QNetworkReply *, transfer> m_transfers;
+
+	void write_reply(QNetworkReply *reply);
 
 private slots:
-	void process();
-	void doRequest();
+	void http_ready_read();
 	void http_finished(QNetworkReply *reply);
 };
 
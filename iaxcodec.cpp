@@ -17,6 +17,7 @@
 
 #include "iaxcodec.h"
 #include "iaxdefines.h"
+#include "logger.h"
 #ifdef Q_OS_WIN
 #include <winsock2.h>
 #else
@@ -157,14 +158,7 @@ void IAXCodec::send_call()
 	out.append(AST_FORMAT_ULAW);
 	m_timestamp = QDateTime::currentMSecsSinceEpoch();
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_call_auth()
@@ -187,14 +181,7 @@ void IAXCodec::send_call_auth()
 	out.append(result.toHex().size());
 	out.append(result.toHex());
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_dtmf(QByteArray dtmf)
@@ -214,14 +201,7 @@ void IAXCodec::send_dtmf(QByteArray dtmf)
 		out.append(AST_FRAME_DTMF);
 		out.append(dtmf.data()[i]);
 		m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-		fprintf(stderr, "SEND: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 	}
 }
 
@@ -240,14 +220,7 @@ void IAXCodec::send_radio_key(bool key)
 	out.append(AST_FRAME_CONTROL);
 	out.append(key ? AST_CONTROL_KEY : AST_CONTROL_UNKEY);
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-		fprintf(stderr, "SEND: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_ping()
@@ -265,14 +238,7 @@ void IAXCodec::send_ping()
 	out.append(AST_FRAME_IAX);
 	out.append(IAX_COMMAND_PING);
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_pong()
@@ -314,14 +280,7 @@ void IAXCodec::send_pong()
 	out.append(sizeof(ooo));
 	out.append((char *)&ooo, sizeof(ooo));
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_ack(uint16_t scall, uint16_t dcall, uint8_t oseq, uint8_t iseq)
@@ -339,14 +298,7 @@ void IAXCodec::send_ack(uint16_t scall, uint16_t dcall, uint8_t oseq, uint8_t is
 	out.append(AST_FRAME_IAX);
 	out.append(IAX_COMMAND_ACK);
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_lag_response()
@@ -364,14 +316,7 @@ void IAXCodec::send_lag_response()
 	out.append(AST_FRAME_IAX);
 	out.append(IAX_COMMAND_LAGRP);
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_voice_frame(int16_t *f)
@@ -394,14 +339,7 @@ void IAXCodec::send_voice_frame(int16_t *f)
 	}
 
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_registration(uint16_t dcall)
@@ -449,14 +387,7 @@ void IAXCodec::send_registration(uint16_t dcall)
 	out.append(0x02);
 	out.append((char *)&refresh, 2);			// refresh time = 60 secs
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::send_disconnect()
@@ -477,14 +408,7 @@ void IAXCodec::send_disconnect()
 	out.append(bye.size());
 	out.append(bye.toUtf8(), bye.size());
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::hostname_lookup(QHostInfo i)
@@ -493,7 +417,7 @@ void IAXCodec::hostname_lookup(QHostInfo i)
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
 		m_regtimer = new QTimer();
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		connect(m_regtimer, SIGNAL(timeout()), this, SLOT(send_registration()));
 		m_timestamp = QDateTime::currentMSecsSinceEpoch();
 		send_registration(0);
@@ -508,24 +432,12 @@ void IAXCodec::send_connect()
 	QHostInfo::lookupHost(m_host, this, SLOT(hostname_lookup(QHostInfo)));
 }
 
-void IAXCodec::process_udp()
+void IAXCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
 	if(buf.data()[0] & 0x80){
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
+		DSLOG_HEX(Logger::IAX, "RECV", buf.data(), buf.size());
 	}
-#endif
 	if( (buf.data()[0] & 0x80) &&
 		(buf.data()[10] == AST_FRAME_IAX) &&
 		(buf.data()[11] == IAX_COMMAND_REGAUTH) &&
@@ -616,11 +528,11 @@ void IAXCodec::process_udp()
 	{
 		if(m_status == CONNECTING){
 			m_status = CONNECTED_RW;
-			m_txtimer = new QTimer();
+			m_txtimer = new MediaTimer(this);
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
-			m_rxtimer = new QTimer();
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
-			m_rxtimer->start(19);
+			m_rxtimer->start(20);
 			m_pingtimer = new QTimer();
 			connect(m_pingtimer, SIGNAL(timeout()), this, SLOT(send_ping()));
 			m_pingtimer->start(2000);
@@ -685,7 +597,7 @@ void IAXCodec::process_udp()
 		}
 		send_voice_frame(zeropcm);
 		if(!m_txtimer->isActive()){
-			m_txtimer->start(19);
+			m_txtimer->start(20);
 		}
 	}
 	else if( (buf.data()[0] & 0x80) &&
@@ -815,14 +727,7 @@ void IAXCodec::transmit()
 		out.append(ulaw_encode(pcm[i]));
 	}
 	m_udp->writeDatagram(out, m_address, m_port);
-#ifdef DEBUGG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::IAX, "SEND", out.data(), out.size());
 }
 
 void IAXCodec::deleteLater()
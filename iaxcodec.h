@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QtNetwork>
 #include "audioengine.h"
+#include "mediascheduler.h"
 #ifdef USE_FLITE
 #include <flite/flite.h>
 #endif
@@ -41,7 +42,7 @@ signals:
 	void update_output_level(unsigned short);
 private slots:
 	void deleteLater();
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void send_connect();
 	void send_disconnect();
 	void hostname_lookup(QHostInfo i);
@@ -95,8 +96,8 @@ private:
 	QByteArray m_md5seed;
 	QTimer *m_regtimer;
 	QTimer *m_pingtimer;
-	QTimer *m_rxtimer;
-	QTimer *m_txtimer;
+	MediaTimer *m_rxtimer;
+	MediaTimer *m_txtimer;
 	AudioEngine *m_audio;
 	uint8_t m_iseq;
 	uint8_t m_oseq;
@@ -0,0 +1,243 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstring>
+#include "jitterbuffer.h"
+
+#define MAX_TARGET_MS		400
+#define MAX_CONCEAL_FRAMES	5
+#define MAX_GAP_PACKETS		4
+#define CONCEAL_FADE		0.6f
+
+JitterBuffer::JitterBuffer() :
+	m_frame_ms(20),
+	m_frame_size(0),
+	m_packet_frames(1),
+	m_modulus(256),
+	m_target_ms(60)
+{
+	reset();
+}
+
+void JitterBuffer::reset()
+{
+	m_packets.clear();
+	m_cur.clear();
+	m_last.clear();
+	m_curidx = 0;
+	m_curconcealed = false;
+	m_started = false;
+	m_playing = false;
+	m_ended = false;
+	m_highest = 0;
+	m_highest_ms = 0;
+	m_next = 0;
+	m_lastarrival = -1;
+	m_lastseq = 0;
+	m_jitter = 0;
+	m_fade = 1.0f;
+	m_concealrun = 0;
+	m_late = 0;
+	m_lost = 0;
+	m_reordered = 0;
+	m_duplicates = 0;
+	m_concealed = 0;
+}
+
+void JitterBuffer::configure(int frame_ms, int frame_size, uint32_t modulus)
+{
+	if((frame_size != m_frame_size) && !m_packets.empty()){
+		reset();
+	}
+	m_frame_ms = frame_ms;
+	m_frame_size = frame_size;
+	m_modulus = modulus ? modulus : 1;
+}
+
+// Extends seq to the candidate nearest to where the time since the highest
+// packet says the counter should be.  Taking the nearest to the highest
+// packet instead breaks on short counters like the YSF FN, where a dropout
+// of half the modulus would make every following packet look late.
+int64_t JitterBuffer::unwrap(uint32_t seq, int frames, int64_t now_ms)
+{
+	seq %= m_modulus;
+
+	if(!m_started){
+		return seq;
+	}
+
+	const int64_t packet_ms = frames * m_frame_ms;
+	const int64_t fwd = ((int64_t)seq - (m_highest % m_modulus) + m_modulus) % m_modulus;
+	const int64_t expect = (now_ms - m_highest_ms + packet_ms / 2) / packet_ms;
+
+	return m_highest + fwd + std::llround((double)(expect - fwd) / m_modulus) * (int64_t)m_modulus;
+}
+
+void JitterBuffer::push(uint32_t seq, const uint8_t *data, int frames, int64_t now_ms)
+{
+	if((m_frame_size == 0) || (frames <= 0)){
+		return;
+	}
+
+	const int64_t s = unwrap(seq, frames, now_ms);
+
+	if(!m_started){
+		m_started = true;
+		m_highest = s;
+		m_highest_ms = now_ms;
+		m_next = s;
+	}
+
+	// RFC 3550 style interarrival jitter, in ms
+	if(m_lastarrival >= 0){
+		float d = (float)((now_ms - m_lastarrival) - ((s - m_lastseq) * frames * m_frame_ms));
+		if(d < 0){
+			d = -d;
+		}
+		m_jitter += (d - m_jitter) / 16.0f;
+	}
+	m_lastarrival = now_ms;
+	m_lastseq = s;
+
+	if(s < m_next){
+		if(m_last.empty() && !m_playing){
+			m_next = s;
+		}
+		else{
+			++m_late;
+			return;
+		}
+	}
+	if(m_packets.count(s)){
+		++m_duplicates;
+		return;
+	}
+	if(s < m_highest){
+		++m_reordered;
+	}
+	else{
+		m_highest = s;
+		m_highest_ms = now_ms;
+	}
+
+	m_packets[s].assign(data, data + (frames * m_frame_size));
+	m_packet_frames = frames;
+}
+
+int JitterBuffer::depth() const
+{
+	int d = (m_cur.size() - m_curidx) / (m_frame_size ? m_frame_size : 1);
+
+	for(auto it = m_packets.begin(); it != m_packets.end(); ++it){
+		d += it->second.size() / m_frame_size;
+	}
+	return d;
+}
+
+int JitterBuffer::adaptive_target_ms() const
+{
+	int t = (int)(3 * m_jitter);
+	const int p = m_packet_frames * m_frame_ms;
+
+	if(t < m_target_ms){
+		t = m_target_ms;
+	}
+	if(t < p){
+		t = p;
+	}
+	return (t > MAX_TARGET_MS) ? MAX_TARGET_MS : t;
+}
+
+int JitterBuffer::pop(uint8_t *frame, float &gain)
+{
+	if(m_frame_size == 0){
+		return EMPTY;
+	}
+
+	if(m_curidx >= m_cur.size()){
+		m_cur.clear();
+		m_curidx = 0;
+
+		if(!m_playing){
+			if(m_packets.empty()){
+				return EMPTY;
+			}
+			if(!m_ended && (depth_ms() < adaptive_target_ms())){
+				return EMPTY;
+			}
+			m_playing = true;
+		}
+
+		if(m_packets.empty()){
+			// Underrun.  Bridge a short gap with the last frame, then
+			// stop and rebuffer up to the target depth.
+			if(m_ended || m_last.empty() || (m_concealrun >= MAX_CONCEAL_FRAMES)){
+				m_playing = false;
+				return EMPTY;
+			}
+			m_cur = m_last;
+			m_curconcealed = true;
+		}
+		else{
+			auto it = m_packets.begin();
+			const int64_t gap = it->first - m_next;
+
+			if((gap > 0) && (gap <= MAX_GAP_PACKETS) && !m_last.empty()){
+				++m_lost;
+				++m_next;
+				for(int i = 0; i < m_packet_frames; ++i){
+					m_cur.insert(m_cur.end(), m_last.begin(), m_last.end());
+				}
+				m_curconcealed = true;
+			}
+			else{
+				if(gap > 0){
+					m_lost += gap;
+				}
+				m_next = it->first + 1;
+				m_cur.swap(it->second);
+				m_packets.erase(it);
+				m_curconcealed = false;
+
+				// Drift back down when the buffer has grown well past the
+				// target, by dropping one frame at a packet boundary.
+				if((m_cur.size() > (size_t)m_frame_size) &&
+				   (depth_ms() > (adaptive_target_ms() + (2 * m_packet_frames * m_frame_ms)))){
+					m_curidx += m_frame_size;
+				}
+			}
+		}
+	}
+
+	memcpy(frame, &m_cur[m_curidx], m_frame_size);
+	m_curidx += m_frame_size;
+
+	if(m_curconcealed){
+		m_fade *= CONCEAL_FADE;
+		gain = m_fade;
+		++m_concealed;
+		++m_concealrun;
+		return CONCEALED;
+	}
+
+	m_last.assign(frame, frame + m_frame_size);
+	m_fade = 1.0f;
+	m_concealrun = 0;
+	gain = 1.0f;
+	return FRAME;
+}
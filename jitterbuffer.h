@@ -0,0 +1,87 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Sequence aware playout buffer for received vocoder frames.  Network packets
+// carrying one or more fixed size vocoder frames are pushed with the protocol's
+// own sequence counter (M17 frame number, DMR seq, YSF FN) and popped one frame
+// per RX timer tick.  Playout starts once the adaptive target depth is
+// buffered, packets arriving out of order are put back in order, and missing
+// packets are concealed by repeating the last good frame with a fade.
+class JitterBuffer
+{
+public:
+	enum{
+		EMPTY,
+		FRAME,
+		CONCEALED
+	};
+	JitterBuffer();
+	void reset();
+	void configure(int frame_ms, int frame_size, uint32_t modulus);
+	void set_target_ms(int ms) { m_target_ms = ms; }
+	int target_ms() const { return m_target_ms; }
+	void set_ended() { m_ended = true; }
+	void push(uint32_t seq, const uint8_t *data, int frames, int64_t now_ms);
+	int pop(uint8_t *frame, float &gain);
+	int depth() const;
+	int depth_ms() const { return depth() * m_frame_ms; }
+	int adaptive_target_ms() const;
+	uint32_t late() const { return m_late; }
+	uint32_t lost() const { return m_lost; }
+	uint32_t reordered() const { return m_reordered; }
+	uint32_t duplicates() const { return m_duplicates; }
+	uint32_t concealed() const { return m_concealed; }
+private:
+	int64_t unwrap(uint32_t seq, int frames, int64_t now_ms);
+
+	std::map<int64_t, std::vector<uint8_t>> m_packets;
+	std::vector<uint8_t> m_cur;
+	std::vector<uint8_t> m_last;
+	size_t m_curidx;
+	bool m_curconcealed;
+	int m_frame_ms;
+	int m_frame_size;
+	int m_packet_frames;
+	uint32_t m_modulus;
+	int m_target_ms;
+	bool m_started;
+	bool m_playing;
+	bool m_ended;
+	int64_t m_highest;
+	int64_t m_highest_ms;
+	int64_t m_next;
+	int64_t m_lastarrival;
+	int64_t m_lastseq;
+	float m_jitter;
+	float m_fade;
+	int m_concealrun;
+	uint32_t m_late;
+	uint32_t m_lost;
+	uint32_t m_reordered;
+	uint32_t m_duplicates;
+	uint32_t m_concealed;
+};
+
+#endif // JITTERBUFFER_H
@@ -0,0 +1,343 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "logger.h"
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+namespace {
+
+const char *const CATEGORY_NAMES[Logger::CategoryCount] = {
+	"app", "audio", "modem", "ambe", "dcs", "dmr", "iax", "m17", "nxdn", "p25", "ref", "xrf", "ysf"
+};
+const char LEVEL_CHARS[] = "EWIDT";
+
+// 256 slots of 1 KiB, enough for a few seconds of every category dumping
+// frames.  A hex dump longer than a slot is truncated.
+const size_t RING_SIZE = 256;
+const size_t SLOT_TEXT = 1000;
+const unsigned int FLUSH_MS = 20;
+
+int64_t now_ms()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bounded multi producer, single consumer queue after Vyukov: a producer
+// claims a slot with one CAS on the head, fills it and publishes it through
+// the slot sequence number.  A full ring drops the message.
+class LogRing
+{
+public:
+	struct Slot {
+		std::atomic<size_t> seq;
+		uint8_t cat;
+		uint8_t level;
+		uint16_t len;
+		int64_t ts;
+		char text[SLOT_TEXT];
+	};
+	LogRing() : m_head(0), m_tail(0), m_dropped(0)
+	{
+		for(size_t i = 0; i < RING_SIZE; ++i){
+			m_slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+	Slot *claim()
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		for(;;){
+			Slot &s = m_slots[pos % RING_SIZE];
+			const intptr_t diff = (intptr_t)s.seq.load(std::memory_order_acquire) - (intptr_t)pos;
+			if(diff == 0){
+				if(m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+					return &s;
+				}
+			}
+			else if(diff < 0){
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			else{
+				pos = m_head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	void publish(Slot *s)
+	{
+		s->seq.store(s->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+	// consumer side, only called from the flush thread
+	Slot *front()
+	{
+		Slot &s = m_slots[m_tail % RING_SIZE];
+		return (s.seq.load(std::memory_order_acquire) == m_tail + 1) ? &s : nullptr;
+	}
+	void pop(Slot *s)
+	{
+		s->seq.store(m_tail + RING_SIZE, std::memory_order_release);
+		++m_tail;
+	}
+	uint32_t take_dropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+private:
+	Slot m_slots[RING_SIZE];
+	std::atomic<size_t> m_head;
+	size_t m_tail;
+	std::atomic<uint32_t> m_dropped;
+};
+
+// Per category one second window counter for the rate limit.
+struct RateState {
+	std::atomic<int64_t> window;
+	std::atomic<uint32_t> count;
+	std::atomic<uint32_t> suppressed;
+};
+
+class LogSink
+{
+public:
+	LogSink() : m_quit(false), m_rate(100), m_start(now_ms())
+	{
+		for(int i = 0; i < Logger::CategoryCount; ++i){
+			m_rates[i].window.store(0);
+			m_rates[i].count.store(0);
+			m_rates[i].suppressed.store(0);
+		}
+		m_thread = std::thread(&LogSink::run, this);
+	}
+	~LogSink()
+	{
+		m_quit.store(true);
+		m_thread.join();
+		drain();
+	}
+	LogRing::Slot *begin(Logger::Category c, Logger::Level l, bool limited)
+	{
+		if(limited && !admit(c)){
+			return nullptr;
+		}
+		LogRing::Slot *s = m_ring.claim();
+		if(s){
+			s->cat = c;
+			s->level = l;
+			s->ts = now_ms() - m_start;
+		}
+		return s;
+	}
+	void commit(LogRing::Slot *s, int len)
+	{
+		s->len = (len < 0) ? 0 : ((size_t)len >= SLOT_TEXT) ? SLOT_TEXT - 1 : len;
+		m_ring.publish(s);
+	}
+	void set_rate(unsigned int r) { m_rate.store(r); }
+	// single consumer, the lock only orders flush() against the thread
+	void drain()
+	{
+		std::lock_guard<std::mutex> lock(m_drainlock);
+		LogRing::Slot *s;
+		while((s = m_ring.front()) != nullptr){
+			write(s->cat, s->level, s->ts, s->text);
+			m_ring.pop(s);
+		}
+		const uint32_t dropped = m_ring.take_dropped();
+		if(dropped){
+			char msg[64];
+			snprintf(msg, sizeof(msg), "%u messages dropped, log ring full", dropped);
+			write(Logger::App, Logger::Warn, now_ms() - m_start, msg);
+		}
+	}
+private:
+	bool admit(Logger::Category c)
+	{
+		RateState &r = m_rates[c];
+		const int64_t sec = now_ms() / 1000;
+		int64_t w = r.window.load(std::memory_order_relaxed);
+		if((w != sec) && r.window.compare_exchange_strong(w, sec, std::memory_order_relaxed)){
+			r.count.store(0, std::memory_order_relaxed);
+			const uint32_t n = r.suppressed.exchange(0, std::memory_order_relaxed);
+			if(n){
+				LogRing::Slot *s = begin(c, Logger::Warn, false);
+				if(s){
+					commit(s, snprintf(s->text, SLOT_TEXT, "%u messages suppressed by rate limit", n));
+				}
+			}
+		}
+		const unsigned int rate = m_rate.load(std::memory_order_relaxed);
+		if(rate && (r.count.fetch_add(1, std::memory_order_relaxed) >= rate)){
+			r.suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		return true;
+	}
+	void write(int cat, int level, int64_t ts, const char *text)
+	{
+#ifdef __ANDROID__
+		static const int prio[] = { ANDROID_LOG_ERROR, ANDROID_LOG_WARN, ANDROID_LOG_INFO, ANDROID_LOG_DEBUG, ANDROID_LOG_VERBOSE };
+		__android_log_print(prio[level], "DroidStar", "[%s] %s", CATEGORY_NAMES[cat], text);
+		(void)ts;
+#else
+		fprintf(stderr, "%lld.%03lld %c [%s] %s\n", (long long)(ts / 1000), (long long)(ts % 1000), LEVEL_CHARS[level], CATEGORY_NAMES[cat], text);
+#endif
+	}
+	void run()
+	{
+		while(!m_quit.load()){
+			std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_MS));
+			drain();
+#ifndef __ANDROID__
+			fflush(stderr);
+#endif
+		}
+	}
+	LogRing m_ring;
+	std::mutex m_drainlock;
+	RateState m_rates[Logger::CategoryCount];
+	std::atomic<bool> m_quit;
+	std::atomic<unsigned int> m_rate;
+	int64_t m_start;
+	std::thread m_thread;
+};
+
+LogSink &sink()
+{
+	static LogSink s;
+	return s;
+}
+
+}
+
+std::atomic<int> Logger::m_levels[Logger::CategoryCount] = {
+	{Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}, {Info}
+};
+std::atomic<bool> Logger::m_hex[Logger::CategoryCount] = {};
+
+void Logger::set_level(Category c, Level l)
+{
+	m_levels[c].store(l, std::memory_order_relaxed);
+}
+
+void Logger::set_hex(Category c, bool on)
+{
+	m_hex[c].store(on, std::memory_order_relaxed);
+}
+
+void Logger::set_rate(unsigned int per_second)
+{
+	sink().set_rate(per_second);
+}
+
+// Comma separated list of name=level[+hex], where name is a category or *
+// for all of them, level one of error, warn, info, debug, trace or off.
+// rate=N sets the per category limit in messages per second, 0 disables it.
+void Logger::configure(const char *spec)
+{
+	static const char *const level_names[] = { "error", "warn", "info", "debug", "trace" };
+	if(!spec){
+		return;
+	}
+	const char *p = spec;
+	while(*p){
+		const char *end = strchr(p, ',');
+		const size_t n = end ? (size_t)(end - p) : strlen(p);
+		char item[64];
+		if(n < sizeof(item)){
+			memcpy(item, p, n);
+			item[n] = 0;
+			char *val = strchr(item, '=');
+			if(val){
+				*val++ = 0;
+				if(strcmp(item, "rate") == 0){
+					set_rate(strtoul(val, nullptr, 10));
+				}
+				else{
+					char *plus = strchr(val, '+');
+					const bool hex = plus && (strcmp(plus + 1, "hex") == 0);
+					if(plus){
+						*plus = 0;
+					}
+					int level = -1;
+					for(int i = 0; i < 5; ++i){
+						if(strcmp(val, level_names[i]) == 0){
+							level = i;
+						}
+					}
+					for(int c = 0; c < CategoryCount; ++c){
+						if((strcmp(item, "*") == 0) || (strcmp(item, CATEGORY_NAMES[c]) == 0)){
+							if(level >= 0){
+								m_levels[c].store(level, std::memory_order_relaxed);
+							}
+							else if(strcmp(val, "off") == 0){
+								m_levels[c].store(-1, std::memory_order_relaxed);
+							}
+							m_hex[c].store(hex, std::memory_order_relaxed);
+						}
+					}
+				}
+			}
+		}
+		p += n;
+		if(*p == ','){
+			++p;
+		}
+	}
+}
+
+void Logger::log(Category c, Level l, const char *fmt, ...)
+{
+	LogRing::Slot *s = sink().begin(c, l, true);
+	if(!s){
+		return;
+	}
+	va_list ap;
+	va_start(ap, fmt);
+	const int len = vsnprintf(s->text, SLOT_TEXT, fmt, ap);
+	va_end(ap);
+	sink().commit(s, len);
+}
+
+void Logger::hex(Category c, const char *tag, const void *data, size_t len)
+{
+	static const char digits[] = "0123456789abcdef";
+	LogRing::Slot *s = sink().begin(c, Debug, true);
+	if(!s){
+		return;
+	}
+	const uint8_t *d = (const uint8_t *)data;
+	int o = snprintf(s->text, SLOT_TEXT, "%s:%u:", tag, (unsigned int)len);
+	for(size_t i = 0; (i < len) && (o + 4 < (int)SLOT_TEXT); ++i){
+		s->text[o++] = ' ';
+		s->text[o++] = digits[d[i] >> 4];
+		s->text[o++] = digits[d[i] & 0x0f];
+	}
+	s->text[o] = 0;
+	sink().commit(s, o);
+}
+
+// Writes out whatever is queued, for use right before exit or a crash report.
+void Logger::flush()
+{
+	sink().drain();
+}
@@ -0,0 +1,71 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Logging for the protocol and audio paths.  Messages are formatted by the
+// caller into a fixed size slot of a lock free ring and written out by a
+// background thread, so a codec thread never blocks on stderr or logcat.
+// Each category has a runtime level, a rate limit and an opt-in hex dump
+// switch, configured with Logger::configure() from DROIDSTAR_LOG, e.g.
+//   DROIDSTAR_LOG="*=info,m17=debug+hex,rate=50"
+// Messages above DSLOG_MAX_LEVEL are compiled out, hex dumps with DSLOG_NO_HEX.
+class Logger
+{
+public:
+	enum Level { Error, Warn, Info, Debug, Trace };
+	enum Category { App, Audio, Modem, Ambe, DCS, DMR, IAX, M17, NXDN, P25, REF, XRF, YSF, CategoryCount };
+	static void configure(const char *spec);
+	static void set_level(Category c, Level l);
+	static void set_hex(Category c, bool on);
+	static void set_rate(unsigned int per_second);
+	static bool enabled(Category c, Level l) { return (int)l <= m_levels[c].load(std::memory_order_relaxed); }
+	static bool hex_enabled(Category c) { return m_hex[c].load(std::memory_order_relaxed); }
+	static void log(Category c, Level l, const char *fmt, ...)
+#if defined(__GNUC__)
+		__attribute__((format(printf, 3, 4)))
+#endif
+		;
+	static void hex(Category c, const char *tag, const void *data, size_t len);
+	static void flush();
+private:
+	static std::atomic<int> m_levels[CategoryCount];
+	static std::atomic<bool> m_hex[CategoryCount];
+};
+
+#ifndef DSLOG_MAX_LEVEL
+#ifdef DEBUG
+#define DSLOG_MAX_LEVEL Logger::Trace
+#else
+#define DSLOG_MAX_LEVEL Logger::Debug
+#endif
+#endif
+
+#define DSLOG(c, l, ...) do { if(((l) <= DSLOG_MAX_LEVEL) && Logger::enabled(c, l)) Logger::log(c, l, __VA_ARGS__); } while(0)
+
+#ifdef DSLOG_NO_HEX
+#define DSLOG_HEX(c, tag, data, len) do {} while(0)
+#else
+#define DSLOG_HEX(c, tag, data, len) do { if(Logger::hex_enabled(c)) Logger::hex(c, tag, data, len); } while(0)
+#endif
+
+#endif // LOGGER_H
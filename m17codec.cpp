@@ -85,24 +85,27 @@ const uint8_t BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02
 
 M17Codec::M17Codec(QString callsign, char module, QString hostname, QString host, int port, bool ipv6, QString modem, QString audioin, QString audioout) :
 	Codec(callsign, module, hostname, host, port, ipv6, NULL, modem, audioin, audioout),
-	m_txrate(1)
+	m_c2rx(nullptr),
+	m_txrate(1),
+	m_rfstreamid(0),
+	m_lichmask(0),
+	m_lsfvalid(false)
 {
+	::memset(m_lsf, 0x00U, sizeof(m_lsf));
+	::memset(m_lichlsf, 0x00U, sizeof(m_lichlsf));
 	m_modeinfo.callsign = callsign;
 	m_modeinfo.host = host;
 	m_modeinfo.port = port;
 	m_modeinfo.count = 0;
 	m_modeinfo.frame_number = 0;
 	m_modeinfo.streamid = 0;
-#ifdef Q_OS_WIN
-	m_txtimerint = 30; // Qt timers on windows seem to be slower than desired value
-
-#else
-	m_txtimerint = 36;
-#endif
+	m_txtimerint = 40;
 }
 
 M17Codec::~M17Codec()
 {
+	sw_vocoder_stop();
+	delete m_c2rx;
 }
 
 void M17Codec::encode_callsign(uint8_t *callsign)
@@ -157,22 +160,27 @@ void M17Codec::encode_c2(int16_t *audio, uint8_t *c)
 	m_c2->codec2_encode(c, audio);
 }
 
-void M17Codec::process_udp()
+// Received frames are decoded on a vocoder worker with an instance of their
+// own, the mode the stream was in when a frame was queued is passed along in
+// flags since m_c2 keeps following the network side.
+void M17Codec::c2_decoder_start()
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
-
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	if(!m_c2rx){
+		m_c2rx = new CCodec2(true);
+	}
+	sw_vocoder_start(
+		[this](int16_t *pcm, const uint8_t *codec2, int flags) {
+			m_c2rx->codec2_set_mode(flags);
+			m_c2rx->codec2_decode(pcm, codec2);
+			return flags ? 160 : 320;
+		},
+		nullptr);
+}
+
+void M17Codec::process_udp(const QByteArray &buf)
+{
+
+	DSLOG_HEX(Logger::M17, "RECV", buf.data(), buf.size());
 	if((m_modeinfo.status != CONNECTED_RW) && (buf.size() == 4) && (::memcmp(buf.data(), "NACK", 4U) == 0)){
 		m_modeinfo.status = DISCONNECTED;
 	}
@@ -185,13 +193,14 @@ void M17Codec::process_udp()
 				m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 				m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 				m_modem->connect_to_serial(m_modemport);
-				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 			}
 
 			m_c2 = new CCodec2(true);
-			m_txtimer = new QTimer();
+			c2_decoder_start();
+			m_txtimer = new MediaTimer(this);
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
-			m_rxtimer = new QTimer();
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
 			m_ping_timer = new QTimer();
 			connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
@@ -211,7 +220,7 @@ void M17Codec::process_udp()
 	if((buf.size() == 54) && (::memcmp(buf.data(), "M17 ", 4U) == 0)){
 		uint16_t streamid = (buf.data()[4] << 8) | (buf.data()[5] & 0xff);
 		if( (m_modeinfo.streamid != 0) && (streamid != m_modeinfo.streamid) ){
-			qDebug() << "New streamid received before timeout";
+			DSLOG(Logger::M17, Logger::Info, "New streamid received before timeout");
 			m_modeinfo.streamid = 0;
 			m_audio->stop_playback();
 		}
@@ -235,17 +244,17 @@ void M17Codec::process_udp()
 				set_mode(false);
 			}
 
+			m_jitter.reset();
+			m_jitter.configure(get_mode() ? 20 : 40, 8, 0x8000);
+			stats_start(40, 0x8000);
+
 			if(!m_rxtimer->isActive()){
-#ifdef Q_OS_WIN
-				m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : 32);
-#else
 				m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : m_rxtimerint*2);
-#endif
 			}
 
 			m_modeinfo.stream_state = STREAM_NEW;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-			qDebug() << "New stream from " << m_modeinfo.src << " to " << m_modeinfo.dst << " id == " << QString::number(m_modeinfo.streamid, 16);
+			DSLOG(Logger::M17, Logger::Info, "New stream from %s to %s id == %x", qPrintable(m_modeinfo.src), qPrintable(m_modeinfo.dst), m_modeinfo.streamid);
 		}
 		else{
 			m_modeinfo.stream_state = STREAMING;
@@ -258,12 +267,13 @@ void M17Codec::process_udp()
 			s = 16;
 		}
 
-		for(int i = 0; i < s; ++i){
-			m_rxcodecq.append((uint8_t )buf.data()[36+i]);
-		}
+		stats_rx(m_modeinfo.frame_number & 0x7fff);
+		m_jitter.push(m_modeinfo.frame_number & 0x7fff, (uint8_t *)&(buf.data()[36]), s / 8, media_ms());
+		update_jitter_info();
 
 		if(m_modeinfo.frame_number & 0x8000){ // EOT
-			qDebug() << "M17 stream ended";
+			DSLOG(Logger::M17, Logger::Info, "M17 stream ended");
+			m_jitter.set_ended();
 			m_rxwatchdog = 0;
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -298,16 +308,9 @@ void M17Codec::hostname_lookup(QHostInfo i)
 		out.append(m_module);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::M17, "CONN", out.data(), out.size());
 	}
 }
 
@@ -318,7 +321,7 @@ void M17Codec::mmdvm_direct_connect()
 		m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 		m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 		m_modem->connect_to_serial(m_modemport);
-		connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+		connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 		if(m_modeinfo.status == CONNECTING){
 			m_modeinfo.status = CONNECTED_RW;
 		}
@@ -328,9 +331,10 @@ void M17Codec::mmdvm_direct_connect()
 	}
 
 	m_c2 = new CCodec2(true);
-	m_txtimer = new QTimer();
+	c2_decoder_start();
+	m_txtimer = new MediaTimer(this);
 	connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
-	m_rxtimer = new QTimer();
+	m_rxtimer = new MediaTimer(this);
 	connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
 	m_audio = new AudioEngine(m_audioin, m_audioout);
 	m_audio->init();
@@ -352,14 +356,7 @@ void M17Codec::send_ping()
 	out.append('G');
 	out.append((char *)cs, 6);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::M17, "PING", out.data(), out.size());
 }
 
 void M17Codec::send_disconnect()
@@ -382,14 +379,7 @@ void M17Codec::send_disconnect()
 	out.append('C');
 	out.append((char *)cs, 6);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::M17, "SEND", out.data(), out.size());
 }
 
 void M17Codec::send_modem_data(QByteArray d)
@@ -412,14 +402,13 @@ void M17Codec::send_modem_data(QByteArray d)
 		interleave(txframe, tmp);
 		decorrelate(tmp, txframe);
 
-		m_rxmodemq.append(MMDVM_FRAME_START);
-		m_rxmodemq.append(M17_FRAME_LENGTH_BYTES + 4);
-		m_rxmodemq.append(MMDVM_M17_LINK_SETUP);
-		m_rxmodemq.append('\x00');
-
-		for(uint32_t i = 0; i < M17_FRAME_LENGTH_BYTES; ++i){
-			m_rxmodemq.append(txframe[i]);
-		}
+		QByteArray out;
+		out.append((char)MMDVM_FRAME_START);
+		out.append(M17_FRAME_LENGTH_BYTES + 4);
+		out.append(MMDVM_M17_LINK_SETUP);
+		out.append('\x00');
+		out.append((char *)txframe, M17_FRAME_LENGTH_BYTES);
+		m_modem->write(out);
 	}
 
 	if(lsfcnt == 0){
@@ -445,14 +434,13 @@ void M17Codec::send_modem_data(QByteArray d)
 	interleave(txframe, tmp);
 	decorrelate(tmp, txframe);
 
-	m_rxmodemq.append(MMDVM_FRAME_START);
-	m_rxmodemq.append(M17_FRAME_LENGTH_BYTES + 4);
-	m_rxmodemq.append(MMDVM_M17_STREAM);
-	m_rxmodemq.append('\x00');
-
-	for(uint32_t i = 0; i < M17_FRAME_LENGTH_BYTES; ++i){
-		m_rxmodemq.append(txframe[i]);
-	}
+	QByteArray out;
+	out.append((char)MMDVM_FRAME_START);
+	out.append(M17_FRAME_LENGTH_BYTES + 4);
+	out.append(MMDVM_M17_STREAM);
+	out.append('\x00');
+	out.append((char *)txframe, M17_FRAME_LENGTH_BYTES);
+	m_modem->write(out);
 	lsfcnt++;
 	if (lsfcnt >= 6U)
 		lsfcnt = 0U;
@@ -460,65 +448,108 @@ void M17Codec::send_modem_data(QByteArray d)
 
 void M17Codec::process_modem_data(QByteArray d)
 {
-	QByteArray txframe;
-	static uint16_t txstreamid = 0;
-	static uint8_t lsf[M17_LSF_LENGTH_BYTES];
-	CM17Convolution conv;
-	uint8_t tmp[M17_FRAME_LENGTH_BYTES];
-
 	if(d.size() < 3){
 		return;
 	}
-	uint8_t *p = (uint8_t *)d.data();
+	const uint8_t type = d.data()[2];
 
-	if((d.data()[2] == MMDVM_M17_LINK_SETUP) || (d.data()[2] == MMDVM_M17_STREAM)){
-		p += 4;
-		decorrelate(p, tmp);
-		interleave(tmp, p);
+	if((type == MMDVM_M17_LINK_SETUP) || (type == MMDVM_M17_STREAM)){
+		if(d.size() < (int)(4 + M17_FRAME_LENGTH_BYTES)){
+			return;
+		}
+		// The modem only gives us hard bits, pass them on at full confidence
+		const uint8_t *p = (const uint8_t *)d.data() + 4;
+		int8_t llr[M17_FRAME_LENGTH_BITS - M17_SYNC_LENGTH_BITS];
+		for(uint32_t i = 0; i < (M17_FRAME_LENGTH_BITS - M17_SYNC_LENGTH_BITS); ++i){
+			llr[i] = READ_BIT(p, i + M17_SYNC_LENGTH_BITS) ? 127 : -127;
+		}
+		process_modem_llr(type, llr);
 	}
-
-	if((d.data()[2] == MMDVM_M17_LOST) || (d.data()[2] == MMDVM_M17_EOT)){
-		txstreamid = 0;
+	else if((type == MMDVM_M17_LOST) || (type == MMDVM_M17_EOT)){
+		m_rfstreamid = 0;
+		m_lsfvalid = false;
+		m_lichmask = 0;
 		if(m_modeinfo.host == "MMDVM_DIRECT"){
 			m_modeinfo.streamid = 0;
 			m_modeinfo.stream_state = STREAM_END;
 		}
 	}
+}
 
-	else if(d.data()[2] == MMDVM_M17_LINK_SETUP){
-		::memset(lsf, 0x00U, M17_LSF_LENGTH_BYTES);
-		conv.decodeLinkSetup(p + M17_SYNC_LENGTH_BYTES, lsf);
-		bool valid = checkCRC16(lsf, M17_LSF_LENGTH_BYTES);
-		txstreamid = static_cast<uint16_t>((::rand() & 0xFFFF));
-		qDebug() << "LSF valid == " << valid;
+// Decode one received LSF or stream frame from soft bits.  llr holds the 368
+// bits following the sync word as they came off the air (still scrambled and
+// interleaved), positive for 1, negative for 0, magnitude as confidence.
+// Demodulators that produce soft symbols can call this directly.
+void M17Codec::process_modem_llr(uint8_t type, const int8_t *llr)
+{
+	QByteArray txframe;
+	CM17Convolution conv;
+	int8_t soft[M17_FRAME_LENGTH_BITS - M17_SYNC_LENGTH_BITS];
+
+	deinterleave_llr(llr, soft);
+
+	if(type == MMDVM_M17_LINK_SETUP){
+		::memset(m_lsf, 0x00U, M17_LSF_LENGTH_BYTES);
+		m_modeinfo.fec_corrected = conv.decodeLinkSetupSoft(soft, m_lsf);
+		m_lsfvalid = checkCRC16(m_lsf, M17_LSF_LENGTH_BYTES);
+		m_lichmask = 0;
+		m_rfstreamid = static_cast<uint16_t>((::rand() & 0xFFFF));
+		DSLOG(Logger::M17, Logger::Debug, "LSF valid == %d corrected bits == %u", m_lsfvalid, m_modeinfo.fec_corrected);
 
 		if(m_modeinfo.host == "MMDVM_DIRECT"){
 			uint8_t cs[10];
-			::memcpy(cs, lsf, 6);
+			::memcpy(cs, m_lsf, 6);
 			decode_callsign(cs);
 			m_modeinfo.dst = QString((char *)cs);
-			::memcpy(cs, lsf+6, 6);
+			::memcpy(cs, m_lsf+6, 6);
 			decode_callsign(cs);
 			m_modeinfo.src = QString((char *)cs);
 		}
 	}
-	else if(d.data()[2] == MMDVM_M17_STREAM){
+	else if(type == MMDVM_M17_STREAM){
+		uint8_t lich[M17_LICH_FRAGMENT_LENGTH_BYTES];
 		uint8_t frame[M17_FN_LENGTH_BYTES + M17_PAYLOAD_LENGTH_BYTES];
-		conv.decodeData(p + M17_SYNC_LENGTH_BYTES + M17_LICH_FRAGMENT_FEC_LENGTH_BYTES, frame);
+		uint32_t corrected = decode_lich_soft(soft, lich);
+		corrected += conv.decodeDataSoft(soft + M17_LICH_FRAGMENT_FEC_LENGTH_BITS, frame);
+		m_modeinfo.fec_corrected = corrected;
+		stats_fec(corrected);
 		//uint16_t fn = (frame[0U] << 8) + (frame[1U] << 0);
 
+		// Late entry, rebuild the LSF from the LICH fragments
+		if(!m_lsfvalid){
+			const uint8_t n = (lich[5] >> 5) & 0x07U;
+			if(n < 6){
+				::memcpy(m_lichlsf + (n * M17_LSF_FRAGMENT_LENGTH_BYTES), lich, M17_LSF_FRAGMENT_LENGTH_BYTES);
+				m_lichmask |= 1U << n;
+			}
+			if((m_lichmask == 0x3FU) && checkCRC16(m_lichlsf, M17_LSF_LENGTH_BYTES)){
+				::memcpy(m_lsf, m_lichlsf, M17_LSF_LENGTH_BYTES);
+				m_lsfvalid = true;
+				DSLOG(Logger::M17, Logger::Info, "LSF recovered from LICH");
+				if(m_modeinfo.host == "MMDVM_DIRECT"){
+					uint8_t cs[10];
+					::memcpy(cs, m_lsf, 6);
+					decode_callsign(cs);
+					m_modeinfo.dst = QString((char *)cs);
+					::memcpy(cs, m_lsf+6, 6);
+					decode_callsign(cs);
+					m_modeinfo.src = QString((char *)cs);
+				}
+			}
+		}
+
 		uint8_t netframe[M17_LSF_LENGTH_BYTES + M17_FN_LENGTH_BYTES + M17_PAYLOAD_LENGTH_BYTES + M17_CRC_LENGTH_BYTES];
-		::memcpy(netframe, lsf, M17_LSF_LENGTH_BYTES);
+		::memcpy(netframe, m_lsf, M17_LSF_LENGTH_BYTES);
 		::memcpy(netframe + M17_LSF_LENGTH_BYTES - M17_CRC_LENGTH_BYTES, frame, M17_FN_LENGTH_BYTES + M17_PAYLOAD_LENGTH_BYTES);
 		netframe[M17_LSF_LENGTH_BYTES - M17_CRC_LENGTH_BYTES + 0U] &= 0x7FU;
 
 		if(m_modeinfo.host == "MMDVM_DIRECT"){
 			if( !m_tx && (m_modeinfo.streamid == 0) ){
-				if(txstreamid == 0){
-					qDebug() << "No header, late entry...";
-					txstreamid = static_cast<uint16_t>((::rand() & 0xFFFF));
+				if(m_rfstreamid == 0){
+					DSLOG(Logger::M17, Logger::Info, "No header, late entry...");
+					m_rfstreamid = static_cast<uint16_t>((::rand() & 0xFFFF));
 				}
-				m_modeinfo.streamid = txstreamid;
+				m_modeinfo.streamid = m_rfstreamid;
 				m_audio->start_playback();
 
 				if((netframe[13] & 0x06U) == 0x04U){
@@ -530,17 +561,17 @@ void M17Codec::process_modem_data(QByteArray d)
 					set_mode(false);
 				}
 
+				m_jitter.reset();
+				m_jitter.configure(get_mode() ? 20 : 40, 8, 0x8000);
+				stats_start(40, 0x8000);
+
 				if(!m_rxtimer->isActive()){
-	#ifdef Q_OS_WIN
-					m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : 32);
-	#else
 					m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : m_rxtimerint*2);
-	#endif
 				}
 
 				m_modeinfo.stream_state = STREAM_NEW;
 				m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-				qDebug() << "New RF stream from " << m_modeinfo.src << " to " << m_modeinfo.dst << " id == " << QString::number(m_modeinfo.streamid, 16);
+				DSLOG(Logger::M17, Logger::Info, "New RF stream from %s to %s id == %x", qPrintable(m_modeinfo.src), qPrintable(m_modeinfo.dst), m_modeinfo.streamid);
 			}
 			else{
 				m_modeinfo.stream_state = STREAMING;
@@ -552,9 +583,9 @@ void M17Codec::process_modem_data(QByteArray d)
 				s = 16;
 			}
 
-			for(int i = 0; i < s; ++i){
-				m_rxcodecq.append(netframe[30+i]);
-			}
+			stats_rx(m_modeinfo.frame_number & 0x7fff);
+			m_jitter.push(m_modeinfo.frame_number & 0x7fff, &netframe[30], s / 8, media_ms());
+			update_jitter_info();
 			emit update(m_modeinfo);
 		}
 		else{
@@ -569,8 +600,8 @@ void M17Codec::process_modem_data(QByteArray d)
 			txframe.append('1');
 			txframe.append('7');
 			txframe.append(' ');
-			txframe.append(txstreamid >> 8);
-			txframe.append(txstreamid & 0xff);
+			txframe.append(m_rfstreamid >> 8);
+			txframe.append(m_rfstreamid & 0xff);
 			txframe.append((char *)dst, 6);
 			//txframe.append((char *)src, 6);
 			txframe.append((char *)&netframe[6], 6);
@@ -582,14 +613,7 @@ void M17Codec::process_modem_data(QByteArray d)
 			txframe.append((char *)&netframe[30], 16);
 			txframe.append(2, 0x00);
 			m_udp->writeDatagram(txframe, m_address, m_modeinfo.port);
-#ifdef DEBUG
-			fprintf(stderr, "NETFRAME:%02x:", (uint8_t)d.data()[2]);
-			for(int i = 0; i < 50; ++i){
-				fprintf(stderr, "%02x ", netframe[i]);
-			}
-			fprintf(stderr, "\n");
-			fflush(stderr);
-#endif
+			DSLOG_HEX(Logger::M17, "NETFRAME", netframe, 50);
 		}
 	}
 }
@@ -653,11 +677,7 @@ void M17Codec::transmit()
 		   //std::cerr << "txstreamid == " << txstreamid << std::endl;
 		   if(!m_rxtimer->isActive() && (m_modeinfo.host == "MMDVM_DIRECT")){
 			   m_modeinfo.stream_state = STREAM_NEW;
-#ifdef Q_OS_WIN
-			   m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : 32);
-#else
-			   m_rxtimer->start(19);
-#endif
+			   m_rxtimer->start(m_modeinfo.type ? m_rxtimerint : m_rxtimerint*2);
 		   }
 
 		}
@@ -715,12 +735,7 @@ void M17Codec::transmit()
 		m_modeinfo.streamid = txstreamid;
 		emit update(m_modeinfo);
 
-		fprintf(stderr, "SEND:%d: ", txframe.size());
-		for(int i = 0; i < txframe.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)txframe.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		DSLOG_HEX(Logger::M17, "SEND", txframe.data(), txframe.size());
 	}
 	else{
 		const uint8_t quiet3200[] = { 0x00, 0x01, 0x43, 0x09, 0xe4, 0x9c, 0x08, 0x21 };
@@ -780,58 +795,37 @@ void M17Codec::transmit()
 		m_modeinfo.frame_number = tx_cnt;
 		m_modeinfo.streamid = txstreamid;
 		emit update(m_modeinfo);
-		fprintf(stderr, "LAST:%d: ", txframe.size());
-		for(int i = 0; i < txframe.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)txframe.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		DSLOG_HEX(Logger::M17, "LAST", txframe.data(), txframe.size());
 	}
 }
 
 void M17Codec::process_rx_data()
 {
-	int16_t pcm[320];
 	uint8_t codec2[8];
-	static uint8_t cnt = 0;
 
 	if(m_rxwatchdog++ > 50){
-		qDebug() << "RX stream timeout ";
+		DSLOG(Logger::M17, Logger::Info, "RX stream timeout");
 		m_rxwatchdog = 0;
+		m_jitter.set_ended();
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 		emit update(m_modeinfo);
 		m_modeinfo.streamid = 0;
 	}
 
-	if((m_rxmodemq.size() > 2) && (++cnt >= 2)){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == MMDVM_FRAME_START) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-		cnt = 0;
-	}
+	float gain;
+	int r = JitterBuffer::EMPTY;
 
-	if((!m_tx) && (m_rxcodecq.size() > 7) ){
-		for(int i = 0; i < 8; ++i){
-			codec2[i] = m_rxcodecq.dequeue();
-		}
-		m_c2->codec2_decode(pcm, codec2);
-		int s = get_mode() ? 160 : 320;
-		m_audio->write(pcm, s);
-		emit update_output_level(m_audio->level());
+	if((!m_tx) && ((r = m_jitter.pop(codec2, gain)) != JitterBuffer::EMPTY) ){
+		sw_decode(codec2, 8, (r == JitterBuffer::CONCEALED) ? gain : 1.0f, get_mode());
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
 		m_rxtimer->stop();
 		m_audio->stop_playback();
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
-		m_rxcodecq.clear();
-		qDebug() << "M17 playback stopped";
+		DSLOG(Logger::M17, Logger::Info, "M17 playback stopped, jitter buffer late: %u lost: %u reordered: %u", m_jitter.late(), m_jitter.lost(), m_jitter.reordered());
+		m_jitter.reset();
 		return;
 	}
 }
@@ -853,6 +847,35 @@ void M17Codec::interleave(uint8_t *in, uint8_t *out)
 	}
 }
 
+// Soft bit equivalents of decorrelate() and interleave() for the receive
+// side, working on the bits after the sync word
+void M17Codec::deinterleave_llr(const int8_t *in, int8_t *out)
+{
+	for (uint32_t i = 0U; i < (M17_FRAME_LENGTH_BITS - M17_SYNC_LENGTH_BITS); i++) {
+		uint32_t n = i + M17_SYNC_LENGTH_BITS;
+		int8_t v = (in[i] < -127) ? -127 : in[i];
+		if (READ_BIT(SCRAMBLER, n) != 0U)
+			v = -v;
+		out[INTERLEAVER[i]] = v;
+	}
+}
+
+// Soft decode the four Golay(24,12) LICH codewords into 6 bytes, returns the
+// number of bits corrected
+uint32_t M17Codec::decode_lich_soft(const int8_t *in, uint8_t *lich)
+{
+	uint32_t frag[4U];
+	uint32_t corrected = 0U;
+	for (uint32_t i = 0U; i < 4U; i++) {
+		uint32_t c = 0U;
+		frag[i] = CGolay24128::decode24128Soft(in + (i * 24U), c);
+		corrected += c;
+	}
+	combineFragmentLICH(frag[0U], frag[1U], frag[2U], frag[3U], lich);
+
+	return corrected;
+}
+
 void M17Codec::splitFragmentLICH(const uint8_t* data, uint32_t& frag1, uint32_t& frag2, uint32_t& frag3, uint32_t& frag4)
 {
 	assert(data != NULL);
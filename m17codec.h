@@ -34,9 +34,13 @@ public:
 	void encode_c2(int16_t *, uint8_t *);
 	void set_mode(bool m){ m_c2->codec2_set_mode(m);}
 	bool get_mode(){ return m_c2->codec2_get_mode(); }
+	void process_modem_llr(uint8_t type, const int8_t *llr);
 	CCodec2 *m_c2;
+private:
+	void c2_decoder_start();
+	CCodec2 *m_c2rx;
 private slots:
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_modem_data(QByteArray);
 	void send_modem_data(QByteArray);
 	void send_ping();
@@ -53,11 +57,18 @@ private slots:
 	void combineFragmentLICHFEC(uint32_t, uint32_t, uint32_t, uint32_t, uint8_t*);
 	void interleave(uint8_t *, uint8_t *);
 	void decorrelate(uint8_t *, uint8_t *);
+	void deinterleave_llr(const int8_t *, int8_t *);
+	uint32_t decode_lich_soft(const int8_t *, uint8_t *);
 	bool checkCRC16(const uint8_t* in, uint32_t nBytes);
 	void encodeCRC16(uint8_t* in, uint32_t nBytes);
 	uint16_t createCRC16(const uint8_t* in, uint32_t nBytes);
 private:
 	int m_txrate;
+	uint16_t m_rfstreamid;
+	uint8_t m_lsf[30];
+	uint8_t m_lichlsf[30];
+	uint8_t m_lichmask;
+	bool m_lsfvalid;
 };
 
 #endif // M17CODEC_H
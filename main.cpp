@@ -20,10 +20,13 @@
 #include <QQuickStyle>
 #include <QIcon>
 #include <fcntl.h>
+#include <cstdlib>
 #include "droidstar.h"
+#include "logger.h"
 
 int main(int argc, char *argv[])
 {
+	Logger::configure(getenv("DROIDSTAR_LOG"));
 	QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 
 	QGuiApplication app(argc, argv);
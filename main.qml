@@ -316,6 +316,17 @@ ApplicationWindow {
 				settingsTab.sliderMicGain.value = 0.5;
 			}
         }
+		function onHosts_changed() {
+			droidstar.set_modelchange(true);
+			mainTab.comboHost.model = droidstar.get_hosts();
+			droidstar.set_modelchange(false);
+			mainTab.comboHost.currentIndex = mainTab.comboHost.find(droidstar.get_saved_host());
+		}
+		function onProbe_results_changed() {
+			hostsTab.probeList.model = droidstar.get_probe_results();
+			hostsTab.probeButton.enabled = droidstar.get_probe_supported();
+			hostsTab.probeButton.text = droidstar.get_probe_supported() ? qsTr("Probe hosts") : qsTr("Probing not available for this mode");
+		}
 		function onUpdate_data() {
 			mainTab.data1.text = droidstar.get_data1();
 			mainTab.data2.text = droidstar.get_data2();
@@ -324,6 +335,7 @@ ApplicationWindow {
 			mainTab.data5.text = droidstar.get_data5();
 			mainTab.data6.text = droidstar.get_data6();
 			mainTab.status.text = droidstar.get_statustxt();
+			mainTab.stats.text = droidstar.get_statstxt();
 			++mainTab.uitimer.rxcnt;
         }
 		function onUpdate_settings() {
@@ -384,6 +396,7 @@ ApplicationWindow {
 			settingsTab.rptr1Edit.text = droidstar.get_rptr1();
 			settingsTab.rptr2Edit.text = droidstar.get_rptr2();
 			settingsTab.txtimerEdit.text = droidstar.get_txtimeout();
+			settingsTab.jitterEdit.text = droidstar.get_jitter_target();
 
 			settingsTab.modemRXFreqEdit.text = droidstar.get_modemRxFreq();
 			settingsTab.modemTXFreqEdit.text = droidstar.get_modemTxFreq();
@@ -0,0 +1,166 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mediascheduler.h"
+#include "logger.h"
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+// A deadline missed by more than this many periods (suspend, debugger, a
+// starved CPU) is not worth catching up on with a burst of frames, restart
+// the entry from now instead.
+static const int MAX_LATE_PERIODS = 5;
+
+MediaScheduler *MediaScheduler::instance()
+{
+	static MediaScheduler s;
+	return &s;
+}
+
+MediaScheduler::MediaScheduler() :
+	m_quit(false),
+	m_nextid(0),
+	m_resyncs(0)
+{
+	start(QThread::TimeCriticalPriority);
+}
+
+MediaScheduler::~MediaScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_cv.notify_one();
+	wait();
+}
+
+int MediaScheduler::add(int period_us, Callback cb)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Entry e;
+	if(++m_nextid <= 0){
+		m_nextid = 1;
+	}
+	e.id = m_nextid;
+	e.period = std::chrono::microseconds(period_us);
+	e.deadline = std::chrono::steady_clock::now() + e.period;
+	e.cb = cb;
+	m_entries.push_back(e);
+	m_cv.notify_one();
+	return e.id;
+}
+
+// Once this returns the callback of id will not be called again.
+void MediaScheduler::remove(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(auto it = m_entries.begin(); it != m_entries.end(); ++it){
+		if(it->id == id){
+			m_entries.erase(it);
+			break;
+		}
+	}
+}
+
+void MediaScheduler::run()
+{
+#ifdef Q_OS_WIN
+	// default Windows timer resolution is 15.6 ms, which is what the old 19 ms
+	// and 30 ms timer fudges were working around
+	timeBeginPeriod(1);
+#endif
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(!m_quit){
+		if(m_entries.empty()){
+			m_cv.wait(lock);
+			continue;
+		}
+		std::chrono::steady_clock::time_point next = m_entries[0].deadline;
+		for(const Entry &e : m_entries){
+			if(e.deadline < next){
+				next = e.deadline;
+			}
+		}
+		if(m_cv.wait_until(lock, next) == std::cv_status::no_timeout){
+			continue;	// entries changed or quitting, recompute
+		}
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		for(Entry &e : m_entries){
+			if(now - e.deadline > e.period * MAX_LATE_PERIODS){
+				e.deadline = now;
+				++m_resyncs;
+				DSLOG(Logger::Audio, Logger::Warn, "MediaScheduler: resync id %d", e.id);
+			}
+			while(e.deadline <= now){
+				e.cb(e.id);
+				e.deadline += e.period;
+			}
+		}
+	}
+#ifdef Q_OS_WIN
+	timeEndPeriod(1);
+#endif
+}
+
+MediaTimer::~MediaTimer()
+{
+	stop();
+}
+
+void MediaTimer::start(int ms)
+{
+	stop();
+	m_interval = ms;
+	if(m_manual){
+		m_id = -1;
+		return;
+	}
+	m_id = MediaScheduler::instance()->add(ms * 1000, [this](int id){
+		QMetaObject::invokeMethod(this, "tick", Qt::QueuedConnection, Q_ARG(int, id));
+	});
+}
+
+void MediaTimer::stop()
+{
+	if(m_id > 0){
+		MediaScheduler::instance()->remove(m_id);
+	}
+	m_id = 0;
+}
+
+void MediaTimer::set_manual(bool manual)
+{
+	if(manual == m_manual){
+		return;
+	}
+	const bool active = isActive();
+	stop();
+	m_manual = manual;
+	if(active){
+		start(m_interval);
+	}
+}
+
+void MediaTimer::tick(int id)
+{
+	if(id == m_id){
+		emit timeout();
+	}
+}
@@ -0,0 +1,91 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEDIASCHEDULER_H
+#define MEDIASCHEDULER_H
+
+#include <QObject>
+#include <QThread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Single high priority thread that clocks the TX and RX frame paths of the
+// codecs.  Entries are kept as absolute deadlines on the monotonic clock and
+// advanced by exactly one period per tick, so lateness of one wakeup is not
+// carried into the next and the long term rate is the nominal frame rate.
+// Callbacks run on the scheduler thread with its lock held and must only
+// post work elsewhere (see MediaTimer).
+class MediaScheduler : public QThread
+{
+	Q_OBJECT
+public:
+	typedef std::function<void(int)> Callback;
+	static MediaScheduler *instance();
+	int add(int period_us, Callback cb);
+	void remove(int id);
+	uint32_t resyncs() const { return m_resyncs; }
+protected:
+	void run() override;
+private:
+	MediaScheduler();
+	~MediaScheduler();
+	struct Entry {
+		int id;
+		std::chrono::steady_clock::time_point deadline;
+		std::chrono::microseconds period;
+		Callback cb;
+	};
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::vector<Entry> m_entries;
+	bool m_quit;
+	int m_nextid;
+	uint32_t m_resyncs;
+};
+
+// Drop in for the QTimer pacing the codecs used for m_txtimer/m_rxtimer.
+// start() registers with the MediaScheduler, each deadline is delivered as
+// timeout() in the thread this object lives in.  Ticks still queued from a
+// previous start() are discarded.  A manual timer is not registered at all
+// and only ticks through fire(), used to run capture replay faster than
+// real time.
+class MediaTimer : public QObject
+{
+	Q_OBJECT
+public:
+	explicit MediaTimer(QObject *parent = nullptr) : QObject(parent), m_id(0), m_interval(0), m_manual(false) {}
+	~MediaTimer();
+	void start(int ms);
+	void stop();
+	bool isActive() const { return m_id != 0; }
+	int interval() const { return m_interval; }
+	void set_manual(bool manual);
+	void fire() { if(m_id) emit timeout(); }
+signals:
+	void timeout();
+private slots:
+	void tick(int id);
+private:
+	int m_id;
+	int m_interval;
+	bool m_manual;
+};
+
+#endif // MEDIASCHEDULER_H
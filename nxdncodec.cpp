@@ -44,7 +44,6 @@ NXDNCodec::NXDNCodec(QString callsign, uint16_t nxdnid, uint32_t gwid, QString h
 	m_nxdnid(nxdnid)
 {
 	m_txcnt = 0;
-	m_txtimerint = 19;
 	m_modeinfo.gwid = gwid;
 }
 
@@ -52,46 +51,42 @@ NXDNCodec::~NXDNCodec()
 {
 }
 
-void NXDNCodec::process_udp()
+void NXDNCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
 	uint8_t ambe[7];
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::NXDN, "RECV", buf.data(), buf.size());
 	if(buf.size() == 17){
 		if(m_modeinfo.status == CONNECTING){
 			m_modeinfo.status = CONNECTED_RW;
-			m_rxtimer = new QTimer();
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
-			m_txtimer = new QTimer();
+			m_txtimer = new MediaTimer(this);
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 			m_ping_timer = new QTimer();
 			connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
 			//m_mbeenc->set_gain_adjust(2.5);
-			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-			if(m_vocoder != ""){
-				m_hwrx = true;
-				m_hwtx = true;
-				m_modeinfo.hw_vocoder_loaded = true;
-				m_ambedev = new SerialAMBE("NXDN");
-				m_ambedev->connect_to_serial(m_vocoder);
-				connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-			}
-			else{
-				m_hwrx = false;
-				m_hwtx = false;
-			}
+			// only the top bit of the last byte belongs to the 49 bit frame
+			sw_vocoder_start(
+				[this](int16_t *pcm, const uint8_t *ambe, int) {
+					if(m_mbevocoder){
+						m_mbevocoder->decode(VOCODER_RATE_2450, pcm, ambe, 1);
+					}
+					else{
+						memset(pcm, 0, 160 * sizeof(int16_t));
+					}
+					return 160;
+				},
+				[this](uint8_t *ambe, const int16_t *pcm, int) {
+					memset(ambe, 0, 7);
+					if(m_mbevocoder){
+						m_mbevocoder->encode(VOCODER_RATE_2450, ambe, pcm, 1);
+					}
+					ambe[6] &= 0x80;
+					return 7;
+				});
+			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2450);
+			open_hw_vocoder("NXDN");
 			m_audio = new AudioEngine(m_audioin, m_audioout);
 			m_audio->init();
 			m_ping_timer->start(1000);
@@ -106,7 +101,7 @@ void NXDNCodec::process_udp()
 		m_modeinfo.dstid = (uint16_t)((buf.data()[7] << 8) & 0xff00) | (buf.data()[8] & 0xff);
 		if(get_lich_fct(buf.data()[10U]) == NXDN_LICH_USC_SACCH_NS){
 			if((buf.data()[9U] & 0x08) == 0x08){
-				qDebug() << "Received EOT";
+				DSLOG(Logger::NXDN, Logger::Info, "Received EOT");
 				m_modeinfo.frame_number = 0;
 				m_modeinfo.stream_state = STREAM_END;
 				m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -119,7 +114,8 @@ void NXDNCodec::process_udp()
 				}
 				m_modeinfo.stream_state = STREAM_NEW;
 				m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-				qDebug() << "New NXDN stream from " << m_modeinfo.srcid << " to " << m_modeinfo.dstid;
+				stats_start(80, 0);
+				DSLOG(Logger::NXDN, Logger::Info, "New NXDN stream from %u to %u", m_modeinfo.srcid, m_modeinfo.dstid);
 			}
 		}
 		else if(!m_tx && ( (m_modeinfo.stream_state == STREAM_LOST) || (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_IDLE) )){
@@ -129,13 +125,15 @@ void NXDNCodec::process_udp()
 			}
 			m_modeinfo.stream_state = STREAM_NEW;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-			qDebug() << "New NXDN stream in progress from " << m_modeinfo.srcid << " to " << m_modeinfo.dstid;
+			stats_start(80, 0);
+			DSLOG(Logger::NXDN, Logger::Info, "New NXDN stream in progress from %u to %u", m_modeinfo.srcid, m_modeinfo.dstid);
 		}
 		else{
 			m_modeinfo.stream_state = STREAMING;
 			m_modeinfo.frame_number++;
 		}
 		m_rxwatchdog = 0;
+		stats_rx();
 
 		memcpy(ambe, buf.data() + 15, 7);
 		if(m_hwrx){
@@ -221,16 +219,9 @@ void NXDNCodec::hostname_lookup(QHostInfo i)
 		out.append((m_modeinfo.gwid >> 0) & 0xff);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::NXDN, "CONN", out.data(), out.size());
 	}
 }
 
@@ -247,14 +238,7 @@ void NXDNCodec::send_ping()
 	out.append((m_modeinfo.gwid >> 8) & 0xff);
 	out.append((m_modeinfo.gwid >> 0) & 0xff);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::NXDN, "PING", out.data(), out.size());
 }
 
 void NXDNCodec::send_disconnect()
@@ -270,23 +254,13 @@ void NXDNCodec::send_disconnect()
 	out.append((m_modeinfo.gwid >> 8) & 0xff);
 	out.append((m_modeinfo.gwid >> 0) & 0xff);
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::NXDN, "SEND", out.data(), out.size());
 }
 
 void NXDNCodec::transmit()
 {
-	uint8_t ambe[7];
 	int16_t pcm[160];
 
-	memset(ambe, 0, 7);
-
 #ifdef USE_FLITE
 	if(m_ttsid > 0){
 		for(int i = 0; i < 160; ++i){
@@ -312,14 +286,7 @@ void NXDNCodec::transmit()
 		m_ambedev->encode(pcm);
 	}
 	else{
-		if(m_modeinfo.sw_vocoder_loaded){
-			m_mbevocoder->encode_2450(pcm, ambe);
-		}
-		ambe[6] &= 0x80;
-
-		for(int i = 0; i < 7; ++i){
-			m_txcodecq.append(ambe[i]);
-		}
+		sw_encode(pcm, 160);
 	}
 
 	if(m_tx && (m_txcodecq.size() >= 28)){
@@ -343,12 +310,7 @@ void NXDNCodec::send_frame()
 		txdata.append((char *)temp_nxdn, 43);
 		m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
 
-		fprintf(stderr, "SEND:%d: ", txdata.size());
-		for(int i = 0; i < txdata.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		DSLOG_HEX(Logger::NXDN, "SEND", txdata.data(), txdata.size());
 	}
 	else{
 		fprintf(stderr, "NXDN TX stopped\n");
@@ -669,7 +631,7 @@ void NXDNCodec::process_rx_data()
 	uint8_t ambe[7];
 
 	if(m_rxwatchdog++ > 25){
-		qDebug() << "NXDN RX stream timeout ";
+		DSLOG(Logger::NXDN, Logger::Info, "NXDN RX stream timeout");
 		m_rxwatchdog = 0;
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -690,14 +652,7 @@ void NXDNCodec::process_rx_data()
 			}
 		}
 		else{
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->decode_2450(pcm, ambe);
-			}
-			else{
-				memset(pcm, 0, 160 * sizeof(int16_t));
-			}
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+			sw_decode(ambe, 7, 1.0f);
 		}
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -706,7 +661,7 @@ void NXDNCodec::process_rx_data()
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
 		m_rxcodecq.clear();
-		qDebug() << "YSF playback stopped";
+		DSLOG(Logger::NXDN, Logger::Info, "NXDN playback stopped");
 		return;
 	}
 }
@@ -31,7 +31,7 @@ public:
 	unsigned char * get_eot(){m_eot = true; return get_frame();}
 	void set_hwtx(bool hw){m_hwtx = hw;}
 private slots:
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_rx_data();
 	void get_ambe();
 	void send_ping();
@@ -51,35 +51,22 @@ P25Codec::P25Codec(QString callsign, int dmrid, int hostname, QString host, int
 	m_dmrid(dmrid)
 {
 	m_p25cnt = 0;
-	m_txtimerint = 19;
 }
 
 P25Codec::~P25Codec()
 {
 }
 
-void P25Codec::process_udp()
+void P25Codec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RCCV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::P25, "RECV", buf.data(), buf.size());
 	if(buf.size() == 11){
 		if(m_modeinfo.status == CONNECTING){
 			m_modeinfo.status = CONNECTED_RW;
 			m_modeinfo.status = CONNECTED_RW;
-			m_txtimer = new QTimer();
-			m_rxtimer = new QTimer();
+			m_txtimer = new MediaTimer(this);
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 			m_ping_timer = new QTimer();
@@ -87,6 +74,15 @@ void P25Codec::process_udp()
 			m_ping_timer->start(5000);
 			m_audio = new AudioEngine(m_audioin, m_audioout);
 			m_audio->init();
+			sw_vocoder_start(
+				[this](int16_t *pcm, const uint8_t *imbe, int) {
+					vocoder.decode_4400(pcm, const_cast<uint8_t *>(imbe));
+					return 160;
+				},
+				[this](uint8_t *imbe, const int16_t *pcm, int) {
+					vocoder.encode_4400(const_cast<int16_t *>(pcm), imbe);
+					return 11;
+				});
 		}
 		if((m_modeinfo.stream_state == STREAM_LOST) || (m_modeinfo.stream_state == STREAM_END) ){
 			m_modeinfo.stream_state = STREAM_IDLE;
@@ -101,12 +97,13 @@ void P25Codec::process_udp()
 		{
 			m_modeinfo.stream_state = STREAM_NEW;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
+			stats_start(20, 18);
 			if(!m_tx && !m_rxtimer->isActive() ){
 				m_rxcodecq.clear();
 				m_audio->start_playback();
 				m_rxtimer->start(m_rxtimerint);
 			}
-			qDebug() << "New P25 stream";
+			DSLOG(Logger::P25, Logger::Info, "New P25 stream");
 		}
 		else{
 			m_modeinfo.stream_state = STREAMING;
@@ -161,13 +158,17 @@ void P25Codec::process_udp()
 		case 0x80U:
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-			qDebug() << "P25 stream ended";
+			DSLOG(Logger::P25, Logger::Info, "P25 stream ended");
 		default:
 			break;
 		}
 		//for(int i = 0; i < 11; ++i){
 			//m_codecq.enqueue(buf.data()[i + offset]);
 		//}
+		// voice frames 0x62-0x73 are the 18 IMBE frames of an LDU1/LDU2 pair
+		if(((uint8_t)buf.data()[0U] >= 0x62U) && ((uint8_t)buf.data()[0U] <= 0x73U)){
+			stats_rx((uint8_t)buf.data()[0U] - 0x62U);
+		}
 		for (int i = 0; i < 11; ++i){
 			m_rxcodecq.append(buf.data()[offset+i]);
 		}
@@ -184,16 +185,9 @@ void P25Codec::hostname_lookup(QHostInfo i)
 		out.append(10 - m_modeinfo.callsign.size(), ' ');
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::P25, "CONN", out.data(), out.size());
 	}
 }
 
@@ -204,14 +198,7 @@ void P25Codec::send_ping()
 	out.append(m_modeinfo.callsign.toUtf8());
 	out.append(10 - m_modeinfo.callsign.size(), ' ');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::P25, "PING", out.data(), out.size());
 }
 
 void P25Codec::send_disconnect()
@@ -221,14 +208,7 @@ void P25Codec::send_disconnect()
 	out.append(m_modeinfo.callsign.toUtf8());
 	out.append(10 - m_modeinfo.callsign.size(), ' ');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::P25, "SEND", out.data(), out.size());
 }
 
 void P25Codec::transmit()
@@ -250,19 +230,24 @@ void P25Codec::transmit()
 				m_ttscnt++;
 			}
 		}
-		encode_4400(pcm, imbe);
 	}
 #endif
 	if(m_ttsid == 0){
 		if(m_audio->read(pcm, 160)){
-			vocoder.encode_4400(pcm, imbe);
 		}
 		else{
 			return;
 		}
 	}
+	sw_encode(pcm, 160);
 
 	if(m_tx){
+		if(m_txcodecq.size() < 11){
+			return;
+		}
+		for(int i = 0; i < 11; ++i){
+			imbe[i] = m_txcodecq.dequeue();
+		}
 		switch (p25step) {
 		case 0x00U:
 			::memcpy(buffer, REC62, 22U);
@@ -404,20 +389,13 @@ void P25Codec::transmit()
 	}
 	emit update_output_level(m_audio->level());
 	emit update(m_modeinfo);
-#ifdef DEBUG
-		fprintf(stderr, "SEND: ");
-		for(int i = 0; i < txdata.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::P25, "SEND", txdata.data(), txdata.size());
 }
 
 void P25Codec::process_rx_data()
 {
 	if(m_rxwatchdog++ > 50){
-		qDebug() << "P25 RX stream timeout ";
+		DSLOG(Logger::P25, Logger::Info, "P25 RX stream timeout");
 		m_rxwatchdog = 0;
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -426,16 +404,12 @@ void P25Codec::process_rx_data()
 	}
 
 	uint8_t imbe[11];
-	int16_t pcm[160];
 
 	if(m_rxcodecq.size() > 10){
 		for(int i = 0; i < 11; ++i){
 			imbe[i] = m_rxcodecq.dequeue();
 		}
-
-		vocoder.decode_4400(pcm, imbe);
-		m_audio->write(pcm, 160);
-		emit update_output_level(m_audio->level());
+		sw_decode(imbe, 11, 1.0f);
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
 		m_rxtimer->stop();
@@ -443,6 +417,6 @@ void P25Codec::process_rx_data()
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
 		m_rxcodecq.clear();
-		qDebug() << "P25 playback stopped";
+		DSLOG(Logger::P25, Logger::Info, "P25 playback stopped");
 	}
 }
@@ -34,7 +34,7 @@ private:
 	uint32_t m_dmrid;
 	uint32_t m_txdstid;
 private slots:
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_rx_data();
 	void send_ping();
 	void send_disconnect();
@@ -36,27 +36,15 @@ REFCodec::~REFCodec()
 {
 }
 
-void REFCodec::process_udp()
+void REFCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
 	static bool sd_sync = 0;
 	static int sd_seq = 0;
 	static char user_data[21];
 	const unsigned char header[5] = {0x80,0x44,0x53,0x56,0x54};
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::REF, "RECV", buf.data(), buf.size());
 	if ((buf.size() == 5) && (buf.data()[0] == 5)){
 		int x = (::rand() % (999999 - 7245 + 1)) + 7245;
 		QString serial = "HS" + QString("%1").arg(x, 6, 10, QChar('0'));
@@ -76,42 +64,24 @@ void REFCodec::process_udp()
 		}
 		emit update(m_modeinfo);
 	}
-#ifdef DEBUG
 	if(out.size()){
-		fprintf(stderr, "SEND: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		DSLOG_HEX(Logger::REF, "SEND", out.data(), out.size());
 	}
-#endif
 	if((m_modeinfo.status == CONNECTING) && (buf.size() == 0x08)){
 		if((memcmp(&buf.data()[4], "OKRW", 4) == 0) || (memcmp(&buf.data()[4], "OKRO", 4) == 0) || (memcmp(&buf.data()[4], "BUSY", 4) == 0)){
-			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-
-			if(m_vocoder != ""){
-				m_hwrx = true;
-				m_hwtx = true;
-				m_modeinfo.hw_vocoder_loaded = true;
-				m_ambedev = new SerialAMBE("REF");
-				m_ambedev->connect_to_serial(m_vocoder);
-				connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-			}
-			else{
-				m_hwrx = false;
-				m_hwtx = false;
-			}
+			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2400x1200);
+
+			open_hw_vocoder("REF");
 			if(m_modemport != ""){
 				m_modem = new SerialModem("REF");
 				m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 				m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 				m_modem->connect_to_serial(m_modemport);
-				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 			}
-			m_rxtimer = new QTimer();
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
-			m_txtimer = new QTimer();
+			m_txtimer = new MediaTimer(this);
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 			m_ping_timer = new QTimer();
 			connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
@@ -167,6 +137,7 @@ void REFCodec::process_udp()
 				m_rxcodecq.clear();
 				m_modeinfo.stream_state = STREAM_NEW;
 				m_modeinfo.streamid = streamid;
+				stats_start(20, 21);
 
 				if(m_modem){
 					uint8_t out[44];
@@ -182,13 +153,10 @@ void REFCodec::process_udp()
 					memcpy(out + 30, mycall.toLocal8Bit().data(), 8);
 					memcpy(out + 38, buf.data() + 52, 4);
 					CCRC::addCCITT161((uint8_t *)out + 3, 41);
-					for(int i = 0; i < 44; ++i){
-						m_rxmodemq.append(out[i]);
-					}
-					//m_modem->write(out);
+					m_modem->write(QByteArray((char *)out, 44));
 				}
 
-				qDebug() << "New stream from " << m_modeinfo.src << " to " << m_modeinfo.dst << " id == " << QString::number(m_modeinfo.streamid, 16);
+				DSLOG(Logger::REF, Logger::Info, "New stream from %s to %s id == %x", qPrintable(m_modeinfo.src), qPrintable(m_modeinfo.dst), m_modeinfo.streamid);
 				emit update(m_modeinfo);
 			}
 		}
@@ -207,12 +175,12 @@ void REFCodec::process_udp()
 		m_modeinfo.frame_number = buf.data()[16];
 
 		if(m_modem){
-			m_rxmodemq.append(0xe0);
-			m_rxmodemq.append(15);
-			m_rxmodemq.append(MMDVM_DSTAR_DATA);
-			for(int i = 0; i < 12; ++i){
-				m_rxmodemq.append(buf.data()[17+i]);
-			}
+			QByteArray out;
+			out.append((char)MMDVM_FRAME_START);
+			out.append(15);
+			out.append(MMDVM_DSTAR_DATA);
+			out.append(buf.constData() + 17, 12);
+			m_modem->write(out);
 		}
 
 		if((buf.data()[16] == 0) && (buf.data()[26] == 0x55) && (buf.data()[27] == 0x2d) && (buf.data()[28] == 0x16)){
@@ -267,6 +235,7 @@ void REFCodec::process_udp()
 		   m_modeinfo.usertxt = QString(user_data);
 		   //ui->usertxt->setText(QString::fromUtf8(user_data.data()));
 		}
+		stats_rx(buf.data()[16] & 0x1f);
 		for(int i = 0; i < 9; ++i){
 			m_rxcodecq.append(buf.data()[17+i]);
 		}
@@ -276,12 +245,11 @@ void REFCodec::process_udp()
 		const uint16_t streamid = (buf.data()[14] << 8) | (buf.data()[15] & 0xff);
 		if(streamid == m_modeinfo.streamid){
 			if(m_modem){
-				m_rxmodemq.append(0xe0);
-				m_rxmodemq.append(3);
-				m_rxmodemq.append(MMDVM_DSTAR_EOT);
+				const char eot[3] = { (char)MMDVM_FRAME_START, 3, MMDVM_DSTAR_EOT };
+				m_modem->write(QByteArray(eot, 3));
 			}
 			m_modeinfo.usertxt.clear();
-			qDebug() << "REF RX stream ended ";
+			DSLOG(Logger::REF, Logger::Info, "REF RX stream ended");
 			m_rxwatchdog = 0;
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -303,16 +271,9 @@ void REFCodec::hostname_lookup(QHostInfo i)
 		out.append(0x01);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::REF, "CONN", out.data(), out.size());
 	}
 }
 
@@ -323,14 +284,7 @@ void REFCodec::send_ping()
 	out.append(0x60);
 	out.append('\x00');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::REF, "PING", out.data(), out.size());
 }
 
 void REFCodec::send_disconnect()
@@ -342,14 +296,7 @@ void REFCodec::send_disconnect()
 	out.append('\x00');
 	out.append('\x00');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::REF, "SEND", out.data(), out.size());
 }
 
 void REFCodec::format_callsign(QString &s)
@@ -443,22 +390,19 @@ void REFCodec::transmit()
 
 	if(m_hwtx){
 		m_ambedev->encode(pcm);
-		if(m_tx && (m_txcodecq.size() >= 9)){
-			for(int i = 0; i < 9; ++i){
-				ambe[i] = m_txcodecq.dequeue();
-			}
-			send_frame(ambe);
-		}
-		else if(!m_tx){
-			send_frame(ambe);
-		}
 	}
 	else{
-		if(m_modeinfo.sw_vocoder_loaded){
-			m_mbevocoder->encode_2400x1200(pcm, ambe);
+		sw_encode(pcm, 160);
+	}
+	if(m_tx && (m_txcodecq.size() >= 9)){
+		for(int i = 0; i < 9; ++i){
+			ambe[i] = m_txcodecq.dequeue();
 		}
 		send_frame(ambe);
 	}
+	else if(!m_tx){
+		send_frame(ambe);
+	}
 }
 
 void REFCodec::send_frame(uint8_t *ambe)
@@ -633,14 +577,7 @@ void REFCodec::send_frame(uint8_t *ambe)
 	m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
 	emit update_output_level(m_audio->level());
 	update(m_modeinfo);
-#ifdef DEBUG
-	fprintf(stderr, "SEND:%d: ", txdata.size());
-	for(int i = 0; i < txdata.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::REF, "SEND", txdata.data(), txdata.size());
 }
 
 void REFCodec::get_ambe()
@@ -660,7 +597,7 @@ void REFCodec::process_rx_data()
 	uint8_t ambe[9];
 
 	if(m_rxwatchdog++ > 50){
-		qDebug() << "REF RX stream timeout ";
+		DSLOG(Logger::REF, Logger::Info, "REF RX stream timeout");
 		m_rxwatchdog = 0;
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -668,17 +605,6 @@ void REFCodec::process_rx_data()
 		m_modeinfo.streamid = 0;
 	}
 
-	if(m_rxmodemq.size() > 2){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == 0xe0) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-	}
-
 	if((!m_tx) && (m_rxcodecq.size() > 8) ){
 		for(int i = 0; i < 9; ++i){
 			ambe[i] = m_rxcodecq.dequeue();
@@ -692,14 +618,7 @@ void REFCodec::process_rx_data()
 			}
 		}
 		else{
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->decode_2400x1200(pcm, ambe);
-			}
-			else{
-				memset(pcm, 0, 160 * sizeof(int16_t));
-			}
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+			sw_decode(ambe, 9, 1.0f);
 		}
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -708,7 +627,7 @@ void REFCodec::process_rx_data()
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
 		m_rxcodecq.clear();
-		qDebug() << "REF playback stopped";
+		DSLOG(Logger::REF, Logger::Info, "REF playback stopped");
 		return;
 	}
 }
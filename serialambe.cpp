@@ -24,12 +24,14 @@
 #endif
 #include <algorithm>
 #include "serialambe.h"
+#include "logger.h"
+#include "vocoderpool.h"
 
 #define ENDLINE "\n"
 
 //#define DEBUG
 
-const uint8_t AMBEP251_4400_2800[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x05U, 0x58U, 0x08U, 0x6BU, 0x10U, 0x30U, 0x00U, 0x00U, 0x00U, 0x00U, 0x01U, 0x90U};		//DVSI P25 USB Dongle FEC
+//const uint8_t AMBEP251_4400_2800[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x05U, 0x58U, 0x08U, 0x6BU, 0x10U, 0x30U, 0x00U, 0x00U, 0x00U, 0x00U, 0x01U, 0x90U};		//DVSI P25 USB Dongle FEC
 //const uint8_t AMBEP251_4400_0000[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x05U, 0x58U, 0x08U, 0x6BU, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x01U, 0x58U};	//DVSI P25 USB Dongle No-FEC
 //const uint8_t AMBE1000_4400_2800[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x00U, 0x58U, 0x08U, 0x87U, 0x30U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x44U, 0x90U};
 //const uint8_t AMBE2000_4400_2800[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x02U, 0x58U, 0x07U, 0x65U, 0x00U, 0x09U, 0x1eU, 0x0cU, 0x41U, 0x27U, 0x73U, 0x90U};
@@ -38,19 +40,53 @@ const uint8_t AMBE2000_2400_1200[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x01U, 0x3
 const uint8_t AMBE3000_2450_1150[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x04U, 0x31U, 0x07U, 0x54U, 0x24U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x6fU, 0x48U};
 const uint8_t AMBE3000_2450_0000[17] = {0x61, 0x00, 0x0d, 0x00, 0x0a, 0x04U, 0x31U, 0x07U, 0x54U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x70U, 0x31U};
 const uint8_t AMBE3000_PARITY_DISABLE[8] = {0x61, 0x00, 0x04, 0x00, 0x3f, 0x00, 0x2f, 0x14};
+const uint8_t AMBE3000_PRODID[5] = {0x61, 0x00, 0x01, 0x00, 0x30};
 
 //const uint8_t AMBE2020[48] = {0x13, 0xec, 0x00, 0x00, 0x10, 0x30, 0x00, 0x01, 0x00, 0x00, 0x42, 0x30, 0x00, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 //const uint8_t AMBE2020[4] = {0x04, 0x20, 0x01, 0x00};
 const uint8_t AMBE2020[5] = {0x05, 0x00, 0x18, 0x00, 0x01};
-SerialAMBE::SerialAMBE(QString protocol) :
-	m_protocol(protocol),
-	m_decode_gain(1.0)
+
+const uint8_t DV3000_START = 0x61;
+const uint8_t DV3000_TYPE_CONTROL = 0x00;
+const uint8_t DV3000_TYPE_AMBE = 0x01;
+const uint8_t DV3000_TYPE_AUDIO = 0x02;
+const uint8_t DV3000_PKT_CHANNEL0 = 0x40;
+const uint8_t DV3000_PKT_RATEP = 0x0a;
+const uint8_t DV3000_PKT_PRODID = 0x30;
+const uint16_t DV2020_AMBE = 0xa032;
+const uint16_t DV2020_AUDIO = 0x8142;
+const int AMBE_WINDOW = 3;
+const int AMBE_REPLY_TIMEOUT_MS = 200;
+const int AMBE_MAX_TIMEOUTS = 3;
+
+SerialAMBE::SerialAMBE() :
+	m_serial(nullptr),
+	m_dv2020(false),
+	m_failed(false),
+	m_channels(1),
+	m_rx(4096),
+	m_txq(8192),
+	m_packetpos(0),
+	m_packetlen(0),
+	m_resyncs(0),
+	m_window(AMBE_WINDOW),
+	m_inflight(0),
+	m_flightgot(0),
+	m_timeouts(0)
 {
+	for(int i = 0; i < MAX_CHANNELS; ++i){
+		m_chan[i].owner = nullptr;
+		m_chan[i].rate = RATE_NONE;
+		m_chan[i].packet_size = 9;
+	}
+	m_lastreply.start();
 }
 
 SerialAMBE::~SerialAMBE()
 {
-	m_serial->close();
+	if(m_serial){
+		m_serial->close();
+	}
 }
 
 QMap<QString, QString> SerialAMBE::discover_devices()
@@ -87,336 +123,509 @@ QMap<QString, QString> SerialAMBE::discover_devices()
 return devlist;
 }
 
-void SerialAMBE::connect_to_serial(QString p)
+
+// Opens the port and identifies the device.  The AMBE3000 family is asked
+// for its product id so an AMBE3003 comes up with all three channels; the
+// channels themselves are configured when a stream is attached.
+bool SerialAMBE::connect_to_serial(QString p)
 {
 	const QString blankString = "N/A";
 	int br = 460800;
 
-	if((m_protocol != "P25") && (m_protocol != "M17") && (p != "")){
+	if(p == ""){
+		return false;
+	}
+	m_port = p;
 #ifndef Q_OS_ANDROID
-		m_serial = new QSerialPort;
-		QSerialPortInfo info(*m_serial);
-		QString out = "Port: " + info.portName() + ENDLINE
-			+ "Location: " + info.systemLocation() + ENDLINE
-			+ "Description: " + (!info.description().isEmpty() ? info.description() : blankString) + ENDLINE
-			+ "Manufacturer: " + (!info.manufacturer().isEmpty() ? info.manufacturer() : blankString) + ENDLINE
-			+ "Serial number: " + (!info.serialNumber().isEmpty() ? info.serialNumber() : blankString) + ENDLINE
-			+ "Vendor Identifier: " + (info.hasVendorIdentifier() ? QByteArray::number(info.vendorIdentifier(), 16) : blankString) + ENDLINE
-			+ "Product Identifier: " + (info.hasProductIdentifier() ? QByteArray::number(info.productIdentifier(), 16) : blankString) + ENDLINE
-			+ "Busy: " + (info.isBusy() ? "Yes" : "No") + ENDLINE;
-		fprintf(stderr, "%s", out.toStdString().c_str());fflush(stderr);
-		m_description = info.description();
-
-		if(m_description == "DV Dongle"){
-			br = 230400;
-		}
+	m_serial = new QSerialPort(this);
+	m_serial->setPortName(p);
+	QSerialPortInfo info(*m_serial);
+	QString out = "Port: " + info.portName() + ENDLINE
+		+ "Location: " + info.systemLocation() + ENDLINE
+		+ "Description: " + (!info.description().isEmpty() ? info.description() : blankString) + ENDLINE
+		+ "Manufacturer: " + (!info.manufacturer().isEmpty() ? info.manufacturer() : blankString) + ENDLINE
+		+ "Serial number: " + (!info.serialNumber().isEmpty() ? info.serialNumber() : blankString) + ENDLINE
+		+ "Vendor Identifier: " + (info.hasVendorIdentifier() ? QByteArray::number(info.vendorIdentifier(), 16) : blankString) + ENDLINE
+		+ "Product Identifier: " + (info.hasProductIdentifier() ? QByteArray::number(info.productIdentifier(), 16) : blankString) + ENDLINE
+		+ "Busy: " + (info.isBusy() ? "Yes" : "No") + ENDLINE;
+	fprintf(stderr, "%s", out.toStdString().c_str());fflush(stderr);
+	m_description = info.description();
 
+	if(m_description == "DV Dongle"){
+		br = 230400;
+		m_dv2020 = true;
+	}
+	else if(m_description.contains("3003")){
+		m_channels = 3;
+	}
 #else
-		m_serial = &AndroidSerialPort::GetInstance();
+	m_serial = &AndroidSerialPort::GetInstance();
 #endif
-		m_serial->setPortName(p);
-		m_serial->setBaudRate(br);
-		m_serial->setDataBits(QSerialPort::Data8);
-		m_serial->setStopBits(QSerialPort::OneStop);
-		m_serial->setParity(QSerialPort::NoParity);
-		//out << "Baud rate == " << serial->baudRate() << endl;
-		if (m_serial->open(QIODevice::ReadWrite)) {
+	m_serial->setPortName(p);
+	m_serial->setBaudRate(br);
+	m_serial->setDataBits(QSerialPort::Data8);
+	m_serial->setStopBits(QSerialPort::OneStop);
+	m_serial->setParity(QSerialPort::NoParity);
+	//out << "Baud rate == " << serial->baudRate() << endl;
+	if (!m_serial->open(QIODevice::ReadWrite)) {
+		qDebug() << "Error: Failed to open device.";
+		return false;
+	}
 #ifndef Q_OS_ANDROID
-			connect(m_serial, &QSerialPort::readyRead, this, &SerialAMBE::process_serial);
+	connect(m_serial, &QSerialPort::readyRead, this, &SerialAMBE::process_serial);
+	connect(m_serial, &QSerialPort::errorOccurred, this, &SerialAMBE::serial_error);
 #else
-			//connect(m_serial, &AndroidSerialPort::readyRead, this, &SerialAMBE::process_serial);
-			connect(m_serial, SIGNAL(data_received(QByteArray)), this, SLOT(receive_serial(QByteArray)));
+	//connect(m_serial, &AndroidSerialPort::readyRead, this, &SerialAMBE::process_serial);
+	connect(m_serial, SIGNAL(data_received(QByteArray)), this, SLOT(receive_serial(QByteArray)));
 #endif
-			QByteArray a;
-			a.clear();
-			if(m_description != "DV Dongle"){
-				m_serial->setFlowControl(QSerialPort::HardwareControl);
-				m_serial->setRequestToSend(true);
-				a.append(reinterpret_cast<const char*>(AMBE3000_PARITY_DISABLE), sizeof(AMBE3000_PARITY_DISABLE));
-				m_serial->write(a);
-				QThread::msleep(100);
-				a.clear();
-			}
-
-			if(m_protocol == "DMR"){
-				a.append(reinterpret_cast<const char*>(AMBE3000_2450_1150), sizeof(AMBE3000_2450_1150));
-				packet_size = 9;
-			}
-			else if( (m_protocol == "YSF") || (m_protocol == "NXDN") ){
-				a.append(reinterpret_cast<const char*>(AMBE3000_2450_0000), sizeof(AMBE3000_2450_0000));
-				packet_size = 7;
-			}
-			else if(m_protocol == "P25"){
-				a.append(reinterpret_cast<const char*>(AMBEP251_4400_2800), sizeof(AMBEP251_4400_2800));
-			}
-			else if(m_description != "DV Dongle"){ //D-Star with AMBE3000
-				a.append(reinterpret_cast<const char*>(AMBE2000_2400_1200), sizeof(AMBE2000_2400_1200));
-				packet_size = 9;
-			}
-			else{
-				a.append(reinterpret_cast<const char*>(AMBE2020), sizeof(AMBE2020));
-				packet_size = 9;
-			}
-			m_serial->write(a);
-#ifdef DEBUG
-			fprintf(stderr, "SENDHW %d:%d:", a.size(), m_serialdata.size());
-			for(int i = 0; i < a.size(); ++i){
-				//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-				//	i+= 6;
-				//}
-				fprintf(stderr, "%02x ", (unsigned char)a.data()[i]);
-			}
-			fprintf(stderr, "\n");
-			fflush(stderr);
-#endif
-		}
-		else{
-			qDebug() << "Error: Failed to open device.";
-		}
+	QByteArray a;
+	if(m_dv2020){
+		a.append(reinterpret_cast<const char*>(AMBE2020), sizeof(AMBE2020));
+		m_serial->write(a);
+		DSLOG_HEX(Logger::Ambe, "SENDHW", a.data(), a.size());
+		m_chan[0].rate = RATE_2400x1200;
+		return true;
 	}
+	m_serial->setFlowControl(QSerialPort::HardwareControl);
+	m_serial->setRequestToSend(true);
+	a.append(reinterpret_cast<const char*>(AMBE3000_PARITY_DISABLE), sizeof(AMBE3000_PARITY_DISABLE));
+	m_serial->write(a);
+	QThread::msleep(100);
+	a.clear();
+	a.append(reinterpret_cast<const char*>(AMBE3000_PRODID), sizeof(AMBE3000_PRODID));
+	m_serial->write(a);
+#ifndef Q_OS_ANDROID
+	if(m_serial->waitForReadyRead(200)){
+		process_serial();
+	}
+#endif
+	return true;
 }
 
-void SerialAMBE::receive_serial(QByteArray d)
+bool SerialAMBE::supports(int rate) const
 {
-	for(int i = 0; i < d.size(); i++){
-		m_serialdata.append(d[i]);
+	if(m_dv2020){
+		return rate == RATE_2400x1200;
 	}
+	return rate != RATE_NONE;
+}
 
-	if(m_description == "DV Dongle"){
-		process_serial_2020();
+int SerialAMBE::owned() const
+{
+	int n = 0;
+	for(int i = 0; i < m_channels; ++i){
+		if(m_chan[i].owner){
+			++n;
+		}
 	}
-	else{
-		process_serial_3000();
+	return n;
+}
+
+void SerialAMBE::attach(int ch, VocoderChannel *c, int rate)
+{
+	clear_queue(ch);
+	m_chan[ch].owner = c;
+	if(m_chan[ch].rate != rate){
+		configure(ch, rate);
 	}
 }
 
-void SerialAMBE::process_serial()
+void SerialAMBE::detach(int ch)
 {
-	QByteArray d = m_serial->readAll();
-	for(int i = 0; i < d.size(); i++){
-		m_serialdata.append(d[i]);
-	}
-#ifdef DEBUG
-	fprintf(stderr, "AMBEHW %d:%d:", d.size(), m_serialdata.size());
-	for(int i = 0; i < d.size(); ++i){
-		//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-		//	i+= 6;
-		//}
-		fprintf(stderr, "%02x ", (unsigned char)d.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	clear_queue(ch);
+	m_chan[ch].owner = nullptr;
+}
 
-	if(m_description == "DV Dongle"){
-		process_serial_2020();
+// Sends the rate parameters for one channel.  A single channel AMBE3000 gets
+// the same packet as always; on an AMBE3003 the channel field goes in front
+// of the rate field.
+void SerialAMBE::configure(int ch, int rate)
+{
+	const uint8_t *p;
+
+	switch(rate){
+	case RATE_2450x1150:
+		p = AMBE3000_2450_1150;
+		m_chan[ch].packet_size = 9;
+		break;
+	case RATE_2450:
+		p = AMBE3000_2450_0000;
+		m_chan[ch].packet_size = 7;
+		break;
+	case RATE_2400x1200:
+	default:
+		p = AMBE2000_2400_1200;
+		m_chan[ch].packet_size = 9;
+		break;
+	}
+	m_chan[ch].rate = rate;
+	if(m_dv2020){
+		return;
+	}
+
+	QByteArray a;
+	if(m_channels == 1){
+		a.append(reinterpret_cast<const char*>(p), 17);
 	}
 	else{
-		process_serial_3000();
+		const char h[5] = { (char)DV3000_START, 0x00, 0x0e, (char)DV3000_TYPE_CONTROL, (char)(DV3000_PKT_CHANNEL0 + ch) };
+		a.append(h, 5);
+		a.append(reinterpret_cast<const char*>(p + 4), 13);
 	}
+	m_serial->write(a);
+	DSLOG_HEX(Logger::Ambe, "SENDHW", a.data(), a.size());
 }
 
-void SerialAMBE::decode(uint8_t *ambe)
+void SerialAMBE::receive_serial(QByteArray d)
 {
-	if(m_description == "DV Dongle"){
-		decode_2020(ambe);
-	}
-	else{
-		decode_3000(ambe);
+	if(m_rx.write((const uint8_t *)d.data(), d.size()) < (size_t)d.size()){
+		DSLOG(Logger::Ambe, Logger::Warn, "SerialAMBE receive ring full, dropped %d bytes", d.size());
 	}
+	parse();
 }
 
-void SerialAMBE::encode(int16_t *audio)
+void SerialAMBE::process_serial()
 {
-	uint8_t packet[327] = {0x61, 0x01, 0x43, 0x02, 0x40, 0x00, 0xa0};
-	for(int i = 0; i < 160; ++i){
-		packet [(i*2)+7] = (audio[i] >> 8) & 0xff;
-		packet [(i*2)+8] = audio[i] & 0xff;
+#ifndef Q_OS_ANDROID
+	char buf[512];
+	qint64 n;
+	while((n = m_serial->read(buf, sizeof(buf))) > 0){
+		DSLOG_HEX(Logger::Ambe, "AMBEHW", buf, n);
+		if(m_rx.write((const uint8_t *)buf, n) < (size_t)n){
+			DSLOG(Logger::Ambe, Logger::Warn, "SerialAMBE receive ring full, dropped %lld bytes", (long long)n);
+		}
+		parse();
 	}
-	m_serial->write((char *)packet, 327);
-#ifdef DEBUG
-			fprintf(stderr, "SENDHW: ");
-			for(int i = 0; i < 326; ++i){
-				//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-				//	i+= 6;
-				//}
-				fprintf(stderr, "%02x ", packet[i]);
-			}
-			fprintf(stderr, "\n");
-			fflush(stderr);
+#else
+	receive_serial(m_serial->readAll());
 #endif
 }
 
-void SerialAMBE::decode_2020(uint8_t *ambe)
+void SerialAMBE::serial_error(QSerialPort::SerialPortError e)
 {
-	uint8_t packet[50] = {0x32, 0xa0, 0xec, 0x13, 0x00, 0x00, 0x30, 0x10, 0x01, 0x00, 0x00, 0x00, 0x30, 0x42, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-	uint8_t pcm[322];
-	memset(pcm, 0, 322);
-	pcm[0] = 0x42;
-	pcm[1] = 0x81;
-	memcpy(packet+24, ambe, packet_size);
-	m_serial->write((char *)packet, 50);
-	m_serial->write((char *)pcm, 322);
+#ifndef Q_OS_ANDROID
+	if((e == QSerialPort::ResourceError) || (e == QSerialPort::PermissionError) || (e == QSerialPort::WriteError) || (e == QSerialPort::ReadError)){
+		fail(m_serial->errorString().toLocal8Bit().constData());
+	}
+#else
+	Q_UNUSED(e);
+#endif
 }
 
-void SerialAMBE::decode_3000(uint8_t *ambe)
+void SerialAMBE::fail(const char *why)
 {
-	uint8_t packet[15] = {0x61, 0x00, 0x0b, 0x01, 0x01, 0x48};
-	if( packet_size == 7 ){
-		packet[2] = 0x09;
-		packet[5] = 0x31;
+	if(m_failed){
+		return;
 	}
-	memcpy(packet+6, ambe, packet_size);
-
-	m_serial->write((char *)packet, (6 + packet_size));
+	DSLOG(Logger::Ambe, Logger::Error, "SerialAMBE %s failed: %s", qPrintable(m_port), why);
+	m_failed = true;
+	m_inflight = 0;
+	m_txq.clear();
+	emit device_failed();
 }
 
-void SerialAMBE::process_serial_2020()
+// Incremental packet parser.  m_packet collects the fixed size header (4
+// bytes DV3000: start byte, big endian length, type; 2 bytes DV2020: little
+// endian length and type) a byte at a time, then the payload in one read once
+// header_length() has validated it.  A bad header slides to the next
+// possible start byte instead of dropping everything queued.
+void SerialAMBE::parse()
 {
-	if( (m_serialdata.size() > 321) &&
-		((uint8_t)m_serialdata[0] == 0x42) &&
-		((uint8_t)m_serialdata[1] == 0x81)
-		)
-	{
-		emit data_ready();
-	}
-	if( (m_serialdata.size() > 49) &&
-		((uint8_t)m_serialdata[0] == 0x32) &&
-		((uint8_t)m_serialdata[1] == 0xa0) &&
-		((uint8_t)m_serialdata[0] == 0xec) &&
-		((uint8_t)m_serialdata[1] == 0x13)
-		)
-	{
-		emit data_ready();
+	const int hdr = m_dv2020 ? 2 : 4;
+
+	while(m_rx.available()){
+		if(m_packetpos < hdr){
+			m_rx.read(m_packet + m_packetpos, 1);
+			if(!m_dv2020 && (m_packetpos == 0) && (m_packet[0] != DV3000_START)){
+				++m_resyncs;
+				continue;
+			}
+			if(++m_packetpos < hdr){
+				continue;
+			}
+			m_packetlen = header_length();
+			if(m_packetlen == 0){
+				int skip = 1;
+				while(!m_dv2020 && (skip < hdr) && (m_packet[skip] != DV3000_START)){
+					++skip;
+				}
+				memmove(m_packet, m_packet + skip, hdr - skip);
+				m_packetpos = hdr - skip;
+				++m_resyncs;
+				continue;
+			}
+		}
+		const size_t need = m_packetlen - m_packetpos;
+		const size_t avail = m_rx.available();
+		m_packetpos += m_rx.read(m_packet + m_packetpos, (need < avail) ? need : avail);
+		if(m_packetpos == m_packetlen){
+			packet_received();
+			m_packetpos = 0;
+			m_packetlen = 0;
+		}
 	}
 }
 
-void SerialAMBE::process_serial_3000()
+// Total length of the packet whose header is in m_packet, 0 if it is not one
+// we know.
+int SerialAMBE::header_length()
 {
-	if( (m_serialdata.size() > 3) &&
-		(m_serialdata[0] == 0x61) &&
-		(m_serialdata[3] == 0x00)
-		)
-	{
-		do {
-			m_serialdata.dequeue();
+	if(m_dv2020){
+		const uint16_t h = m_packet[0] | (m_packet[1] << 8);
+		const int len = h & 0x1fff;
+		if((h == DV2020_AMBE) || (h == DV2020_AUDIO) || (((h >> 13) == 0) && (len >= 2) && (len <= 64))){
+			return len;
 		}
-		while(m_serialdata.size() && m_serialdata[0] != 0x61);
+		return 0;
 	}
-	if( (m_serialdata.size() >= (6 + packet_size)) &&
-		(m_serialdata[0] == 0x61) &&
-		(m_serialdata[3] == 0x01)
-		)
-	{
-		emit data_ready();
+	const int len = 4 + ((m_packet[1] << 8) | m_packet[2]);
+	if((m_packet[3] <= DV3000_TYPE_AUDIO) && (len > 4) && (len <= (int)sizeof(m_packet))){
+		return len;
 	}
+	return 0;
 }
 
-bool SerialAMBE::get_ambe(uint8_t *ambe)
+void SerialAMBE::packet_received()
 {
-	bool r = false;
-	if(m_serialdata.isEmpty()){
-		return r;
-	}
-
-	if( (m_serialdata.size() > 3) &&
-		(m_serialdata[0] == 0x61) &&
-		(m_serialdata[3] != 0x01)
-		)
-	{
-		do {
-			m_serialdata.dequeue();
+	int16_t pcm[160];
+
+	if(m_dv2020){
+		const uint16_t h = m_packet[0] | (m_packet[1] << 8);
+		if(h == DV2020_AMBE){
+			reply(0, REQ_ENCODE, m_packet + 24, nullptr);
+		}
+		else if(h == DV2020_AUDIO){
+			for(int i = 0; i < 160; ++i){
+				pcm[i] = m_packet[2 + (i * 2)] | (m_packet[3 + (i * 2)] << 8);
+			}
+			reply(0, REQ_DECODE, nullptr, pcm);
 		}
-		while(m_serialdata.size() && m_serialdata[0] != 0x61);
+		return;
 	}
 
-	if( (m_serialdata.size() >= (6 + packet_size)) &&
-		(m_serialdata[0] == 0x61) &&
-		(m_serialdata[3] == 0x01)
-		)
-	{
-		for(int i = 0; i < 6; ++i){
-			m_serialdata.dequeue();
+	// The AMBE3003 puts a channel field in front of the data field of
+	// every reply, the AMBE3000 leaves it out for channel 0.
+	int ch = 0;
+	int base = 4;
+	if((m_packetlen > 4) && (m_packet[4] >= DV3000_PKT_CHANNEL0) && (m_packet[4] < DV3000_PKT_CHANNEL0 + MAX_CHANNELS)){
+		ch = m_packet[4] - DV3000_PKT_CHANNEL0;
+		base = 5;
+	}
+
+	switch(m_packet[3]){
+	case DV3000_TYPE_AMBE:
+		if(m_packetlen >= (base + 2 + m_chan[ch].packet_size)){
+			reply(ch, REQ_ENCODE, m_packet + base + 2, nullptr);
 		}
-		for(int i = 0; i < packet_size; i++){
-			ambe[i] = m_serialdata.dequeue();
+		break;
+	case DV3000_TYPE_AUDIO:
+		if(m_packetlen >= (base + 2 + 320)){
+			for(int i = 0; i < 160; ++i){
+				//Byte swap BE to LE
+				pcm[i] = (int16_t)((m_packet[base + 2 + (i * 2)] << 8) | m_packet[base + 3 + (i * 2)]);
+			}
+			reply(ch, REQ_DECODE, nullptr, pcm);
 		}
-		r = true;
+		break;
+	case DV3000_TYPE_CONTROL:
+	default:
+		if((m_packet[4] == DV3000_PKT_PRODID) && (m_packetlen > 5)){
+			const QByteArray id((const char *)m_packet + 5, m_packetlen - 5);
+			DSLOG(Logger::Ambe, Logger::Info, "SerialAMBE %s product id %s", qPrintable(m_port), id.constData());
+			if(id.contains("3003")){
+				m_channels = 3;
+			}
+		}
+		DSLOG_HEX(Logger::Ambe, "CTRL", m_packet, m_packetlen);
+		break;
 	}
-	return r;
 }
 
-bool SerialAMBE::get_audio(int16_t *audio)
+// Matches a reply to the oldest request in flight on its channel.  The
+// DV3000 answers a decode with audio and an encode with AMBE; the DV2020
+// answers every request with both, and only the half that was asked for is
+// kept.  Replies to requests made before clear_queue() are dropped.
+void SerialAMBE::reply(int ch, uint8_t product, const uint8_t *ambe, const int16_t *pcm)
 {
-	bool r = false;
-	if(m_serialdata.isEmpty()){
-		return r;
+	uint8_t tag = product | (ch << 4);
+	int i = 0;
+
+	while((i < m_inflight) && (((m_flight[i] >> 4) & 0x07) != ch)){
+		++i;
 	}
-	uint8_t header[] = {0x61, 0x01, 0x42, 0x02, 0x00, 0xA0};
-/*
-	if( (m_serialdata.size() > 3) &&
-		(m_serialdata[0] == 0x61) &&
-		(m_serialdata[3] != 0x02)
-		)
-	{
-		do {
-			m_serialdata.dequeue();
+	if(i < m_inflight){
+		tag = m_flight[i];
+		m_flightgot |= product;
+		if(!m_dv2020 || (m_flightgot == (REQ_DECODE | REQ_ENCODE))){
+			memmove(m_flight + i, m_flight + i + 1, m_inflight - i - 1);
+			--m_inflight;
+			m_flightgot = 0;
 		}
-		while(m_serialdata.size() && m_serialdata[0] != 0x61);
+		m_lastreply.restart();
+		m_timeouts = 0;
 	}
 
-	//qDebug() << "get_audio() m_serialdata.size() == " << m_serialdata.size();
-
-	fprintf(stderr, "AMBEHW %d:%d:", m_serialdata.size(), m_serialdata.size());
-	for(int i = 0; i < m_serialdata.size(); ++i){
-		//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-		//	i+= 6;
-		//}
-		fprintf(stderr, "%02x ", (unsigned char)m_serialdata[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-*/
-	if(m_serialdata.size() >= 326){
-		if ( ((uint8_t)m_serialdata[0] == header[0]) &&
-			 ((uint8_t)m_serialdata[1] == header[1]) &&
-			 ((uint8_t)m_serialdata[2] == header[2]) &&
-			 ((uint8_t)m_serialdata[3] == header[3]) &&
-			 ((uint8_t)m_serialdata[4] == header[4]) &&
-			 ((uint8_t)m_serialdata[5] == header[5])){
-			//m_serialdata.erase(m_serialdata.begin(), m_serialdata.begin() + 6);
-			m_serialdata.dequeue();
-			m_serialdata.dequeue();
-			m_serialdata.dequeue();
-			m_serialdata.dequeue();
-			m_serialdata.dequeue();
-			m_serialdata.dequeue();
-			//qDebug() << "Found header, deleting.....................................................................";
-			for(int i = 0; i < 160; i++){
-				//Byte swap BE to LE
-				audio[i] =  ((m_serialdata.dequeue() << 8) & 0xff00) | (m_serialdata.dequeue() & 0xff);
-				audio[i] = (qreal)audio[i] * m_decode_gain;
-			}
-			r = true;
+	VocoderChannel *c = m_chan[ch].owner;
+	if(c && ((tag & (REQ_KIND | REQ_STALE)) == product)){
+		if(product == REQ_DECODE){
+			c->deliver_audio(pcm);
 		}
 		else{
-			qDebug() << "Header not found..............................................................................." ;
-			while( (m_serialdata.size() > 5) && (
-				((uint8_t)m_serialdata[0] != header[0]) ||
-				((uint8_t)m_serialdata[1] != header[1]) ||
-				((uint8_t)m_serialdata[2] != header[2]) ||
-				((uint8_t)m_serialdata[3] != header[3]) ||
-				((uint8_t)m_serialdata[4] != header[4]) ||
-				((uint8_t)m_serialdata[5] != header[5]))){
-					m_serialdata.dequeue();
-					//qDebug() << "Finding start of audio frame";
-			}
+			c->deliver_ambe(ambe, m_chan[ch].packet_size);
+		}
+	}
+	flush_requests();
+}
+
+void SerialAMBE::send_request(uint8_t tag, const uint8_t *data, int len)
+{
+	if(m_failed){
+		return;
+	}
+	if(m_inflight && (m_lastreply.elapsed() > AMBE_REPLY_TIMEOUT_MS)){
+		DSLOG(Logger::Ambe, Logger::Warn, "SerialAMBE: %d requests unanswered, resetting window", m_inflight);
+		m_inflight = 0;
+		m_flightgot = 0;
+		if(++m_timeouts >= AMBE_MAX_TIMEOUTS){
+			fail("no replies");
+			return;
 		}
 	}
-	return r;
+	if((m_inflight < (m_window * m_channels)) && (m_txq.available() == 0)){
+		write_request(tag, data, len);
+		return;
+	}
+	if(m_txq.free_space() < (size_t)(len + 3)){
+		DSLOG(Logger::Ambe, Logger::Debug, "SerialAMBE request queue full, frame dropped");
+		return;
+	}
+	const uint8_t h[3] = { tag, (uint8_t)(len & 0xff), (uint8_t)(len >> 8) };
+	m_txq.write(h, 3);
+	m_txq.write(data, len);
+}
+
+void SerialAMBE::write_request(uint8_t tag, const uint8_t *data, int len)
+{
+	if(m_inflight == 0){
+		m_lastreply.restart();
+	}
+	m_serial->write((char *)data, len);
+	m_flight[m_inflight++] = tag;
+	DSLOG_HEX(Logger::Ambe, "SENDHW", data, len);
+}
+
+void SerialAMBE::flush_requests()
+{
+	uint8_t buf[400];
+	uint8_t h[3];
+
+	while((m_inflight < (m_window * m_channels)) && (m_txq.available() >= 3)){
+		m_txq.read(h, 3);
+		const int len = h[1] | (h[2] << 8);
+		m_txq.read(buf, len);
+		write_request(h[0], buf, len);
+	}
+}
+
+void SerialAMBE::decode(int ch, const uint8_t *ambe)
+{
+	if(m_dv2020){
+		decode_2020(ambe);
+	}
+	else{
+		decode_3000(ch, ambe);
+	}
+}
+
+void SerialAMBE::encode(int ch, const int16_t *audio)
+{
+	if(m_dv2020){
+		encode_2020(audio);
+	}
+	else{
+		encode_3000(ch, audio);
+	}
+}
+
+void SerialAMBE::encode_3000(int ch, const int16_t *audio)
+{
+	uint8_t packet[327] = {0x61, 0x01, 0x43, 0x02, 0x40, 0x00, 0xa0};
+	packet[4] = DV3000_PKT_CHANNEL0 + ch;
+	for(int i = 0; i < 160; ++i){
+		packet [(i*2)+7] = (audio[i] >> 8) & 0xff;
+		packet [(i*2)+8] = audio[i] & 0xff;
+	}
+	send_request(REQ_ENCODE | (ch << 4), packet, 327);
 }
 
-void SerialAMBE::clear_queue()
+// The DV Dongle takes an AMBE packet and an audio packet for every frame and
+// answers with both, so decode and encode send the same pair with the unused
+// half zeroed.
+static const uint8_t DV2020_AMBE_PACKET[50] = {0x32, 0xa0, 0xec, 0x13, 0x00, 0x00, 0x30, 0x10, 0x01, 0x00, 0x00, 0x00, 0x30, 0x42, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+void SerialAMBE::decode_2020(const uint8_t *ambe)
+{
+	uint8_t packet[50 + 322];
+	memcpy(packet, DV2020_AMBE_PACKET, 50);
+	memcpy(packet+24, ambe, m_chan[0].packet_size);
+	memset(packet + 50, 0, 322);
+	packet[50] = 0x42;
+	packet[51] = 0x81;
+	send_request(REQ_DECODE, packet, sizeof(packet));
+}
+
+void SerialAMBE::encode_2020(const int16_t *audio)
+{
+	uint8_t packet[50 + 322];
+	memcpy(packet, DV2020_AMBE_PACKET, 50);
+	packet[50] = 0x42;
+	packet[51] = 0x81;
+	for(int i = 0; i < 160; ++i){
+		packet[52 + (i*2)] = audio[i] & 0xff;
+		packet[53 + (i*2)] = (audio[i] >> 8) & 0xff;
+	}
+	send_request(REQ_ENCODE, packet, sizeof(packet));
+}
+
+// A single channel AMBE3000 gets the same decode packet as always, the
+// AMBE3003 needs the channel field in front of the data field.
+void SerialAMBE::decode_3000(int ch, const uint8_t *ambe)
 {
-	m_serialdata.clear();
+	uint8_t packet[16] = {0x61, 0x00, 0x0b, 0x01, 0x01, 0x48};
+	const uint8_t ps = m_chan[ch].packet_size;
+	int p = 4;
+	if(m_channels > 1){
+		packet[p++] = DV3000_PKT_CHANNEL0 + ch;
+	}
+	packet[2] = 2 + ps + (p - 4);
+	packet[p++] = 0x01;
+	packet[p++] = (ps == 7) ? 0x31 : 0x48;
+	memcpy(packet + p, ambe, ps);
+	send_request(REQ_DECODE | (ch << 4), packet, p + ps);
+}
+
+// Drops the frames of one channel that are still queued.  Replies the
+// device still owes for requests already sent are marked stale and
+// discarded when they arrive.
+void SerialAMBE::clear_queue(int ch)
+{
+	uint8_t buf[400];
+	uint8_t h[3];
+	size_t n = m_txq.available();
+
+	while(n >= 3){
+		m_txq.read(h, 3);
+		const int len = h[1] | (h[2] << 8);
+		m_txq.read(buf, len);
+		n -= 3 + len;
+		if(((h[0] >> 4) & 0x07) != ch){
+			m_txq.write(h, 3);
+			m_txq.write(buf, len);
+		}
+	}
+	for(int i = 0; i < m_inflight; ++i){
+		if(((m_flight[i] >> 4) & 0x07) == ch){
+			m_flight[i] |= REQ_STALE;
+		}
+	}
 }
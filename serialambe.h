@@ -23,46 +23,105 @@
 #ifdef Q_OS_ANDROID
 #include "androidserialport.h"
 #endif
-#include <QQueue>
+#include <QElapsedTimer>
+#include "audioringbuffer.h"
 
+class VocoderChannel;
+
+// DV3000 (AMBE3000 / ThumbDV), AMBE3003 (USB-3003) and DV2020 (DV Dongle)
+// serial vocoder.  Bytes from the port go into a ring buffer that an
+// incremental parser turns into AMBE and PCM frames.  Requests are
+// pipelined: up to m_window frames are kept in flight so the USB round trip
+// of one frame overlaps with the next, the rest wait in a queue until a reply
+// frees a slot.  Each hardware channel is configured for its own rate and
+// hands its results to the VocoderChannel attached to it; VocoderPool owns
+// the devices and runs them on its own thread.
 class SerialAMBE : public QObject
 {
 	Q_OBJECT
 public:
-	SerialAMBE(QString);
+	SerialAMBE();
 	~SerialAMBE();
 	static QMap<QString, QString>  discover_devices();
-	void connect_to_serial(QString);
-	bool get_audio(int16_t *);
-	bool get_ambe(uint8_t *ambe);
-	void decode(uint8_t *);
-	void encode(int16_t *);
-	void clear_queue();//{ m_serialdata.clear(); }
-	void set_decode_gain(qreal g){ m_decode_gain = g; }
+	bool connect_to_serial(QString);
+	QString port() const { return m_port; }
+	int channels() const { return m_channels; }
+	bool failed() const { return m_failed; }
+	bool supports(int rate) const;
+	VocoderChannel *owner(int ch) const { return m_chan[ch].owner; }
+	int channel_rate(int ch) const { return m_chan[ch].rate; }
+	int owned() const;
+	void attach(int ch, VocoderChannel *, int rate);
+	void detach(int ch);
+	void decode(int ch, const uint8_t *);
+	void encode(int ch, const int16_t *);
+	void clear_queue(int ch);
+	void set_window(int n) { m_window = (n < 1) ? 1 : ((n > MAX_WINDOW) ? MAX_WINDOW : n); }
+	int in_flight() const { return m_inflight; }
+	uint32_t resyncs() const { return m_resyncs; }
+	enum {
+		RATE_NONE,
+		RATE_2400x1200,
+		RATE_2450x1150,
+		RATE_2450
+	};
+	enum { MAX_CHANNELS = 3, MAX_WINDOW = 24 };
+signals:
+	void device_failed();
 private slots:
 	void process_serial();
 	void receive_serial(QByteArray);
+	void serial_error(QSerialPort::SerialPortError);
 private:
+	// A request tag is kind | (channel << 4), REQ_STALE once its reply is
+	// no longer wanted.
+	enum{
+		REQ_DECODE = 0x01,
+		REQ_ENCODE = 0x02,
+		REQ_KIND = 0x0f,
+		REQ_STALE = 0x80
+	};
+	struct Channel {
+		VocoderChannel *owner;
+		int rate;
+		uint8_t packet_size;
+	};
 #ifndef Q_OS_ANDROID
 	QSerialPort *m_serial;
 #else
 	AndroidSerialPort *m_serial;
 #endif
+	QString m_port;
 	QString m_description;
-	QString m_manufacturer;
-	QString m_serialnum;
-	QString m_protocol;
-	uint8_t packet_size;
-	qreal m_decode_gain;
-	QQueue<char> m_serialdata;
-	void decode_2020(uint8_t *);
-	void encode_2020(int16_t *);
-	void decode_3000(uint8_t *);
-	void encode_3000(int16_t *);
-	void process_serial_2020();
-	void process_serial_3000();
-signals:
-	void data_ready();
+	bool m_dv2020;
+	bool m_failed;
+	int m_channels;
+	Channel m_chan[MAX_CHANNELS];
+	AudioRingBuffer<uint8_t> m_rx;
+	AudioRingBuffer<uint8_t> m_txq;
+	uint8_t m_packet[400];
+	int m_packetpos;
+	int m_packetlen;
+	uint32_t m_resyncs;
+	int m_window;
+	int m_inflight;
+	uint8_t m_flight[MAX_WINDOW];
+	uint8_t m_flightgot;
+	int m_timeouts;
+	QElapsedTimer m_lastreply;
+	void configure(int ch, int rate);
+	void decode_2020(const uint8_t *);
+	void encode_2020(const int16_t *);
+	void decode_3000(int ch, const uint8_t *);
+	void encode_3000(int ch, const int16_t *);
+	void parse();
+	int header_length();
+	void packet_received();
+	void reply(int ch, uint8_t product, const uint8_t *ambe, const int16_t *pcm);
+	void send_request(uint8_t tag, const uint8_t *data, int len);
+	void write_request(uint8_t tag, const uint8_t *data, int len);
+	void flush_requests();
+	void fail(const char *why);
 };
 
 #endif // SERIALAMBE_H
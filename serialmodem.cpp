@@ -16,15 +16,37 @@
 */
 
 #include <QMap>
-#include <QThread>
 #include <QDebug>
 #include "serialmodem.h"
 #include "MMDVMDefines.h"
+#include "logger.h"
 
 //#define DEBUGHW
 
-SerialModem::SerialModem(QString protocol)
+// GET_STATUS is polled at the slow rate while nothing is waiting for the
+// modem, at the fast one while a queue is held back for lack of space.  A
+// status request that got no reply is given up on after STATUS_TIMEOUT_MS.
+static const int STATUS_IDLE_MS = 250;
+static const int STATUS_BUSY_MS = 20;
+static const int STATUS_TIMEOUT_MS = 500;
+// Frames kept per mode while the modem has no room, older ones are dropped
+static const int MAX_TXQ_FRAMES = 50;
+
+SerialModem::SerialModem(QString protocol) :
+	m_serial(nullptr),
+	m_statustimer(nullptr),
+	m_statuspending(false),
+	m_init(INIT_VERSION),
+	m_rx(4096),
+	m_framepos(0),
+	m_framelen(0),
+	m_resyncs(0),
+	m_txdropped(0)
 {
+	for(int i = 0; i < TXQ_COUNT; ++i){
+		m_space[i] = 0;
+		m_metered[i] = true;
+	}
 	set_mode(protocol);
 	m_dmrDelay = 0;
 	m_debug = false;
@@ -35,7 +57,13 @@ SerialModem::SerialModem(QString protocol)
 
 SerialModem::~SerialModem()
 {
-	m_serial->close();
+	if(m_statustimer){
+		m_statustimer->stop();
+		delete m_statustimer;
+	}
+	if(m_serial){
+		m_serial->close();
+	}
 }
 
 void SerialModem::set_mode(QString m)
@@ -109,9 +137,8 @@ void SerialModem::connect_to_serial(QString p)
 	m_serial->setParity(QSerialPort::NoParity);
 		//out << "Baud rate == " << serial->baudRate() << endl;
 	if (m_serial->open(QIODevice::ReadWrite)) {
-		m_modemtimer = new QTimer();
-		connect(m_modemtimer, SIGNAL(timeout()), this, SLOT(process_modem()));
-		m_modemtimer->start(19);
+		m_statustimer = new QTimer();
+		connect(m_statustimer, SIGNAL(timeout()), this, SLOT(request_status()));
 #ifndef Q_OS_ANDROID
 		connect(m_serial, &QSerialPort::readyRead, this, &SerialModem::process_serial);
 #else
@@ -126,93 +153,204 @@ void SerialModem::connect_to_serial(QString p)
 		a.append(3);
 		a.append(MMDVM_GET_VERSION);
 		m_serial->write(a);
-#ifdef DEBUGHW
-			fprintf(stderr, "MODEMTX %d:%d:", a.size(), m_serialdata.size());
-			for(int i = 0; i < a.size(); ++i){
-				//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-				//	i+= 6;
-				//}
-				fprintf(stderr, "%02x ", (uint8_t)a.data()[i]);
-			}
-			fprintf(stderr, "\n");
-			fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::Modem, "MODEMTX", a.data(), a.size());
 	}
 }
 
 void SerialModem::receive_serial(QByteArray d)
 {
-	for(int i = 0; i < d.size(); i++){
-		m_serialdata.enqueue(d[i]);
+	DSLOG_HEX(Logger::Modem, "MODEMRX", d.data(), d.size());
+	if(m_rx.write((const uint8_t *)d.data(), d.size()) < (size_t)d.size()){
+		DSLOG(Logger::Modem, Logger::Warn, "SerialModem receive ring full, dropped %d bytes", d.size());
 	}
-	//qDebug() << "SerialModem::process_serial()" << d.toHex();
+	parse();
 }
 
 void SerialModem::process_serial()
 {
-	QByteArray d = m_serial->readAll();
-
-	for(int i = 0; i < d.size(); i++){
-		m_serialdata.enqueue(d[i]);
-	}
-	//qDebug() << "SerialModem::process_serial()" << d.toHex();
-#ifdef DEBUGHW
-	fprintf(stderr, "MODEMRX %d:%d:", d.size(), m_serialdata.size());
-	for(int i = 0; i < d.size(); ++i){
-		//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-		//	i+= 6;
-		//}
-		fprintf(stderr, "%02x ", (uint8_t)d.data()[i]);
+#ifndef Q_OS_ANDROID
+	char buf[512];
+	qint64 n;
+	while((n = m_serial->read(buf, sizeof(buf))) > 0){
+		DSLOG_HEX(Logger::Modem, "MODEMRX", buf, n);
+		if(m_rx.write((const uint8_t *)buf, n) < (size_t)n){
+			DSLOG(Logger::Modem, Logger::Warn, "SerialModem receive ring full, dropped %lld bytes", (long long)n);
+		}
+		parse();
 	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
+#else
+	receive_serial(m_serial->readAll());
 #endif
 }
 
-void SerialModem::process_modem()
+// Incremental frame parser, runs on every readyRead.  m_frame collects the
+// start byte and length a byte at a time, then the rest of the frame in one
+// read.  Anything that is not a frame start, or a length too short to hold
+// the type byte, is skipped a byte at a time until the stream lines up.
+void SerialModem::parse()
 {
-	QByteArray out;
-	if(m_serialdata.size() < 3){
-		return;
+	while(m_rx.available()){
+		if(m_framepos < 2){
+			m_rx.read(m_frame + m_framepos, 1);
+			if((m_framepos == 0) && (m_frame[0] != MMDVM_FRAME_START)){
+				++m_resyncs;
+				continue;
+			}
+			if(++m_framepos < 2){
+				continue;
+			}
+			m_framelen = m_frame[1];
+			if(m_framelen < 3){
+				m_framepos = (m_frame[1] == MMDVM_FRAME_START) ? 1 : 0;
+				m_frame[0] = MMDVM_FRAME_START;
+				++m_resyncs;
+				continue;
+			}
+		}
+		const size_t need = m_framelen - m_framepos;
+		const size_t avail = m_rx.available();
+		m_framepos += m_rx.read(m_frame + m_framepos, (need < avail) ? need : avail);
+		if(m_framepos == m_framelen){
+			frame_received();
+			m_framepos = 0;
+			m_framelen = 0;
+		}
 	}
-	//qDebug() << "process_modem() " << (uint8_t)m_serialdata[0] << ":" << (uint8_t)m_serialdata[1] << ":" << m_serialdata.size();
-	if(((uint8_t)m_serialdata[0] == MMDVM_FRAME_START) && (m_serialdata.size() >= m_serialdata[1])){
-		const uint8_t r = (uint8_t)m_serialdata[2];
-		const uint8_t s = (uint8_t)m_serialdata[1];
+}
+
+// Setup runs as GET_VERSION, SET_FREQ, SET_CONFIG, each step started by the
+// reply to the one before, then status polling starts.  A NAK is logged and
+// setup carries on, as not every board takes every command.
+void SerialModem::frame_received()
+{
+	const uint8_t r = m_frame[2];
 
+	if((r == MMDVM_ACK) || (r == MMDVM_NAK)){
+		const uint8_t cmd = (m_framelen > 3) ? m_frame[3] : 0xff;
 		if(r == MMDVM_NAK){
-			qDebug() << "Received MMDVM_NAK";
-			for(int i = 0; i < s; ++i){
-				m_serialdata.dequeue();
-			}
+			DSLOG(Logger::Modem, Logger::Warn, "Received MMDVM_NAK for 0x%02x reason %d", cmd, (m_framelen > 4) ? m_frame[4] : 0);
 		}
-
-		else if(r == MMDVM_ACK){
-			qDebug() << "Received MMDVM_ACK";
-			for(int i = 0; i < s; ++i){
-				m_serialdata.dequeue();
-			}
+		else{
+			DSLOG(Logger::Modem, Logger::Debug, "Received MMDVM_ACK for 0x%02x", cmd);
 		}
-
-		else if(r == MMDVM_GET_VERSION){
-			QThread::msleep(100);
-			set_freq();
-			QThread::msleep(100);
+		if((m_init == INIT_FREQ) && (cmd == MMDVM_SET_FREQ)){
+			m_init = INIT_CONFIG;
 			set_config();
-			for(int i = 0; i < s; ++i){
-				m_serialdata.dequeue();
-			}
 		}
+		else if((m_init == INIT_CONFIG) && (cmd == MMDVM_SET_CONFIG)){
+			m_init = INIT_DONE;
+			m_statustimer->start(STATUS_IDLE_MS);
+			request_status();
+		}
+	}
+	else if(r == MMDVM_GET_VERSION){
+		if(m_init == INIT_VERSION){
+			m_init = INIT_FREQ;
+			set_freq();
+		}
+	}
+	else if(r == MMDVM_GET_STATUS){
+		status_received();
+	}
+	else{
+		emit modem_data_ready(QByteArray((const char *)m_frame, m_framelen));
+	}
+}
+
+// Protocol 1 status: modes, state, flags, then the free space of each mode's
+// TX buffer in frames.  Older firmware stops before POCSAG and M17, those
+// queues are then written as frames come in, as before.
+void SerialModem::status_received()
+{
+	static const int offsets[TXQ_COUNT] = { 6, 7, 8, 9, 10, 11, 12, 13 };
+
+	m_statuspending = false;
+	for(int i = 0; i < TXQ_COUNT; ++i){
+		m_metered[i] = offsets[i] < m_framelen;
+		m_space[i] = m_metered[i] ? m_frame[offsets[i]] : 0;
+	}
+	schedule();
+}
+
+void SerialModem::request_status()
+{
+	if(m_statuspending && !m_statusclock.hasExpired(STATUS_TIMEOUT_MS)){
+		return;
+	}
+	const char req[3] = { (char)MMDVM_FRAME_START, 3, MMDVM_GET_STATUS };
+	m_statuspending = true;
+	m_statusclock.start();
+	m_serial->write(QByteArray(req, 3));
+}
+
+// The queue a frame waits in for modem buffer space, -1 for commands and
+// anything else that is written straight away.
+int SerialModem::txq_for(uint8_t type)
+{
+	switch(type){
+	case MMDVM_DSTAR_HEADER:
+	case MMDVM_DSTAR_DATA:
+	case MMDVM_DSTAR_EOT:
+		return TXQ_DSTAR;
+	case MMDVM_DMR_DATA1:
+		return TXQ_DMR1;
+	case MMDVM_DMR_DATA2:
+		return TXQ_DMR2;
+	case MMDVM_YSF_DATA:
+		return TXQ_YSF;
+	case MMDVM_P25_HDR:
+	case MMDVM_P25_LDU:
+		return TXQ_P25;
+	case MMDVM_NXDN_DATA:
+		return TXQ_NXDN;
+	case MMDVM_POCSAG_DATA:
+		return TXQ_POCSAG;
+	case MMDVM_M17_LINK_SETUP:
+	case MMDVM_M17_STREAM:
+	case MMDVM_M17_PACKET:
+	case MMDVM_M17_EOT:
+		return TXQ_M17;
+	default:
+		return -1;
+	}
+}
 
-		else if(m_serialdata.size() >= m_serialdata[1]){
-			for(int i = 0; i < s; ++i){
-				out.append(m_serialdata.dequeue());
+// Writes queued frames while the last status says the modem has room for
+// them, counting down the space as it goes the way MMDVMHost does, one
+// frame is held in reserve.  A D-Star header takes 4 frames of buffer.
+// Until the next status the count is only an estimate, so while anything
+// is held back status is polled at the fast rate.
+void SerialModem::schedule()
+{
+	bool backlog = false;
+
+	for(int i = 0; i < TXQ_COUNT; ++i){
+		while(!m_txq[i].isEmpty()){
+			const QByteArray &f = m_txq[i].head();
+			const int cost = ((uint8_t)f[2] == MMDVM_DSTAR_HEADER) ? 4 : 1;
+			if(m_metered[i] && (m_space[i] <= cost)){
+				backlog = true;
+				break;
 			}
-			emit modem_data_ready(out);
+			send(f);
+			m_space[i] -= cost;
+			m_txq[i].dequeue();
+		}
+	}
+	if(m_statustimer && (m_init == INIT_DONE)){
+		const int ms = backlog ? STATUS_BUSY_MS : STATUS_IDLE_MS;
+		if(m_statustimer->interval() != ms){
+			m_statustimer->start(ms);
 		}
 	}
 }
 
+void SerialModem::send(const QByteArray &b)
+{
+	m_serial->write(b);
+	DSLOG_HEX(Logger::Modem, "MODEMTX", b.data(), b.size());
+}
+
 void SerialModem::set_freq()
 {
 	QByteArray out;
@@ -237,17 +375,7 @@ void SerialModem::set_freq()
 	out.append((pfreq >> 16) & 0xFFU);
 	out.append((pfreq >> 24) & 0xFFU);
 	m_serial->write(out);
-#ifdef DEBUGHW
-	fprintf(stderr, "MODEMTX %d:%d:", out.size(), m_serialdata.size());
-	for(int i = 0; i < out.size(); ++i){
-		//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-		//	i+= 6;
-		//}
-		fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::Modem, "MODEMTX", out.data(), out.size());
 }
 
 void SerialModem::set_config()
@@ -329,17 +457,7 @@ void SerialModem::set_config()
 	}
 
 	m_serial->write(out);
-#ifdef DEBUGHW
-	fprintf(stderr, "MODEMTX %d:%d:", out.size(), m_serialdata.size());
-	for(int i = 0; i < out.size(); ++i){
-		//if((d.data()[i] == 0x61) && (data.data()[i+1] == 0x01) && (data.data()[i+2] == 0x42) && (data.data()[i+3] == 0x02)){
-		//	i+= 6;
-		//}
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::Modem, "MODEMTX", out.data(), out.size());
 }
 
 void SerialModem::set_mode(uint8_t m)
@@ -353,15 +471,21 @@ void SerialModem::set_mode(uint8_t m)
 	m_serial->write(out);
 }
 
+// Codecs hand every frame for the modem to write() as it arrives.  Mode
+// data waits in its queue until the modem reports room for it, commands go
+// out at once.
 void SerialModem::write(QByteArray b)
 {
-	m_serial->write(b);
-#ifdef DEBUGHW
-	fprintf(stderr, "MODEMTX %d:%d:", b.size(), m_serialdata.size());
-	for(int i = 0; i < b.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)b.data()[i]);
+	const int q = ((b.size() > 2) && ((uint8_t)b[0] == MMDVM_FRAME_START)) ? txq_for(b[2]) : -1;
+
+	if(q < 0){
+		send(b);
+		return;
 	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	if(m_txq[q].size() >= MAX_TXQ_FRAMES){
+		m_txq[q].dequeue();
+		++m_txdropped;
+	}
+	m_txq[q].enqueue(b);
+	schedule();
 }
@@ -23,8 +23,10 @@
 #ifdef Q_OS_ANDROID
 #include "androidserialport.h"
 #endif
+#include <QElapsedTimer>
 #include <QQueue>
 #include <QTimer>
+#include "audioringbuffer.h"
 
 class SerialModem : public QObject
 {
@@ -38,22 +40,57 @@ public:
 	static QMap<QString, QString>  discover_devices();
 	void connect_to_serial(QString);
 	void write(QByteArray);
+	uint32_t resyncs() const { return m_resyncs; }
+	uint32_t tx_dropped() const { return m_txdropped; }
+	enum {
+		TXQ_DSTAR,
+		TXQ_DMR1,
+		TXQ_DMR2,
+		TXQ_YSF,
+		TXQ_P25,
+		TXQ_NXDN,
+		TXQ_POCSAG,
+		TXQ_M17,
+		TXQ_COUNT
+	};
 private slots:
 	void process_serial();
 	void receive_serial(QByteArray);
-	void process_modem();
+	void request_status();
 	void set_freq();
 	void set_config();
 	void set_mode(uint8_t);
 private:
+	enum {
+		INIT_VERSION,
+		INIT_FREQ,
+		INIT_CONFIG,
+		INIT_DONE
+	};
+	void parse();
+	void frame_received();
+	void status_received();
+	void schedule();
+	void send(const QByteArray &);
+	static int txq_for(uint8_t type);
 #ifndef Q_OS_ANDROID
 	QSerialPort *m_serial;
 #else
 	AndroidSerialPort *m_serial;
 #endif
-	QTimer *m_modemtimer;
-	uint8_t packet_size;
-	QQueue<char> m_serialdata;
+	QTimer *m_statustimer;
+	QElapsedTimer m_statusclock;
+	bool m_statuspending;
+	int m_init;
+	AudioRingBuffer<uint8_t> m_rx;
+	uint8_t m_frame[256];
+	int m_framepos;
+	int m_framelen;
+	uint32_t m_resyncs;
+	QQueue<QByteArray> m_txq[TXQ_COUNT];
+	int m_space[TXQ_COUNT];
+	bool m_metered[TXQ_COUNT];
+	uint32_t m_txdropped;
 	uint32_t m_rxfreq;
 	uint32_t m_txfreq;
 	uint32_t m_dmrColorCode;
@@ -0,0 +1,150 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "streamstats.h"
+
+StreamStats::StreamStats()
+{
+	reset(20, 0);
+	reset_tx(20);
+}
+
+// modulus is the wrap of the sequence counter, 0 if the mode has none
+void StreamStats::reset(int packet_ms, uint32_t modulus)
+{
+	const uint32_t tx_frames = m_summary.tx_frames;
+	const float tx_jitter = m_summary.tx_jitter_ms;
+	::memset(&m_summary, 0, sizeof(m_summary));
+	m_summary.tx_frames = tx_frames;
+	m_summary.tx_jitter_ms = tx_jitter;
+	m_packet_us = packet_ms * 1000;
+	m_modulus = modulus;
+	m_started = false;
+	m_highest = 0;
+	m_highest_us = 0;
+	m_seen = 0;
+	m_lasttransit = 0;
+	m_jitter = 0;
+	m_decode_total = 0;
+}
+
+void StreamStats::reset_tx(int frame_ms)
+{
+	m_summary.tx_frames = 0;
+	m_summary.tx_jitter_ms = 0;
+	m_tx_us = frame_ms * 1000;
+	m_txlast = 0;
+	m_txjitter = 0;
+}
+
+void StreamStats::rx(uint32_t seq, int64_t now_us)
+{
+	if(m_modulus == 0){
+		rx(now_us);
+		return;
+	}
+	seq %= m_modulus;
+	if(!m_started){
+		m_started = true;
+		m_highest = seq;
+		m_highest_us = now_us;
+		m_seen = 1;
+		arrival(seq, now_us);
+		return;
+	}
+	// A counter of a few frames (YSF FN, D-STAR seq) wraps within a short
+	// dropout, so seq alone cannot tell a gap from a duplicate.  The time
+	// since the highest packet, in packet periods, says how far ahead this
+	// one should be and the unwrapped value nearest to that is taken.
+	const uint32_t hm = (uint32_t)(m_highest % m_modulus);
+	const uint32_t fwd = (seq + m_modulus - hm) % m_modulus;
+	const int64_t expect = (now_us - m_highest_us + m_packet_us / 2) / m_packet_us;
+	const int64_t diff = fwd + std::llround((double)(expect - (int64_t)fwd) / m_modulus) * (int64_t)m_modulus;
+	const int64_t ext = m_highest + diff;
+
+	if(diff > 0){
+		m_summary.lost += diff - 1;
+		m_seen = (diff >= 64) ? 1 : ((m_seen << diff) | 1);
+		m_highest = ext;
+		m_highest_us = now_us;
+	}
+	else if(diff == 0 || ((-diff < 64) && (m_seen & (1ULL << -diff)))){
+		++m_summary.duplicates;
+		return;
+	}
+	else{
+		++m_summary.reordered;
+		if(-diff < 64){
+			m_seen |= 1ULL << -diff;
+			if(m_summary.lost){
+				--m_summary.lost;
+			}
+		}
+	}
+	arrival(ext, now_us);
+}
+
+void StreamStats::rx(int64_t now_us)
+{
+	arrival(m_started ? m_highest + 1 : 0, now_us);
+	m_highest = m_started ? m_highest + 1 : 0;
+	m_started = true;
+}
+
+// J += (|D| - J) / 16 where D is the change in transit time between two
+// packets, transit being arrival minus the nominal send time of the packet.
+void StreamStats::arrival(int64_t ext, int64_t now_us)
+{
+	const int64_t transit = now_us - ext * m_packet_us;
+	if(m_summary.packets){
+		const double d = (double)std::llabs(transit - m_lasttransit);
+		m_jitter += (d - m_jitter) / 16.0;
+		m_summary.jitter_ms = (float)(m_jitter / 1000.0);
+	}
+	m_lasttransit = transit;
+	++m_summary.packets;
+}
+
+void StreamStats::decoded(int64_t us)
+{
+	++m_summary.decoded;
+	m_decode_total += us;
+	m_summary.decode_us = (uint32_t)(m_decode_total / m_summary.decoded);
+	if(us > m_summary.decode_us_max){
+		m_summary.decode_us_max = (uint32_t)us;
+	}
+}
+
+void StreamStats::tx(int64_t now_us)
+{
+	if(m_summary.tx_frames){
+		const double d = (double)std::llabs((now_us - m_txlast) - m_tx_us);
+		m_txjitter += (d - m_txjitter) / 16.0;
+		m_summary.tx_jitter_ms = (float)(m_txjitter / 1000.0);
+	}
+	m_txlast = now_us;
+	++m_summary.tx_frames;
+}
+
+int64_t StreamStats::now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,79 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMSTATS_H
+#define STREAMSTATS_H
+
+#include <cstdint>
+
+// Per stream quality counters kept by every digital mode codec.  RX packets
+// are fed with the protocol's own sequence counter (M17 frame number, DMR seq,
+// YSF FN, D-STAR seq, P25 LDU frame), from which loss by sequence gap,
+// duplicates and out of order arrivals are counted over a 64 packet window,
+// with the arrival time deciding which wrap of a short counter a packet
+// belongs to, and interarrival jitter is estimated as in RFC 3550 section 6.4.1.  Modes
+// without a usable counter pass no sequence and only get jitter and counts.
+// Vocoder decode time, frames dropped by a backed up software vocoder and
+// FEC corrected bits are added by the codec, and TX
+// send times give the jitter of our own frame clock.
+class StreamStats
+{
+public:
+	struct Summary {
+		uint32_t packets;
+		uint32_t lost;
+		uint32_t duplicates;
+		uint32_t reordered;
+		float jitter_ms;
+		uint32_t fec_corrected;
+		uint32_t decoded;
+		uint32_t decode_us;
+		uint32_t decode_us_max;
+		uint32_t vocoder_dropped;
+		uint32_t tx_frames;
+		float tx_jitter_ms;
+	};
+	StreamStats();
+	void reset(int packet_ms, uint32_t modulus);
+	void reset_tx(int frame_ms);
+	void rx(uint32_t seq, int64_t now_us);
+	void rx(int64_t now_us);
+	void fec(uint32_t bits) { m_summary.fec_corrected += bits; }
+	void decoded(int64_t us);
+	void vocoder_dropped(uint32_t n) { m_summary.vocoder_dropped = n; }
+	void tx(int64_t now_us);
+	const Summary &summary() const { return m_summary; }
+	static int64_t now_us();
+private:
+	void arrival(int64_t ext, int64_t now_us);
+
+	Summary m_summary;
+	int64_t m_packet_us;
+	uint32_t m_modulus;
+	bool m_started;
+	int64_t m_highest;
+	int64_t m_highest_us;
+	uint64_t m_seen;
+	int64_t m_lasttransit;
+	double m_jitter;
+	uint64_t m_decode_total;
+	int64_t m_tx_us;
+	int64_t m_txlast;
+	double m_txjitter;
+};
+
+#endif // STREAMSTATS_H
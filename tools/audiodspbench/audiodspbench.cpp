@@ -0,0 +1,335 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compares the AGC of AudioEngine::process_audio() built on the audiodsp
+// block kernels against the scalar passes it replaced, for speed and output.
+//
+// usage: audiodspbench [--frames 160|320] [--iterations n] [file.raw ...]
+//
+// Inputs are 8 kHz 16 bit mono raw little endian.  Without inputs a built in
+// synthetic voice signal is used.  160 sample frames must match the old code
+// bit for bit and a mismatch fails the run.  320 sample frames (M17 1600) are
+// timed and compared too, but differ by design: the old code ramped the gain
+// over a fixed 160 samples and left the second half of the frame unramped.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "audiodsp.h"
+
+// AGC state of AudioEngine, with the two versions of process_audio().
+class Agc
+{
+public:
+	Agc()
+	{
+		memset(m_aout_max_buf, 0, sizeof(m_aout_max_buf));
+		m_aout_max_buf_p = m_aout_max_buf;
+		m_aout_max_buf_idx = 0;
+		m_aout_gain = 100;
+		m_volume = 1.0f;
+		m_audio_out_temp_buf_p = m_audio_out_temp_buf;
+	}
+	void process_old(int16_t *pcm, size_t s);
+	void process_new(int16_t *pcm, size_t s);
+private:
+	float gain_delta(float max);
+	// 160 entries in AudioEngine, which a 320 sample frame overran
+	float m_audio_out_temp_buf[320];
+	float *m_audio_out_temp_buf_p;
+	float m_aout_max_buf[200];
+	float *m_aout_max_buf_p;
+	int m_aout_max_buf_idx;
+	float m_aout_gain;
+	float m_volume;
+};
+
+// Peak history and gain target, unchanged between the two versions.
+float Agc::gain_delta(float max)
+{
+	float gainfactor, gaindelta;
+
+	*m_aout_max_buf_p = max;
+	m_aout_max_buf_p++;
+	m_aout_max_buf_idx++;
+
+	if (m_aout_max_buf_idx > 24){
+		m_aout_max_buf_idx = 0;
+		m_aout_max_buf_p = m_aout_max_buf;
+	}
+
+	for (size_t i = 0; i < 25; i++){
+		if (m_aout_max_buf[i] > max){
+			max = m_aout_max_buf[i];
+		}
+	}
+
+	if (max > static_cast<float>(0)){
+		gainfactor = (static_cast<float>(30000) / max);
+	}
+	else{
+		gainfactor = static_cast<float>(50);
+	}
+
+	if (gainfactor < m_aout_gain){
+		m_aout_gain = gainfactor;
+		gaindelta = static_cast<float>(0);
+	}
+	else{
+		if (gainfactor > static_cast<float>(50)){
+			gainfactor = static_cast<float>(50);
+		}
+
+		gaindelta = gainfactor - m_aout_gain;
+
+		if (gaindelta > (static_cast<float>(0.05) * m_aout_gain)){
+			gaindelta = (static_cast<float>(0.05) * m_aout_gain);
+		}
+	}
+	return gaindelta;
+}
+
+// The scalar passes as they were before the audiodsp kernels.
+void Agc::process_old(int16_t *pcm, size_t s)
+{
+	float aout_abs, max, gaindelta;
+
+	for(size_t i = 0; i < s; ++i){
+		m_audio_out_temp_buf[i] = static_cast<float>(pcm[i]);
+	}
+
+	max = 0;
+	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
+
+	for (size_t i = 0; i < s; i++){
+		aout_abs = fabsf(*m_audio_out_temp_buf_p);
+
+		if (aout_abs > max){
+			max = aout_abs;
+		}
+
+		m_audio_out_temp_buf_p++;
+	}
+
+	gaindelta = gain_delta(max);
+	gaindelta /= static_cast<float>(160);
+
+	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
+
+	for (size_t i = 0; i < 160; i++){
+		*m_audio_out_temp_buf_p = (m_aout_gain + (static_cast<float>(i) * gaindelta)) * (*m_audio_out_temp_buf_p);
+		m_audio_out_temp_buf_p++;
+	}
+
+	m_aout_gain += (static_cast<float>(s) * gaindelta);
+	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
+
+	for (size_t i = 0; i < s; i++){
+		*m_audio_out_temp_buf_p *= m_volume;
+		if (*m_audio_out_temp_buf_p > static_cast<float>(32760)){
+			*m_audio_out_temp_buf_p = static_cast<float>(32760);
+		}
+		else if (*m_audio_out_temp_buf_p < static_cast<float>(-32760)){
+			*m_audio_out_temp_buf_p = static_cast<float>(-32760);
+		}
+		pcm[i] = static_cast<int16_t>(*m_audio_out_temp_buf_p);
+		m_audio_out_temp_buf_p++;
+	}
+}
+
+// The current AudioEngine::process_audio().
+void Agc::process_new(int16_t *pcm, size_t s)
+{
+	float gaindelta;
+
+	if(s == 0){
+		return;
+	}
+
+	gaindelta = gain_delta(static_cast<float>(audiodsp_peak(pcm, s)));
+	gaindelta /= static_cast<float>(s);
+
+	audiodsp_gain(pcm, s, m_aout_gain, gaindelta, m_volume, static_cast<float>(32760));
+	m_aout_gain += (static_cast<float>(s) * gaindelta);
+}
+
+static bool load_file(const std::string &path, std::vector<int16_t> &pcm)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if(fp == nullptr){
+		fprintf(stderr, "Unable to open %s\n", path.c_str());
+		return false;
+	}
+	unsigned char buf[4096];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf) & ~(size_t)1, fp)) > 1){
+		for(size_t i = 0; i + 1 < n; i += 2){
+			pcm.push_back((int16_t)(buf[i] | (buf[i + 1] << 8)));
+		}
+	}
+	fclose(fp);
+	return true;
+}
+
+// 20 s of harmonics with a wandering pitch, syllable rate amplitude
+// modulation, loud bursts that drive the limiter and near silent pauses that
+// let the gain climb.
+static void make_synthetic(std::vector<int16_t> &pcm)
+{
+	const int len = 20 * 8000;
+	uint32_t seed = 0x12345678;
+	double phase = 0;
+
+	pcm.resize(len);
+	for(int i = 0; i < len; ++i){
+		const double t = i / 8000.0;
+		const double f0 = 110.0 + 50.0 * sin(2 * M_PI * 0.3 * t);
+		const double env = fabs(sin(2 * M_PI * 2.5 * t));
+		const int segment = (int)(t * 4) % 8;
+		seed = seed * 1664525 + 1013904223;
+		const double noise = ((int32_t)seed >> 16) / 32768.0;
+		double v = 0;
+
+		phase += 2 * M_PI * f0 / 8000.0;
+		for(int h = 1; h < 8; ++h){
+			v += sin(h * phase) / h;
+		}
+		if(segment == 3){
+			v *= 30000.0 * env;
+		}
+		else if(segment == 6){
+			v *= 40.0 * env;
+		}
+		else{
+			v *= 4000.0 * env;
+		}
+		v += 20.0 * noise;
+		pcm[i] = (int16_t)std::max(-32767.0, std::min(32767.0, v));
+	}
+}
+
+// Runs one version over the input in frames of spf samples, iterations
+// times, each from a fresh AGC.  out gets the output of the first pass.
+static double run(bool use_new, const std::vector<int16_t> &in, size_t spf, int iterations, std::vector<int16_t> &out, uint64_t &frames)
+{
+	const size_t nframes = in.size() / spf;
+	std::vector<int16_t> work(nframes * spf);
+	double ns = 0;
+
+	frames = 0;
+	for(int it = 0; it < iterations; ++it){
+		Agc agc;
+		std::copy(in.begin(), in.begin() + work.size(), work.begin());
+		auto t0 = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < nframes; ++i){
+			if(use_new){
+				agc.process_new(&work[i * spf], spf);
+			}
+			else{
+				agc.process_old(&work[i * spf], spf);
+			}
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+		frames += nframes;
+		if(it == 0){
+			out = work;
+		}
+	}
+	return ns;
+}
+
+static int run_frames(size_t spf, const std::vector<int16_t> &in, int iterations)
+{
+	std::vector<int16_t> ref, out;
+	uint64_t frames;
+	const double old_ns = run(false, in, spf, iterations, ref, frames);
+	const double new_ns = run(true, in, spf, iterations, out, frames);
+
+	size_t diff = 0;
+	size_t diff_frames = 0;
+	int maxerr = 0;
+	for(size_t f = 0; f < ref.size() / spf; ++f){
+		bool differs = false;
+		for(size_t i = f * spf; i < (f + 1) * spf; ++i){
+			if(ref[i] != out[i]){
+				++diff;
+				differs = true;
+				maxerr = std::max(maxerr, abs(ref[i] - out[i]));
+			}
+		}
+		diff_frames += differs;
+	}
+
+	fprintf(stdout, "%zu sample frames: %llu frames\n", spf, (unsigned long long)frames);
+	fprintf(stdout, "  old: %8.1f ns/frame\n", old_ns / frames);
+	fprintf(stdout, "  new: %8.1f ns/frame  %.2fx\n", new_ns / frames, old_ns / new_ns);
+	if(diff == 0){
+		fprintf(stdout, "  output matches bit for bit\n\n");
+		return 0;
+	}
+	fprintf(stdout, "  output differs in %zu samples of %zu frames, max error %d\n", diff, diff_frames, maxerr);
+	if(spf != 160){
+		fprintf(stdout, "  expected, the old code ramped the gain over 160 samples only\n\n");
+		return 0;
+	}
+	fprintf(stdout, "  FAIL\n\n");
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<size_t> sizes = { 160, 320 };
+	std::vector<int16_t> pcm;
+	int iterations = 50;
+
+	for(int i = 1; i < argc; ++i){
+		const std::string arg = argv[i];
+		if((arg == "--frames") && (i + 1 < argc)){
+			sizes = { (size_t)std::max(1, atoi(argv[++i])) };
+		}
+		else if((arg == "--iterations") && (i + 1 < argc)){
+			iterations = std::max(1, atoi(argv[++i]));
+		}
+		else if(arg[0] == '-'){
+			fprintf(stderr, "usage: %s [--frames 160|320] [--iterations n] [file.raw ...]\n", argv[0]);
+			return 2;
+		}
+		else if(!load_file(arg, pcm)){
+			return 2;
+		}
+	}
+
+	if(pcm.empty()){
+		make_synthetic(pcm);
+	}
+
+	int failures = 0;
+	for(size_t spf : sizes){
+		if(spf > 320){
+			fprintf(stderr, "Frames of more than 320 samples overrun the old code\n");
+			return 2;
+		}
+		failures += run_frames(spf, pcm, iterations);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+# Standalone benchmark of the AGC block kernels against the old scalar passes.
+# Build with: cd tools/audiodspbench && qmake && make
+TEMPLATE = app
+TARGET = audiodspbench
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O2
+INCLUDEPATH += ../..
+
+SOURCES += \
+        audiodspbench.cpp \
+        ../../audiodsp.cpp
+
+HEADERS += \
+	../../audiodsp.h
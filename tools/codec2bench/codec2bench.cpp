@@ -0,0 +1,333 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Runs codec2 encode and decode over a speech corpus as fast as possible and
+// reports frames/sec, time per codec2 stage and heap allocations per frame.
+// With --golden the encoded bitstreams are compared against stored outputs
+// so that performance changes can be checked for bit exactness.
+//
+// usage: codec2bench [--mode 3200|1600] [--iterations n] [--golden dir [--update]] [file.raw|file.wav ...]
+//
+// Inputs are 8 kHz 16 bit mono, raw little endian or WAV.  Without inputs a
+// built in synthetic voice signal is used.  golden/ holds its bitstreams for
+// both modes (x86-64, -O2); compilers that contract to FMA may need their own
+// set from --update taken before the change under test.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "codec2.h"
+#include "profile.h"
+
+static uint64_t alloc_count = 0;
+
+void *operator new(size_t n)
+{
+	++alloc_count;
+	void *p = malloc(n ? n : 1);
+	if(p == nullptr){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+struct corpus_file
+{
+	std::string name;
+	std::vector<short> pcm;
+};
+
+static bool load_file(const std::string &path, corpus_file &f)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if(fp == nullptr){
+		fprintf(stderr, "Unable to open %s\n", path.c_str());
+		return false;
+	}
+	std::vector<unsigned char> data;
+	unsigned char buf[4096];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf), fp)) > 0){
+		data.insert(data.end(), buf, buf + n);
+	}
+	fclose(fp);
+
+	size_t off = 0;
+	size_t len = data.size();
+	if((len >= 12) && !memcmp(data.data(), "RIFF", 4) && !memcmp(data.data() + 8, "WAVE", 4)){
+		size_t p = 12;
+		off = len = 0;
+		while(p + 8 <= data.size()){
+			uint32_t clen = data[p+4] | (data[p+5] << 8) | (data[p+6] << 16) | ((uint32_t)data[p+7] << 24);
+			if(!memcmp(data.data() + p, "fmt ", 4) && (p + 24 <= data.size())){
+				uint16_t ch = data[p+10] | (data[p+11] << 8);
+				uint32_t rate = data[p+12] | (data[p+13] << 8) | (data[p+14] << 16) | ((uint32_t)data[p+15] << 24);
+				uint16_t bits = data[p+22] | (data[p+23] << 8);
+				if((ch != 1) || (rate != 8000) || (bits != 16)){
+					fprintf(stderr, "%s: must be 8 kHz 16 bit mono\n", path.c_str());
+					return false;
+				}
+			}
+			else if(!memcmp(data.data() + p, "data", 4)){
+				off = p + 8;
+				len = std::min<size_t>(clen, data.size() - off);
+				break;
+			}
+			p += 8 + clen + (clen & 1);
+		}
+	}
+
+	f.name = path.substr(path.find_last_of("/\\") + 1);
+	f.pcm.resize(len / 2);
+	for(size_t i = 0; i < f.pcm.size(); ++i){
+		f.pcm[i] = (short)(data[off + 2*i] | (data[off + 2*i + 1] << 8));
+	}
+	return true;
+}
+
+// 60 s of a voiced signal with a wandering pitch, syllable rate amplitude
+// modulation, unvoiced bursts and pauses.  Deterministic, so it is also
+// usable as a golden input.
+static void make_synthetic(corpus_file &f)
+{
+	const int len = 60 * 8000;
+	uint32_t seed = 0x12345678;
+	double phase = 0;
+
+	f.name = "synthetic";
+	f.pcm.resize(len);
+	for(int i = 0; i < len; ++i){
+		const double t = i / 8000.0;
+		const double f0 = 110.0 + 50.0 * sin(2 * M_PI * 0.3 * t) + 20.0 * sin(2 * M_PI * 2.1 * t);
+		const double env = fabs(sin(2 * M_PI * 2.5 * t));
+		const int segment = (int)(t * 4) % 8;
+		seed = seed * 1664525 + 1013904223;
+		const double noise = ((int32_t)seed >> 16) / 32768.0;
+		double v = 0;
+
+		phase += 2 * M_PI * f0 / 8000.0;
+		if(segment < 5){
+			for(int h = 1; h * f0 < 3800; ++h){
+				v += sin(h * phase) / h;
+			}
+			v *= 6000.0 * env;
+		}
+		else if(segment == 5){
+			v = 2000.0 * env * noise;
+		}
+		v += 30.0 * noise;
+		f.pcm[i] = (short)std::max(-32767.0, std::min(32767.0, v));
+	}
+}
+
+static bool read_golden(const std::string &path, std::vector<unsigned char> &bits)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if(fp == nullptr){
+		return false;
+	}
+	unsigned char buf[4096];
+	size_t n;
+	bits.clear();
+	while((n = fread(buf, 1, sizeof(buf), fp)) > 0){
+		bits.insert(bits.end(), buf, buf + n);
+	}
+	fclose(fp);
+	return true;
+}
+
+static bool write_golden(const std::string &path, const std::vector<unsigned char> &bits)
+{
+	FILE *fp = fopen(path.c_str(), "wb");
+	if(fp == nullptr){
+		fprintf(stderr, "Unable to write %s\n", path.c_str());
+		return false;
+	}
+	fwrite(bits.data(), 1, bits.size(), fp);
+	fclose(fp);
+	return true;
+}
+
+static void print_stages(double encode_ns, double decode_ns)
+{
+	fprintf(stdout, "  %-28s %10s %12s %10s %8s\n", "stage", "calls", "total ms", "us/call", "%");
+	for(int s = 0; s < C2_STAGE_COUNT; ++s){
+		const c2_stage_stats &st = c2_profile[s];
+		if(st.calls == 0){
+			continue;
+		}
+		double parent = (s == C2_STAGE_SYNTHESISE || s == C2_STAGE_AKS_TO_M2 || s == C2_STAGE_DECODE) ? decode_ns : encode_ns;
+		fprintf(stdout, "  %-28s %10llu %12.2f %10.2f %7.1f%%\n", c2_stage_names[s], (unsigned long long)st.calls,
+			st.ns / 1e6, st.ns / 1e3 / st.calls, parent > 0 ? 100.0 * st.ns / parent : 0.0);
+	}
+}
+
+static int run_mode(int mode, const std::vector<corpus_file> &corpus, int iterations, const std::string &golden, bool update)
+{
+	int failures = 0;
+	uint64_t frames = 0;
+	uint64_t encode_allocs = 0;
+	uint64_t decode_allocs = 0;
+	double encode_ns = 0;
+	double decode_ns = 0;
+
+	memset(c2_profile, 0, sizeof(c2_profile));
+
+	for(const corpus_file &f : corpus){
+		CCodec2 enc(mode == 3200);
+		CCodec2 dec(mode == 3200);
+		const int spf = enc.codec2_samples_per_frame();
+		const int bpf = (enc.codec2_bits_per_frame() + 7) / 8;
+		const int nframes = f.pcm.size() / spf;
+		std::vector<unsigned char> bits(nframes * bpf);
+		std::vector<short> out(nframes * spf);
+
+		for(int it = 0; it < iterations; ++it){
+			uint64_t a = alloc_count;
+			auto t0 = std::chrono::steady_clock::now();
+			for(int i = 0; i < nframes; ++i){
+				enc.codec2_encode(&bits[i * bpf], &f.pcm[i * spf]);
+			}
+			auto t1 = std::chrono::steady_clock::now();
+			encode_allocs += alloc_count - a;
+			a = alloc_count;
+			for(int i = 0; i < nframes; ++i){
+				dec.codec2_decode(&out[i * spf], &bits[i * bpf]);
+			}
+			auto t2 = std::chrono::steady_clock::now();
+			decode_allocs += alloc_count - a;
+			encode_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+			decode_ns += std::chrono::duration<double, std::nano>(t2 - t1).count();
+			frames += nframes;
+
+			// later iterations continue from the codec state of the first,
+			// only the first pass is a valid bitstream to compare
+			if((it == 0) && !golden.empty()){
+				const std::string path = golden + "/" + f.name + "." + std::to_string(mode) + ".c2";
+				std::vector<unsigned char> ref;
+				if(update){
+					if(write_golden(path, bits)){
+						fprintf(stdout, "%s: wrote %s\n", f.name.c_str(), path.c_str());
+					}
+				}
+				else if(!read_golden(path, ref)){
+					fprintf(stdout, "%s: FAIL no golden output %s\n", f.name.c_str(), path.c_str());
+					++failures;
+				}
+				else if(ref != bits){
+					size_t diff = 0;
+					size_t first = bits.size();
+					for(size_t i = 0; i < std::min(ref.size(), bits.size()); ++i){
+						if(ref[i] != bits[i]){
+							first = std::min(first, i);
+							for(unsigned char x = ref[i] ^ bits[i]; x; x &= x - 1){
+								++diff;
+							}
+						}
+					}
+					fprintf(stdout, "%s: FAIL %zu bits differ, first in frame %zu%s\n", f.name.c_str(), diff, first / bpf,
+						(ref.size() != bits.size()) ? " (length differs)" : "");
+					++failures;
+				}
+				else{
+					fprintf(stdout, "%s: bitstream matches golden output\n", f.name.c_str());
+				}
+			}
+		}
+	}
+
+	const double audio_s = frames * (mode == 3200 ? 0.02 : 0.04);
+	fprintf(stdout, "\nCodec2 %d: %llu frames (%.1f s of audio)\n", mode, (unsigned long long)frames, audio_s);
+	fprintf(stdout, "  encode: %10.0f frames/s %8.2f us/frame %7.0fx realtime %6.2f allocs/frame\n",
+		frames / (encode_ns / 1e9), encode_ns / 1e3 / frames, audio_s / (encode_ns / 1e9), (double)encode_allocs / frames);
+	fprintf(stdout, "  decode: %10.0f frames/s %8.2f us/frame %7.0fx realtime %6.2f allocs/frame\n\n",
+		frames / (decode_ns / 1e9), decode_ns / 1e3 / frames, audio_s / (decode_ns / 1e9), (double)decode_allocs / frames);
+	print_stages(encode_ns, decode_ns);
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<int> modes = { 3200, 1600 };
+	std::vector<corpus_file> corpus;
+	std::string golden;
+	bool update = false;
+	int iterations = 1;
+
+	for(int i = 1; i < argc; ++i){
+		const std::string arg = argv[i];
+		if((arg == "--mode") && (i + 1 < argc)){
+			modes = { atoi(argv[++i]) };
+		}
+		else if((arg == "--iterations") && (i + 1 < argc)){
+			iterations = std::max(1, atoi(argv[++i]));
+		}
+		else if((arg == "--golden") && (i + 1 < argc)){
+			golden = argv[++i];
+		}
+		else if(arg == "--update"){
+			update = true;
+		}
+		else if(arg[0] == '-'){
+			fprintf(stderr, "usage: %s [--mode 3200|1600] [--iterations n] [--golden dir [--update]] [file.raw|file.wav ...]\n", argv[0]);
+			return 2;
+		}
+		else{
+			corpus_file f;
+			if(!load_file(arg, f)){
+				return 2;
+			}
+			corpus.push_back(f);
+		}
+	}
+
+	if(corpus.empty()){
+		corpus_file f;
+		make_synthetic(f);
+		corpus.push_back(f);
+	}
+
+	int failures = 0;
+	for(int mode : modes){
+		if((mode != 3200) && (mode != 1600)){
+			fprintf(stderr, "Unsupported mode %d\n", mode);
+			return 2;
+		}
+		failures += run_mode(mode, corpus, iterations, golden, update);
+	}
+
+	if(!golden.empty() && !update){
+		fprintf(stdout, "\n%s: %d bitstream mismatches\n", failures ? "FAILED" : "PASSED", failures);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+# Standalone codec2 benchmark and bitstream regression check.
+# Build with: cd tools/codec2bench && qmake && make
+TEMPLATE = app
+TARGET = codec2bench
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+DEFINES += CODEC2_PROFILE
+QMAKE_CXXFLAGS_RELEASE += -O2
+INCLUDEPATH += ../../codec2
+
+SOURCES += \
+        codec2bench.cpp \
+        ../../codec2/codebooks.cpp \
+        ../../codec2/codec2.cpp \
+        ../../codec2/kiss_fft.cpp \
+        ../../codec2/lpc.cpp \
+        ../../codec2/nlp.cpp \
+        ../../codec2/pack.cpp \
+        ../../codec2/qbase.cpp \
+        ../../codec2/quantise.cpp
+
+HEADERS += \
+	../../codec2/codec2.h \
+	../../codec2/profile.h
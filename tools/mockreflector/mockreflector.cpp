@@ -0,0 +1,1062 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Local stand in for a reflector, for load and regression testing of the
+// protocol code without going on the air.  Speaks the reflector side of one
+// protocol per instance: M17 (CONN/ACKN/PING), DMR Homebrew (RPTL/RPTK/RPTC/
+// RPTACK/DMRD), YSF, P25, NXDN and D-STAR DPlus (REF), DExtra (XRF) and DCS.
+// Every client that links gets keepalives and the injected streams, and
+// whatever it sends is timed and optionally recorded.
+//
+// usage: mockreflector --mode m17|dmr|ysf|p25|nxdn|ref|xrf|dcs [options]
+//   --port n          UDP port, defaults to the mode's usual reflector port
+//   --name s          reflector name, D-STAR streams are addressed to "name module"
+//   --module c        D-STAR / M17 module (default C)
+//   --streams n       synthetic streams to send, -1 for no end (default 0)
+//   --frames n        network frames per synthetic stream (default 100)
+//   --inject file     send the stream packets of a DSCAP capture instead
+//   --inject-tx       inject what the capture's client sent rather than received
+//   --loops n         times to play the injected capture (default 1)
+//   --gap ms          idle time between streams (default 1000)
+//   --delay ms        wait after the first client links before sending (default 2000)
+//   --rate x          speed factor for frame pacing, 2 sends twice as fast (default 1)
+//   --loss pct        drop this percentage of stream packets
+//   --jitter ms       delay each stream packet by 0..ms, packets may reorder
+//   --seed n          random seed, runs with the same seed drop the same packets
+//   --parrot          play each client transmission back to it when it ends
+//   --record file     write everything exchanged with clients to a DSCAP capture
+//
+// Synthetic streams carry silence frames for the mode's vocoder, so they
+// exercise the protocol, jitter buffer and decode paths rather than audio.
+// TX pacing of every client stream (interval jitter against the mode's frame
+// period, largest late packet) is printed when the stream ends, and totals on
+// SIGINT.  Captures use the DroidStar FrameCapture format, so a --record file
+// can be fed back with --inject or replayed into the codecs directly.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <queue>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "framecapture.h"
+#include "CRCenc.h"
+#include "YSFFICH.h"
+
+enum proto_mode { MODE_M17, MODE_DMR, MODE_YSF, MODE_P25, MODE_NXDN, MODE_REF, MODE_XRF, MODE_DCS };
+
+struct mode_def
+{
+	const char *name;
+	const char *capname;
+	proto_mode mode;
+	uint16_t port;
+	int frame_ms;
+	int keepalive_ms;
+};
+
+// keepalive_ms 0: the client polls and we answer
+static const mode_def modes[] = {
+	{ "m17",  "M17",  MODE_M17,  17000, 40,  3000 },
+	{ "dmr",  "DMR",  MODE_DMR,  62031, 60,  0 },
+	{ "ysf",  "YSF",  MODE_YSF,  42000, 100, 0 },
+	{ "p25",  "P25",  MODE_P25,  41000, 20,  0 },
+	{ "nxdn", "NXDN", MODE_NXDN, 41400, 80,  0 },
+	{ "ref",  "REF",  MODE_REF,  20001, 20,  1000 },
+	{ "xrf",  "XRF",  MODE_XRF,  30001, 20,  1000 },
+	{ "dcs",  "DCS",  MODE_DCS,  30051, 20,  1000 },
+};
+
+typedef std::vector<uint8_t> packet;
+
+struct timed_packet
+{
+	uint64_t offset_us;
+	packet data;
+};
+
+typedef std::vector<timed_packet> stream;
+
+struct pending
+{
+	uint64_t due_us;
+	uint64_t order;
+	size_t client;
+	packet data;
+	bool operator<(const pending &o) const { return (due_us != o.due_us) ? (due_us > o.due_us) : (order > o.order); }
+};
+
+struct client
+{
+	sockaddr_in addr;
+	bool linked;
+	uint64_t last_us;
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	uint64_t dropped;
+	// current transmission from the client
+	bool tx_active;
+	uint64_t tx_start_us;
+	uint64_t tx_last_us;
+	uint32_t tx_frames;
+	double tx_jitter_us;
+	double tx_late_max_us;
+	stream tx_stream;
+};
+
+struct options
+{
+	const mode_def *mode = nullptr;
+	uint16_t port = 0;
+	std::string name = "MOCK001";
+	char module = 'C';
+	int streams = 0;
+	int frames = 100;
+	std::string inject;
+	bool inject_tx = false;
+	int loops = 1;
+	int gap_ms = 1000;
+	int delay_ms = 2000;
+	double rate = 1.0;
+	double loss = 0.0;
+	int jitter_ms = 0;
+	unsigned int seed = 1;
+	bool parrot = false;
+	std::string record;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+static options opt;
+static int sock = -1;
+static std::vector<client> clients;
+static std::priority_queue<pending> queue;
+static uint64_t queue_order = 0;
+static std::mt19937 rng;
+static FrameCapture capture;
+static uint64_t run_start_us;
+
+static const char M17_CHARS[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-/.";
+static const uint8_t M17_SILENCE[8] = {0x00, 0x01, 0x43, 0x09, 0xe4, 0x9c, 0x08, 0x21};
+static const uint8_t DMR_SILENCE[9] = {0xb9, 0xe8, 0x81, 0x52, 0x61, 0x73, 0x00, 0x2a, 0x6b};
+static const uint8_t DMR_VOICE_SYNC[6] = {0x75, 0x5f, 0xd7, 0xdf, 0x75, 0xf7};
+static const uint8_t DSTAR_SILENCE[9] = {0x9e, 0x8d, 0x32, 0x88, 0x26, 0x1a, 0x3f, 0x61, 0xe8};
+static const uint8_t DSTAR_SYNC[3] = {0x55, 0x2d, 0x16};
+static const uint8_t DSTAR_FILLER[3] = {0x16, 0x29, 0xf5};
+static const uint8_t P25_SILENCE[11] = {0x04, 0x0c, 0xfd, 0x7b, 0xfb, 0x7d, 0xf2, 0x7b, 0x3d, 0x9e, 0x45};
+static const uint8_t YSF_SYNC[5] = {0xd4, 0x71, 0xc9, 0x63, 0x4d};
+static const uint8_t DPLUS_HEADER[5] = {0x80, 'D', 'S', 'V', 'T'};
+
+static void on_signal(int)
+{
+	g_stop = 1;
+}
+
+static uint64_t now_us()
+{
+	return FrameCapture::now_us();
+}
+
+static std::string addr_str(const sockaddr_in &a)
+{
+	char s[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &a.sin_addr, s, sizeof(s));
+	return std::string(s) + ":" + std::to_string(ntohs(a.sin_port));
+}
+
+static void send_to(client &c, const packet &p)
+{
+	sendto(sock, p.data(), p.size(), 0, (const sockaddr *)&c.addr, sizeof(c.addr));
+	c.tx_packets++;
+	if(capture.is_open()){
+		capture.write(FrameCapture::UdpRx, p.data(), p.size());
+	}
+}
+
+static void send_to(client &c, const char *s, size_t len)
+{
+	send_to(c, packet((const uint8_t *)s, (const uint8_t *)s + len));
+}
+
+// Fixed width, space padded copy of a callsign style field
+static void put_field(uint8_t *dst, const std::string &s, size_t len, char pad = ' ')
+{
+	memset(dst, pad, len);
+	memcpy(dst, s.c_str(), (s.size() < len) ? s.size() : len);
+}
+
+static void put_be(uint8_t *dst, uint32_t v, int bytes)
+{
+	for(int i = 0; i < bytes; ++i){
+		dst[i] = (v >> (8 * (bytes - 1 - i))) & 0xff;
+	}
+}
+
+static std::string dstar_rptr()
+{
+	std::string r = opt.name.substr(0, 7);
+	r.append(7 - r.size(), ' ');
+	return r + opt.module;
+}
+
+static void m17_encode_callsign(const std::string &cs, uint8_t *out)
+{
+	uint64_t encoded = 0;
+	for(int i = (int)cs.size() - 1; i >= 0; --i){
+		const char *p = strchr(M17_CHARS, cs[i]);
+		encoded = encoded * 40 + ((p && cs[i]) ? (p - M17_CHARS) : 0);
+	}
+	for(int i = 0; i < 6; ++i){
+		out[i] = (encoded >> (8 * (5 - i))) & 0xff;
+	}
+}
+
+static uint16_t m17_crc(const uint8_t *d, size_t len)
+{
+	uint16_t crc = 0xffff;
+	for(size_t i = 0; i < len; ++i){
+		crc ^= d[i] << 8;
+		for(int b = 0; b < 8; ++b){
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x5935) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+static bool is_stream_packet(const packet &p)
+{
+	const uint8_t *b = p.data();
+	const size_t n = p.size();
+	switch(opt.mode->mode){
+	case MODE_M17:
+		return (n == 54) && !memcmp(b, "M17 ", 4);
+	case MODE_DMR:
+		return (n == 55) && !memcmp(b, "DMRD", 4);
+	case MODE_YSF:
+		return (n == 155) && !memcmp(b, "YSFD", 4);
+	case MODE_P25:
+		return (n > 11) && (((b[0] >= 0x62) && (b[0] <= 0x73)) || (b[0] == 0x80));
+	case MODE_NXDN:
+		return (n == 43) && !memcmp(b, "NXDND", 5);
+	case MODE_REF:
+		return ((n == 0x3a) || (n == 0x1d) || (n == 0x20)) && !memcmp(b + 1, DPLUS_HEADER, 5);
+	case MODE_XRF:
+		return ((n == 56) || (n == 27)) && !memcmp(b, "DSVT", 4);
+	case MODE_DCS:
+		return (n == 100) && !memcmp(b, "0001", 4);
+	}
+	return false;
+}
+
+static bool is_stream_end(const packet &p)
+{
+	const uint8_t *b = p.data();
+	switch(opt.mode->mode){
+	case MODE_M17:
+		return (b[34] & 0x80) != 0;
+	case MODE_DMR:
+		return (b[15] & 0x20) && ((b[15] & 0x0f) == 0x02);
+	case MODE_YSF:{
+		CYSFFICH fich;
+		return fich.decode(b + 35) && (fich.getFI() == 0x02);
+	}
+	case MODE_P25:
+		return b[0] == 0x80;
+	case MODE_NXDN:
+		return (b[9] & 0x08) != 0;
+	case MODE_REF:
+		return (p.size() == 0x20) || ((p.size() == 0x1d) && (b[16] & 0x40));
+	case MODE_XRF:
+		return (p.size() == 27) && (b[14] & 0x40);
+	case MODE_DCS:
+		return (b[45] & 0x40) != 0;
+	}
+	return false;
+}
+
+// Give a replayed stream its own id and, for D-STAR, address it to this
+// reflector so the client accepts it whatever it was recorded from.
+static void restamp(packet &p, uint32_t id)
+{
+	uint8_t *b = p.data();
+	switch(opt.mode->mode){
+	case MODE_M17:{
+		put_be(b + 4, id, 2);
+		const uint16_t crc = m17_crc(b, 52);
+		put_be(b + 52, crc, 2);
+		break;
+	}
+	case MODE_DMR:
+		put_be(b + 16, id, 4);
+		break;
+	case MODE_REF:
+		put_be(b + 14, id, 2);
+		if(p.size() == 0x3a){
+			put_field(b + 20, dstar_rptr(), 8);
+			put_field(b + 28, dstar_rptr(), 8);
+			CCRC::addCCITT161(b + 17, 41);
+		}
+		break;
+	case MODE_XRF:
+		put_be(b + 12, id, 2);
+		if(p.size() == 56){
+			put_field(b + 18, dstar_rptr(), 8);
+			put_field(b + 26, dstar_rptr(), 8);
+			CCRC::addCCITT161(b + 15, 41);
+		}
+		break;
+	case MODE_DCS:
+		put_field(b + 7, dstar_rptr(), 8);
+		put_field(b + 15, dstar_rptr(), 8);
+		put_be(b + 43, id, 2);
+		break;
+	default:
+		break;
+	}
+}
+
+static void make_m17(stream &s, int frames)
+{
+	uint8_t p[54];
+	memset(p, 0, sizeof(p));
+	memcpy(p, "M17 ", 4);
+	m17_encode_callsign("ALL", p + 6);
+	m17_encode_callsign("N0CALL D", p + 12);
+	p[19] = 0x05; // stream, 3200 voice
+	for(int i = 0; i < frames; ++i){
+		const uint16_t fn = i | ((i == frames - 1) ? 0x8000 : 0);
+		put_be(p + 34, fn, 2);
+		memcpy(p + 36, M17_SILENCE, 8);
+		memcpy(p + 44, M17_SILENCE, 8);
+		s.push_back({ (uint64_t)i * 40000, packet(p, p + sizeof(p)) });
+	}
+}
+
+static void make_dmr(stream &s, int frames)
+{
+	const uint32_t src = 3100001, dst = 91, rptr = 310000101;
+	uint8_t p[55];
+	memset(p, 0, sizeof(p));
+	memcpy(p, "DMRD", 4);
+	put_be(p + 5, src, 3);
+	put_be(p + 8, dst, 3);
+	put_be(p + 11, rptr, 4);
+	uint8_t seq = 0;
+	uint64_t t = 0;
+
+	p[4] = seq++;
+	p[15] = 0x80 | 0x20 | 0x01; // TS2, data sync, voice LC header
+	s.push_back({ t, packet(p, p + sizeof(p)) });
+
+	uint8_t ambe[27];
+	for(int i = 0; i < 3; ++i){
+		memcpy(ambe + 9 * i, DMR_SILENCE, 9);
+	}
+	for(int i = 0; i < frames; ++i){
+		const int n = i % 6;
+		uint8_t *f = p + 20;
+		memset(f, 0, 33);
+		memcpy(f, ambe, 13);
+		memcpy(f + 20, ambe + 14, 13);
+		f[13] = ambe[13] & 0xf0;
+		f[19] = ambe[13] & 0x0f;
+		if(n == 0){
+			f[13] |= DMR_VOICE_SYNC[0] >> 4;
+			for(int j = 0; j < 5; ++j){
+				f[14 + j] = (DMR_VOICE_SYNC[j] << 4) | (DMR_VOICE_SYNC[j + 1] >> 4);
+			}
+			f[19] |= DMR_VOICE_SYNC[5] << 4;
+		}
+		p[4] = seq++;
+		p[15] = 0x80 | (n ? n : 0x10);
+		t += 60000;
+		s.push_back({ t, packet(p, p + sizeof(p)) });
+	}
+
+	memset(p + 20, 0, 33);
+	p[4] = seq++;
+	p[15] = 0x80 | 0x20 | 0x02; // terminator with LC
+	t += 60000;
+	s.push_back({ t, packet(p, p + sizeof(p)) });
+}
+
+static void make_ysf(stream &s, int frames)
+{
+	uint8_t p[155];
+	memset(p, 0, sizeof(p));
+	memcpy(p, "YSFD", 4);
+	put_field(p + 4, opt.name, 10);
+	put_field(p + 14, "N0CALL", 10);
+	put_field(p + 24, "ALL", 10);
+	memcpy(p + 35, YSF_SYNC, 5);
+	for(int i = 0; i < frames + 2; ++i){
+		const bool header = (i == 0), term = (i == frames + 1);
+		CYSFFICH fich;
+		fich.setFI(header ? 0x00 : (term ? 0x02 : 0x01));
+		fich.setCS(2U);
+		fich.setCM(0U);
+		fich.setBN(0U);
+		fich.setBT(0U);
+		fich.setFN((header || term) ? 0U : (i - 1) % 7);
+		fich.setFT(6U);
+		fich.setDev(false);
+		fich.setMR(0U);
+		fich.setVoIP(false);
+		fich.setDT(0x02); // V/D mode 2
+		fich.setSQL(false);
+		fich.setSQ(0U);
+		fich.encode(p + 35);
+		p[34] = ((i & 0x7f) << 1) | (term ? 0x01 : 0x00);
+		s.push_back({ (uint64_t)i * 100000, packet(p, p + sizeof(p)) });
+	}
+}
+
+static void make_p25(stream &s, int frames)
+{
+	// record type, length and IMBE offset of one LDU1 + LDU2 superframe
+	static const uint8_t ldu[18][3] = {
+		{0x62, 22, 10}, {0x63, 14, 1}, {0x64, 17, 5}, {0x65, 17, 5}, {0x66, 17, 5}, {0x67, 17, 5}, {0x68, 17, 5}, {0x69, 17, 5}, {0x6a, 16, 4},
+		{0x6b, 22, 10}, {0x6c, 14, 1}, {0x6d, 17, 5}, {0x6e, 17, 5}, {0x6f, 17, 5}, {0x70, 17, 5}, {0x71, 17, 5}, {0x72, 17, 5}, {0x73, 16, 4},
+	};
+	const uint32_t src = 3100001, dst = 10200;
+	int i;
+	for(i = 0; i < frames; ++i){
+		const uint8_t *r = ldu[i % 18];
+		packet p(r[1], 0);
+		p[0] = r[0];
+		if(r[0] == 0x65){
+			put_be(p.data() + 1, dst, 3);
+		}
+		else if(r[0] == 0x66){
+			put_be(p.data() + 1, src, 3);
+		}
+		memcpy(p.data() + r[2], P25_SILENCE, 11);
+		s.push_back({ (uint64_t)i * 20000, p });
+	}
+	packet end(17, 0);
+	end[0] = 0x80;
+	s.push_back({ (uint64_t)i * 20000, end });
+}
+
+static void make_nxdn(stream &s, int frames)
+{
+	const uint16_t src = 1234, dst = 65000;
+	uint8_t p[43];
+	for(int i = 0; i < frames + 2; ++i){
+		const bool header = (i == 0), eot = (i == frames + 1);
+		memset(p, 0, sizeof(p));
+		memcpy(p, "NXDND", 5);
+		put_be(p + 5, src, 2);
+		put_be(p + 7, dst, 2);
+		p[9] = 0x01;
+		if(header || eot){
+			p[9] |= eot ? 0x08 : 0x04;
+			p[10] = 0x81; // RDCH, SACCH non superframe, FACCH in both halves
+			p[15] = p[29] = eot ? 0x08 : 0x01; // TX_REL or VCALL
+		}
+		else{
+			p[10] = 0xac; // RDCH, SACCH superframe, voice in both halves
+		}
+		s.push_back({ (uint64_t)i * 80000, packet(p, p + sizeof(p)) });
+	}
+}
+
+static void dstar_header(uint8_t *h)
+{
+	// flags(3), rptr2, rptr1, urcall, mycall, suffix, crc
+	memset(h, 0, 41);
+	put_field(h + 3, dstar_rptr(), 8);
+	put_field(h + 11, dstar_rptr(), 8);
+	put_field(h + 19, "CQCQCQ", 8);
+	put_field(h + 27, "N0CALL", 8);
+	put_field(h + 35, "MOCK", 4);
+	CCRC::addCCITT161(h, 41);
+}
+
+static void dstar_voice(uint8_t *v, int seq)
+{
+	memcpy(v, DSTAR_SILENCE, 9);
+	memcpy(v + 9, (seq % 21) ? DSTAR_FILLER : DSTAR_SYNC, 3);
+}
+
+static void make_dstar(stream &s, int frames)
+{
+	uint8_t h[41];
+	dstar_header(h);
+	for(int i = 0; i < frames; ++i){
+		const bool last = (i == frames - 1);
+		const uint8_t seq = (i % 21) | (last ? 0x40 : 0);
+		uint8_t p[100];
+		memset(p, 0, sizeof(p));
+		if(opt.mode->mode == MODE_REF){
+			memcpy(p + 1, DPLUS_HEADER, 5);
+			p[6] = 0x10; p[10] = 0x20; p[11] = 0x00; p[12] = 0x01; p[13] = 0x01;
+			if(i == 0){
+				p[0] = 0x3a;
+				memcpy(p + 17, h, 41);
+				s.push_back({ 0, packet(p, p + 0x3a) });
+			}
+			p[0] = 0x1d;
+			p[6] = 0x20;
+			p[16] = seq;
+			dstar_voice(p + 17, i);
+			s.push_back({ (uint64_t)i * 20000, packet(p, p + 0x1d) });
+			if(last){
+				p[0] = 0x20;
+				memset(p + 17, 0, 15);
+				p[26] = 0x55; p[27] = 0x55; p[28] = 0x55; p[29] = 0x55; p[30] = 0xc8; p[31] = 0x7a;
+				s.push_back({ (uint64_t)i * 20000 + 1000, packet(p, p + 0x20) });
+			}
+		}
+		else if(opt.mode->mode == MODE_XRF){
+			memcpy(p, "DSVT", 4);
+			p[4] = 0x10; p[8] = 0x20; p[9] = 0x00; p[10] = 0x01; p[11] = 0x01;
+			if(i == 0){
+				memcpy(p + 15, h, 41);
+				s.push_back({ 0, packet(p, p + 56) });
+			}
+			p[4] = 0x20;
+			p[14] = seq;
+			dstar_voice(p + 15, i);
+			s.push_back({ (uint64_t)i * 20000, packet(p, p + 27) });
+		}
+		else{
+			memcpy(p, "0001", 4);
+			memcpy(p + 4, h, 39);
+			p[45] = seq;
+			dstar_voice(p + 46, i);
+			p[58] = i & 0xff;
+			p[59] = (i >> 8) & 0xff;
+			p[60] = (i >> 16) & 0xff;
+			p[61] = 0x01;
+			s.push_back({ (uint64_t)i * 20000, packet(p, p + 100) });
+		}
+	}
+}
+
+static void make_synthetic(stream &s)
+{
+	switch(opt.mode->mode){
+	case MODE_M17:	make_m17(s, opt.frames); break;
+	case MODE_DMR:	make_dmr(s, opt.frames); break;
+	case MODE_YSF:	make_ysf(s, opt.frames); break;
+	case MODE_P25:	make_p25(s, opt.frames); break;
+	case MODE_NXDN:	make_nxdn(s, opt.frames); break;
+	default:		make_dstar(s, opt.frames); break;
+	}
+}
+
+// Splits the stream packets of a capture into streams at end markers or
+// gaps longer than a second.
+static bool load_capture(const std::string &path, std::vector<stream> &out)
+{
+	FrameCapture cap;
+	if(!cap.open_read(path)){
+		return false;
+	}
+	if(cap.mode() != opt.mode->capname){
+		fprintf(stderr, "Warning: %s is a %s capture, serving %s\n", path.c_str(), cap.mode().c_str(), opt.mode->capname);
+	}
+	const uint8_t kind = opt.inject_tx ? FrameCapture::UdpTx : FrameCapture::UdpRx;
+	FrameCapture::Record r;
+	stream s;
+	uint64_t first = 0, last = 0;
+	while(cap.read(r)){
+		if((r.kind != kind) || !is_stream_packet(r.data)){
+			continue;
+		}
+		if(!s.empty() && (r.t_us - last > 1000000)){
+			out.push_back(s);
+			s.clear();
+		}
+		if(s.empty()){
+			first = r.t_us;
+		}
+		last = r.t_us;
+		s.push_back({ r.t_us - first, r.data });
+		if(is_stream_end(r.data)){
+			out.push_back(s);
+			s.clear();
+		}
+	}
+	if(!s.empty()){
+		out.push_back(s);
+	}
+	size_t packets = 0;
+	for(const stream &x : out){
+		packets += x.size();
+	}
+	fprintf(stderr, "Loaded %zu streams, %zu packets from %s\n", out.size(), packets, path.c_str());
+	return !out.empty();
+}
+
+// Queues a stream for one client, applying rate, loss and jitter.  Returns
+// the nominal end time.
+static uint64_t schedule(size_t ci, const stream &s, uint64_t start_us)
+{
+	std::uniform_real_distribution<double> pct(0.0, 100.0);
+	std::uniform_int_distribution<int> jit(0, opt.jitter_ms * 1000);
+	const uint32_t id = rng();
+	uint64_t end = start_us;
+	for(const timed_packet &tp : s){
+		const uint64_t due = start_us + (uint64_t)(tp.offset_us / opt.rate);
+		end = due;
+		if((opt.loss > 0.0) && (pct(rng) < opt.loss)){
+			clients[ci].dropped++;
+			continue;
+		}
+		pending p;
+		p.due_us = due + (opt.jitter_ms ? jit(rng) : 0);
+		p.order = queue_order++;
+		p.client = ci;
+		p.data = tp.data;
+		restamp(p.data, id);
+		queue.push(p);
+	}
+	return end;
+}
+
+static void tx_stream_done(client &c)
+{
+	if(!c.tx_active){
+		return;
+	}
+	const double secs = (c.tx_last_us - c.tx_start_us) / 1e6;
+	fprintf(stderr, "%s TX stream: %u packets in %.2f s, interval jitter %.2f ms, latest packet %.2f ms late\n",
+			addr_str(c.addr).c_str(), c.tx_frames, secs, c.tx_jitter_us / 1000.0, c.tx_late_max_us / 1000.0);
+	if(opt.parrot && !c.tx_stream.empty()){
+		schedule(&c - clients.data(), c.tx_stream, now_us() + 500000);
+	}
+	c.tx_active = false;
+	c.tx_stream.clear();
+}
+
+// RFC 3550 style interarrival jitter against the mode's frame period, plus
+// the largest delay past the packet's ideal send time.
+static void tx_stream_packet(client &c, const packet &p, uint64_t now)
+{
+	const double period = opt.mode->frame_ms * 1000.0;
+	if(!c.tx_active){
+		c.tx_active = true;
+		c.tx_start_us = now;
+		c.tx_frames = 0;
+		c.tx_jitter_us = 0;
+		c.tx_late_max_us = 0;
+	}
+	else{
+		const double d = (double)(now - c.tx_last_us) - period;
+		c.tx_jitter_us += (std::abs(d) - c.tx_jitter_us) / 16.0;
+		const double late = (double)(now - c.tx_start_us) - c.tx_frames * period;
+		if(late > c.tx_late_max_us){
+			c.tx_late_max_us = late;
+		}
+	}
+	c.tx_frames++;
+	c.tx_last_us = now;
+	if(opt.parrot){
+		c.tx_stream.push_back({ now - c.tx_start_us, p });
+	}
+	if(is_stream_end(p)){
+		tx_stream_done(c);
+	}
+}
+
+static void link(client &c)
+{
+	if(!c.linked){
+		fprintf(stderr, "%s linked\n", addr_str(c.addr).c_str());
+	}
+	c.linked = true;
+}
+
+static void unlink(client &c)
+{
+	if(c.linked){
+		fprintf(stderr, "%s unlinked\n", addr_str(c.addr).c_str());
+	}
+	c.linked = false;
+}
+
+static void handle_packet(client &c, const packet &p)
+{
+	const uint8_t *b = p.data();
+	const size_t n = p.size();
+	char r[32];
+
+	switch(opt.mode->mode){
+	case MODE_M17:
+		if((n == 11) && !memcmp(b, "CONN", 4)){
+			send_to(c, "ACKN", 4);
+			link(c);
+		}
+		else if((n == 10) && !memcmp(b, "DISC", 4)){
+			memcpy(r, "DISC", 4);
+			m17_encode_callsign(opt.name, (uint8_t *)r + 4);
+			send_to(c, r, 10);
+			unlink(c);
+		}
+		break;
+	case MODE_DMR:
+		if((n == 8) && !memcmp(b, "RPTL", 4)){
+			memcpy(r, "RPTACK", 6);
+			const uint32_t salt = rng();
+			memcpy(r + 6, &salt, 4);
+			send_to(c, r, 10);
+		}
+		else if(((n == 40) && !memcmp(b, "RPTK", 4)) || ((n == 302) && !memcmp(b, "RPTC", 4)) || ((n > 8) && !memcmp(b, "RPTO", 4))){
+			memcpy(r, "RPTACK", 6);
+			memcpy(r + 6, b + 4, 4);
+			send_to(c, r, 10);
+			if(b[3] == 'C'){
+				link(c);
+			}
+		}
+		else if((n == 11) && !memcmp(b, "RPTPING", 7)){
+			memcpy(r, "MSTPONG", 7);
+			memcpy(r + 7, b + 7, 4);
+			send_to(c, r, 11);
+		}
+		else if((n >= 5) && !memcmp(b, "RPTCL", 5)){
+			unlink(c);
+		}
+		break;
+	case MODE_YSF:
+		if((n == 14) && !memcmp(b, "YSFP", 4)){
+			memcpy(r, "YSFP", 4);
+			put_field((uint8_t *)r + 4, opt.name, 10);
+			send_to(c, r, 14);
+			link(c);
+		}
+		else if((n == 14) && !memcmp(b, "YSFU", 4)){
+			unlink(c);
+		}
+		break;
+	case MODE_P25:
+		if((n == 11) && (b[0] == 0xf0)){
+			send_to(c, p);
+			link(c);
+		}
+		else if((n == 11) && (b[0] == 0xf1)){
+			unlink(c);
+		}
+		break;
+	case MODE_NXDN:
+		if((n == 17) && !memcmp(b, "NXDNP", 5)){
+			send_to(c, p);
+			link(c);
+		}
+		else if((n == 17) && !memcmp(b, "NXDNU", 5)){
+			unlink(c);
+		}
+		break;
+	case MODE_REF:
+		if((n == 5) && (b[0] == 0x05) && (b[2] == 0x18)){
+			send_to(c, p);
+			if(b[4] == 0x00){
+				unlink(c);
+			}
+		}
+		else if((n == 28) && (b[0] == 0x1c) && (b[1] == 0xc0)){
+			const uint8_t ok[8] = {0x08, 0xc0, 0x04, 0x00, 'O', 'K', 'R', 'W'};
+			send_to(c, (const char *)ok, 8);
+			link(c);
+		}
+		break;
+	case MODE_XRF:
+		if((n == 11) && (b[9] != ' ')){
+			memcpy(r, b, 10);
+			memcpy(r + 10, "ACK", 4);
+			send_to(c, r, 14);
+			link(c);
+		}
+		else if((n == 11) && (b[9] == ' ')){
+			unlink(c);
+		}
+		break;
+	case MODE_DCS:
+		if(n == 519){
+			memcpy(r, b, 10);
+			memcpy(r + 10, "ACK", 4);
+			send_to(c, r, 14);
+			link(c);
+		}
+		else if((n == 19) && (b[9] == ' ')){
+			unlink(c);
+		}
+		break;
+	}
+
+	if(c.linked && is_stream_packet(p)){
+		tx_stream_packet(c, p, now_us());
+	}
+}
+
+static void send_keepalive(client &c)
+{
+	char r[32];
+	switch(opt.mode->mode){
+	case MODE_M17:
+		memcpy(r, "PING", 4);
+		m17_encode_callsign(opt.name, (uint8_t *)r + 4);
+		send_to(c, r, 10);
+		break;
+	case MODE_REF:
+		send_to(c, "\x03\x60\x00", 3);
+		break;
+	case MODE_XRF:
+		put_field((uint8_t *)r, opt.name, 8);
+		r[8] = 0;
+		send_to(c, r, 9);
+		break;
+	case MODE_DCS:
+		memset(r, 0, 22);
+		put_field((uint8_t *)r, opt.name, 8);
+		send_to(c, r, 22);
+		break;
+	default:
+		break;
+	}
+}
+
+static size_t find_client(const sockaddr_in &a)
+{
+	for(size_t i = 0; i < clients.size(); ++i){
+		if((clients[i].addr.sin_addr.s_addr == a.sin_addr.s_addr) && (clients[i].addr.sin_port == a.sin_port)){
+			return i;
+		}
+	}
+	client c = client();
+	c.addr = a;
+	clients.push_back(c);
+	return clients.size() - 1;
+}
+
+static void print_totals()
+{
+	fprintf(stderr, "%-22s %10s %10s %10s\n", "client", "received", "sent", "dropped");
+	for(const client &c : clients){
+		fprintf(stderr, "%-22s %10llu %10llu %10llu\n", addr_str(c.addr).c_str(), (unsigned long long)c.rx_packets, (unsigned long long)c.tx_packets, (unsigned long long)c.dropped);
+	}
+}
+
+static bool parse_args(int argc, char *argv[])
+{
+	for(int i = 1; i < argc; ++i){
+		const std::string arg = argv[i];
+		const bool has = (i + 1 < argc);
+		if((arg == "--mode") && has){
+			const std::string m = argv[++i];
+			for(const mode_def &d : modes){
+				if(m == d.name){
+					opt.mode = &d;
+				}
+			}
+		}
+		else if((arg == "--port") && has){
+			opt.port = atoi(argv[++i]);
+		}
+		else if((arg == "--name") && has){
+			opt.name = argv[++i];
+		}
+		else if((arg == "--module") && has){
+			opt.module = argv[++i][0];
+		}
+		else if((arg == "--streams") && has){
+			opt.streams = atoi(argv[++i]);
+		}
+		else if((arg == "--frames") && has){
+			opt.frames = std::max(2, atoi(argv[++i]));
+		}
+		else if((arg == "--inject") && has){
+			opt.inject = argv[++i];
+		}
+		else if(arg == "--inject-tx"){
+			opt.inject_tx = true;
+		}
+		else if((arg == "--loops") && has){
+			opt.loops = atoi(argv[++i]);
+		}
+		else if((arg == "--gap") && has){
+			opt.gap_ms = atoi(argv[++i]);
+		}
+		else if((arg == "--delay") && has){
+			opt.delay_ms = atoi(argv[++i]);
+		}
+		else if((arg == "--rate") && has){
+			opt.rate = atof(argv[++i]);
+		}
+		else if((arg == "--loss") && has){
+			opt.loss = atof(argv[++i]);
+		}
+		else if((arg == "--jitter") && has){
+			opt.jitter_ms = atoi(argv[++i]);
+		}
+		else if((arg == "--seed") && has){
+			opt.seed = strtoul(argv[++i], nullptr, 10);
+		}
+		else if(arg == "--parrot"){
+			opt.parrot = true;
+		}
+		else if((arg == "--record") && has){
+			opt.record = argv[++i];
+		}
+		else{
+			return false;
+		}
+	}
+	return (opt.mode != nullptr) && (opt.rate > 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+	if(!parse_args(argc, argv)){
+		fprintf(stderr, "usage: %s --mode m17|dmr|ysf|p25|nxdn|ref|xrf|dcs [--port n] [--name s] [--module c]\n"
+						"       [--streams n] [--frames n] [--inject file [--inject-tx] [--loops n]] [--gap ms] [--delay ms]\n"
+						"       [--rate x] [--loss pct] [--jitter ms] [--seed n] [--parrot] [--record file]\n", argv[0]);
+		return 2;
+	}
+	if(!opt.port){
+		opt.port = opt.mode->port;
+	}
+	rng.seed(opt.seed);
+
+	std::vector<stream> program;
+	if(!opt.inject.empty()){
+		if(!load_capture(opt.inject, program)){
+			return 1;
+		}
+	}
+	else if(opt.streams){
+		program.resize(1);
+		make_synthetic(program[0]);
+	}
+	const int plays = opt.inject.empty() ? opt.streams : opt.loops * (int)program.size();
+
+	if(!opt.record.empty() && !capture.open_write(opt.record, opt.mode->capname)){
+		return 1;
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(opt.port);
+	if((sock < 0) || (bind(sock, (sockaddr *)&local, sizeof(local)) < 0)){
+		perror("bind");
+		return 1;
+	}
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	fprintf(stderr, "Mock %s reflector %s on UDP port %u\n", opt.mode->capname, opt.name.c_str(), opt.port);
+
+	run_start_us = now_us();
+	uint64_t next_stream_us = 0;
+	uint64_t next_keepalive_us = 0;
+	int played = 0;
+	uint8_t buf[2048];
+
+	while(!g_stop){
+		uint64_t now = now_us();
+
+		while(!queue.empty() && (queue.top().due_us <= now)){
+			const pending &p = queue.top();
+			if(clients[p.client].linked){
+				send_to(clients[p.client], p.data);
+			}
+			queue.pop();
+		}
+
+		if(opt.mode->keepalive_ms && (now >= next_keepalive_us)){
+			for(client &c : clients){
+				if(c.linked){
+					send_keepalive(c);
+				}
+			}
+			next_keepalive_us = now + opt.mode->keepalive_ms * 1000ULL;
+		}
+
+		bool any_linked = false;
+		for(client &c : clients){
+			if(c.linked && (now - c.last_us > 30000000ULL)){
+				fprintf(stderr, "%s timed out\n", addr_str(c.addr).c_str());
+				unlink(c);
+			}
+			if(c.tx_active && (now - c.tx_last_us > 1000000ULL)){
+				tx_stream_done(c);
+			}
+			any_linked |= c.linked;
+		}
+
+		if(any_linked && !program.empty() && ((plays < 0) || (played < plays))){
+			if(!next_stream_us){
+				next_stream_us = now + opt.delay_ms * 1000ULL;
+			}
+			else if(now >= next_stream_us){
+				const stream &s = program[played % program.size()];
+				uint64_t end = now;
+				for(size_t i = 0; i < clients.size(); ++i){
+					if(clients[i].linked){
+						end = schedule(i, s, now);
+					}
+				}
+				++played;
+				next_stream_us = end + opt.gap_ms * 1000ULL;
+			}
+		}
+
+		int timeout = 10;
+		if(!queue.empty()){
+			const int64_t d = ((int64_t)queue.top().due_us - (int64_t)now) / 1000;
+			timeout = (d < 0) ? 0 : ((d < timeout) ? (int)d : timeout);
+		}
+		pollfd pfd = { sock, POLLIN, 0 };
+		if(poll(&pfd, 1, timeout) <= 0){
+			continue;
+		}
+
+		sockaddr_in from;
+		socklen_t fromlen = sizeof(from);
+		ssize_t n;
+		while((n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr *)&from, &fromlen)) > 0){
+			client &c = clients[find_client(from)];
+			const packet p(buf, buf + n);
+			c.last_us = now_us();
+			c.rx_packets++;
+			if(capture.is_open()){
+				capture.write(FrameCapture::UdpTx, p.data(), p.size());
+			}
+			handle_packet(c, p);
+			fromlen = sizeof(from);
+		}
+	}
+
+	print_totals();
+	capture.close();
+	close(sock);
+	return 0;
+}
@@ -0,0 +1,27 @@
+# Local mock reflector for protocol load and regression tests.
+# Build with: cd tools/mockreflector && qmake && make
+TEMPLATE = app
+TARGET = mockreflector
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O2
+INCLUDEPATH += ../..
+
+SOURCES += \
+        mockreflector.cpp \
+        ../../CRCenc.cpp \
+        ../../Golay24128.cpp \
+        ../../YSFConvolution.cpp \
+        ../../YSFFICH.cpp \
+        ../../framecapture.cpp \
+        ../../logger.cpp \
+        ../../viterbi.cpp
+
+HEADERS += \
+	../../CRCenc.h \
+	../../Golay24128.h \
+	../../YSFConvolution.h \
+	../../YSFFICH.h \
+	../../framecapture.h \
+	../../logger.h \
+	../../viterbi.h
@@ -0,0 +1,142 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "viterbi.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VITERBI_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VITERBI_NEON 1
+#endif
+
+// Butterfly i feeds states 2i and 2i+1 from states i and i+8:
+//   new[2i]   = min(old[i] + bm, old[i+8] + (m - bm)),  decision = took old[i+8]
+//   new[2i+1] = min(old[i] + (m - bm), old[i+8] + bm)
+// A tie picks old[i+8], as the original scalar code did.  The survivor
+// metric grows by at most m per step; with m <= 28 (soft symbols) and the
+// longest block at 244 steps that stays below 2^15, so 16 bit lanes never
+// overflow and signed and unsigned compares agree.
+void viterbi_acs16(uint16_t *metrics, uint64_t *dp, const uint8_t *sym, unsigned int n, const uint8_t *bt1, const uint8_t *bt2, uint16_t m)
+{
+#if defined(VITERBI_SSE2)
+	const __m128i b1 = _mm_setr_epi16(bt1[0], bt1[1], bt1[2], bt1[3], bt1[4], bt1[5], bt1[6], bt1[7]);
+	const __m128i b2 = _mm_setr_epi16(bt2[0], bt2[1], bt2[2], bt2[3], bt2[4], bt2[5], bt2[6], bt2[7]);
+	const __m128i vm = _mm_set1_epi16(m);
+	__m128i lo = _mm_loadu_si128((const __m128i *)metrics);
+	__m128i hi = _mm_loadu_si128((const __m128i *)(metrics + 8));
+
+	for(unsigned int k = 0; k < n; ++k){
+		const __m128i s0 = _mm_set1_epi16(sym[2*k]);
+		const __m128i s1 = _mm_set1_epi16(sym[2*k+1]);
+		const __m128i bm = _mm_add_epi16(_mm_sub_epi16(_mm_max_epi16(b1, s0), _mm_min_epi16(b1, s0)),
+		                                 _mm_sub_epi16(_mm_max_epi16(b2, s1), _mm_min_epi16(b2, s1)));
+		const __m128i ibm = _mm_sub_epi16(vm, bm);
+
+		const __m128i m1a = _mm_add_epi16(hi, ibm);
+		const __m128i m1b = _mm_add_epi16(hi, bm);
+		const __m128i na = _mm_min_epi16(_mm_add_epi16(lo, bm), m1a);
+		const __m128i nb = _mm_min_epi16(_mm_add_epi16(lo, ibm), m1b);
+		const __m128i da = _mm_cmpeq_epi16(na, m1a);
+		const __m128i db = _mm_cmpeq_epi16(nb, m1b);
+
+		lo = _mm_unpacklo_epi16(na, nb);
+		hi = _mm_unpackhi_epi16(na, nb);
+		const __m128i d = _mm_packs_epi16(_mm_unpacklo_epi16(da, db), _mm_unpackhi_epi16(da, db));
+		dp[k] = (uint16_t)_mm_movemask_epi8(d);
+	}
+	_mm_storeu_si128((__m128i *)metrics, lo);
+	_mm_storeu_si128((__m128i *)(metrics + 8), hi);
+#elif defined(VITERBI_NEON)
+	const uint16_t weights[8] = { 1U, 4U, 16U, 64U, 256U, 1024U, 4096U, 16384U };
+	const uint16x8_t wa = vld1q_u16(weights);
+	const uint16x8_t wb = vshlq_n_u16(wa, 1);
+	uint16_t t1[8], t2[8];
+	for(int i = 0; i < 8; ++i){
+		t1[i] = bt1[i];
+		t2[i] = bt2[i];
+	}
+	const uint16x8_t b1 = vld1q_u16(t1);
+	const uint16x8_t b2 = vld1q_u16(t2);
+	const uint16x8_t vm = vdupq_n_u16(m);
+	uint16x8_t lo = vld1q_u16(metrics);
+	uint16x8_t hi = vld1q_u16(metrics + 8);
+
+	for(unsigned int k = 0; k < n; ++k){
+		const uint16x8_t bm = vaddq_u16(vabdq_u16(b1, vdupq_n_u16(sym[2*k])), vabdq_u16(b2, vdupq_n_u16(sym[2*k+1])));
+		const uint16x8_t ibm = vsubq_u16(vm, bm);
+
+		const uint16x8_t m1a = vaddq_u16(hi, ibm);
+		const uint16x8_t m1b = vaddq_u16(hi, bm);
+		const uint16x8_t na = vminq_u16(vaddq_u16(lo, bm), m1a);
+		const uint16x8_t nb = vminq_u16(vaddq_u16(lo, ibm), m1b);
+		// decision bits 2i from da, 2i+1 from db
+		const uint16x8_t d = vorrq_u16(vandq_u16(vceqq_u16(na, m1a), wa), vandq_u16(vceqq_u16(nb, m1b), wb));
+		const uint64x2_t s = vpaddlq_u32(vpaddlq_u16(d));
+		dp[k] = vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1);
+
+		const uint16x8x2_t z = vzipq_u16(na, nb);
+		lo = z.val[0];
+		hi = z.val[1];
+	}
+	vst1q_u16(metrics, lo);
+	vst1q_u16(metrics + 8, hi);
+#else
+	// branch metrics for every symbol value up front, symbols are small
+	// (0-2 hard, 0-14 soft) so a table indexed by value beats abs() per step
+	uint16_t bmt1[16][8], bmt2[16][8];
+	for(int s = 0; s < 16; ++s){
+		for(unsigned int i = 0; i < 8U; ++i){
+			bmt1[s][i] = std::abs(bt1[i] - s);
+			bmt2[s][i] = std::abs(bt2[i] - s);
+		}
+	}
+
+	uint16_t buf[16];
+	uint16_t *old = metrics;
+	uint16_t *cur = buf;
+	for(unsigned int k = 0; k < n; ++k){
+		const uint16_t *bm1 = bmt1[sym[2*k] & 15];
+		const uint16_t *bm2 = bmt2[sym[2*k+1] & 15];
+		uint64_t dec = 0U;
+
+		for(unsigned int i = 0; i < 8U; ++i){
+			const uint16_t bm = bm1[i] + bm2[i];
+			uint16_t m0 = old[i] + bm;
+			uint16_t m1 = old[i + 8U] + (m - bm);
+			cur[2*i] = (m0 >= m1) ? m1 : m0;
+			dec |= uint64_t(m0 >= m1) << (2*i);
+
+			m0 = old[i] + (m - bm);
+			m1 = old[i + 8U] + bm;
+			cur[2*i+1] = (m0 >= m1) ? m1 : m0;
+			dec |= uint64_t(m0 >= m1) << (2*i + 1);
+		}
+		dp[k] = dec;
+
+		uint16_t *tmp = old;
+		old = cur;
+		cur = tmp;
+	}
+	if(old != metrics){
+		::memcpy(metrics, old, 16 * sizeof(uint16_t));
+	}
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VITERBI_H
+#define VITERBI_H
+
+#include <cstdint>
+
+// Add-compare-select for the 16 state (K=5) rate 1/2 trellis shared by
+// CM17Convolution and CYSFConvolution.  Runs n trellis steps over the symbol
+// pairs in sym[0..2n-1], updating the 16 path metrics in place and writing
+// one decision word per step to dp.  Symbols range from 0 to 15 (0-2 for
+// hard decisions, 0-14 for soft), bt1/bt2 are the 8 entry branch tables
+// and m the branch metric ceiling (at most 28).  The 8 butterflies of a step
+// are done in one SSE2/NEON register when available; results match the
+// scalar loop.
+void viterbi_acs16(uint16_t *metrics, uint64_t *dp, const uint8_t *sym, unsigned int n, const uint8_t *bt1, const uint8_t *bt2, uint16_t m);
+
+#endif // VITERBI_H
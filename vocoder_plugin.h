@@ -36,4 +36,47 @@ public:
 typedef Vocoder* create_t();
 typedef void destry_t(Vocoder *);
 
+// Version 2 of the plugin ABI, exported as create_v2 / destroy_v2 next to
+// (or instead of) the version 1 create symbol.  One VocoderV2 instance is
+// shared by every stream in the process; each stream gets its own opaque
+// state from open(), and calls on different states may run concurrently.
+// decode() and encode() convert a batch of frames per call: pcm holds 160
+// samples per frame, codec 9 bytes per frame for the 72 bit rates and 7 for
+// 2450.  Both return the number of frames converted.
+
+#define VOCODER_ABI_VERSION 2
+
+enum {
+	VOCODER_RATE_2400x1200 = 0x01,	// D-STAR
+	VOCODER_RATE_2450x1150 = 0x02,	// DMR
+	VOCODER_RATE_2450 = 0x04		// YSF, NXDN
+};
+
+struct VocoderInfo
+{
+	uint32_t abi_version;	// ABI version the plugin implements
+	uint32_t rates;			// VOCODER_RATE_* bits the plugin supports
+	uint32_t max_batch;		// most frames per decode()/encode() call, 0 for no limit
+	const char *name;
+};
+
+struct VocoderState;
+
+class VocoderV2
+{
+public:
+	VocoderV2() {}
+	virtual ~VocoderV2() {}
+	virtual const VocoderInfo *info() const = 0;
+	virtual VocoderState *open(uint32_t rate) = 0;		// nullptr if the rate is not supported
+	virtual void close(VocoderState *state) = 0;
+	virtual int decode(VocoderState *state, int16_t *pcm, const uint8_t *codec, int frames) = 0;
+	virtual int encode(VocoderState *state, uint8_t *codec, const int16_t *pcm, int frames) = 0;
+};
+
+// The host passes the highest ABI version it understands, the plugin returns
+// nullptr if it cannot serve that version.
+typedef VocoderV2* create_v2_t(uint32_t host_abi_version);
+typedef void destroy_v2_t(VocoderV2 *);
+
 #endif // VOCODER_PLUGIN_H
@@ -0,0 +1,251 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <cstring>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#include "vocoderloader.h"
+#include "logger.h"
+
+static int rate_index(uint32_t rate)
+{
+	return (rate == VOCODER_RATE_2400x1200) ? 0 : ((rate == VOCODER_RATE_2450x1150) ? 1 : 2);
+}
+
+static int codec_bytes(uint32_t rate)
+{
+	return (rate == VOCODER_RATE_2450) ? 7 : 9;
+}
+
+VocoderStream::VocoderStream(VocoderV2 *v2, Vocoder *v1, uint32_t max_batch) :
+	m_v2(v2),
+	m_v1(v1),
+	m_max_batch(max_batch)
+{
+	memset(m_state, 0, sizeof(m_state));
+}
+
+VocoderStream::~VocoderStream()
+{
+	for(int i = 0; i < 3; ++i){
+		if(m_state[i]){
+			m_v2->close(m_state[i]);
+		}
+	}
+	if(m_v1){
+		VocoderLoader::instance()->release_v1(m_v1);
+	}
+}
+
+VocoderState *VocoderStream::state(uint32_t rate)
+{
+	const int i = rate_index(rate);
+	if(!m_state[i]){
+		m_state[i] = m_v2->open(rate);
+	}
+	return m_state[i];
+}
+
+// Frames the plugin could not convert come back as silence / zeroed codec
+// bytes, the callers always expect a full buffer.
+int VocoderStream::decode(uint32_t rate, int16_t *pcm, const uint8_t *codec, int frames)
+{
+	const int bytes = codec_bytes(rate);
+	int done = 0;
+
+	if(m_v2){
+		VocoderState *s = state(rate);
+		while(s && (done < frames)){
+			int n = frames - done;
+			if(m_max_batch && (n > (int)m_max_batch)){
+				n = m_max_batch;
+			}
+			const int r = m_v2->decode(s, pcm + (done * 160), codec + (done * bytes), n);
+			if(r <= 0){
+				break;
+			}
+			done += r;
+		}
+	}
+	else{
+		for(; done < frames; ++done){
+			uint8_t *c = const_cast<uint8_t *>(codec + (done * bytes));
+			if(rate == VOCODER_RATE_2400x1200){
+				m_v1->decode_2400x1200(pcm + (done * 160), c);
+			}
+			else if(rate == VOCODER_RATE_2450x1150){
+				m_v1->decode_2450x1150(pcm + (done * 160), c);
+			}
+			else{
+				m_v1->decode_2450(pcm + (done * 160), c);
+			}
+		}
+	}
+	if(done < frames){
+		memset(pcm + (done * 160), 0, (frames - done) * 160 * sizeof(int16_t));
+	}
+	return done;
+}
+
+int VocoderStream::encode(uint32_t rate, uint8_t *codec, const int16_t *pcm, int frames)
+{
+	const int bytes = codec_bytes(rate);
+	int done = 0;
+
+	if(m_v2){
+		VocoderState *s = state(rate);
+		while(s && (done < frames)){
+			int n = frames - done;
+			if(m_max_batch && (n > (int)m_max_batch)){
+				n = m_max_batch;
+			}
+			const int r = m_v2->encode(s, codec + (done * bytes), pcm + (done * 160), n);
+			if(r <= 0){
+				break;
+			}
+			done += r;
+		}
+	}
+	else{
+		for(; done < frames; ++done){
+			int16_t *p = const_cast<int16_t *>(pcm + (done * 160));
+			if(rate == VOCODER_RATE_2400x1200){
+				m_v1->encode_2400x1200(p, codec + (done * bytes));
+			}
+			else if(rate == VOCODER_RATE_2450x1150){
+				m_v1->encode_2450x1150(p, codec + (done * bytes));
+			}
+			else{
+				m_v1->encode_2450(p, codec + (done * bytes));
+			}
+		}
+	}
+	if(done < frames){
+		memset(codec + (done * bytes), 0, (frames - done) * bytes);
+	}
+	return done;
+}
+
+VocoderLoader::VocoderLoader() :
+	m_loaded(false),
+	m_create(nullptr),
+	m_v2(nullptr)
+{
+	memset(&m_info, 0, sizeof(m_info));
+}
+
+VocoderLoader *VocoderLoader::instance()
+{
+	static VocoderLoader loader;
+	return &loader;
+}
+
+// nullptr when there is no usable plugin or it does not do the rate the
+// stream needs.  Version 1 instances are reused once their stream is done
+// with them rather than created per connect.
+VocoderStream *VocoderLoader::open_stream(uint32_t rate)
+{
+	QMutexLocker l(&m_mutex);
+
+	if(!m_loaded && !load()){
+		return nullptr;
+	}
+	if(!(m_info.rates & rate)){
+		DSLOG(Logger::Audio, Logger::Warn, "Vocoder plugin does not support rate 0x%x", (unsigned int)rate);
+		return nullptr;
+	}
+	if(m_v2){
+		return new VocoderStream(m_v2, nullptr, m_info.max_batch);
+	}
+	Vocoder *v = m_v1free.isEmpty() ? m_create() : m_v1free.takeLast();
+	if(!v){
+		return nullptr;
+	}
+	return new VocoderStream(nullptr, v, 1);
+}
+
+void VocoderLoader::release_v1(Vocoder *v)
+{
+	QMutexLocker l(&m_mutex);
+	m_v1free.append(v);
+}
+
+// Called with m_mutex held.  The library handle is never closed, the plugin
+// stays loaded for the life of the process.
+bool VocoderLoader::load()
+{
+	QString config_path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+#if !defined(Q_OS_ANDROID) && !defined(Q_OS_WIN)
+	config_path += "/dudetronics";
+#endif
+#if defined(Q_OS_ANDROID)
+	QString voc = config_path + "/vocoder_plugin." + QSysInfo::productType() + "." + QSysInfo::currentCpuArchitecture();
+#else
+	QString voc = config_path + "/vocoder_plugin." + QSysInfo::kernelType() + "." + QSysInfo::currentCpuArchitecture();
+#endif
+#if !defined(Q_OS_WIN)
+	void *lib = dlopen(voc.toLocal8Bit(), RTLD_LAZY);
+	if (!lib) {
+		DSLOG(Logger::Audio, Logger::Info, "Cannot load library: %s", dlerror());
+		return false;
+	}
+	create_v2_t *create_v2 = (create_v2_t *)dlsym(lib, "create_v2");
+	destroy_v2_t *destroy_v2 = (destroy_v2_t *)dlsym(lib, "destroy_v2");
+	create_t *create = (create_t *)dlsym(lib, "create");
+#else
+	HINSTANCE lib = LoadLibrary(reinterpret_cast<LPCWSTR>(voc.utf16()));
+	if (lib == NULL) {
+		return false;
+	}
+	create_v2_t *create_v2 = (create_v2_t *)GetProcAddress(lib, "create_v2");
+	destroy_v2_t *destroy_v2 = (destroy_v2_t *)GetProcAddress(lib, "destroy_v2");
+	create_t *create = (create_t *)GetProcAddress(lib, "create");
+#endif
+
+	if(create_v2){
+		VocoderV2 *v = create_v2(VOCODER_ABI_VERSION);
+		const VocoderInfo *info = v ? v->info() : nullptr;
+		if(info && (info->abi_version >= 2) && (info->abi_version <= VOCODER_ABI_VERSION) && info->rates){
+			m_v2 = v;
+			m_info = *info;
+			DSLOG(Logger::Audio, Logger::Info, "%s loaded, ABI %u %s", qPrintable(voc), (unsigned int)m_info.abi_version, m_info.name ? m_info.name : "");
+			m_loaded = true;
+			return true;
+		}
+		DSLOG(Logger::Audio, Logger::Warn, "%s offers no compatible v2 interface", qPrintable(voc));
+		if(v && destroy_v2){
+			destroy_v2(v);
+		}
+	}
+	if(!create){
+		DSLOG(Logger::Audio, Logger::Warn, "Cannot load symbol create from %s", qPrintable(voc));
+		return false;
+	}
+	m_create = create;
+	m_info.abi_version = 1;
+	m_info.rates = VOCODER_RATE_2400x1200 | VOCODER_RATE_2450x1150 | VOCODER_RATE_2450;
+	m_info.max_batch = 1;
+	m_info.name = nullptr;
+	DSLOG(Logger::Audio, Logger::Info, "%s loaded", qPrintable(voc));
+	m_loaded = true;
+	return true;
+}
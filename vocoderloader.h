@@ -0,0 +1,77 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VOCODERLOADER_H
+#define VOCODERLOADER_H
+
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include "vocoder_plugin.h"
+
+class VocoderLoader;
+
+// One stream's view of the software vocoder plugin.  With a version 2
+// plugin it holds a state per rate on the shared plugin instance; a version
+// 1 plugin has its state inside the Vocoder object, so the stream gets an
+// instance of its own and batches are converted a frame at a time.
+class VocoderStream
+{
+public:
+	~VocoderStream();
+	int decode(uint32_t rate, int16_t *pcm, const uint8_t *codec, int frames);
+	int encode(uint32_t rate, uint8_t *codec, const int16_t *pcm, int frames);
+	void decode_2400x1200(int16_t *pcm, uint8_t *codec) { decode(VOCODER_RATE_2400x1200, pcm, codec, 1); }
+	void decode_2450x1150(int16_t *pcm, uint8_t *codec) { decode(VOCODER_RATE_2450x1150, pcm, codec, 1); }
+	void decode_2450(int16_t *pcm, uint8_t *codec) { decode(VOCODER_RATE_2450, pcm, codec, 1); }
+	void encode_2400x1200(int16_t *pcm, uint8_t *codec) { encode(VOCODER_RATE_2400x1200, codec, pcm, 1); }
+	void encode_2450x1150(int16_t *pcm, uint8_t *codec) { encode(VOCODER_RATE_2450x1150, codec, pcm, 1); }
+	void encode_2450(int16_t *pcm, uint8_t *codec) { encode(VOCODER_RATE_2450, codec, pcm, 1); }
+private:
+	friend class VocoderLoader;
+	VocoderStream(VocoderV2 *v2, Vocoder *v1, uint32_t max_batch);
+	VocoderState *state(uint32_t rate);
+	VocoderV2 *m_v2;
+	Vocoder *m_v1;
+	uint32_t m_max_batch;
+	VocoderState *m_state[3];
+};
+
+// Process wide loader for the software vocoder plugin.  The library is
+// opened once and kept; a plugin exporting create_v2 is asked for the ABI
+// version this build speaks and used through VocoderV2, otherwise the
+// version 1 create symbol is used.  A failed load is retried on the next
+// open_stream() so a plugin downloaded at run time is picked up.
+class VocoderLoader
+{
+public:
+	static VocoderLoader *instance();
+	VocoderStream *open_stream(uint32_t rate);
+private:
+	friend class VocoderStream;
+	VocoderLoader();
+	bool load();
+	void release_v1(Vocoder *);
+	QMutex m_mutex;
+	bool m_loaded;
+	create_t *m_create;
+	VocoderV2 *m_v2;
+	VocoderInfo m_info;
+	QList<Vocoder *> m_v1free;
+};
+
+#endif // VOCODERLOADER_H
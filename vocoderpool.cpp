@@ -0,0 +1,260 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "vocoderpool.h"
+#include "logger.h"
+
+VocoderChannel::VocoderChannel(QString protocol, int rate) :
+	m_protocol(protocol),
+	m_rate(rate),
+	m_packet_size((rate == SerialAMBE::RATE_2450) ? 7 : 9),
+	m_decode_gain(1.0),
+	m_dev(nullptr),
+	m_ch(0),
+	m_pcmq(160 * 16),
+	m_ambeq(9 * 16)
+{
+}
+
+void VocoderChannel::decode(uint8_t *ambe)
+{
+	QMetaObject::invokeMethod(this, "send_decode", Qt::QueuedConnection, Q_ARG(QByteArray, QByteArray((const char *)ambe, m_packet_size)));
+}
+
+void VocoderChannel::encode(int16_t *pcm)
+{
+	QMetaObject::invokeMethod(this, "send_encode", Qt::QueuedConnection, Q_ARG(QByteArray, QByteArray((const char *)pcm, 160 * sizeof(int16_t))));
+}
+
+// The rings are cleared from the consumer side here, the requests still
+// queued on the device are dropped on the pool thread.
+void VocoderChannel::clear_queue()
+{
+	m_pcmq.clear();
+	m_ambeq.clear();
+	QMetaObject::invokeMethod(this, "send_clear", Qt::QueuedConnection);
+}
+
+bool VocoderChannel::get_audio(int16_t *pcm)
+{
+	if(m_pcmq.read(pcm, 160, false) != 160){
+		return false;
+	}
+	if(m_decode_gain != 1.0){
+		for(int i = 0; i < 160; ++i){
+			pcm[i] = qBound(-32768, (int)(pcm[i] * m_decode_gain), 32767);
+		}
+	}
+	return true;
+}
+
+bool VocoderChannel::get_ambe(uint8_t *ambe)
+{
+	return m_ambeq.read(ambe, m_packet_size, false) == m_packet_size;
+}
+
+void VocoderChannel::send_decode(QByteArray a)
+{
+	if(m_dev){
+		m_dev->decode(m_ch, (const uint8_t *)a.constData());
+	}
+}
+
+void VocoderChannel::send_encode(QByteArray a)
+{
+	if(m_dev){
+		m_dev->encode(m_ch, (const int16_t *)a.constData());
+	}
+}
+
+void VocoderChannel::send_clear()
+{
+	if(m_dev){
+		m_dev->clear_queue(m_ch);
+	}
+}
+
+void VocoderChannel::deliver_audio(const int16_t *pcm)
+{
+	m_pcmq.write(pcm, 160);
+}
+
+void VocoderChannel::deliver_ambe(const uint8_t *ambe, int len)
+{
+	m_ambeq.write(ambe, len);
+	emit data_ready();
+}
+
+VocoderPool::VocoderPool()
+{
+	qRegisterMetaType<VocoderChannel *>("VocoderChannel*");
+	m_thread = new QThread;
+	moveToThread(m_thread);
+	m_thread->start();
+}
+
+VocoderPool *VocoderPool::instance()
+{
+	static VocoderPool *pool = new VocoderPool;
+	return pool;
+}
+
+// Rate each protocol runs the AMBE chip at, the same table SerialAMBE used
+// when it was configured per connection.
+int VocoderPool::rate_for(QString protocol)
+{
+	if(protocol == "DMR"){
+		return SerialAMBE::RATE_2450x1150;
+	}
+	else if( (protocol == "YSF") || (protocol == "NXDN") ){
+		return SerialAMBE::RATE_2450;
+	}
+	else if( (protocol == "REF") || (protocol == "XRF") || (protocol == "DCS") ){
+		return SerialAMBE::RATE_2400x1200;
+	}
+	return SerialAMBE::RATE_NONE;
+}
+
+VocoderChannel *VocoderPool::acquire(QString protocol, QString ports)
+{
+	const int rate = rate_for(protocol);
+	bool ok = false;
+
+	if(rate == SerialAMBE::RATE_NONE){
+		return nullptr;
+	}
+	VocoderChannel *c = new VocoderChannel(protocol, rate);
+	c->moveToThread(m_thread);
+	QMetaObject::invokeMethod(this, "attach", (QThread::currentThread() == m_thread) ? Qt::DirectConnection : Qt::BlockingQueuedConnection,
+							  Q_RETURN_ARG(bool, ok), Q_ARG(QString, ports), Q_ARG(VocoderChannel*, c));
+	if(!ok){
+		DSLOG(Logger::Ambe, Logger::Info, "VocoderPool: no free hardware channel for %s", qPrintable(protocol));
+		c->deleteLater();
+		return nullptr;
+	}
+	return c;
+}
+
+void VocoderPool::release(VocoderChannel *c)
+{
+	QMetaObject::invokeMethod(this, "detach", (QThread::currentThread() == m_thread) ? Qt::DirectConnection : Qt::BlockingQueuedConnection,
+							  Q_ARG(VocoderChannel*, c));
+	c->deleteLater();
+}
+
+bool VocoderPool::attach(QString ports, VocoderChannel *c)
+{
+	QStringList l = ports.split(',') + QString::fromLocal8Bit(qgetenv("DROIDSTAR_VOCODERS")).split(',');
+	open_ports(l);
+	return bind(c);
+}
+
+void VocoderPool::detach(VocoderChannel *c)
+{
+	if(c->m_dev){
+		c->m_dev->detach(c->m_ch);
+		c->m_dev = nullptr;
+	}
+}
+
+void VocoderPool::open_ports(QStringList l)
+{
+	for(QString p : l){
+		p = p.trimmed();
+		bool open = (p == "");
+		for(SerialAMBE *d : m_devices){
+			if(d->port() == p){
+				open = true;
+			}
+		}
+		if(open){
+			continue;
+		}
+		SerialAMBE *d = new SerialAMBE();
+		if(d->connect_to_serial(p)){
+			connect(d, SIGNAL(device_failed()), this, SLOT(device_failed()));
+			m_devices.append(d);
+			DSLOG(Logger::Ambe, Logger::Info, "VocoderPool: opened %s with %d channels", qPrintable(p), d->channels());
+		}
+		else{
+			delete d;
+		}
+	}
+}
+
+// Least loaded device first, ties go to the one with fewer frames in
+// flight.  Within a device a free channel already running the wanted rate
+// is preferred so it does not have to be reconfigured.
+bool VocoderPool::bind(VocoderChannel *c)
+{
+	SerialAMBE *best = nullptr;
+	int bestch = -1;
+
+	for(SerialAMBE *d : m_devices){
+		if(d->failed() || !d->supports(c->m_rate)){
+			continue;
+		}
+		int ch = -1;
+		for(int i = 0; i < d->channels(); ++i){
+			if(d->owner(i)){
+				continue;
+			}
+			if((ch < 0) || ((d->channel_rate(i) == c->m_rate) && (d->channel_rate(ch) != c->m_rate))){
+				ch = i;
+			}
+		}
+		if(ch < 0){
+			continue;
+		}
+		if(!best || (d->owned() < best->owned()) || ((d->owned() == best->owned()) && (d->in_flight() < best->in_flight()))){
+			best = d;
+			bestch = ch;
+		}
+	}
+	if(!best){
+		return false;
+	}
+	best->attach(bestch, c, c->m_rate);
+	c->m_dev = best;
+	c->m_ch = bestch;
+	DSLOG(Logger::Ambe, Logger::Info, "VocoderPool: %s on %s channel %d", qPrintable(c->m_protocol), qPrintable(best->port()), bestch);
+	return true;
+}
+
+// Moves the streams of a dead device to whatever is left.  A stream that
+// cannot be placed is told through failed() and goes back to software.
+void VocoderPool::device_failed()
+{
+	SerialAMBE *d = qobject_cast<SerialAMBE *>(sender());
+	if(!d){
+		return;
+	}
+	m_devices.removeAll(d);
+	for(int i = 0; i < d->channels(); ++i){
+		VocoderChannel *c = d->owner(i);
+		if(!c){
+			continue;
+		}
+		d->detach(i);
+		c->m_dev = nullptr;
+		if(!bind(c)){
+			DSLOG(Logger::Ambe, Logger::Warn, "VocoderPool: %s lost its hardware vocoder", qPrintable(c->m_protocol));
+			emit c->failed();
+		}
+	}
+	d->deleteLater();
+}
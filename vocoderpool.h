@@ -0,0 +1,94 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VOCODERPOOL_H
+#define VOCODERPOOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include "audioringbuffer.h"
+#include "serialambe.h"
+
+// One stream's share of the hardware vocoders: a single channel of a
+// ThumbDV, DV Dongle or AMBE3003, configured for the stream's rate.  It is
+// used from the codec thread like SerialAMBE used to be; requests are
+// handed to the pool thread and results come back through the rings.  If
+// the device goes away the pool moves the stream to another free channel,
+// and emits failed() when there is none left so the codec can fall back to
+// the software vocoder.
+class VocoderChannel : public QObject
+{
+	Q_OBJECT
+public:
+	VocoderChannel(QString protocol, int rate);
+	bool get_audio(int16_t *);
+	bool get_ambe(uint8_t *);
+	void decode(uint8_t *);
+	void encode(int16_t *);
+	void clear_queue();
+	void set_decode_gain(qreal g){ m_decode_gain = g; }
+	QString protocol() const { return m_protocol; }
+	int rate() const { return m_rate; }
+signals:
+	void data_ready();
+	void failed();
+private slots:
+	void send_decode(QByteArray);
+	void send_encode(QByteArray);
+	void send_clear();
+private:
+	friend class SerialAMBE;
+	friend class VocoderPool;
+	void deliver_audio(const int16_t *);
+	void deliver_ambe(const uint8_t *, int);
+	QString m_protocol;
+	int m_rate;
+	uint8_t m_packet_size;
+	qreal m_decode_gain;
+	SerialAMBE *m_dev;
+	int m_ch;
+	AudioRingBuffer<int16_t> m_pcmq;
+	AudioRingBuffer<uint8_t> m_ambeq;
+};
+
+// Process wide set of hardware vocoders.  The devices live on the pool's own
+// thread so they outlive any one connection and can be shared by several
+// concurrent streams.  acquire() opens the ports it is given (plus any listed
+// in DROIDSTAR_VOCODERS) and hands out the least loaded free channel that
+// can run the protocol's rate, or nullptr when there is none.
+class VocoderPool : public QObject
+{
+	Q_OBJECT
+public:
+	static VocoderPool *instance();
+	static int rate_for(QString protocol);
+	VocoderChannel *acquire(QString protocol, QString ports);
+	void release(VocoderChannel *);
+private slots:
+	bool attach(QString ports, VocoderChannel *);
+	void detach(VocoderChannel *);
+	void device_failed();
+private:
+	VocoderPool();
+	void open_ports(QStringList);
+	bool bind(VocoderChannel *);
+	QThread *m_thread;
+	QList<SerialAMBE *> m_devices;
+};
+
+#endif // VOCODERPOOL_H
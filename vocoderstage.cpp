@@ -0,0 +1,211 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "vocoderstage.h"
+#include "logger.h"
+#include "streamstats.h"
+
+// Frames queued per direction.  At 20 ms a frame this is well past any
+// delay worth keeping, frames beyond it are dropped.
+static const int STAGE_FRAMES = 8;
+static const int MAX_WORKERS = 4;
+
+VocoderStage::VocoderStage(QObject *owner, DecodeFn decode, EncodeFn encode) :
+	m_owner(owner),
+	m_decode(decode),
+	m_encode(encode),
+	m_in(STAGE_FRAMES),
+	m_out(STAGE_FRAMES),
+	m_notified(false)
+{
+	m_worker = VocoderWorker::assign(this);
+}
+
+// Returns once the worker is no longer inside process() for this stage, so
+// the decode and encode functions can be torn down after it.
+VocoderStage::~VocoderStage()
+{
+	m_worker->remove(this);
+}
+
+// Blocks until the worker has processed every frame submitted so far, for
+// callers that cannot afford to lose frames to a full ring.
+void VocoderStage::wait()
+{
+	m_worker->wait(this);
+}
+
+bool VocoderStage::decode(const uint8_t *codec, int len, float gain, int flags)
+{
+	Frame f;
+	f.us = 0;
+	f.gain = gain;
+	f.op = DECODE;
+	f.flags = flags;
+	f.len = (len > (int)sizeof(f.codec)) ? sizeof(f.codec) : len;
+	memcpy(f.codec, codec, f.len);
+	return submit(f);
+}
+
+bool VocoderStage::encode(const int16_t *pcm, int samples, int flags)
+{
+	Frame f;
+	f.us = 0;
+	f.gain = 1.0f;
+	f.op = ENCODE;
+	f.flags = flags;
+	f.len = (samples > 320) ? 320 : samples;
+	memcpy(f.pcm, pcm, f.len * sizeof(int16_t));
+	return submit(f);
+}
+
+// A full ring counts an overflow and the frame is lost.
+bool VocoderStage::submit(const Frame &f)
+{
+	if(m_in.write(&f, 1) == 0){
+		return false;
+	}
+	m_worker->wake();
+	return true;
+}
+
+// Codec thread.  The notified flag is cleared before the ring is read so a
+// frame finished meanwhile always gets a fresh vocoder_ready().
+bool VocoderStage::get(Frame &f)
+{
+	m_notified.store(false, std::memory_order_release);
+	return m_out.read(&f, 1, false) == 1;
+}
+
+// Worker thread.  For a decode the result has the samples in pcm, their
+// count in len and the time spent in the decoder in us, for an encode the
+// codec bytes in codec and their count in len.
+bool VocoderStage::process()
+{
+	Frame f;
+	bool done = false;
+
+	while(m_in.read(&f, 1, false) == 1){
+		if(f.op == DECODE){
+			const int64_t start = StreamStats::now_us();
+			f.len = m_decode(f.pcm, f.codec, f.flags);
+			f.us = (int32_t)(StreamStats::now_us() - start);
+			if(f.gain != 1.0f){
+				for(int i = 0; i < f.len; ++i){
+					f.pcm[i] = (int16_t)(f.pcm[i] * f.gain);
+				}
+			}
+		}
+		else{
+			f.len = m_encode(f.codec, f.pcm, f.flags);
+		}
+		m_out.write(&f, 1);
+		done = true;
+	}
+	if(done && !m_notified.exchange(true, std::memory_order_acq_rel)){
+		QMetaObject::invokeMethod(m_owner, "vocoder_ready", Qt::QueuedConnection);
+	}
+	return done;
+}
+
+VocoderWorker::VocoderWorker() :
+	m_current(nullptr),
+	m_pending(false),
+	m_quit(false)
+{
+	start(QThread::HighPriority);
+}
+
+// Puts the stage on the worker with the fewest streams.  The pool is sized
+// on first use to leave a core for the codec and audio threads.
+VocoderWorker *VocoderWorker::assign(VocoderStage *s)
+{
+	static std::mutex lock;
+	static std::vector<VocoderWorker *> workers;
+	std::lock_guard<std::mutex> l(lock);
+
+	if(workers.empty()){
+		const int n = qBound(1, QThread::idealThreadCount() - 1, MAX_WORKERS);
+		for(int i = 0; i < n; ++i){
+			workers.push_back(new VocoderWorker);
+		}
+		DSLOG(Logger::Audio, Logger::Info, "VocoderWorker: started %d vocoder threads", n);
+	}
+	VocoderWorker *best = workers[0];
+	size_t load = (size_t)-1;
+	for(VocoderWorker *w : workers){
+		std::lock_guard<std::mutex> wl(w->m_mutex);
+		if(w->m_stages.size() < load){
+			best = w;
+			load = w->m_stages.size();
+		}
+	}
+	std::lock_guard<std::mutex> wl(best->m_mutex);
+	best->m_stages.push_back(s);
+	return best;
+}
+
+void VocoderWorker::remove(VocoderStage *s)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for(auto it = m_stages.begin(); it != m_stages.end(); ++it){
+		if(*it == s){
+			m_stages.erase(it);
+			break;
+		}
+	}
+	m_idle.wait(lock, [this, s]{ return m_current != s; });
+}
+
+// m_current is set before process() takes a frame from the input ring and
+// cleared after the results are written, so an empty ring with the stage not
+// current means every frame has been through.
+void VocoderWorker::wait(VocoderStage *s)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this, s]{ return (m_current != s) && (s->m_in.available() == 0); });
+}
+
+void VocoderWorker::wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending = true;
+	}
+	m_cv.notify_one();
+}
+
+// The lock is only held to pick the next stage, never while a frame is
+// converted, so wake() from a codec thread does not wait on a vocoder.
+void VocoderWorker::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while(!m_quit){
+		m_cv.wait(lock, [this]{ return m_pending || m_quit; });
+		m_pending = false;
+		for(size_t i = 0; i < m_stages.size(); ++i){
+			m_current = m_stages[i];
+			lock.unlock();
+			m_current->process();
+			lock.lock();
+			m_current = nullptr;
+			m_idle.notify_all();
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/*
+	Copyright (C) 2019-2021 Doug McLain
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VOCODERSTAGE_H
+#define VOCODERSTAGE_H
+
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "audioringbuffer.h"
+
+// Software vocoder work of one stream, run off the codec thread.  The codec
+// thread submits frames into a lock free ring, a VocoderWorker decodes or
+// encodes them in order and puts the results into a second ring, then calls
+// vocoder_ready() on the owner through a queued call so the codec thread can
+// collect them.  The decode and encode functions only ever run on the
+// worker, so any vocoder state they use needs no locking as long as the
+// codec thread leaves it alone.  Both rings are bounded; a frame that does
+// not fit is dropped rather than letting latency grow.
+class VocoderStage
+{
+public:
+	// flags is passed through from the submitting call, e.g. to pick a
+	// rate.  Decode returns the number of samples written, encode the
+	// number of codec bytes.
+	typedef std::function<int(int16_t *pcm, const uint8_t *codec, int flags)> DecodeFn;
+	typedef std::function<int(uint8_t *codec, const int16_t *pcm, int flags)> EncodeFn;
+	enum {
+		DECODE,
+		ENCODE
+	};
+	// us is the time spent in the decode function, filled in by the worker.
+	struct Frame {
+		int32_t us;
+		float gain;
+		uint8_t op;
+		uint8_t flags;
+		uint16_t len;
+		uint8_t codec[16];
+		int16_t pcm[320];
+	};
+	VocoderStage(QObject *owner, DecodeFn decode, EncodeFn encode);
+	~VocoderStage();
+	bool decode(const uint8_t *codec, int len, float gain, int flags);
+	bool encode(const int16_t *pcm, int samples, int flags);
+	bool get(Frame &f);
+	void wait();
+	uint32_t dropped() const { return m_in.overflows() + m_out.overflows(); }
+private:
+	friend class VocoderWorker;
+	bool submit(const Frame &f);
+	bool process();
+	QObject *m_owner;
+	DecodeFn m_decode;
+	EncodeFn m_encode;
+	AudioRingBuffer<Frame> m_in;
+	AudioRingBuffer<Frame> m_out;
+	std::atomic<bool> m_notified;
+	class VocoderWorker *m_worker;
+};
+
+// One thread of the worker pool.  Stages are spread over the workers when
+// they are created and stay on theirs, which keeps each ring single
+// producer / single consumer.
+class VocoderWorker : public QThread
+{
+	Q_OBJECT
+public:
+	static VocoderWorker *assign(VocoderStage *s);
+	void remove(VocoderStage *s);
+	void wait(VocoderStage *s);
+	void wake();
+protected:
+	void run() override;
+private:
+	VocoderWorker();
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_idle;
+	std::vector<VocoderStage *> m_stages;
+	VocoderStage *m_current;
+	bool m_pending;
+	bool m_quit;
+};
+
+#endif // VOCODERSTAGE_H
@@ -32,25 +32,13 @@ XRFCodec::~XRFCodec()
 {
 }
 
-void XRFCodec::process_udp()
+void XRFCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
-	QHostAddress sender;
-	quint16 senderPort;
 	static bool sd_sync = 0;
 	static int sd_seq = 0;
 	static char user_data[21];
 
-	buf.resize(m_udp->pendingDatagramSize());
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::XRF, "RECV", buf.data(), buf.size());
 	if(buf.size() == 9){
 		m_modeinfo.count++;
 		if( (m_modeinfo.stream_state == STREAM_LOST) || (m_modeinfo.stream_state == STREAM_END) ){
@@ -60,25 +48,18 @@ void XRFCodec::process_udp()
 
 	if( (m_modeinfo.status == CONNECTING) && (buf.size() == 14) && (!memcmp(buf.data()+10, "ACK", 3)) ){
 		m_modeinfo.status = CONNECTED_RW;
-		m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-		if(m_vocoder != ""){
-			m_hwrx = true;
-			m_hwtx = true;
-			m_modeinfo.hw_vocoder_loaded = true;
-			m_ambedev = new SerialAMBE("XRF");
-			m_ambedev->connect_to_serial(m_vocoder);
-			connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-		}
+		m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2400x1200);
+		open_hw_vocoder("XRF");
 		if(m_modemport != ""){
 			m_modem = new SerialModem("XRF");
 			m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 			m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 			m_modem->connect_to_serial(m_modemport);
-			connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+			connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 		}
-		m_rxtimer = new QTimer();
+		m_rxtimer = new MediaTimer(this);
 		connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
-		m_txtimer = new QTimer();
+		m_txtimer = new MediaTimer(this);
 		connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 		m_ping_timer = new QTimer();
 		connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
@@ -90,7 +71,7 @@ void XRFCodec::process_udp()
 	if((buf.size() == 56) && (!memcmp(buf.data(), "DSVT", 4)) ){
 		uint16_t streamid = (buf.data()[12] << 8) | (buf.data()[13] & 0xff);
 		if( (m_modeinfo.streamid != 0) && (streamid != m_modeinfo.streamid) ){
-			qDebug() << "New header received before timeout";
+			DSLOG(Logger::XRF, Logger::Info, "New header received before timeout");
 			m_modeinfo.streamid = 0;
 			m_audio->stop_playback();
 		}
@@ -108,6 +89,7 @@ void XRFCodec::process_udp()
 			m_modeinfo.streamid = streamid;
 			m_modeinfo.stream_state = STREAM_NEW;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
+			stats_start(20, 21);
 
 			if(!m_rxtimer->isActive()){
 				m_audio->start_playback();
@@ -128,13 +110,10 @@ void XRFCodec::process_udp()
 				memcpy(out + 30, m_modeinfo.src.toLocal8Bit().data(), 8);
 				memcpy(out + 38, buf.data() + 50, 4);
 				CCRC::addCCITT161((uint8_t *)out + 3, 41);
-				for(int i = 0; i < 44; ++i){
-					m_rxmodemq.append(out[i]);
-				}
-				//m_modem->write(out);
+				m_modem->write(QByteArray((char *)out, 44));
 			}
 
-			qDebug() << "New stream from " << m_modeinfo.src << " to " << m_modeinfo.dst << " id == " << QString::number(m_modeinfo.streamid, 16);
+			DSLOG(Logger::XRF, Logger::Info, "New stream from %s to %s id == %x", qPrintable(m_modeinfo.src), qPrintable(m_modeinfo.dst), m_modeinfo.streamid);
 			emit update(m_modeinfo);
 		}
 		m_rxwatchdog = 0;
@@ -144,7 +123,7 @@ void XRFCodec::process_udp()
 		m_rxwatchdog = 0;
 		uint16_t streamid = (buf.data()[12] << 8) | (buf.data()[13] & 0xff);
 		if( (streamid != m_modeinfo.streamid) ){
-			qDebug() << "New data packet received before timeout";
+			DSLOG(Logger::XRF, Logger::Info, "New data packet received before timeout");
 			m_modeinfo.streamid = streamid;
 			if(!m_rxtimer->isActive()){
 				m_audio->start_playback();
@@ -157,6 +136,7 @@ void XRFCodec::process_udp()
 				m_rxtimer->start(m_rxtimerint);
 			}
 			m_modeinfo.stream_state = STREAM_NEW;
+			stats_start(20, 21);
 		}
 		else{
 			m_modeinfo.stream_state = STREAMING;
@@ -165,25 +145,24 @@ void XRFCodec::process_udp()
 		m_modeinfo.frame_number = buf.data()[14];
 
 		if(m_modeinfo.frame_number & 0x40){
-			qDebug() << "XRF RX stream ended ";
+			DSLOG(Logger::XRF, Logger::Info, "XRF RX stream ended");
 			m_rxwatchdog = 0;
 			m_modeinfo.stream_state = STREAM_END;
 			m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 			emit update(m_modeinfo);
 			m_modeinfo.streamid = 0;
 			if(m_modem){
-				m_rxmodemq.append(0xe0);
-				m_rxmodemq.append(3);
-				m_rxmodemq.append(MMDVM_DSTAR_EOT);
+				const char eot[3] = { (char)MMDVM_FRAME_START, 3, MMDVM_DSTAR_EOT };
+				m_modem->write(QByteArray(eot, 3));
 			}
 		}
 		else if(m_modem){
-			m_rxmodemq.append(MMDVM_FRAME_START);
-			m_rxmodemq.append(15);
-			m_rxmodemq.append(MMDVM_DSTAR_DATA);
-			for(int i = 0; i < 12; ++i){
-				m_rxmodemq.append(buf.data()[15+i]);
-			}
+			QByteArray out;
+			out.append((char)MMDVM_FRAME_START);
+			out.append(15);
+			out.append(MMDVM_DSTAR_DATA);
+			out.append(buf.constData() + 15, 12);
+			m_modem->write(out);
 		}
 
 		if((buf.data()[14] == 0) && (buf.data()[24] == 0x55) && (buf.data()[25] == 0x2d) && (buf.data()[26] == 0x16)){
@@ -237,6 +216,7 @@ void XRFCodec::process_udp()
 			sd_seq = 0;
 			m_modeinfo.usertxt = QString(user_data);
 		}
+		stats_rx(buf.data()[14] & 0x1f);
 		for(int i = 0; i < 9; ++i){
 			m_rxcodecq.append(buf.data()[15+i]);
 		}
@@ -255,16 +235,9 @@ void XRFCodec::hostname_lookup(QHostInfo i)
 		out.append(11);
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::XRF, "CONN", out.data(), out.size());
 	}
 }
 
@@ -275,14 +248,7 @@ void XRFCodec::send_ping()
 	out.append(8 - m_modeinfo.callsign.size(), ' ');
 	out.append('\x00');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::XRF, "PING", out.data(), out.size());
 }
 
 void XRFCodec::send_disconnect()
@@ -294,14 +260,7 @@ void XRFCodec::send_disconnect()
 	out.append(' ');
 	out.append('\x00');
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::XRF, "SEND", out.data(), out.size());
 }
 
 void XRFCodec::format_callsign(QString &s)
@@ -393,22 +352,19 @@ void XRFCodec::transmit()
 	}
 	if(m_hwtx){
 		m_ambedev->encode(pcm);
-		if(m_tx && (m_txcodecq.size() >= 9)){
-			for(int i = 0; i < 9; ++i){
-				ambe[i] = m_txcodecq.dequeue();
-			}
-			send_frame(ambe);
-		}
-		else if(!m_tx){
-			send_frame(ambe);
-		}
 	}
 	else{
-		if(m_modeinfo.sw_vocoder_loaded){
-			m_mbevocoder->encode_2400x1200(pcm, ambe);
+		sw_encode(pcm, 160);
+	}
+	if(m_tx && (m_txcodecq.size() >= 9)){
+		for(int i = 0; i < 9; ++i){
+			ambe[i] = m_txcodecq.dequeue();
 		}
 		send_frame(ambe);
 	}
+	else if(!m_tx){
+		send_frame(ambe);
+	}
 }
 
 void XRFCodec::send_frame(uint8_t *ambe)
@@ -551,14 +507,7 @@ void XRFCodec::send_frame(uint8_t *ambe)
 	m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
 	emit update_output_level(m_audio->level());
 	update(m_modeinfo);
-#ifdef DEBUG
-	fprintf(stderr, "SEND:%d: ", txdata.size());
-	for(int i = 0; i < txdata.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)txdata.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::XRF, "SEND", txdata.data(), txdata.size());
 }
 
 void XRFCodec::get_ambe()
@@ -578,7 +527,7 @@ void XRFCodec::process_rx_data()
 	uint8_t ambe[9];
 
 	if(m_rxwatchdog++ > 100){
-		qDebug() << "XRF RX stream timeout ";
+		DSLOG(Logger::XRF, Logger::Info, "XRF RX stream timeout");
 		m_rxwatchdog = 0;
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
@@ -586,17 +535,6 @@ void XRFCodec::process_rx_data()
 		m_modeinfo.streamid = 0;
 	}
 
-	if(m_rxmodemq.size() > 2){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == MMDVM_FRAME_START) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-	}
-
 	if((!m_tx) && (m_rxcodecq.size() > 8) ){
 		for(int i = 0; i < 9; ++i){
 			ambe[i] = m_rxcodecq.dequeue();
@@ -610,14 +548,7 @@ void XRFCodec::process_rx_data()
 			}
 		}
 		else{
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->decode_2400x1200(pcm, ambe);
-			}
-			else{
-				memset(pcm, 0, 160 * sizeof(int16_t));
-			}
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+			sw_decode(ambe, 9, 1.0f);
 		}
 	}
 	else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -626,7 +557,7 @@ void XRFCodec::process_rx_data()
 		m_rxwatchdog = 0;
 		m_modeinfo.streamid = 0;
 		m_rxcodecq.clear();
-		qDebug() << "XRF playback stopped";
+		DSLOG(Logger::XRF, Logger::Info, "XRF playback stopped");
 		return;
 	}
 }
@@ -34,7 +34,7 @@ private slots:
 	void toggle_tx(bool);
 	void start_tx();
 	void format_callsign(QString &);
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_rx_data();
 	void process_modem_data(QByteArray d);
 	void get_ambe();
@@ -111,56 +111,58 @@ YSFCodec::~YSFCodec()
 {
 }
 
-void YSFCodec::process_udp()
+void YSFCodec::process_udp(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
 	char ysftag[11];
-	buf.resize(m_udp->pendingDatagramSize());
 	int p = 5000;
-	m_udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
-#ifdef DEBUG
-	fprintf(stderr, "RECV: ");
-	for(int i = 0; i < buf.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)buf.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::YSF, "RECV", buf.data(), buf.size());
 	if(((buf.size() == 14) && (m_hostname.left(3) != "FCS")) || ((buf.size() == 7) && (m_hostname.left(3) == "FCS"))){
 		if(m_modeinfo.status == CONNECTING){
 			m_modeinfo.status = CONNECTED_RW;
-			m_txtimer = new QTimer();
+			m_txtimer = new MediaTimer(this);
 			connect(m_txtimer, SIGNAL(timeout()), this, SLOT(transmit()));
 			m_ping_timer = new QTimer();
 			connect(m_ping_timer, SIGNAL(timeout()), this, SLOT(send_ping()));
 			set_fcs_mode(false);
 			//m_mbeenc->set_gain_adjust(2.5);
-			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin();
-			m_rxtimer = new QTimer();
+			// flags 1 selects the full rate IMBE vocoder, 0 the V/D mode AMBE plugin
+			sw_vocoder_start(
+				[this](int16_t *pcm, const uint8_t *codec, int flags) {
+					if(flags){
+						vocoder.decode_4400(pcm, const_cast<uint8_t *>(codec));
+					}
+					else if(m_mbevocoder){
+						m_mbevocoder->decode(VOCODER_RATE_2450, pcm, codec, 1);
+					}
+					else{
+						memset(pcm, 0, 160 * sizeof(int16_t));
+					}
+					return 160;
+				},
+				[this](uint8_t *codec, const int16_t *pcm, int flags) {
+					if(flags){
+						vocoder.encode_4400(const_cast<int16_t *>(pcm), codec);
+						return 11;
+					}
+					memset(codec, 0, 7);
+					if(m_mbevocoder){
+						m_mbevocoder->encode(VOCODER_RATE_2450, codec, pcm, 1);
+					}
+					return 7;
+				});
+			m_modeinfo.sw_vocoder_loaded = load_vocoder_plugin(VOCODER_RATE_2450);
+			m_rxtimer = new MediaTimer(this);
 			connect(m_rxtimer, SIGNAL(timeout()), this, SLOT(process_rx_data()));
 
-			if(m_vocoder != ""){
-				m_hwrx = true;
-				m_hwtx = true;
-				m_modeinfo.hw_vocoder_loaded = true;
-				m_ambedev = new SerialAMBE("YSF");
-				m_ambedev->connect_to_serial(m_vocoder);
-				connect(m_ambedev, SIGNAL(data_ready()), this, SLOT(get_ambe()));
-			}
-			else{
-				m_hwrx = false;
-				m_hwtx = false;
-			}
+			open_hw_vocoder("YSF");
 
 			if(m_modemport != ""){
 				m_modem = new SerialModem("YSF");
 				m_modem->set_modem_flags(m_rxInvert, m_txInvert, m_pttInvert, m_useCOSAsLockout, m_duplex);
 				m_modem->set_modem_params(m_rxfreq, m_txfreq, m_txDelay, m_rxLevel, m_rfLevel, m_ysfTXHang, m_cwIdTXLevel, m_dstarTXLevel, m_dmrTXLevel, m_ysfTXLevel, m_p25TXLevel, m_nxdnTXLevel, m_pocsagTXLevel, m_m17TXLevel);
 				m_modem->connect_to_serial(m_modemport);
-				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(process_modem_data(QByteArray)));
+				connect(m_modem, SIGNAL(modem_data_ready(QByteArray)), this, SLOT(modem_rx(QByteArray)));
 			}
 
 			m_audio = new AudioEngine(m_audioin, m_audioout);
@@ -194,15 +196,13 @@ void YSFCodec::process_udp()
 		m_modeinfo.gw = QString(ysftag);
 		p_data = (uint8_t *)buf.data() + 35;
 		if(m_modem){
-			m_rxmodemq.append(MMDVM_FRAME_START);
-			m_rxmodemq.append(124);
-			m_rxmodemq.append(MMDVM_YSF_DATA);
-			m_rxmodemq.append('\x00');
-
-			for(int i = 0; i < 120; ++i){
-				m_rxmodemq.append(buf.data()[35+i]);
-			}
-			//m_rxmodemq.append(buf.mid(35));
+			QByteArray frame;
+			frame.append((char)MMDVM_FRAME_START);
+			frame.append(124);
+			frame.append(MMDVM_YSF_DATA);
+			frame.append('\x00');
+			frame.append(buf.constData() + 35, 120);
+			m_modem->write(frame);
 		}
 	}
 	else if(buf.size() == 130){
@@ -222,31 +222,36 @@ void YSFCodec::process_udp()
 			m_modeinfo.type = fich.getDT();
 
 			if(m_fi == YSF_FI_HEADER){
+				m_jitter.reset();
+				stats_start(100, m_modeinfo.frame_total + 1);
 				m_modeinfo.stream_state = STREAM_NEW;
 				m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 				if(!m_tx && !m_rxtimer->isActive() ){
 					m_audio->start_playback();
 					m_rxtimer->start(m_rxtimerint);
 				}
-				qDebug() << "New YSF stream from gw" << m_modeinfo.gw;
+				DSLOG(Logger::YSF, Logger::Info, "New YSF stream from gw %s", qPrintable(m_modeinfo.gw));
 			}
 			else if(m_fi == YSF_FI_TERMINATOR){
 				m_modeinfo.stream_state = STREAM_END;
 				m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
-				qDebug() << "YSF stream ended" << m_modeinfo.gw;
+				m_jitter.set_ended();
+				DSLOG(Logger::YSF, Logger::Info, "YSF stream ended %s", qPrintable(m_modeinfo.gw));
 			}
 			else if(YSF_FI_COMMUNICATIONS){
 				if( (m_modeinfo.stream_state == STREAM_END) ||
 					(m_modeinfo.stream_state == STREAM_LOST) ||
 					(m_modeinfo.stream_state == STREAM_IDLE))
 				{
+					m_jitter.reset();
+					stats_start(100, m_modeinfo.frame_total + 1);
 					m_modeinfo.stream_state = STREAM_NEW;
 					m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 					if(!m_tx && !m_rxtimer->isActive() ){
 						m_audio->start_playback();
 						m_rxtimer->start(m_rxtimerint);
 					}
-					qDebug() << "New YSF stream in progress from gw" << m_modeinfo.gw;
+					DSLOG(Logger::YSF, Logger::Info, "New YSF stream in progress from gw %s", qPrintable(m_modeinfo.gw));
 
 				}
 				else{
@@ -254,12 +259,17 @@ void YSFCodec::process_udp()
 				}
 			}
 		}
+		m_jitter.configure(20, (m_modeinfo.type == 3) ? 11 : 7, m_modeinfo.frame_total + 1);
+		if(m_fi == YSF_FI_COMMUNICATIONS){
+			stats_rx(m_modeinfo.frame_number);
+		}
 		if(m_modeinfo.type == 3){
 			decode_vw(p_data);
 		}
 		else{
 			decode_dn(p_data);
 		}
+		update_jitter_info();
 	}
 	emit update(m_modeinfo);
 }
@@ -288,16 +298,9 @@ void YSFCodec::hostname_lookup(QHostInfo i)
 		}
 		m_address = i.addresses().first();
 		m_udp = new QUdpSocket(this);
-		connect(m_udp, SIGNAL(readyRead()), this, SLOT(process_udp()));
+		connect(m_udp, SIGNAL(readyRead()), this, SLOT(drain_udp()));
 		m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "CONN: ");
-		for(int i = 0; i < out.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::YSF, "CONN", out.data(), out.size());
 	}
 }
 
@@ -323,14 +326,7 @@ void YSFCodec::send_ping()
 		out.append(10 - m_modeinfo.callsign.size(), ' ');
 	}
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "PING: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::YSF, "PING", out.data(), out.size());
 }
 
 void YSFCodec::send_disconnect()
@@ -353,20 +349,14 @@ void YSFCodec::send_disconnect()
 		out.append(10 - m_modeinfo.callsign.size(), ' ');
 	}
 	m_udp->writeDatagram(out, m_address, m_modeinfo.port);
-#ifdef DEBUG
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (uint8_t)out.data()[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::YSF, "SEND", out.data(), out.size());
 }
 
 void YSFCodec::decode_vw(uint8_t* data)
 {
 	uint8_t vch[18U];
 	uint8_t imbe[11U];
+	uint8_t frames[5U * 11U];
 	bool bit[144U];
 
 	data += YSF_SYNC_LENGTH_BYTES + YSF_FICH_LENGTH_BYTES;
@@ -416,9 +406,12 @@ void YSFCodec::decode_vw(uint8_t* data)
 		for (unsigned int i = 0U; i < 7U; i++, offset++)
 			WRITE_BIT(imbe, offset, bit[i + 137U]);
 
-		for(int i = 0; i < 11; ++i){
-			m_rxcodecq.append(imbe[i]);
-		}
+		::memcpy(frames + (j * 11U), imbe, 11U);
+	}
+
+	// Header and terminator frames carry no voice
+	if(m_fi == YSF_FI_COMMUNICATIONS){
+		m_jitter.push(m_modeinfo.frame_number, frames, 5, media_ms());
 	}
 }
 
@@ -436,15 +429,15 @@ void YSFCodec::decode_vd1(uint8_t* data, uint8_t *dt)
 	CYSFConvolution conv;
 	conv.start();
 
+	uint8_t sym[360U];
 	for (unsigned int i = 0U; i < 180U; i++) {
 		unsigned int n = INTERLEAVE_TABLE_9_20[i];
-		uint8_t s0 = READ_BIT(dch, n) ? 1U : 0U;
+		sym[2U * i + 0U] = READ_BIT(dch, n) ? 1U : 0U;
 
 		n++;
-		uint8_t s1 = READ_BIT(dch, n) ? 1U : 0U;
-
-		conv.decode(s0, s1);
+		sym[2U * i + 1U] = READ_BIT(dch, n) ? 1U : 0U;
 	}
+	conv.decode(sym, 180U);
 
 	unsigned char output[23U];
 	conv.chainback(output, 176U);
@@ -472,15 +465,15 @@ void YSFCodec::decode_vd2(uint8_t* data, uint8_t *dt)
 	CYSFConvolution conv;
 	conv.start();
 
+	uint8_t sym[200U];
 	for (unsigned int i = 0U; i < 100U; i++) {
 		unsigned int n = INTERLEAVE_TABLE_5_20[i];
-		uint8_t s0 = READ_BIT(dch, n) ? 1U : 0U;
+		sym[2U * i + 0U] = READ_BIT(dch, n) ? 1U : 0U;
 
 		n++;
-		uint8_t s1 = READ_BIT(dch, n) ? 1U : 0U;
-
-		conv.decode(s0, s1);
+		sym[2U * i + 1U] = READ_BIT(dch, n) ? 1U : 0U;
 	}
+	conv.decode(sym, 100U);
 
 	unsigned char output[13U];
 	conv.chainback(output, 96U);
@@ -498,6 +491,7 @@ void YSFCodec::decode_dn(uint8_t* data)
 {
 	uint8_t v_tmp[7U];
 	uint8_t dt[20];
+	uint8_t frames[5U * 7U];
 	::memset(v_tmp, 0, 7U);
 
 	data += YSF_SYNC_LENGTH_BYTES + YSF_FICH_LENGTH_BYTES;
@@ -581,9 +575,12 @@ void YSFCodec::decode_dn(uint8_t* data)
 		if(m_hwrx){
 			interleave(v_tmp);
 		}
-		for(int i = 0; i < 7; ++i){
-			m_rxcodecq.append(v_tmp[i]);
-		}
+		::memcpy(frames + (j * 7U), v_tmp, 7U);
+	}
+
+	// Header and terminator frames carry no voice
+	if(m_fi == YSF_FI_COMMUNICATIONS){
+		m_jitter.push(m_modeinfo.frame_number, frames, 5, media_ms());
 	}
 }
 
@@ -628,24 +625,14 @@ void YSFCodec::process_modem_data(QByteArray d)
 	txdata.append((char *)m_ysfFrame, 155);
 	m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
 	qDebug() << "Sending modem to network.....................................................";
-#ifdef DEBUG
-		fprintf(stderr, "SEND:%d: ", txdata.size());
-		for(int i = 0; i < txdata.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)txdata.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::YSF, "SEND", txdata.data(), txdata.size());
 }
 
 void YSFCodec::transmit()
 {
-	uint8_t ambe_frame[88];
-	uint8_t ambe[7];
 	int16_t pcm[160];
 	uint8_t s = 7;
 
-	memset(ambe, 0, 7);
 #ifdef USE_FLITE
 	if(m_ttsid > 0){
 		for(int i = 0; i < 160; ++i){
@@ -670,25 +657,8 @@ void YSFCodec::transmit()
 		m_ambedev->encode(pcm);
 	}
 	else{
-		if(m_txfullrate){
-			s = 11;
-			vocoder.encode_4400(pcm, ambe_frame);
-		}
-		else{
-			s = 7;
-			if(m_modeinfo.sw_vocoder_loaded){
-				m_mbevocoder->encode_2450(pcm, ambe);
-			}
-		}
-
-		for(int i = 0; i < s; ++i){
-			if(!m_txfullrate){
-				m_txcodecq.append(ambe[i]);
-			}
-			else{
-				m_txcodecq.append(ambe_frame[i]);
-			}
-		}
+		s = m_txfullrate ? 11 : 7;
+		sw_encode(pcm, 160, m_txfullrate ? 1 : 0);
 	}
 	if(m_tx && (m_txcodecq.size() >= (s*5))){
 		for(int i = 0; i < (s*5); ++i){
@@ -718,14 +688,7 @@ void YSFCodec::send_frame()
 		frame_size = ::memcmp(m_ysfFrame, "YSFD", 4) ? 130 : 155;
 		txdata.append((char *)m_ysfFrame, frame_size);
 		m_udp->writeDatagram(txdata, m_address, m_modeinfo.port);
-#ifdef DEBUG
-		fprintf(stderr, "SEND:%d: ", txdata.size());
-		for(int i = 0; i < txdata.size(); ++i){
-			fprintf(stderr, "%02x ", (uint8_t)txdata.data()[i]);
-		}
-		fprintf(stderr, "\n");
-		fflush(stderr);
-#endif
+		DSLOG_HEX(Logger::YSF, "SEND", txdata.data(), txdata.size());
 	}
 	else{
 		fprintf(stderr, "YSF TX stopped\n");
@@ -1222,14 +1185,7 @@ void YSFCodec::writeVDMode2Data(uint8_t* data, const uint8_t* dt)
 
 	uint8_t* p1 = data;
 	uint8_t* p2 = bytes;
-#ifdef SWDEBUG
-	fprintf(stderr, "AMBE: ");
-	for(int i = 0; i < 45; ++i){
-		fprintf(stderr, "%02x ", m_ambe[i]);
-	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
-#endif
+	DSLOG_HEX(Logger::YSF, "AMBE", m_ambe, 45);
 	for (uint32_t i = 0U; i < 5U; i++) {
 		::memcpy(p1, p2, 5U);
 		if(m_hwtx){
@@ -1279,67 +1235,46 @@ void YSFCodec::process_rx_data()
 	int16_t pcm[160];
 	uint8_t ambe[7];
 	uint8_t imbe[11];
-	static uint8_t cnt = 0;
 
 	if(m_rxwatchdog++ > 20){
-		qDebug() << "YSF RX stream timeout ";
+		DSLOG(Logger::YSF, Logger::Info, "YSF RX stream timeout");
+		m_jitter.set_ended();
 		m_modeinfo.stream_state = STREAM_LOST;
 		m_modeinfo.ts = QDateTime::currentMSecsSinceEpoch();
 		emit update(m_modeinfo);
 	}
 
-	if((m_rxmodemq.size() > 2) && (++cnt >= 5)){
-		QByteArray out;
-		int s = m_rxmodemq[1];
-		if((m_rxmodemq[0] == MMDVM_FRAME_START) && (m_rxmodemq.size() >= s)){
-			for(int i = 0; i < s; ++i){
-				out.append(m_rxmodemq.dequeue());
-			}
-			m_modem->write(out);
-		}
-		cnt = 0;
-	}
+	float gain;
+	int r = JitterBuffer::EMPTY;
 
 	if(m_modeinfo.type == 3){
-		if(m_rxcodecq.size() > 10){
-			for(int i = 0; i < 11; ++i){
-				imbe[i] = m_rxcodecq.dequeue();
-			}
-			vocoder.decode_4400(pcm, imbe);
-			m_audio->write(pcm, 160);
-			emit update_output_level(m_audio->level());
+		if((r = m_jitter.pop(imbe, gain)) != JitterBuffer::EMPTY){
+			sw_decode(imbe, 11, (r == JitterBuffer::CONCEALED) ? gain : 1.0f, 1);
 		}
 		else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
 			m_rxtimer->stop();
 			m_audio->stop_playback();
 			m_rxwatchdog = 0;
 			m_modeinfo.streamid = 0;
-			m_rxcodecq.clear();
-			qDebug() << "YSF FR playback stopped";
+			DSLOG(Logger::YSF, Logger::Info, "YSF FR playback stopped, jitter buffer late: %u lost: %u reordered: %u", m_jitter.late(), m_jitter.lost(), m_jitter.reordered());
+			m_jitter.reset();
 		}
 	}
 	else{
-		if((!m_tx) && (m_rxcodecq.size() > 6) ){
-			for(int i = 0; i < 7; ++i){
-				ambe[i] = m_rxcodecq.dequeue();
-			}
+		if((!m_tx) && ((r = m_jitter.pop(ambe, gain)) != JitterBuffer::EMPTY) ){
 			if(m_hwrx){
 				m_ambedev->decode(ambe);
 
 				if(m_ambedev->get_audio(pcm)){
+					if(r == JitterBuffer::CONCEALED){
+						apply_gain(pcm, 160, gain);
+					}
 					m_audio->write(pcm, 160);
 					emit update_output_level(m_audio->level());
 				}
 			}
 			else{
-				if(m_modeinfo.sw_vocoder_loaded){
-					m_mbevocoder->decode_2450(pcm, ambe);
-				}
-				else{
-					memset(pcm, 0, 160 * sizeof(int16_t));
-				}
-				m_audio->write(pcm, 160);
-				emit update_output_level(m_audio->level());
+				sw_decode(ambe, 7, (r == JitterBuffer::CONCEALED) ? gain : 1.0f, 0);
 			}
 		}
 		else if ( (m_modeinfo.stream_state == STREAM_END) || (m_modeinfo.stream_state == STREAM_LOST) ){
@@ -1347,9 +1282,9 @@ void YSFCodec::process_rx_data()
 			m_audio->stop_playback();
 			m_rxwatchdog = 0;
 			m_modeinfo.streamid = 0;
-			m_rxcodecq.clear();
 			//m_ambedev->clear_queue();
-			qDebug() << "YSF VD playback stopped";
+			DSLOG(Logger::YSF, Logger::Info, "YSF VD playback stopped, jitter buffer late: %u lost: %u reordered: %u", m_jitter.late(), m_jitter.lost(), m_jitter.reordered());
+			m_jitter.reset();
 			return;
 		}
 	}
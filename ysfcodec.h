@@ -59,7 +59,7 @@ public:
 	~YSFCodec();
 	void set_fcs_mode(bool y, std::string f = "        "){ m_fcs = y; m_fcsname = f; }
 private slots:
-	void process_udp();
+	void process_udp(const QByteArray &buf);
 	void process_rx_data();
 	void get_ambe();
 	void send_ping();